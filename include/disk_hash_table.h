@@ -0,0 +1,184 @@
+/**
+ * @file disk_hash_table.h
+ * @author SeveraTheDuck
+ * @brief Disk-resident hash table with extendible hashing
+ *
+ * @details
+ * The table is a file of fixed-size pages. The directory of 2^global_depth
+ * page indexes is kept in memory and is indexed by the low bits of the key
+ * hash. When a page is full, only it is split into two pages by one more
+ * hash bit, and the directory is doubled if the page used all its bits.
+ * The pages are read and written through a small page cache with the clock
+ * (second chance) eviction, so the
+ * table may be much larger than the memory.
+ *
+ * The directory is saved after the last page when the table is destructed.
+ */
+
+
+
+#pragma once
+
+
+
+#include "hash_table.h"
+
+
+
+//-----------------------------------------------------------------------------
+// Disk hash table structures
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Disk hash table
+ */
+typedef struct disk_hash_table disk_hash_table;
+
+
+/**
+ * @brief Counters of the page cache
+ */
+typedef
+struct disk_hash_table_stats
+{
+    size_t elem_number;     ///< number of elements in the table
+    size_t pages_number;    ///< number of data pages in the file
+    size_t global_depth;    ///< number of hash bits indexing the directory
+    size_t cache_hits;      ///< pages found in the cache
+    size_t cache_misses;    ///< pages read from the file
+    size_t page_writes;     ///< pages written to the file
+    size_t splits;          ///< pages split
+}
+disk_hash_table_stats;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Disk hash table interface
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Opens the disk hash table, creates the file if it does not exist
+ *
+ * @param filename Name of the file
+ * @param h_func Hash function, must be the same for every opening
+ * @param cache_pages Number of pages in the cache, 0 for the default
+ *
+ * @retval Pointer to the disk hash table
+ * @retval NULL if the file can not be opened or is not a disk hash table
+ * @retval NULL if h_func differs from the one the file was made with
+ * @retval NULL if allocation error occurred
+ */
+disk_hash_table*
+DiskHashTableConstructor (const char* const filename,
+                          hash_function h_func,
+                          const size_t cache_pages);
+
+
+/**
+ * @brief Writes the cached pages and the directory and closes the table
+ *
+ * @param table Pointer to the disk hash table
+ *
+ * @retval NULL
+ */
+disk_hash_table*
+DiskHashTableDestructor (disk_hash_table* const table);
+
+
+/**
+ * @brief Inserts the key and the value into the table
+ *
+ * @param table Pointer to the disk hash table
+ * @param key Key of the inserting element
+ * @param value Value of the inserting element, may be NULL
+ * @param key_cmp A comparator function
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_SUCCESS if such key is already in the table
+ * @retval HASH_TABLE_ERROR if the key and the value do not fit into a page
+ * @retval HASH_TABLE_ERROR if the full page keys and the key have the same low 32 hash bits
+ * @retval HASH_TABLE_ERROR if the file can not be read or written
+ * @retval HASH_TABLE_ERROR if bad input received
+ */
+hash_table_error_status
+DiskHashTableInsert (disk_hash_table*  const table,
+                     hash_table_key*   const key,
+                     hash_table_value* const value,
+                     hash_table_key_comparator key_cmp);
+
+
+/**
+ * @brief Deletes the element with a key equal to the given one
+ *
+ * @param table Pointer to the disk hash table
+ * @param key A key to find
+ * @param key_cmp A comparator function
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_ERROR if key not found
+ * @retval HASH_TABLE_ERROR if the file can not be read or written
+ * @retval HASH_TABLE_ERROR if bad input received
+ *
+ * @note Pages are never merged
+ */
+hash_table_error_status
+DiskHashTableDelete (disk_hash_table* const table,
+                     hash_table_key*  const key,
+                     hash_table_key_comparator key_cmp);
+
+
+/**
+ * @brief Finds the element with a key equal to the given one
+ *
+ * @param table Pointer to the disk hash table
+ * @param key A key to find
+ * @param key_cmp Key comparator function
+ * @param found_value Pointer to save the found value, may be NULL
+ *
+ * @retval HASH_TABLE_SUCCESS if the key is found
+ * @retval HASH_TABLE_ERROR if key not found
+ * @retval HASH_TABLE_ERROR if the file can not be read or written
+ * @retval HASH_TABLE_ERROR if bad input received
+ *
+ * @details The found value points into the page cache and is valid until
+ * the next call with this table
+ */
+hash_table_error_status
+DiskHashTableFind (disk_hash_table* const table,
+                   hash_table_key*  const key,
+                   hash_table_key_comparator key_cmp,
+                   hash_table_value* const found_value);
+
+
+/**
+ * @brief Writes the dirty cached pages to the file
+ *
+ * @param table Pointer to the disk hash table
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_ERROR if the file can not be written
+ * @retval HASH_TABLE_ERROR if bad input received
+ */
+hash_table_error_status
+DiskHashTableFlush (disk_hash_table* const table);
+
+
+/**
+ * @brief Gets the counters of the table
+ *
+ * @param table Pointer to the disk hash table
+ * @param stats Pointer to save the counters
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_ERROR if bad input received
+ */
+hash_table_error_status
+DiskHashTableStats (const disk_hash_table* const table,
+                    disk_hash_table_stats* const stats);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
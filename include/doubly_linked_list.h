@@ -11,6 +11,7 @@
 
 
 #include "list_interface.h"
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -19,6 +20,8 @@
 /**
  * The implementation of doubly linked cycled list using regular nodes
  * @note list_value is allowed to be NULL
+ * @note value field is the last one, LIST_NODE_KEY_ONLY nodes are allocated
+ * without it and must not access it
  */
 
 
@@ -29,17 +32,20 @@
 
 struct list
 {
-    list_node* head;    ///< first node in the list
-    size_t elem_number; ///< number of elements in the list
+    list_node* head;            ///< first node in the list
+    size_t elem_number;         ///< number of elements in the list
+    list_node_layout layout;    ///< layout of the nodes
+    size_t extra_size;          ///< extra bytes after every node
 };
 
 
 struct list_node
 {
     list_key*   key;    ///< key of the node
-    list_value* value;  ///< value of the node
     list_node*  next;   ///< next node in the list
     list_node*  prev;   ///< previous node in the list
+    size_t      hash;   ///< hash of the key, 0 if not given
+    list_value* value;  ///< value of the node, absent in LIST_NODE_KEY_ONLY
 };
 
 
@@ -119,3 +119,82 @@ HashFunctionCrc32 (hash_table_key* const key,
 /** @} */ // end of hash_functions group
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Incremental hashing
+//-----------------------------------------------------------------------------
+/**
+ * @defgroup hash_state
+ *
+ * @brief Computes the hash of a key given by several parts
+ *
+ * @details
+ * @code
+ * hash_state state = {};
+ * HashStateInit   (&state, HashFunctionCrc32);
+ * HashStateUpdate (&state, "hash_", 5);
+ * HashStateUpdate (&state, "table", 5);
+ * HashStateFinal  (&state); // HashFunctionCrc32 ("hash_table", HASH_TABLE_FULL_RANGE)
+ * @endcode
+ * The result can be passed to HashTableInsertHashed() and HashTableFindHashed()
+ *
+ * @{
+ */
+
+/**
+ * @brief State of the incremental hash computation
+ */
+typedef
+struct hash_state
+{
+    hash_function    h_func;    ///< hash function the state computes
+    hash_table_index value;     ///< hash of the characters added so far
+    size_t           length;    ///< number of characters added so far
+}
+hash_state;
+
+
+/**
+ * @brief Prepares the state for a new key
+ *
+ * @param state Hash state
+ * @param h_func Hash function from this file
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_ERROR if the function can not be computed by parts
+ * @retval HASH_TABLE_ERROR if bad input received
+ */
+hash_table_error_status
+HashStateInit (hash_state* const state,
+               hash_function h_func);
+
+
+/**
+ * @brief Adds the next part of the key
+ *
+ * @param state Hash state
+ * @param buffer Part of the key
+ * @param size Number of bytes in the part
+ */
+void
+HashStateUpdate (hash_state* const state,
+                 const void* const buffer,
+                 const size_t size);
+
+
+/**
+ * @brief Gets the hash of all parts added since HashStateInit()
+ *
+ * @param state Hash state
+ *
+ * @retval The same hash as
+ * @code state->h_func (key, HASH_TABLE_FULL_RANGE) @endcode
+ */
+hash_table_index
+HashStateFinal (const hash_state* const state);
+
+/** @} */ // end of hash_state group
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
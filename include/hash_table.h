@@ -10,7 +10,10 @@
 
 
 
+#include "alloc_tracking.h"
 #include "list_interface.h"
+#include <stdint.h>
+#include <stdio.h>
 
 
 
@@ -57,6 +60,49 @@ typedef
 hash_table_index (*hash_function) (hash_table_key* const, const size_t);
 
 
+/**
+ * @brief Number of buckets to pass to a hash function to get the whole hash
+ *
+ * @details Hash functions return the hash modulo number of buckets,
+ * the table computes the whole hash once and takes the bucket index from it
+ */
+#define HASH_TABLE_FULL_RANGE SIZE_MAX
+
+
+/**
+ * @brief Hash table modes, chosen when the table is constructed
+ */
+typedef
+enum hash_table_mode
+{
+    HASH_TABLE_MAP      = 0,    ///< nodes contain keys and values
+    HASH_TABLE_SET      = 1,    ///< nodes contain keys only, values are ignored
+    HASH_TABLE_MULTIMAP = 2     ///< nodes contain keys and arrays of values
+}
+hash_table_mode;
+
+
+/**
+ * @brief Recency list and budget of the LRU table, see HashTableSetLru()
+ */
+typedef struct hash_table_lru hash_table_lru;
+
+
+/**
+ * @brief Timing wheel of the table with expiring keys, see HashTableSetTtl()
+ */
+typedef struct hash_table_ttl hash_table_ttl;
+
+
+/**
+ * @brief A signature for a clock of the expiring keys
+ *
+ * @details Returns current time in ticks, must not decrease
+ */
+typedef
+uint64_t (*hash_table_clock) (void);
+
+
 /**
  * @brief Hash table structure
  *
@@ -69,9 +115,106 @@ struct hash_table
     size_t              buckets_num;    ///< number of buckets
     hash_function       h_func;         ///< hash function
     size_t              elem_number;    ///< total number of elements
+    hash_table_mode     mode;           ///< map, set or multimap
+    size_t              value_size;     ///< size of one multimap value
+    hash_table_lru*     lru;            ///< NULL if not a LRU cache
+    hash_table_ttl*     ttl;            ///< NULL if keys do not expire
+    size_t*             chain_counts;   ///< number of buckets of every length
+    size_t              max_chain;      ///< length of the longest bucket
+    size_t              sum_of_squares; ///< sum of squared bucket lengths
+    alloc_counters      memory;         ///< allocations of the table
+    size_t              changes_number; ///< inserts and deletes made
 } hash_table_t;
 
 
+/**
+ * @brief Number of chain lengths in the histogram of hash_table_stats
+ */
+#define HASH_TABLE_STATS_HISTOGRAM_SIZE 16
+
+
+/**
+ * @brief Operations with measured latency, see HashTableLatencyPercentile()
+ */
+typedef
+enum hash_table_operation
+{
+    HASH_TABLE_OP_INSERT = 0,   ///< HashTableInsert()
+    HASH_TABLE_OP_FIND   = 1,   ///< HashTableFind()
+    HASH_TABLE_OP_DELETE = 2    ///< HashTableDelete()
+}
+hash_table_operation;
+
+
+/**
+ * @brief Parts of the measured operation
+ */
+typedef
+enum hash_table_latency_part
+{
+    HASH_TABLE_LATENCY_HASH  = 0,   ///< hashing the key
+    HASH_TABLE_LATENCY_PROBE = 1,   ///< searching the bucket, allocating, linking
+    HASH_TABLE_LATENCY_TOTAL = 2    ///< whole operation
+}
+hash_table_latency_part;
+
+
+/**
+ * @brief Distribution of the elements over the buckets, see HashTableGetStats()
+ */
+typedef
+struct hash_table_stats
+{
+    size_t elem_number;     ///< total number of elements
+    size_t buckets_number;  ///< number of buckets
+    size_t empty_buckets;   ///< number of buckets without elements
+    size_t max_chain;       ///< length of the longest bucket
+    double load_factor;     ///< elements per bucket
+    double mean_chain;      ///< elements per non-empty bucket
+    double variance;        ///< variance of the bucket lengths
+
+    /// number of buckets of every length, the last one counts longer ones too
+    size_t chain_histogram[HASH_TABLE_STATS_HISTOGRAM_SIZE];
+}
+hash_table_stats;
+
+
+/**
+ * @brief Memory of the table, see HashTableMemoryUsage()
+ */
+typedef
+struct hash_table_memory_usage
+{
+    size_t table_bytes;             ///< table structure, chain counters, LRU, TTL
+    size_t buckets_bytes;           ///< buckets array and bucket lists
+    size_t nodes_bytes;             ///< nodes with their LRU and TTL links
+    size_t keys_bytes;              ///< key structures and key copies
+    size_t values_bytes;            ///< value structures and value copies
+    size_t total_bytes;             ///< all of the above
+    size_t live_blocks;             ///< allocated blocks not freed yet
+    size_t allocations;             ///< blocks allocated since construction
+    size_t frees;                   ///< blocks freed since construction
+    size_t changes_number;          ///< inserts and deletes made
+    double allocations_per_change;  ///< allocations / changes_number
+    double bytes_per_element;       ///< total_bytes / elem_number
+}
+hash_table_memory_usage;
+
+
+/**
+ * @brief Counters of the LRU table
+ */
+typedef
+struct hash_table_lru_stats
+{
+    size_t hits;        ///< finds of the present keys
+    size_t misses;      ///< finds of the absent keys
+    size_t evictions;   ///< nodes deleted to stay within the budget
+    size_t bytes;       ///< bytes taken by the nodes, keys and values
+}
+hash_table_lru_stats;
+
+
 /**
  * @brief A enumeration for for a key comparator function result
  */
@@ -134,6 +277,50 @@ HashTableConstructor (const size_t buckets_number,
                       hash_function h_func);
 
 
+/**
+ * @brief Constructor for hash table structure with the given mode
+ *
+ * @param buckets_number Number of buckets in the hash table
+ * @param h_func Hash function
+ * @param mode HASH_TABLE_MAP or HASH_TABLE_SET
+ *
+ * @retval Pointer to hash_table structure
+ * @retval NULL if allocation error occurred
+ * @retval NULL if hash function is NULL
+ *
+ * @retval NULL if mode is HASH_TABLE_MULTIMAP
+ *
+ * @details The nodes of HASH_TABLE_SET table have no value field,
+ * values given to the insert functions are not copied,
+ * value field of the found nodes must not be accessed
+ */
+hash_table_t*
+HashTableConstructorWithMode (const size_t buckets_number,
+                              hash_function h_func,
+                              const hash_table_mode mode);
+
+
+/**
+ * @brief Constructor for HASH_TABLE_MULTIMAP hash table structure
+ *
+ * @param buckets_number Number of buckets in the hash table
+ * @param h_func Hash function
+ * @param value_size Size of every value in bytes
+ *
+ * @retval Pointer to hash_table structure
+ * @retval NULL if allocation error occurred
+ * @retval NULL if hash function is NULL or value_size is 0
+ *
+ * @details Every key has one node, the insert functions append the value
+ * to the contiguous array of the key values, its capacity is doubled
+ * when full. See HashTableNodeValues().
+ */
+hash_table_t*
+HashTableMultimapConstructor (const size_t buckets_number,
+                              hash_function h_func,
+                              const size_t value_size);
+
+
 /**
  * @brief Destructor for hash table structure
  *
@@ -212,6 +399,9 @@ HashTableValueDestructor (hash_table_value* const value);
  *
  * @details Finds given key in the hash table
  * If the key is not found, inserts node with given key and value
+ * For HASH_TABLE_MULTIMAP table the value is appended to the key values,
+ * its size must be table->value_size
+ * If the key expires, see HashTableInsertTtl(), it keeps its expiration
  */
 hash_table_error_status
 HashTableInsert (hash_table_t*     const table,
@@ -220,6 +410,32 @@ HashTableInsert (hash_table_t*     const table,
                  hash_table_key_comparator key_cmp);
 
 
+/**
+ * @brief Same as HashTableInsert(), but takes the hash of the key
+ *
+ * @param table Hash table to insert into
+ * @param key Key of the inserting node
+ * @param value Value of the inserting node
+ * @param key_cmp A comparator function
+ * @param hash Hash of the key, see HashTableKeyHash()
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_SUCCESS if such key is already in the hash table
+ * @retval HASH_TABLE_ERROR if allocation error occured
+ * @retval HASH_TABLE_ERROR if bad input received
+ *
+ * @details The hash function is not called, the hash must be equal to
+ * @code table->h_func (key, HASH_TABLE_FULL_RANGE) @endcode
+ * for example computed by the hash_state functions while reading the key
+ */
+hash_table_error_status
+HashTableInsertHashed (hash_table_t*     const table,
+                       hash_table_key*   const key,
+                       hash_table_value* const value,
+                       hash_table_key_comparator key_cmp,
+                       const hash_table_index hash);
+
+
 /**
  * @brief Deletes the first node to find with a key equal to the given one
  *
@@ -260,5 +476,374 @@ HashTableFind (hash_table_t*   const table,
                hash_table_key* const key,
                hash_table_key_comparator key_cmp);
 
+
+/**
+ * @brief Same as HashTableDelete(), but takes the hash of the key
+ *
+ * @param table Hash table
+ * @param key A key to find
+ * @param key_cmp A comparator function
+ * @param hash Hash of the key, see HashTableKeyHash()
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_ERROR if bad input received
+ * @retval HASH_TABLE_ERROR if key not found
+ */
+hash_table_error_status
+HashTableDeleteHashed (hash_table_t*   const table,
+                       hash_table_key* const key,
+                       hash_table_key_comparator key_cmp,
+                       const hash_table_index hash);
+
+
+/**
+ * @brief Same as HashTableFind(), but takes the hash of the key
+ *
+ * @param table Hash table
+ * @param key A key to find
+ * @param key_cmp Key comparator function
+ * @param hash Hash of the key, see HashTableKeyHash()
+ *
+ * @retval Pointer to the found node
+ * @retval NULL if node not found
+ * @retval NULL if bad input recieved
+ */
+hash_table_node*
+HashTableFindHashed (hash_table_t*   const table,
+                     hash_table_key* const key,
+                     hash_table_key_comparator key_cmp,
+                     const hash_table_index hash);
+
+
+/**
+ * @brief Finds node with a key equal to the given bytes
+ *
+ * @param table Hash table
+ * @param key_buffer Bytes of the key
+ * @param key_size Number of bytes in the key
+ * @param key_cmp Key comparator function
+ *
+ * @retval Pointer to the found node
+ * @retval NULL if node not found
+ * @retval NULL if bad input recieved
+ *
+ * @details Same as HashTableFind(), but the key is made on the stack and
+ * points to key_buffer, so nothing is allocated or copied
+ */
+hash_table_node*
+HashTableFindBytes (hash_table_t* const table,
+                    const void* const key_buffer,
+                    const size_t key_size,
+                    hash_table_key_comparator key_cmp);
+
+
+/**
+ * @brief Deletes the node with a key equal to the given bytes
+ *
+ * @param table Hash table
+ * @param key_buffer Bytes of the key
+ * @param key_size Number of bytes in the key
+ * @param key_cmp Key comparator function
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_ERROR if bad input received
+ * @retval HASH_TABLE_ERROR if key not found
+ *
+ * @details Same as HashTableDelete(), but nothing is allocated
+ * to make the key
+ */
+hash_table_error_status
+HashTableDeleteBytes (hash_table_t* const table,
+                      const void* const key_buffer,
+                      const size_t key_size,
+                      hash_table_key_comparator key_cmp);
+
+
+/**
+ * @brief Gets the values array of the HASH_TABLE_MULTIMAP node
+ *
+ * @param table HASH_TABLE_MULTIMAP hash table
+ * @param node Node of the table
+ * @param values_number Pointer to save the number of values
+ *
+ * @retval Pointer to the values, table->value_size bytes each
+ * @retval NULL if bad input received
+ *
+ * @note The pointer is invalidated by the next insert of the same key
+ */
+const void*
+HashTableNodeValues (const hash_table_t* const table,
+                     const hash_table_node* const node,
+                     size_t* const values_number);
+
+
+/**
+ * @brief Makes the table a LRU cache with the given budget
+ *
+ * @param table Empty hash table
+ * @param max_elems Maximum number of elements, 0 for no limit
+ * @param max_bytes Maximum bytes taken by the nodes, 0 for no limit
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_ERROR if the table is not empty
+ * @retval HASH_TABLE_ERROR if allocation error occured
+ * @retval HASH_TABLE_ERROR if bad input received
+ *
+ * @details Every node is linked into the recency list, found and
+ * reinserted nodes are moved to its front. Insert beyond the budget
+ * deletes the nodes from the back of the list, all in O(1).
+ * Inserting a node larger than max_bytes fails, so does appending a value
+ * to a multimap node that would make it larger than max_bytes.
+ * Bytes of a node are counted as the node with the key and value structures
+ * and their buffers.
+ */
+hash_table_error_status
+HashTableSetLru (hash_table_t* const table,
+                 const size_t max_elems,
+                 const size_t max_bytes);
+
+
+/**
+ * @brief Gets the counters of the LRU table
+ *
+ * @param table LRU hash table
+ * @param stats Pointer to save the counters
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_ERROR if the table is not a LRU cache
+ * @retval HASH_TABLE_ERROR if bad input received
+ */
+hash_table_error_status
+HashTableLruStats (const hash_table_t* const table,
+                   hash_table_lru_stats* const stats);
+
+
+/**
+ * @brief Allows the keys of the table to expire
+ *
+ * @param table Empty hash table
+ * @param clock Clock to measure the time to live, NULL for milliseconds of
+ * CLOCK_MONOTONIC
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_ERROR if the table is not empty
+ * @retval HASH_TABLE_ERROR if allocation error occured
+ * @retval HASH_TABLE_ERROR if bad input received
+ *
+ * @details The expiring nodes are kept in a hierarchical timing wheel.
+ * Expired nodes are deleted when found, when their key is inserted again,
+ * by a few on every insert and by HashTableExpire() batches.
+ * Nodes inserted without the time to live never expire.
+ * The clock is read once by every insert and HashTableExpire() call and
+ * by the finds of the expiring keys, the finds of the keys without the time
+ * to live do not read it. Only inserts and HashTableExpire() advance
+ * the wheel.
+ */
+hash_table_error_status
+HashTableSetTtl (hash_table_t* const table,
+                 hash_table_clock clock);
+
+
+/**
+ * @brief Same as HashTableInsert(), but the key expires after ttl ticks
+ *
+ * @param table Hash table with expiring keys
+ * @param key Key of the inserting node
+ * @param value Value of the inserting node
+ * @param key_cmp A comparator function
+ * @param ttl Time to live in the clock ticks, 0 for no expiration
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_ERROR if the table keys can not expire
+ * @retval HASH_TABLE_ERROR if allocation error occured
+ * @retval HASH_TABLE_ERROR if bad input received
+ *
+ * @details If the key is already in the table, its time to live is reset,
+ * the value is not changed, ttl 0 makes it never expire
+ */
+hash_table_error_status
+HashTableInsertTtl (hash_table_t*     const table,
+                    hash_table_key*   const key,
+                    hash_table_value* const value,
+                    hash_table_key_comparator key_cmp,
+                    const uint64_t ttl);
+
+
+/**
+ * @brief Deletes the expired nodes
+ *
+ * @param table Hash table with expiring keys
+ * @param max_work Maximum number of nodes to delete or move inside
+ * the timing wheel, 0 for no limit
+ *
+ * @retval Number of deleted nodes
+ *
+ * @details Call it periodically with a small max_work to spread a wave of
+ * expirations over many calls, the next call continues where this one stopped
+ */
+size_t
+HashTableExpire (hash_table_t* const table,
+                 const size_t max_work);
+
+
+/**
+ * @brief Number of bytes asked for one node in the given mode
+ *
+ * @param mode Hash table mode
+ *
+ * @retval Size of the node without the key and the value buffers
+ *
+ * @details The allocator may give more, see HashTableModeSavedBytes()
+ */
+size_t
+HashTableNodeSize (const hash_table_mode mode);
+
+
+/**
+ * @brief Number of node bytes saved per element compared to HASH_TABLE_MAP
+ *
+ * @param mode Hash table mode
+ *
+ * @retval Difference of the usable sizes the allocator gives for the map node
+ * and the mode node, 0 if they are of one size class
+ *
+ * @details With glibc the 32-byte set node and the 40-byte map node are both
+ * 40 usable bytes, so it is 0, the set saves the value structures only
+ */
+size_t
+HashTableModeSavedBytes (const hash_table_mode mode);
+
+
+/**
+ * @brief Computes the whole hash of the key with the table hash function
+ *
+ * @param table Hash table
+ * @param key A key to hash
+ *
+ * @retval Hash to pass to the *Hashed functions
+ * @retval 0 if bad input received
+ */
+hash_table_index
+HashTableKeyHash (const hash_table_t* const table,
+                  hash_table_key* const key);
+
+
+/**
+ * @brief Gets the distribution of the elements over the buckets
+ *
+ * @param table Hash table
+ * @param stats Pointer to save the distribution
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_ERROR if bad input received
+ *
+ * @details The bucket lengths counters and the sum of their squares are
+ * updated by every insertion and deletion, so the buckets are not walked.
+ * $D\ksi = E(\ksi^2) - (E\ksi)^2$, where $\ksi$ is the bucket length
+ */
+hash_table_error_status
+HashTableGetStats (const hash_table_t* const table,
+                   hash_table_stats* const stats);
+
+
+/**
+ * @brief Gets the memory the table has allocated
+ *
+ * @param table Hash table
+ * @param usage Pointer to save the memory usage
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_ERROR if bad input received
+ * @retval HASH_TABLE_ERROR if built without HASH_TABLE_TRACK_ALLOC,
+ * the usage is zeros
+ *
+ * @details Every allocation of the table and its lists is counted when it is
+ * made, see alloc_tracking.h, so the nodes are not walked. The bytes are the
+ * usable sizes of the blocks, the allocator headers are not counted.
+ * A multimap counts the allocations of growing value arrays too.
+ */
+hash_table_error_status
+HashTableMemoryUsage (const hash_table_t* const table,
+                      hash_table_memory_usage* const usage);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Latency instrumentation interface
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Sets how often the operations are measured
+ *
+ * @param period Every period-th operation of every thread is measured
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_ERROR if period is 0
+ * @retval HASH_TABLE_ERROR if built without HASH_TABLE_INSTRUMENT
+ *
+ * @details The latencies are measured only if the table is built with
+ * HASH_TABLE_INSTRUMENT defined, otherwise the operations are not changed.
+ * HashTableInsert(), HashTableFind() and HashTableDelete() are measured,
+ * the *Hashed functions are not. The period is 256 by default.
+ */
+hash_table_error_status
+HashTableLatencySetPeriod (const size_t period);
+
+
+/**
+ * @brief Gets the latency below which the given part of samples is
+ *
+ * @param operation Measured operation
+ * @param part Measured part of the operation
+ * @param percentile Percent of samples, from 0 to 100
+ * @param nanoseconds Pointer to save the latency
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_ERROR if there are no samples
+ * @retval HASH_TABLE_ERROR if built without HASH_TABLE_INSTRUMENT
+ * @retval HASH_TABLE_ERROR if bad input received
+ *
+ * @details The samples are kept in log-bucketed histograms,
+ * so the latency is rounded up by at most 1/16 of it
+ */
+hash_table_error_status
+HashTableLatencyPercentile (const hash_table_operation operation,
+                            const hash_table_latency_part part,
+                            const double percentile,
+                            double* const nanoseconds);
+
+
+/**
+ * @brief Gets the number of measured operations
+ *
+ * @param operation Measured operation
+ *
+ * @retval Number of samples since the last reset
+ * @retval 0 if built without HASH_TABLE_INSTRUMENT
+ */
+size_t
+HashTableLatencySamples (const hash_table_operation operation);
+
+
+/**
+ * @brief Prints the percentiles of every operation and part
+ *
+ * @param file File to print to
+ */
+void
+HashTableLatencyDump (FILE* const file);
+
+
+/**
+ * @brief Deletes all samples
+ *
+ * @details Must not be called while the tables are used by other threads
+ */
+void
+HashTableLatencyReset (void);
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
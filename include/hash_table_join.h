@@ -0,0 +1,95 @@
+/**
+ * @file hash_table_join.h
+ * @author SeveraTheDuck
+ * @brief Parallel joins of two hash tables
+ */
+
+
+
+#pragma once
+
+
+
+#include "hash_table.h"
+
+
+
+//-----------------------------------------------------------------------------
+// Join structures
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Types of the join
+ */
+typedef
+enum hash_table_join_type
+{
+    HASH_TABLE_JOIN_INTERSECT  = 0, ///< keys present in both tables
+    HASH_TABLE_JOIN_DIFFERENCE = 1, ///< keys of the left table only
+    HASH_TABLE_JOIN_UNION      = 2  ///< keys present in any of the tables
+}
+hash_table_join_type;
+
+
+/**
+ * @brief A signature for a join result callback
+ *
+ * @details Takes the node of the left table, the node of the right table,
+ * the index of the thread calling it and the user argument.
+ * The node is NULL if the key is absent in its table.
+ */
+typedef
+void (*hash_table_join_callback) (hash_table_node* const,
+                                  hash_table_node* const,
+                                  const size_t,
+                                  void* const);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Join interface
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Joins two hash tables on the given number of threads
+ *
+ * @param left Left hash table
+ * @param right Right hash table
+ * @param type Type of the join
+ * @param key_cmp Key comparator function
+ * @param threads_number Number of threads, 0 for the number of CPUs
+ * @param callback Function called for every key of the result
+ * @param arg Argument passed to the callback
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_ERROR if the tables have different hash functions
+ * @retval HASH_TABLE_ERROR if allocation error occured
+ * @retval HASH_TABLE_ERROR if bad input received
+ *
+ * @details The nodes of both tables are partitioned by the radix of their
+ * stored hashes, then every partition of the right table is put into a small
+ * open addressing table and probed by the same partition of the left one.
+ * No key is hashed again, keys are compared only if their hashes are equal.
+ *
+ * For HASH_TABLE_JOIN_INTERSECT the callback gets both nodes,
+ * for HASH_TABLE_JOIN_DIFFERENCE it gets the left node and NULL,
+ * for HASH_TABLE_JOIN_UNION it gets both nodes or one of them and NULL.
+ *
+ * @note The callback is called concurrently from all threads with indexes
+ * in [0, threads_number), the tables must not be changed during the join.
+ * Expired nodes not deleted yet are joined too.
+ */
+hash_table_error_status
+HashTableJoin (hash_table_t* const left,
+               hash_table_t* const right,
+               const hash_table_join_type type,
+               hash_table_key_comparator key_cmp,
+               const size_t threads_number,
+               hash_table_join_callback callback,
+               void* const arg);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
@@ -0,0 +1,129 @@
+/**
+ * @file hash_table_probes.h
+ * @author SeveraTheDuck
+ * @brief USDT probes of the hash table operations
+ *
+ * @details
+ * The probes are SystemTap-compatible static tracepoints: every probe is one
+ * nop in the code and a note in the .note.stapsdt section describing its
+ * address and arguments, so perf and bpftrace attach to it in a running
+ * process, for example
+ * @code
+ * bpftrace -e 'usdt:./test_hash_function:hash_table:find_miss
+ *              { @chain = hist (arg1); }'
+ * @endcode
+ *
+ * Probes of the provider hash_table, all arguments are 64-bit:
+ * - insert (key_size, chain_length, bucket_index)
+ * - find_hit (key_size, chain_length, bucket_index)
+ * - find_miss (key_size, chain_length, bucket_index)
+ * - delete (key_size, chain_length, bucket_index)
+ * - bucket_create (bucket_index, buckets_number)
+ *
+ * chain_length is the number of nodes in the bucket before the operation,
+ * all of them are walked by a miss.
+ *
+ * Every probe has a semaphore, the tracer increments it while attached,
+ * so the arguments of a probe nobody traces are not even computed.
+ *
+ * The probes are built on 64-bit ELF x86 and ARM targets unless
+ * HASH_TABLE_NO_PROBES is defined, otherwise they are empty.
+ */
+
+
+
+#pragma once
+
+
+
+#include <stdint.h>
+
+
+
+//-----------------------------------------------------------------------------
+// Probe macros
+//-----------------------------------------------------------------------------
+
+#if defined (__ELF__) && (defined (__x86_64__) || defined (__aarch64__)) && \
+    !defined (HASH_TABLE_NO_PROBES)
+
+/**
+ * @brief Defines the semaphore of the probe, once per program
+ */
+#define HASH_TABLE_PROBE_SEMAPHORE(name)                                    \
+    __attribute__ ((section (".probes"), visibility ("hidden"), used))     \
+    volatile unsigned short hash_table_##name##_semaphore = 0
+
+
+/**
+ * @brief Non-zero if the probe is traced
+ */
+#define HASH_TABLE_PROBE_ENABLED(name)                                      \
+    __builtin_expect (hash_table_##name##_semaphore != 0, 0)
+
+
+/**
+ * @brief Emits the probe site and its note, the arguments are asm operands
+ *
+ * @details Same layout as <sys/sdt.h> makes: the note holds the nop address,
+ * the address of _.stapsdt.base to adjust it for prelinking, the semaphore
+ * address, the provider, the name and the arguments description
+ */
+#define HASH_TABLE_PROBE_ASM(name, arguments, ...)                          \
+    __asm__ __volatile__ (                                                  \
+        "990: nop\n"                                                        \
+        ".pushsection .note.stapsdt,\"?\",\"note\"\n"                       \
+        ".balign 4\n"                                                       \
+        ".4byte 992f-991f, 994f-993f, 3\n"                                  \
+        "991: .asciz \"stapsdt\"\n"                                         \
+        "992: .balign 4\n"                                                  \
+        "993: .8byte 990b\n"                                                \
+        ".8byte _.stapsdt.base\n"                                           \
+        ".8byte hash_table_" #name "_semaphore\n"                           \
+        ".asciz \"hash_table\"\n"                                           \
+        ".asciz \"" #name "\"\n"                                            \
+        ".asciz \"" arguments "\"\n"                                        \
+        "994: .balign 4\n"                                                  \
+        ".popsection\n"                                                     \
+        ".ifndef _.stapsdt.base\n"                                          \
+        ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+        ".weak _.stapsdt.base\n"                                            \
+        ".hidden _.stapsdt.base\n"                                          \
+        "_.stapsdt.base: .space 1\n"                                        \
+        ".size _.stapsdt.base, 1\n"                                         \
+        ".popsection\n"                                                     \
+        ".endif\n"                                                          \
+        :: __VA_ARGS__)
+
+
+/// @brief Probe with two unsigned 64-bit arguments
+#define HASH_TABLE_PROBE2(name, arg1, arg2)                                 \
+    do {                                                                    \
+        if (HASH_TABLE_PROBE_ENABLED (name))                                \
+            HASH_TABLE_PROBE_ASM (name, "8@%0 8@%1",                        \
+                                  "nor" ((uint64_t) (arg1)),                \
+                                  "nor" ((uint64_t) (arg2)));               \
+    } while (0)
+
+
+/// @brief Probe with three unsigned 64-bit arguments
+#define HASH_TABLE_PROBE3(name, arg1, arg2, arg3)                           \
+    do {                                                                    \
+        if (HASH_TABLE_PROBE_ENABLED (name))                                \
+            HASH_TABLE_PROBE_ASM (name, "8@%0 8@%1 8@%2",                   \
+                                  "nor" ((uint64_t) (arg1)),                \
+                                  "nor" ((uint64_t) (arg2)),                \
+                                  "nor" ((uint64_t) (arg3)));               \
+    } while (0)
+
+#else
+
+#define HASH_TABLE_PROBE_SEMAPHORE(name) \
+    typedef int hash_table_##name##_semaphore
+#define HASH_TABLE_PROBE2(name, arg1, arg2) ((void) 0)
+#define HASH_TABLE_PROBE3(name, arg1, arg2, arg3) ((void) 0)
+
+#endif
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
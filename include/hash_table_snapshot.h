@@ -0,0 +1,152 @@
+/**
+ * @file hash_table_snapshot.h
+ * @author SeveraTheDuck
+ * @brief Binary snapshots of hash tables
+ *
+ * @details
+ * The snapshot file is position independent, all its parts are addressed
+ * by offsets from the beginning of the file:
+ * - header with the sizes, the offsets of the parts and a probe hash
+ * - buckets_num + 1 indexes of the first entry of every bucket
+ * - entries with the stored hash, the key and the value offsets and sizes
+ * - key and value bytes, every blob aligned to 8 bytes
+ *
+ * The loaded snapshot is mapped read-only and used in place, nothing is
+ * allocated per node and no key is hashed again.
+ */
+
+
+
+#pragma once
+
+
+
+#include "hash_table.h"
+
+
+
+//-----------------------------------------------------------------------------
+// Snapshot structures
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Loaded snapshot of a hash table
+ */
+typedef struct hash_table_snapshot hash_table_snapshot;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Snapshot interface
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Saves the hash table to the file
+ *
+ * @param table Hash table
+ * @param filename Name of the file, it is rewritten
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_ERROR if the file can not be written
+ * @retval HASH_TABLE_ERROR if bad input received
+ *
+ * @details Saves the nodes of all modes, the multimap values are saved
+ * as one array. LRU and expiration data is not saved.
+ */
+hash_table_error_status
+HashTableSave (const hash_table_t* const table,
+               const char* const filename);
+
+
+/**
+ * @brief Maps the snapshot file read-only
+ *
+ * @param filename Name of the file made by HashTableSave()
+ * @param h_func Hash function of the saved table
+ *
+ * @retval Pointer to the snapshot
+ * @retval NULL if the file can not be mapped or is not a snapshot
+ * @retval NULL if h_func differs from the saved table function
+ * @retval NULL if allocation error occured
+ *
+ * @details Only the header is checked, so loading takes the same time for
+ * any file size. The hash function is checked by the hash of a probe key.
+ */
+hash_table_snapshot*
+HashTableLoad (const char* const filename,
+               hash_function h_func);
+
+
+/**
+ * @brief Unmaps the snapshot
+ *
+ * @param snapshot Pointer to the snapshot
+ *
+ * @retval NULL
+ */
+hash_table_snapshot*
+HashTableSnapshotDestructor (hash_table_snapshot* const snapshot);
+
+
+/**
+ * @brief Finds the key in the snapshot
+ *
+ * @param snapshot Pointer to the snapshot
+ * @param key_buffer Bytes of the key
+ * @param key_size Number of bytes in the key
+ * @param key_cmp Key comparator function, must not change the keys
+ * @param found_key Pointer to save the found key, may be NULL
+ * @param found_value Pointer to save the found value, may be NULL
+ *
+ * @retval HASH_TABLE_SUCCESS if the key is found
+ * @retval HASH_TABLE_ERROR if the key is not found
+ * @retval HASH_TABLE_ERROR if bad input received
+ *
+ * @details The found key and value point into the mapped file and are valid
+ * until the snapshot is destructed. The value is empty for the saved set.
+ */
+hash_table_error_status
+HashTableSnapshotFind (const hash_table_snapshot* const snapshot,
+                       const void* const key_buffer,
+                       const size_t key_size,
+                       hash_table_key_comparator key_cmp,
+                       hash_table_key* const found_key,
+                       hash_table_value* const found_value);
+
+
+/**
+ * @brief Gets the number of elements in the snapshot
+ *
+ * @param snapshot Pointer to the snapshot
+ *
+ * @retval Number of elements
+ * @retval 0 if snapshot is NULL
+ */
+size_t
+HashTableSnapshotSize (const hash_table_snapshot* const snapshot);
+
+
+/**
+ * @brief Makes the hash table with the elements of the snapshot
+ *
+ * @param snapshot Pointer to the snapshot
+ * @param key_cmp Key comparator function
+ *
+ * @retval Pointer to the hash table
+ * @retval NULL if the snapshot entries are broken
+ * @retval NULL if allocation error occured
+ * @retval NULL if bad input received
+ *
+ * @details The table has the saved mode and number of buckets,
+ * the keys are not hashed again. The table can be changed, for example
+ * by replaying the log made after the snapshot.
+ */
+hash_table_t*
+HashTableSnapshotToTable (const hash_table_snapshot* const snapshot,
+                          hash_table_key_comparator key_cmp);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
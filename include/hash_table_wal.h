@@ -0,0 +1,221 @@
+/**
+ * @file hash_table_wal.h
+ * @author SeveraTheDuck
+ * @brief Write-ahead log of hash table changes
+ *
+ * @details
+ * The log is an append-only file of insert and delete records, every record
+ * has a checksum, so the torn tail left by a crash is found and cut off.
+ *
+ * Every change is appended to the log buffer and only then applied to the
+ * table, both under the log mutex. The first caller waiting for its record becomes the leader:
+ * it writes the whole buffer and calls fdatasync() once for the group, while
+ * the next callers fill the other buffer for the next group.
+ *
+ * The table is recovered from the latest snapshot and the log:
+ * @code
+ * hash_table_snapshot* snapshot = HashTableLoad (snapshot_file, h_func);
+ * hash_table_t* table = (snapshot != NULL) ?
+ *     HashTableSnapshotToTable (snapshot, key_cmp) :
+ *     HashTableConstructor (buckets_number, h_func);
+ * HashTableSnapshotDestructor (snapshot);
+ *
+ * HashTableWalReplay (log_file, table, key_cmp, NULL);
+ * hash_table_wal* wal = HashTableWalConstructor (log_file, table, key_cmp,
+ *                                                HASH_TABLE_WAL_SYNC);
+ * @endcode
+ * HashTableWalCompact() saves the new snapshot and empties the log.
+ *
+ * A group that can not be written or synced fails the log: the table keeps
+ * the changes of the group, which may be in the file or not, and every next
+ * change and compaction returns HASH_TABLE_ERROR. The table must be destroyed
+ * with the log and recovered as above.
+ */
+
+
+
+#pragma once
+
+
+
+#include "hash_table.h"
+
+
+
+//-----------------------------------------------------------------------------
+// Write-ahead log structures
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Write-ahead log of one hash table
+ */
+typedef struct hash_table_wal hash_table_wal;
+
+
+/**
+ * @brief When the logged change is returned
+ */
+typedef
+enum hash_table_wal_sync
+{
+    HASH_TABLE_WAL_SYNC    = 0, ///< after fdatasync() of its group
+    HASH_TABLE_WAL_NO_SYNC = 1  ///< after write() of its group
+}
+hash_table_wal_sync;
+
+
+/**
+ * @brief Counters of the log
+ */
+typedef
+struct hash_table_wal_stats
+{
+    size_t records_number;      ///< records appended
+    size_t groups_number;       ///< groups written, one write() each
+    size_t syncs_number;        ///< fdatasync() calls
+    size_t bytes_number;        ///< bytes written
+}
+hash_table_wal_stats;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Write-ahead log interface
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Opens the log for appending the changes of the table
+ *
+ * @param filename Name of the log file, it is created if it does not exist
+ * @param table Hash table, the log must be replayed into it before
+ * @param key_cmp Key comparator function
+ * @param sync When the logged changes are returned
+ *
+ * @retval Pointer to the log
+ * @retval NULL if the file can not be opened
+ * @retval NULL if allocation error occured
+ * @retval NULL if bad input received
+ *
+ * @details While the log functions are called from several threads,
+ * the table must be changed only through the log
+ */
+hash_table_wal*
+HashTableWalConstructor (const char* const filename,
+                         hash_table_t* const table,
+                         hash_table_key_comparator key_cmp,
+                         const hash_table_wal_sync sync);
+
+
+/**
+ * @brief Writes the buffered records and closes the log, the table is kept
+ *
+ * @param wal Pointer to the log
+ *
+ * @retval NULL
+ */
+hash_table_wal*
+HashTableWalDestructor (hash_table_wal* const wal);
+
+
+/**
+ * @brief Inserts the key and the value into the table and logs it
+ *
+ * @param wal Pointer to the log
+ * @param key Key of the inserting node
+ * @param value Value of the inserting node
+ *
+ * @retval HASH_TABLE_SUCCESS if the change is in the table and in the log
+ * @retval HASH_TABLE_ERROR if allocation error occured
+ * @retval HASH_TABLE_ERROR if the log failed, the table must be recovered
+ * @retval HASH_TABLE_ERROR if bad input received
+ *
+ * @details Same as HashTableInsert(), returns when the record group is
+ * written or synced according to the log sync
+ */
+hash_table_error_status
+HashTableWalInsert (hash_table_wal*   const wal,
+                    hash_table_key*   const key,
+                    hash_table_value* const value);
+
+
+/**
+ * @brief Deletes the key from the table and logs it
+ *
+ * @param wal Pointer to the log
+ * @param key A key to delete
+ *
+ * @retval HASH_TABLE_SUCCESS if the change is in the table and in the log
+ * @retval HASH_TABLE_ERROR if key not found, nothing is logged
+ * @retval HASH_TABLE_ERROR if allocation error occured
+ * @retval HASH_TABLE_ERROR if the log failed, the table must be recovered
+ * @retval HASH_TABLE_ERROR if bad input received
+ */
+hash_table_error_status
+HashTableWalDelete (hash_table_wal*  const wal,
+                    hash_table_key*  const key);
+
+
+/**
+ * @brief Saves the table snapshot and empties the log
+ *
+ * @param wal Pointer to the log
+ * @param snapshot_filename Name of the snapshot file
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_ERROR if the snapshot or the log can not be written,
+ * the old snapshot and the log are kept
+ * @retval HASH_TABLE_ERROR if the log failed
+ * @retval HASH_TABLE_ERROR if bad input received
+ *
+ * @details The snapshot is written to a temporary file, synced and renamed,
+ * only then the log is truncated. A crash between the two replays the log
+ * on top of the new snapshot, which gives the same map or set, but appends
+ * the multimap values once more.
+ */
+hash_table_error_status
+HashTableWalCompact (hash_table_wal* const wal,
+                     const char* const snapshot_filename);
+
+
+/**
+ * @brief Applies the records of the log file to the table
+ *
+ * @param filename Name of the log file
+ * @param table Hash table, usually made from the latest snapshot
+ * @param key_cmp Key comparator function
+ * @param records_number Pointer to save the number of applied records,
+ * may be NULL
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_SUCCESS if the file does not exist
+ * @retval HASH_TABLE_ERROR if the file can not be read or truncated
+ * @retval HASH_TABLE_ERROR if allocation error occured
+ * @retval HASH_TABLE_ERROR if bad input received
+ *
+ * @details The file is cut at the first incomplete or broken record
+ */
+hash_table_error_status
+HashTableWalReplay (const char* const filename,
+                    hash_table_t* const table,
+                    hash_table_key_comparator key_cmp,
+                    size_t* const records_number);
+
+
+/**
+ * @brief Gets the counters of the log
+ *
+ * @param wal Pointer to the log
+ * @param stats Pointer to save the counters
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_ERROR if bad input received
+ */
+hash_table_error_status
+HashTableWalStats (hash_table_wal* const wal,
+                   hash_table_wal_stats* const stats);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
@@ -83,6 +83,18 @@ typedef
 list_key_cmp_t (*list_key_cmp)(list_key* const, list_key* const);
 
 
+/**
+ * @brief Layout of the list nodes, chosen when the list is constructed
+ */
+typedef
+enum list_node_layout
+{
+    LIST_NODE_KEY_VALUE = 0,    ///< Nodes contain a key and a value
+    LIST_NODE_KEY_ONLY  = 1     ///< Nodes contain a key only, no value slot
+}
+list_node_layout;
+
+
 /**
  * @brief Possible error status codes
  */
@@ -113,6 +125,38 @@ list_t*
 ListConstructor (void);
 
 
+/**
+ * @brief Constructor for a list structure with the given node layout
+ *
+ * @param layout Layout of the nodes in the list
+ *
+ * @retval Pointer to the list structure
+ * @retval NULL if allocation error occurred
+ *
+ * @details Values passed to the LIST_NODE_KEY_ONLY list are ignored,
+ * they are neither copied nor destructed
+ */
+list_t*
+ListConstructorWithLayout (const list_node_layout layout);
+
+
+/**
+ * @brief Constructor for a list structure with extra bytes in every node
+ *
+ * @param layout Layout of the nodes in the list
+ * @param extra_size Number of extra bytes allocated after every node
+ *
+ * @retval Pointer to the list structure
+ * @retval NULL if allocation error occurred
+ *
+ * @details The extra bytes are zeroed when the node is inserted and are
+ * owned by the user of the list, see ListNodeExtra()
+ */
+list_t*
+ListConstructorWithExtra (const list_node_layout layout,
+                          const size_t extra_size);
+
+
 /**
  * @brief Destructor for a list structure
  *
@@ -148,11 +192,39 @@ ListNodeConstructor (const list_key* const key,
  * @param node Pointer to the node to be destructed
  *
  * @retval NULL
+ *
+ * @note Only for nodes made by ListNodeConstructor(),
+ * nodes of a list are destructed by the list
  */
 list_node*
 ListNodeDestructor (list_node* const node);
 
 
+/**
+ * @brief Number of bytes allocated for one node of the given layout
+ *
+ * @param layout Layout of the node
+ *
+ * @retval Size of the node structure without the key and the value buffers
+ */
+size_t
+ListNodeSize (const list_node_layout layout);
+
+
+/**
+ * @brief Extra bytes of the node of a list made by ListConstructorWithExtra()
+ *
+ * @param node Pointer to the node
+ * @param layout Layout of the nodes in the list
+ *
+ * @retval Pointer to the extra bytes
+ * @retval NULL if node is NULL
+ */
+void*
+ListNodeExtra (list_node* const node,
+               const list_node_layout layout);
+
+
 /**
  * @brief Insert node with given key and value after a given prev_node
  *
@@ -205,6 +277,24 @@ ListPushFront (list_t*     const list,
                list_value* const value);
 
 
+/**
+ * @brief Insert in the end of the list and save the hash of the key
+ *
+ * @param list A pointer to the list where to insert
+ * @param key A key of the node to insert
+ * @param value A value of the node to insert
+ * @param hash Hash of the key, compared before the keys by ListFindNodeHashed()
+ *
+ * @retval LIST_SUCCESS if function ended successfully
+ * @retval LIST_ERROR   if error occured (implementation defined)
+ */
+list_error_status
+ListPushBackHashed (list_t*     const list,
+                    list_key*   const key,
+                    list_value* const value,
+                    const size_t hash);
+
+
 /**
  * @brief Delete node from the list
  *
@@ -235,6 +325,27 @@ ListFindNode (list_t* const list,
               list_key_cmp key_cmp);
 
 
+/**
+ * @brief A function which searches for a node with the given key and hash
+ *
+ * @param list A pointer to the list to find the node
+ * @param key  A pointer to the key to search
+ * @param hash Hash of the key
+ * @param key_cmp A pointer to the comparator function
+ *
+ * @retval Pointer to the found node in the list
+ * @retval NULL if node not found or invalid arguments recieved
+ *
+ * @details The comparator is called only for nodes with the same hash,
+ * so all nodes must be inserted with ListPushBackHashed()
+ */
+list_node*
+ListFindNodeHashed (list_t* const list,
+                    list_key* const key,
+                    const size_t hash,
+                    list_key_cmp key_cmp);
+
+
 /**
  * @brief Constructor for list key structure
  *
@@ -0,0 +1,168 @@
+/**
+ * @file alloc_tracking.h
+ *
+ * @author SeveraTheDuck
+ *
+ * @brief Counting wrappers of the allocation functions
+ *
+ * @details
+ * Every allocation of the hash table, the lists and the separation library
+ * goes through these wrappers with a category. The wrappers count the
+ * allocations, the frees and the live bytes of every category in the global
+ * counters and in the counters of the current scope of the thread, so the
+ * memory of one hash table is known apart from the others.
+ *
+ * The bytes are the usable sizes the allocator gives, which are a bit larger
+ * than the asked ones, its per-chunk headers are not counted.
+ *
+ * The counting is built only with HASH_TABLE_TRACK_ALLOC defined, it takes
+ * atomic adds and a usable size lookup per call. Without it the wrappers
+ * call the allocation functions alone and every counter stays 0.
+ */
+
+
+
+#pragma once
+
+
+
+#include <stddef.h>
+
+
+
+//-----------------------------------------------------------------------------
+// Allocation tracking structures
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief What the allocated memory is used for
+ */
+typedef
+enum alloc_category
+{
+    ALLOC_CATEGORY_TABLE   = 0, ///< hash table structure and its counters
+    ALLOC_CATEGORY_BUCKETS = 1, ///< buckets array and list structures
+    ALLOC_CATEGORY_NODES   = 2, ///< list nodes with their extra bytes
+    ALLOC_CATEGORY_KEYS    = 3, ///< key structures and key bytes
+    ALLOC_CATEGORY_VALUES  = 4, ///< value structures and value bytes
+    ALLOC_CATEGORY_TEXT    = 5  ///< text, strings and states of the separation
+}
+alloc_category;
+
+
+/**
+ * @brief Number of the allocation categories
+ */
+#define ALLOC_CATEGORIES_NUMBER 6
+
+
+/**
+ * @brief Allocation counters of every category
+ */
+typedef
+struct alloc_counters
+{
+    size_t allocations[ALLOC_CATEGORIES_NUMBER];    ///< blocks allocated
+    size_t frees      [ALLOC_CATEGORIES_NUMBER];    ///< blocks freed
+    size_t live_bytes [ALLOC_CATEGORIES_NUMBER];    ///< bytes not freed yet
+}
+alloc_counters;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Allocation tracking interface
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Same as malloc(), counts the block
+ */
+void*
+TrackedMalloc (const size_t size,
+               const alloc_category category);
+
+
+/**
+ * @brief Same as calloc(), counts the block
+ */
+void*
+TrackedCalloc (const size_t number,
+               const size_t size,
+               const alloc_category category);
+
+
+/**
+ * @brief Same as realloc(), counts the old block freed and the new one
+ * allocated
+ */
+void*
+TrackedRealloc (void* const pointer,
+                const size_t size,
+                const alloc_category category);
+
+
+/**
+ * @brief Same as free(), the category must be the one of the allocation
+ */
+void
+TrackedFree (void* const pointer,
+             const alloc_category category);
+
+
+/**
+ * @brief Sets the counters the allocations of the thread are counted in
+ * besides the global ones
+ *
+ * @param scope Counters of the scope, NULL for only the global ones
+ *
+ * @retval The previous scope, to be set back
+ * @retval NULL if built without HASH_TABLE_TRACK_ALLOC
+ *
+ * @details The scope counters are not atomic, they must be changed
+ * by one thread at a time, as a hash table is
+ */
+alloc_counters*
+AllocTrackingSetScope (alloc_counters* const scope);
+
+
+/**
+ * @brief Gets the global counters of all threads
+ *
+ * @param counters Pointer to save the counters, zeros if built without
+ * HASH_TABLE_TRACK_ALLOC
+ */
+void
+AllocTrackingGetGlobal (alloc_counters* const counters);
+
+
+/**
+ * @brief Gets the usable size of the block the allocator gives for the size
+ *
+ * @param size Asked size in bytes
+ *
+ * @retval Usable size of the block
+ * @retval 0 if allocation error occurred
+ *
+ * @details Allocates and frees one block, which is not counted,
+ * the sizes of one allocator size class have the same usable size
+ */
+size_t
+AllocUsableSize (const size_t size);
+
+
+/**
+ * @brief Gets the name of the category
+ *
+ * @param category The category
+ *
+ * @retval Name of the category
+ * @retval NULL if category is out of range
+ */
+const char*
+AllocCategoryName (const alloc_category category);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
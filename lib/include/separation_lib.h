@@ -41,12 +41,14 @@ string_info;
  * @brief Structure which contains text and its separation
  *
  * @details String_info structures contain pointers to the text
+ * The strings are stored in one contiguous array, so the i-th string is
+ * @code text_sep->strings_array[i] @endcode
  */
 typedef
 struct text_separation
 {
     string_info* text;              ///< buffer with whole text
-    string_info** strings_array;    ///< array of strings
+    string_info* strings_array;     ///< contiguous array of strings
     size_t strings_number;          ///< number of strings
 }
 text_separation;
@@ -58,7 +60,8 @@ text_separation;
 enum separation_errors
 {
     SEPARATION_SUCCESS = 0, ///< no error occured, success
-    SEPARATION_ERROR   = 1  ///< error occured (allocation, nullptr etc)
+    SEPARATION_ERROR   = 1, ///< error occured (allocation, nullptr etc)
+    SEPARATION_END     = 2  ///< no more strings in the stream
 };
 
 
@@ -92,6 +95,93 @@ typedef size_t separator_function_status_t;
 typedef
 separator_function_status_t (*sep_function) (const char* const);
 
+
+/**
+ * @brief Enumeration of the instruction sets for the separation by classes
+ */
+typedef
+enum separation_simd_level
+{
+    SEPARATION_SIMD_AUTO   = 0, ///< the best available on the running CPU
+    SEPARATION_SIMD_SCALAR = 1, ///< one character per iteration, no SIMD
+    SEPARATION_SIMD_AVX2   = 2, ///< 32 characters per instruction
+    SEPARATION_SIMD_AVX512 = 3  ///< 64 characters per instruction
+}
+separation_simd_level;
+
+
+/**
+ * @brief Character classes description, replaces separator function
+ *
+ * @details Every string is a maximal sequence of characters c such that
+ * @code string_chars[(unsigned char) c] != 0 @endcode
+ * all other characters are separators which are not taken into strings
+ *
+ * The nibble tables are built by the constructor and let the vector code
+ * classify 32 or 64 characters at once
+ */
+typedef
+struct separation_char_classes
+{
+    unsigned char string_chars[256];        ///< 1 for string characters
+    unsigned char low_nibble_lo_bits[16];   ///< high nibbles 0-7 by low nibble
+    unsigned char low_nibble_hi_bits[16];   ///< high nibbles 8-15 by low nibble
+    separation_simd_level simd_level;       ///< instruction set to be used
+}
+separation_char_classes;
+
+
+/**
+ * @brief Stream which separates file chunk by chunk
+ *
+ * @details Only one chunk of the file is in memory, the string which is cut
+ * by the end of the chunk is moved to the beginning of the buffer and
+ * finished with the next chunk
+ */
+typedef struct separation_stream separation_stream;
+
+
+/**
+ * @brief Signature for the function which receives strings from the stream
+ *
+ * @details The string is valid only during the call, the second argument
+ * is the context given to SeparationStreamForEach()
+ * Returning SEPARATION_ERROR stops the separation
+ */
+typedef
+separation_error_t (*separation_callback) (const string_info* const,
+                                           void* const);
+
+
+/**
+ * @brief Signature for the function which receives strings with their hashes
+ *
+ * @see separation_callback, the second argument is the hash of the string
+ */
+typedef
+separation_error_t (*separation_hashed_callback) (const string_info* const,
+                                                  const size_t,
+                                                  void* const);
+
+
+/**
+ * @brief Functions to hash strings while the stream separates them
+ *
+ * @details The state is a buffer of state_size bytes, every string starts
+ * from a copy of initial_state. The string cut by the end of the chunk is
+ * hashed by parts: its beginning while the chunk is separated,
+ * the rest with the next chunk, so update must accept several parts
+ */
+typedef
+struct separation_hasher
+{
+    void   (*update) (void* const, const char* const, const size_t); ///< adds characters to the state
+    size_t (*final)  (const void* const);   ///< gets hash from the state
+    const void* initial_state;              ///< state before the first character
+    size_t      state_size;                 ///< size of the state in bytes
+}
+separation_hasher;
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 
@@ -114,7 +204,7 @@ separator_function_status_t (*sep_function) (const char* const);
  * @retval NULL if file is empty
  *
  * @details This function opens file with name filename and makes an array
- * of strings
+ * of strings in a single pass over the text
  *
  * @note The strings are not guaranteed to be null terminated
  */
@@ -122,6 +212,137 @@ text_separation*
 SeparateTextFile (const char* const filename,
                   sep_function separator);
 
+/**
+ * @brief Opens file and separates its text into strings by character
+ * classes, closes file
+ *
+ * @param filename Name of file to separate
+ * @param classes Character classes description
+ *
+ * @retval Pointer to the text_separation structure
+ * @retval NULL if allocation error occured
+ * @retval NULL if file open  error occured
+ * @retval NULL if classes is NULL
+ * @retval NULL if file is empty
+ *
+ * @details Same as SeparateTextFile(), but classifies the text with
+ * AVX2 or AVX-512 if available instead of calling a separator function
+ * for every character
+ *
+ * @note The strings are not guaranteed to be null terminated
+ */
+text_separation*
+SeparateTextFileByClasses (const char* const filename,
+                           const separation_char_classes* const classes);
+
+
+/**
+ * @brief Separates text in the given buffer into strings
+ *
+ * @param buffer Buffer with the text
+ * @param buffer_size Number of characters in the buffer
+ * @param separator Separator function
+ *
+ * @retval Pointer to the text_separation structure
+ * @retval NULL if allocation error occured
+ * @retval NULL if buffer or separator function is NULL
+ *
+ * @note The buffer is not owned by the separation, text field is NULL
+ */
+text_separation*
+SeparateBuffer (char* const buffer,
+                const size_t buffer_size,
+                sep_function separator);
+
+
+/**
+ * @brief Separates text in the given buffer into strings by character classes
+ *
+ * @param buffer Buffer with the text
+ * @param buffer_size Number of characters in the buffer
+ * @param classes Character classes description
+ *
+ * @retval Pointer to the text_separation structure
+ * @retval NULL if allocation error occured
+ * @retval NULL if buffer or classes is NULL
+ *
+ * @note The buffer is not owned by the separation, text field is NULL
+ */
+text_separation*
+SeparateBufferByClasses (char* const buffer,
+                         const size_t buffer_size,
+                         const separation_char_classes* const classes);
+
+
+/**
+ * @brief Opens file and separates its text into strings on several threads,
+ * closes file
+ *
+ * @param filename Name of file to separate
+ * @param separator Separator function, must not depend on previous characters
+ * @param threads_number Number of threads, 0 for the number of CPUs
+ *
+ * @retval Pointer to the text_separation structure
+ * @retval NULL if allocation or thread creation error occured
+ * @retval NULL if file open  error occured
+ * @retval NULL if separator function is NULL
+ * @retval NULL if file is empty
+ *
+ * @details The text is split into ranges, the range boundary is moved
+ * forward while it cuts a string, so every string belongs to one range
+ * The strings are the same and in the same order as with SeparateTextFile()
+ */
+text_separation*
+SeparateTextFileParallel (const char* const filename,
+                          sep_function separator,
+                          const size_t threads_number);
+
+
+/**
+ * @brief Opens file and separates its text into strings by character classes
+ * on several threads, closes file
+ *
+ * @param filename Name of file to separate
+ * @param classes Character classes description
+ * @param threads_number Number of threads, 0 for the number of CPUs
+ *
+ * @retval Pointer to the text_separation structure
+ * @retval NULL if allocation or thread creation error occured
+ * @retval NULL if file open  error occured
+ * @retval NULL if classes is NULL
+ * @retval NULL if file is empty
+ *
+ * @see SeparateTextFileParallel()
+ */
+text_separation*
+SeparateTextFileByClassesParallel (const char* const filename,
+                                   const separation_char_classes* const classes,
+                                   const size_t threads_number);
+
+
+/**
+ * @brief Separates text in the given buffer into strings on several threads
+ *
+ * @param buffer Buffer with the text
+ * @param buffer_size Number of characters in the buffer
+ * @param separator Separator function, used if classes is NULL
+ * @param classes Character classes description
+ * @param threads_number Number of threads, 0 for the number of CPUs
+ *
+ * @retval Pointer to the text_separation structure
+ * @retval NULL if allocation or thread creation error occured
+ * @retval NULL if buffer is NULL or both separator and classes are NULL
+ *
+ * @note The buffer is not owned by the separation, text field is NULL
+ */
+text_separation*
+SeparateBufferParallel (char* const buffer,
+                        const size_t buffer_size,
+                        sep_function separator,
+                        const separation_char_classes* const classes,
+                        const size_t threads_number);
+
+
 /**
  * @brief Destructor for text_separation structure
  *
@@ -135,5 +356,205 @@ SeparateTextFile (const char* const filename,
 text_separation*
 DestroySeparation (text_separation* const text_sep);
 
+
+/**
+ * @brief Constructor for separation_char_classes structure
+ *
+ * @param string_chars 256 flags, non-zero for the characters taken into strings
+ *
+ * @retval Pointer to the separation_char_classes structure
+ * @retval NULL if allocation error occured
+ * @retval NULL if string_chars is NULL
+ */
+separation_char_classes*
+SeparationCharClassesConstructor (const unsigned char* const string_chars);
+
+
+/**
+ * @brief Makes separation_char_classes structure from the separator function
+ *
+ * @param separator Separator function
+ *
+ * @retval Pointer to the separation_char_classes structure
+ * @retval NULL if allocation error occured
+ * @retval NULL if separator function is NULL
+ * @retval NULL if separator returns something except
+ * NOT_SEPARATOR_ELEMENT and SEPARATOR_ELEMENT_NOT_TAKE
+ *
+ * @details Calls the separator once for every character
+ */
+separation_char_classes*
+SeparationCharClassesFromSeparator (sep_function separator);
+
+
+/**
+ * @brief Destructor for separation_char_classes structure
+ *
+ * @param classes Pointer to the separation_char_classes structure
+ *
+ * @retval NULL
+ */
+separation_char_classes*
+SeparationCharClassesDestructor (separation_char_classes* const classes);
+
+
+/**
+ * @brief Opens file for the chunked separation by separator
+ *
+ * @param filename Name of file to separate
+ * @param chunk_size Number of characters read at once, 0 for default size
+ * @param separator Separator function
+ *
+ * @retval Pointer to the separation_stream structure
+ * @retval NULL if allocation error occured
+ * @retval NULL if file open  error occured
+ * @retval NULL if separator function is NULL
+ */
+separation_stream*
+SeparationStreamConstructor (const char* const filename,
+                             const size_t chunk_size,
+                             sep_function separator);
+
+
+/**
+ * @brief Opens file for the chunked separation by character classes
+ *
+ * @param filename Name of file to separate
+ * @param chunk_size Number of characters read at once, 0 for default size
+ * @param classes Character classes description, must outlive the stream
+ *
+ * @retval Pointer to the separation_stream structure
+ * @retval NULL if allocation error occured
+ * @retval NULL if file open  error occured
+ * @retval NULL if classes is NULL
+ */
+separation_stream*
+SeparationStreamConstructorByClasses (const char* const filename,
+                                      const size_t chunk_size,
+                                      const separation_char_classes* const classes);
+
+
+/**
+ * @brief Destructor for separation_stream structure, closes file
+ *
+ * @param stream Pointer to the separation_stream structure
+ *
+ * @retval NULL
+ */
+separation_stream*
+SeparationStreamDestructor (separation_stream* const stream);
+
+
+/**
+ * @brief Sets number of threads to separate every chunk of the stream
+ *
+ * @param stream Pointer to the separation_stream structure
+ * @param threads_number Number of threads, 0 for the number of CPUs
+ *
+ * @retval SEPARATION_SUCCESS if function ended successfully
+ * @retval SEPARATION_ERROR if stream is NULL
+ *
+ * @details Chunks are separated as in SeparateTextFileParallel(),
+ * the strings are handed out in the same order. Threads are started
+ * for every chunk, so bigger chunks pay off better
+ */
+separation_error_t
+SeparationStreamSetThreads (separation_stream* const stream,
+                            const size_t threads_number);
+
+
+/**
+ * @brief Makes the stream hash every string
+ *
+ * @param stream Pointer to the separation_stream structure
+ * @param hasher Hash functions and initial state, copied by the stream
+ *
+ * @retval SEPARATION_SUCCESS if function ended successfully
+ * @retval SEPARATION_ERROR if allocation error occured
+ * @retval SEPARATION_ERROR if the stream has already read the file
+ * @retval SEPARATION_ERROR if bad input received
+ *
+ * @details The strings are hashed right after the chunk is separated,
+ * while it is still in cache
+ */
+separation_error_t
+SeparationStreamSetHasher (separation_stream* const stream,
+                           const separation_hasher* const hasher);
+
+
+/**
+ * @brief Gets the next string from the stream
+ *
+ * @param stream Pointer to the separation_stream structure
+ * @param string Pointer to save the string
+ *
+ * @retval SEPARATION_SUCCESS if the string is saved
+ * @retval SEPARATION_END if there are no more strings
+ * @retval SEPARATION_ERROR if allocation error occured
+ * @retval SEPARATION_ERROR if bad input received
+ *
+ * @note The string points into the stream buffer and is valid
+ * until the next call
+ */
+separation_error_t
+SeparationStreamNext (separation_stream* const stream,
+                      string_info* const string);
+
+
+/**
+ * @brief Gets the next string and its hash from the stream
+ *
+ * @param stream Pointer to the separation_stream structure with the hasher
+ * @param string Pointer to save the string
+ * @param hash Pointer to save the hash of the string
+ *
+ * @retval SEPARATION_SUCCESS if the string is saved
+ * @retval SEPARATION_END if there are no more strings
+ * @retval SEPARATION_ERROR if allocation error occured
+ * @retval SEPARATION_ERROR if bad input received or no hasher is set
+ *
+ * @see SeparationStreamNext()
+ */
+separation_error_t
+SeparationStreamNextHashed (separation_stream* const stream,
+                            string_info* const string,
+                            size_t* const hash);
+
+
+/**
+ * @brief Calls callback for every string left in the stream
+ *
+ * @param stream Pointer to the separation_stream structure
+ * @param callback Function to receive strings
+ * @param context Pointer passed to the callback as is
+ *
+ * @retval SEPARATION_SUCCESS if all strings are passed
+ * @retval SEPARATION_ERROR if allocation error occured
+ * @retval SEPARATION_ERROR if callback returned SEPARATION_ERROR
+ * @retval SEPARATION_ERROR if bad input received
+ */
+separation_error_t
+SeparationStreamForEach (separation_stream* const stream,
+                         separation_callback callback,
+                         void* const context);
+
+
+/**
+ * @brief Calls callback for every string left in the stream and its hash
+ *
+ * @param stream Pointer to the separation_stream structure with the hasher
+ * @param callback Function to receive strings and hashes
+ * @param context Pointer passed to the callback as is
+ *
+ * @retval SEPARATION_SUCCESS if all strings are passed
+ * @retval SEPARATION_ERROR if allocation error occured
+ * @retval SEPARATION_ERROR if callback returned SEPARATION_ERROR
+ * @retval SEPARATION_ERROR if bad input received or no hasher is set
+ */
+separation_error_t
+SeparationStreamForEachHashed (separation_stream* const stream,
+                               separation_hashed_callback callback,
+                               void* const context);
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
@@ -0,0 +1,291 @@
+#include "alloc_tracking.h"
+#include <assert.h>
+#include <stdlib.h>
+
+#if defined (__APPLE__)
+    #include <malloc/malloc.h>
+    #define ALLOC_USABLE_SIZE(pointer) malloc_size (pointer)
+#else
+    #include <malloc.h>
+    #define ALLOC_USABLE_SIZE(pointer) malloc_usable_size (pointer)
+#endif
+
+
+
+//-----------------------------------------------------------------------------
+// Static variables
+//-----------------------------------------------------------------------------
+
+#ifdef HASH_TABLE_TRACK_ALLOC
+
+/// @brief Counters of all threads, changed atomically
+static alloc_counters global_counters = {0};
+
+
+/// @brief Counters of the current scope of the thread, NULL if none
+static _Thread_local alloc_counters* scope_counters = NULL;
+
+#endif
+
+
+/// @brief Names of the categories in the order of alloc_category
+static const char* const ALLOC_CATEGORY_NAMES[ALLOC_CATEGORIES_NUMBER] =
+{
+    "table",
+    "buckets",
+    "nodes",
+    "keys",
+    "values",
+    "text"
+};
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static functions prototypes
+//-----------------------------------------------------------------------------
+
+#ifdef HASH_TABLE_TRACK_ALLOC
+
+/**
+ * @brief Counts the allocated block in the global and the scope counters
+ */
+static void
+CountAllocation (void* const pointer,
+                 const alloc_category category);
+
+
+/**
+ * @brief Counts the freed block of the usable size in the global
+ * and the scope counters
+ */
+static void
+CountFree (const size_t size,
+           const alloc_category category);
+
+#endif
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Allocation tracking implementation
+//-----------------------------------------------------------------------------
+
+#ifdef HASH_TABLE_TRACK_ALLOC
+
+void*
+TrackedMalloc (const size_t size,
+               const alloc_category category)
+{
+    void* const pointer = malloc (size);
+    CountAllocation (pointer, category);
+
+    return pointer;
+}
+
+
+void*
+TrackedCalloc (const size_t number,
+               const size_t size,
+               const alloc_category category)
+{
+    void* const pointer = calloc (number, size);
+    CountAllocation (pointer, category);
+
+    return pointer;
+}
+
+
+void*
+TrackedRealloc (void* const pointer,
+                const size_t size,
+                const alloc_category category)
+{
+    // the old block is counted before, it can not be read after
+    const size_t old_size = (pointer != NULL) ? ALLOC_USABLE_SIZE (pointer) : 0;
+
+    void* const new_pointer = realloc (pointer, size);
+    if (new_pointer == NULL && size != 0) return NULL;
+
+    if (pointer != NULL) CountFree (old_size, category);
+    CountAllocation (new_pointer, category);
+
+    return new_pointer;
+}
+
+
+void
+TrackedFree (void* const pointer,
+             const alloc_category category)
+{
+    if (pointer != NULL) CountFree (ALLOC_USABLE_SIZE (pointer), category);
+    free (pointer);
+}
+
+
+alloc_counters*
+AllocTrackingSetScope (alloc_counters* const scope)
+{
+    alloc_counters* const previous = scope_counters;
+    scope_counters = scope;
+
+    return previous;
+}
+
+
+void
+AllocTrackingGetGlobal (alloc_counters* const counters)
+{
+    assert (counters);
+
+    for (size_t i = 0; i < ALLOC_CATEGORIES_NUMBER; ++i)
+    {
+        counters->allocations[i] =
+            __atomic_load_n (&global_counters.allocations[i], __ATOMIC_RELAXED);
+        counters->frees[i] =
+            __atomic_load_n (&global_counters.frees[i], __ATOMIC_RELAXED);
+        counters->live_bytes[i] =
+            __atomic_load_n (&global_counters.live_bytes[i], __ATOMIC_RELAXED);
+    }
+}
+
+#else
+
+void*
+TrackedMalloc (const size_t size,
+               const alloc_category category)
+{
+    (void) category;
+    return malloc (size);
+}
+
+
+void*
+TrackedCalloc (const size_t number,
+               const size_t size,
+               const alloc_category category)
+{
+    (void) category;
+    return calloc (number, size);
+}
+
+
+void*
+TrackedRealloc (void* const pointer,
+                const size_t size,
+                const alloc_category category)
+{
+    (void) category;
+    return realloc (pointer, size);
+}
+
+
+void
+TrackedFree (void* const pointer,
+             const alloc_category category)
+{
+    (void) category;
+    free (pointer);
+}
+
+
+alloc_counters*
+AllocTrackingSetScope (alloc_counters* const scope)
+{
+    (void) scope;
+    return NULL;
+}
+
+
+void
+AllocTrackingGetGlobal (alloc_counters* const counters)
+{
+    assert (counters);
+
+    *counters = (alloc_counters) {0};
+}
+
+#endif
+
+
+size_t
+AllocUsableSize (const size_t size)
+{
+    void* const pointer = malloc (size);
+    if (pointer == NULL) return 0;
+
+    const size_t usable_size = ALLOC_USABLE_SIZE (pointer);
+    free (pointer);
+
+    return usable_size;
+}
+
+
+const char*
+AllocCategoryName (const alloc_category category)
+{
+    if ((size_t) category >= ALLOC_CATEGORIES_NUMBER) return NULL;
+
+    return ALLOC_CATEGORY_NAMES[category];
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static functions implementation
+//-----------------------------------------------------------------------------
+
+#ifdef HASH_TABLE_TRACK_ALLOC
+
+static void
+CountAllocation (void* const pointer,
+                 const alloc_category category)
+{
+    assert ((size_t) category < ALLOC_CATEGORIES_NUMBER);
+
+    if (pointer == NULL) return;
+
+    const size_t size = ALLOC_USABLE_SIZE (pointer);
+
+    __atomic_fetch_add (&global_counters.allocations[category], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add (&global_counters.live_bytes[category], size,
+                        __ATOMIC_RELAXED);
+
+    if (scope_counters != NULL)
+    {
+        ++scope_counters->allocations[category];
+        scope_counters->live_bytes[category] += size;
+    }
+}
+
+
+static void
+CountFree (const size_t size,
+           const alloc_category category)
+{
+    assert ((size_t) category < ALLOC_CATEGORIES_NUMBER);
+
+    __atomic_fetch_add (&global_counters.frees[category], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_sub (&global_counters.live_bytes[category], size,
+                        __ATOMIC_RELAXED);
+
+    if (scope_counters != NULL)
+    {
+        ++scope_counters->frees[category];
+        scope_counters->live_bytes[category] -= size;
+    }
+}
+
+#endif
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
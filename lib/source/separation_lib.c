@@ -1,4 +1,129 @@
 #include "separation_lib.h"
+#include "alloc_tracking.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined (__x86_64__) || defined (__i386__)
+    #define SEPARATION_X86_SIMD 1
+    #include <immintrin.h>
+#else
+    #define SEPARATION_X86_SIMD 0
+#endif
+
+
+
+//-----------------------------------------------------------------------------
+// Consts
+//-----------------------------------------------------------------------------
+
+/// @brief Initial capacity of the strings array
+static const size_t STRINGS_ARRAY_MIN_CAPACITY = 64;
+
+
+/// @brief Number of characters classified by one vector block
+static const size_t CLASSES_BLOCK_SIZE = 64;
+
+
+/// @brief Default number of characters read by the stream at once
+static const size_t STREAM_DEFAULT_CHUNK_SIZE = 1 << 20;
+
+
+/// @brief Minimal number of characters separated by one thread
+static const size_t PARALLEL_MIN_RANGE_SIZE = 1 << 16;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static structures
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Growable contiguous array of strings
+ */
+typedef
+struct strings_vector
+{
+    string_info* data;  ///< array of strings
+    size_t size;        ///< number of strings
+    size_t capacity;    ///< number of allocated strings
+}
+strings_vector;
+
+
+/**
+ * @brief Result of one range tokenization
+ *
+ * @details Only finished strings are pushed by tokenizers, the last
+ * string may continue after the end of the range
+ */
+typedef
+struct tokenize_result
+{
+    size_t tail_offset; ///< offset of the unfinished string, range size if none
+    int    ended;       ///< non-zero if separator returned END_SEPARATION
+}
+tokenize_result;
+
+
+/**
+ * @brief Stream which separates file chunk by chunk
+ *
+ * @details Strings of the current chunk are kept in the strings vector,
+ * characters from tail_offset to data_size are the beginning of the string
+ * which continues in the next chunk
+ */
+struct separation_stream
+{
+    FILE* file;                             ///< file to read from
+    sep_function separator;                 ///< separator function
+    const separation_char_classes* classes; ///< classes, used if not NULL
+
+    char*  buffer;                          ///< current chunk
+    size_t capacity;                        ///< size of the buffer
+    size_t data_size;                       ///< number of read characters
+    size_t tail_offset;                     ///< offset of the unfinished string
+
+    strings_vector strings;                 ///< strings of the current chunk
+    size_t next_string;                     ///< index of the next string
+    int    finished;                        ///< non-zero if file is over
+
+    size_t threads_number;                  ///< threads to separate a chunk
+
+    separation_hasher hasher;               ///< hash functions, update is NULL if not set
+    void*  string_state;                    ///< hash state of the current string
+    void*  tail_state;                      ///< hash state of the unfinished string
+    size_t tail_hashed;                     ///< hashed characters of the unfinished string
+    size_t* hashes;                         ///< hashes of the current chunk strings
+    size_t hashes_capacity;                 ///< number of allocated hashes
+};
+
+
+/**
+ * @brief Range of the text separated by one thread
+ */
+typedef
+struct tokenize_task
+{
+    sep_function separator;                 ///< separator function
+    const separation_char_classes* classes; ///< classes, used if not NULL
+
+    char*  begin;                           ///< begin of the range
+    size_t size;                            ///< size of the range
+    int    is_last;                         ///< the range ends the text
+
+    strings_vector*    strings;             ///< vector to push strings into
+    tokenize_result    result;              ///< result of the tokenization
+    separation_error_t status;              ///< error status of the thread
+}
+tokenize_task;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
 
 
 
@@ -32,32 +157,329 @@ GetFileSize (FILE* const file);
 
 
 /**
- * @brief Get number of strings separated by separator
+ * @brief Makes separation of the buffer by separator or by classes
  *
- * @param text Pointer to string_info structure to separate
- * @param separator Separator function
+ * @param text Pointer to string to separate
+ * @param separator Separator function, used if classes is NULL
+ * @param classes Character classes description
+ *
+ * @retval Pointer to text_separation structure
+ * @retval NULL if allocation error occured
+ *
+ * @details The text is not owned by the returned separation
+ */
+static text_separation*
+MakeSeparation (string_info* const text,
+                sep_function separator,
+                const separation_char_classes* const classes,
+                const size_t threads_number);
+
+
+/**
+ * @brief Opens file and separates it, common for all file separations
+ *
+ * @param filename Name of file to separate
+ * @param separator Separator function, used if classes is NULL
+ * @param classes Character classes description
+ * @param threads_number Number of threads, 0 for the number of CPUs
+ *
+ * @retval Pointer to the text_separation structure owning the text
+ * @retval NULL if error occured
+ */
+static text_separation*
+MakeFileSeparation (const char* const filename,
+                    sep_function separator,
+                    const separation_char_classes* const classes,
+                    const size_t threads_number);
+
+
+/**
+ * @brief Same as TokenizeRange(), but separates the range on several threads
+ *
+ * @param separator Separator function, used if classes is NULL
+ * @param classes Character classes description
+ * @param begin Pointer to the range to separate
+ * @param size Number of characters in the range
+ * @param threads_number Number of threads, 0 for the number of CPUs
+ * @param strings Vector to push the strings into
+ * @param result Pointer to save the unfinished string and END_SEPARATION flag
+ *
+ * @retval SEPARATION_SUCCESS if function ended successfully
+ * @retval SEPARATION_ERROR if allocation error occured
+ *
+ * @details The first range is separated into strings vector directly,
+ * the others into their own vectors which are appended in order when all
+ * threads are joined, so no lock is taken while separating
+ */
+static separation_error_t
+TokenizeRangeParallel (sep_function separator,
+                       const separation_char_classes* const classes,
+                       char* const begin,
+                       const size_t size,
+                       const size_t threads_number,
+                       strings_vector* const strings,
+                       tokenize_result* const result);
+
+
+/**
+ * @brief Thread function, separates one range
+ *
+ * @param task Pointer to the tokenize_task structure
+ *
+ * @retval NULL
+ *
+ * @details The string at the end of not the last range is finished by
+ * the range boundary, so it is pushed too
+ */
+static void*
+TokenizeTaskRun (void* const task);
+
+
+/**
+ * @brief Moves the range boundary forward while it cuts a string
+ *
+ * @param separator Separator function, used if classes is NULL
+ * @param classes Character classes description
+ * @param begin Pointer to the text
+ * @param size Number of characters in the text
+ * @param boundary Proposed boundary
  *
- * @retval Number of strings
+ * @retval Offset of the boundary such that no string contains both
+ * characters before and after it
  */
 static size_t
-GetStringsNumber (string_info* const text,
-                  sep_function separator);
+FindRangeBoundary (sep_function separator,
+                   const separation_char_classes* const classes,
+                   char* const begin,
+                   const size_t size,
+                   size_t boundary);
 
 
 /**
- * @brief Make array of strings separated by separator
+ * @brief Gets the number of threads to separate the text
+ *
+ * @param threads_number Requested number of threads, 0 for the number of CPUs
+ * @param size Number of characters in the text
+ *
+ * @retval Number of threads, every thread gets at least
+ * PARALLEL_MIN_RANGE_SIZE characters
+ */
+static size_t
+GetThreadsNumber (const size_t threads_number,
+                  const size_t size);
+
+
+/**
+ * @brief Pushes strings separated by separator or by classes into the vector
+ *
+ * @param separator Separator function, used if classes is NULL
+ * @param classes Character classes description
+ * @param begin Pointer to the range to separate
+ * @param size Number of characters in the range
+ * @param strings Vector to push the strings into
+ * @param result Pointer to save the unfinished string and END_SEPARATION flag
+ *
+ * @retval SEPARATION_SUCCESS if function ended successfully
+ * @retval SEPARATION_ERROR if allocation error occured
+ */
+static separation_error_t
+TokenizeRange (sep_function separator,
+               const separation_char_classes* const classes,
+               char* const begin,
+               const size_t size,
+               strings_vector* const strings,
+               tokenize_result* const result);
+
+
+/**
+ * @brief Pushes strings separated by separator into the vector
  *
- * @param text Pointer to string to separate
  * @param separator Separator function
- * @param strings_num Number of strings
+ * @param begin Pointer to the range to separate
+ * @param size Number of characters in the range
+ * @param strings Vector to push the strings into
+ * @param result Pointer to save the unfinished string and END_SEPARATION flag
+ *
+ * @retval SEPARATION_SUCCESS if function ended successfully
+ * @retval SEPARATION_ERROR if allocation error occured
+ */
+static separation_error_t
+TokenizeBySeparator (sep_function separator,
+                     char* const begin,
+                     const size_t size,
+                     strings_vector* const strings,
+                     tokenize_result* const result);
+
+
+/**
+ * @brief Pushes strings separated by character classes into the vector
+ *
+ * @param classes Character classes description
+ * @param begin Pointer to the range to separate
+ * @param size Number of characters in the range
+ * @param strings Vector to push the strings into
+ * @param result Pointer to save the unfinished string
+ *
+ * @retval SEPARATION_SUCCESS if function ended successfully
+ * @retval SEPARATION_ERROR if allocation error occured
+ *
+ * @details Chooses the instruction set by classes->simd_level and the CPU
+ */
+static separation_error_t
+TokenizeByClasses (const separation_char_classes* const classes,
+                   char* const begin,
+                   const size_t size,
+                   strings_vector* const strings,
+                   tokenize_result* const result);
+
+
+/**
+ * @brief Classifies characters one by one and pushes the strings
+ *
+ * @param classes Character classes description
+ * @param begin Pointer to the range to separate
+ * @param size Number of characters in the range
+ * @param start Offset of the first character to classify
+ * @param strings Vector to push the strings into
+ * @param string_begin Offset of the unfinished string, SIZE_MAX if none
+ *
+ * @retval SEPARATION_SUCCESS if function ended successfully
+ * @retval SEPARATION_ERROR if allocation error occured
+ *
+ * @details Used for the whole range and for the tails of vector tokenizers
+ */
+static separation_error_t
+TokenizeByClassesScalar (const separation_char_classes* const classes,
+                         char* const begin,
+                         const size_t size,
+                         size_t start,
+                         strings_vector* const strings,
+                         size_t* const string_begin);
+
+
+/**
+ * @brief Pushes strings found in one block by its string characters mask
+ *
+ * @param begin Pointer to the range to separate
+ * @param block_offset Offset of the block in the range
+ * @param mask Bit i is set if character i of the block is a string character
+ * @param prev_mask Mask of the previous block
+ * @param strings Vector to push the strings into
+ * @param string_begin Offset of the unfinished string, SIZE_MAX if none
+ *
+ * @retval SEPARATION_SUCCESS if function ended successfully
+ * @retval SEPARATION_ERROR if allocation error occured
+ *
+ * @details Strings begin and end where the mask differs from itself
+ * shifted by one, the positions are taken with tzcnt
+ */
+static inline separation_error_t
+PushBlockStrings (char* const begin,
+                  const size_t block_offset,
+                  uint64_t mask,
+                  const uint64_t prev_mask,
+                  strings_vector* const strings,
+                  size_t* const string_begin);
+
+#if SEPARATION_X86_SIMD
+
+/**
+ * @brief Vector tokenizer, 2 AVX2 registers per block
+ *
+ * @see TokenizeByClassesScalar() for the params
+ */
+static separation_error_t
+TokenizeByClassesAvx2 (const separation_char_classes* const classes,
+                       char* const begin,
+                       const size_t size,
+                       strings_vector* const strings,
+                       size_t* const string_begin);
+
+
+/**
+ * @brief Vector tokenizer, 1 AVX-512 register per block
+ *
+ * @see TokenizeByClassesScalar() for the params
+ */
+static separation_error_t
+TokenizeByClassesAvx512 (const separation_char_classes* const classes,
+                         char* const begin,
+                         const size_t size,
+                         strings_vector* const strings,
+                         size_t* const string_begin);
+
+#endif // SEPARATION_X86_SIMD
+
+
+/**
+ * @brief Chooses the instruction set supported by the CPU
+ *
+ * @param requested Requested instruction set
+ *
+ * @retval The best supported instruction set not better than requested
+ */
+static separation_simd_level
+GetSimdLevel (const separation_simd_level requested);
+
+
+/**
+ * @brief Builds nibble tables of the classes from string_chars
+ *
+ * @param classes Character classes description
+ */
+static void
+BuildNibbleTables (separation_char_classes* const classes);
+
+
+/**
+ * @brief Common constructor for separation streams
  *
- * @retval Array of strings
+ * @param filename Name of file to separate
+ * @param chunk_size Number of characters read at once, 0 for default size
+ * @param separator Separator function, used if classes is NULL
+ * @param classes Character classes description
+ *
+ * @retval Pointer to the separation_stream structure
  * @retval NULL if allocation error occured
+ * @retval NULL if file open  error occured
  */
-static string_info**
-MakeSeparation (string_info* const text,
-                sep_function separator,
-                const size_t strings_num);
+static separation_stream*
+StreamConstructor (const char* const filename,
+                   const size_t chunk_size,
+                   sep_function separator,
+                   const separation_char_classes* const classes);
+
+
+/**
+ * @brief Reads the next chunk and separates it
+ *
+ * @param stream Pointer to the separation_stream structure
+ *
+ * @retval SEPARATION_SUCCESS if function ended successfully
+ * @retval SEPARATION_ERROR if allocation error occured
+ *
+ * @details Moves the unfinished string to the beginning of the buffer and
+ * reads the chunk after it, the buffer grows only if the string takes
+ * the whole buffer. The last string is pushed when the file is over
+ */
+static separation_error_t
+ReadNextChunk (separation_stream* const stream);
+
+
+/**
+ * @brief Hashes the strings of the current chunk
+ *
+ * @param stream Pointer to the separation_stream structure with the hasher
+ *
+ * @retval SEPARATION_SUCCESS if function ended successfully
+ * @retval SEPARATION_ERROR if allocation error occured
+ *
+ * @details The unfinished string at the end of the chunk is hashed into
+ * tail_state, the first string of the next chunk continues from it
+ */
+static separation_error_t
+HashChunkStrings (separation_stream* const stream);
+
 
 /**
  * @brief Constructor for text_separation structure
@@ -71,50 +493,77 @@ MakeSeparation (string_info* const text,
  */
 static text_separation*
 TextSeparationConstructor (string_info* const text,
-                           string_info** const strings_array,
+                           string_info* const strings_array,
                            const size_t strings_num);
 
 
 /**
- * @brief Aborts separation if error occured
+ * @brief Destructor for whole text from file
  *
- * @param text Pointer to string with whole text
- * @param strings_array Array of strings from the text
- * @param strings_num Number of strings
+ * @param text Pointer to the string with text
  *
  * @retval NULL
  */
-static text_separation*
-AbortSeparation (string_info* const text,
-                 string_info** const strings_array,
-                 const size_t strings_num);
+static string_info*
+BufferDestructor (string_info* const text);
 
 
 /**
- * @brief Destructor for whole text from file
+ * @brief Constructor for the strings vector
  *
- * @param text Pointer to the string with text
+ * @param strings Pointer to the vector
  *
- * @retval NULL
+ * @retval SEPARATION_SUCCESS if function ended successfully
+ * @retval SEPARATION_ERROR if allocation error occured
  */
-static string_info*
-BufferDestructor (string_info* const text);
+static separation_error_t
+StringsVectorConstructor (strings_vector* const strings);
+
+
+/**
+ * @brief Appends string to the strings vector
+ *
+ * @param strings Pointer to the vector
+ * @param begin_ptr Pointer to begining of the string
+ * @param chars_number Number of characters in the string
+ *
+ * @retval SEPARATION_SUCCESS if function ended successfully
+ * @retval SEPARATION_ERROR if allocation error occured
+ *
+ * @details Doubles the capacity if the array is full
+ */
+static inline separation_error_t
+StringsVectorPush (strings_vector* const strings,
+                   char* const begin_ptr,
+                   const size_t chars_number);
+
+
+/**
+ * @brief Appends all strings from one vector to another
+ *
+ * @param strings Pointer to the vector to append to
+ * @param source Pointer to the vector with strings to append
+ *
+ * @retval SEPARATION_SUCCESS if function ended successfully
+ * @retval SEPARATION_ERROR if allocation error occured
+ */
+static separation_error_t
+StringsVectorAppend (strings_vector* const strings,
+                     const strings_vector* const source);
 
 
 /**
  * @brief Destructor for strings array
  *
  * @param strings_array Pointer to the strings array
- * @param strings_num Number of strings
  *
  * @retval NULL
  *
- * @details Calls for destructor for every string and
- * frees memory allocated for the array
+ * @details The strings are stored in the array itself, so only
+ * the array memory is freed
  */
-static string_info**
-StringsArrayDestructor (string_info** const strings_array,
-                        const size_t strings_num);
+static string_info*
+StringsArrayDestructor (string_info* const strings_array);
 
 
 /**
@@ -155,88 +604,394 @@ SeparateTextFile (const char* const filename,
 {
     if (separator == NULL) return NULL;
 
-    text_separation* text_sep      = NULL;
-    string_info*     buffer        = NULL;
-    string_info**    strings_array = NULL;
-    size_t           strings_num   = 0;
-
-    buffer = ReadFile (filename);
-    if (buffer == NULL)
-        return AbortSeparation (buffer, strings_array, strings_num);
-
-    strings_num = GetStringsNumber (buffer, separator);
+    return MakeFileSeparation (filename, separator, NULL, 1);
+}
 
-    strings_array = MakeSeparation (buffer, separator, strings_num);
-    if (strings_array == NULL)
-        return AbortSeparation (buffer, strings_array, strings_num);
 
-    text_sep = TextSeparationConstructor (buffer, strings_array, strings_num);
-    if (text_sep == NULL)
-        return AbortSeparation (buffer, strings_array, strings_num);
+text_separation*
+SeparateTextFileByClasses (const char* const filename,
+                           const separation_char_classes* const classes)
+{
+    if (classes == NULL) return NULL;
 
-    return text_sep;
+    return MakeFileSeparation (filename, NULL, classes, 1);
 }
 
 
 text_separation*
-DestroySeparation (text_separation* const text_sep)
+SeparateTextFileParallel (const char* const filename,
+                          sep_function separator,
+                          const size_t threads_number)
 {
-    if (text_sep == NULL) return NULL;
-
-    text_sep->text           = BufferDestructor       (text_sep->text);
-    text_sep->strings_array  = StringsArrayDestructor (text_sep->strings_array,
-                                                       text_sep->strings_number);
-    text_sep->strings_number = 0;
+    if (separator == NULL) return NULL;
 
-    free (text_sep);
-    return NULL;
+    return MakeFileSeparation (filename, separator, NULL, threads_number);
 }
 
-//-----------------------------------------------------------------------------
-//-----------------------------------------------------------------------------
 
+text_separation*
+SeparateTextFileByClassesParallel (const char* const filename,
+                                   const separation_char_classes* const classes,
+                                   const size_t threads_number)
+{
+    if (classes == NULL) return NULL;
 
+    return MakeFileSeparation (filename, NULL, classes, threads_number);
+}
 
-//-----------------------------------------------------------------------------
-// Static functions implementation
-//-----------------------------------------------------------------------------
 
-static string_info*
-ReadFile (const char* const filename)
+text_separation*
+SeparateBuffer (char* const buffer,
+                const size_t buffer_size,
+                sep_function separator)
 {
-    if (filename == NULL) return NULL;
+    if (buffer    == NULL ||
+        separator == NULL)
+        return NULL;
 
-    FILE* file = fopen (filename, "rb");
-    if (file == NULL) return NULL;
+    string_info text = {.begin_ptr = buffer, .chars_number = buffer_size};
+    return MakeSeparation (&text, separator, NULL, 1);
+}
 
-    const size_t file_size = GetFileSize (file);
-    if (file_size == 0)
-    {
-        fclose (file);
-        return NULL;
-    }
 
-    char* buffer = malloc (file_size);
-    if (buffer == NULL)
-    {
-        fclose (file);
+text_separation*
+SeparateBufferByClasses (char* const buffer,
+                         const size_t buffer_size,
+                         const separation_char_classes* const classes)
+{
+    if (buffer  == NULL ||
+        classes == NULL)
         return NULL;
-    }
 
-    fread (buffer, sizeof (char), file_size, file);
-    fclose (file);
+    string_info text = {.begin_ptr = buffer, .chars_number = buffer_size};
+    return MakeSeparation (&text, NULL, classes, 1);
+}
 
-    string_info* text = StringInfoConstructor (buffer, file_size);
-    if (text == NULL) free (buffer);
 
-    return text;
+text_separation*
+SeparateBufferParallel (char* const buffer,
+                        const size_t buffer_size,
+                        sep_function separator,
+                        const separation_char_classes* const classes,
+                        const size_t threads_number)
+{
+    if (buffer == NULL ||
+        (separator == NULL && classes == NULL))
+        return NULL;
+
+    string_info text = {.begin_ptr = buffer, .chars_number = buffer_size};
+    return MakeSeparation (&text, separator, classes, threads_number);
 }
 
 
-static size_t
-GetFileSize (FILE* const file)
+text_separation*
+DestroySeparation (text_separation* const text_sep)
 {
-    assert (file);
+    if (text_sep == NULL) return NULL;
+
+    text_sep->text           = BufferDestructor       (text_sep->text);
+    text_sep->strings_array  = StringsArrayDestructor (text_sep->strings_array);
+    text_sep->strings_number = 0;
+
+    TrackedFree (text_sep, ALLOC_CATEGORY_TEXT);
+    return NULL;
+}
+
+
+separation_char_classes*
+SeparationCharClassesConstructor (const unsigned char* const string_chars)
+{
+    if (string_chars == NULL) return NULL;
+
+    separation_char_classes* const classes =
+        TrackedMalloc (sizeof (separation_char_classes), ALLOC_CATEGORY_TEXT);
+    if (classes == NULL) return NULL;
+
+    for (size_t i = 0; i < sizeof (classes->string_chars); ++i)
+        classes->string_chars[i] = (string_chars[i] != 0);
+
+    classes->simd_level = SEPARATION_SIMD_AUTO;
+    BuildNibbleTables (classes);
+
+    return classes;
+}
+
+
+separation_char_classes*
+SeparationCharClassesFromSeparator (sep_function separator)
+{
+    if (separator == NULL) return NULL;
+
+    unsigned char string_chars[256] = {0};
+
+    for (size_t i = 0; i < sizeof (string_chars); ++i)
+    {
+        const char symbol = (char) i;
+
+        switch (separator (&symbol))
+        {
+            case NOT_SEPARATOR_ELEMENT:
+                string_chars[i] = 1;
+                break;
+
+            case SEPARATOR_ELEMENT_NOT_TAKE:
+                string_chars[i] = 0;
+                break;
+
+            default:
+                return NULL;
+        }
+    }
+
+    return SeparationCharClassesConstructor (string_chars);
+}
+
+
+separation_char_classes*
+SeparationCharClassesDestructor (separation_char_classes* const classes)
+{
+    TrackedFree (classes, ALLOC_CATEGORY_TEXT);
+    return NULL;
+}
+
+
+separation_stream*
+SeparationStreamConstructor (const char* const filename,
+                             const size_t chunk_size,
+                             sep_function separator)
+{
+    if (separator == NULL) return NULL;
+
+    return StreamConstructor (filename, chunk_size, separator, NULL);
+}
+
+
+separation_stream*
+SeparationStreamConstructorByClasses (const char* const filename,
+                                      const size_t chunk_size,
+                                      const separation_char_classes* const classes)
+{
+    if (classes == NULL) return NULL;
+
+    return StreamConstructor (filename, chunk_size, NULL, classes);
+}
+
+
+separation_stream*
+SeparationStreamDestructor (separation_stream* const stream)
+{
+    if (stream == NULL) return NULL;
+
+    if (stream->file != NULL)
+        fclose (stream->file);
+
+    TrackedFree (stream->buffer, ALLOC_CATEGORY_TEXT);
+    StringsArrayDestructor (stream->strings.data);
+
+    TrackedFree ((void*) stream->hasher.initial_state, ALLOC_CATEGORY_TEXT);
+    TrackedFree (stream->string_state, ALLOC_CATEGORY_TEXT);
+    TrackedFree (stream->tail_state, ALLOC_CATEGORY_TEXT);
+    TrackedFree (stream->hashes, ALLOC_CATEGORY_TEXT);
+
+    TrackedFree (stream, ALLOC_CATEGORY_TEXT);
+
+    return NULL;
+}
+
+
+separation_error_t
+SeparationStreamSetThreads (separation_stream* const stream,
+                            const size_t threads_number)
+{
+    if (stream == NULL) return SEPARATION_ERROR;
+
+    stream->threads_number = threads_number;
+    return SEPARATION_SUCCESS;
+}
+
+
+separation_error_t
+SeparationStreamSetHasher (separation_stream* const stream,
+                           const separation_hasher* const hasher)
+{
+    if (stream                == NULL ||
+        hasher                == NULL ||
+        hasher->update        == NULL ||
+        hasher->final         == NULL ||
+        hasher->initial_state == NULL ||
+        stream->hasher.update != NULL ||
+        stream->data_size     != 0)
+        return SEPARATION_ERROR;
+
+    const size_t state_size = hasher->state_size;
+
+    void* const initial_state = TrackedMalloc (state_size, ALLOC_CATEGORY_TEXT);
+    stream->string_state      = TrackedMalloc (state_size, ALLOC_CATEGORY_TEXT);
+    stream->tail_state        = TrackedMalloc (state_size, ALLOC_CATEGORY_TEXT);
+
+    if (initial_state        == NULL ||
+        stream->string_state == NULL ||
+        stream->tail_state   == NULL)
+    {
+        TrackedFree (initial_state, ALLOC_CATEGORY_TEXT);
+        TrackedFree (stream->string_state, ALLOC_CATEGORY_TEXT);
+        TrackedFree (stream->tail_state, ALLOC_CATEGORY_TEXT);
+
+        stream->string_state = NULL;
+        stream->tail_state   = NULL;
+
+        return SEPARATION_ERROR;
+    }
+
+    memcpy (initial_state, hasher->initial_state, state_size);
+
+    stream->hasher = *hasher;
+    stream->hasher.initial_state = initial_state;
+
+    return SEPARATION_SUCCESS;
+}
+
+
+separation_error_t
+SeparationStreamNext (separation_stream* const stream,
+                      string_info* const string)
+{
+    if (stream == NULL ||
+        string == NULL)
+        return SEPARATION_ERROR;
+
+    while (stream->next_string == stream->strings.size)
+    {
+        if (stream->finished) return SEPARATION_END;
+
+        if (ReadNextChunk (stream) == SEPARATION_ERROR)
+            return SEPARATION_ERROR;
+    }
+
+    *string = stream->strings.data[stream->next_string];
+    ++stream->next_string;
+
+    return SEPARATION_SUCCESS;
+}
+
+
+separation_error_t
+SeparationStreamNextHashed (separation_stream* const stream,
+                            string_info* const string,
+                            size_t* const hash)
+{
+    if (stream == NULL ||
+        hash   == NULL ||
+        stream->hasher.update == NULL)
+        return SEPARATION_ERROR;
+
+    const separation_error_t status = SeparationStreamNext (stream, string);
+
+    if (status == SEPARATION_SUCCESS)
+        *hash = stream->hashes[stream->next_string - 1];
+
+    return status;
+}
+
+
+separation_error_t
+SeparationStreamForEach (separation_stream* const stream,
+                         separation_callback callback,
+                         void* const context)
+{
+    if (stream   == NULL ||
+        callback == NULL)
+        return SEPARATION_ERROR;
+
+    while (1)
+    {
+        const size_t strings_num = stream->strings.size;
+
+        for (; stream->next_string < strings_num; ++stream->next_string)
+            if (callback (stream->strings.data + stream->next_string,
+                          context) == SEPARATION_ERROR)
+                return SEPARATION_ERROR;
+
+        if (stream->finished) return SEPARATION_SUCCESS;
+
+        if (ReadNextChunk (stream) == SEPARATION_ERROR)
+            return SEPARATION_ERROR;
+    }
+}
+
+
+separation_error_t
+SeparationStreamForEachHashed (separation_stream* const stream,
+                               separation_hashed_callback callback,
+                               void* const context)
+{
+    if (stream   == NULL ||
+        callback == NULL ||
+        stream->hasher.update == NULL)
+        return SEPARATION_ERROR;
+
+    while (1)
+    {
+        const size_t strings_num = stream->strings.size;
+
+        for (; stream->next_string < strings_num; ++stream->next_string)
+            if (callback (stream->strings.data + stream->next_string,
+                          stream->hashes[stream->next_string],
+                          context) == SEPARATION_ERROR)
+                return SEPARATION_ERROR;
+
+        if (stream->finished) return SEPARATION_SUCCESS;
+
+        if (ReadNextChunk (stream) == SEPARATION_ERROR)
+            return SEPARATION_ERROR;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static functions implementation
+//-----------------------------------------------------------------------------
+
+static string_info*
+ReadFile (const char* const filename)
+{
+    if (filename == NULL) return NULL;
+
+    FILE* file = fopen (filename, "rb");
+    if (file == NULL) return NULL;
+
+    const size_t file_size = GetFileSize (file);
+    if (file_size == 0)
+    {
+        fclose (file);
+        return NULL;
+    }
+
+    char* buffer = TrackedMalloc (file_size, ALLOC_CATEGORY_TEXT);
+    if (buffer == NULL)
+    {
+        fclose (file);
+        return NULL;
+    }
+
+    fread (buffer, sizeof (char), file_size, file);
+    fclose (file);
+
+    string_info* text = StringInfoConstructor (buffer, file_size);
+    if (text == NULL) TrackedFree (buffer, ALLOC_CATEGORY_TEXT);
+
+    return text;
+}
+
+
+static size_t
+GetFileSize (FILE* const file)
+{
+    assert (file);
 
     fseek (file, 0, SEEK_END);
     const size_t file_size = ftell (file);
@@ -246,59 +1001,268 @@ GetFileSize (FILE* const file)
 }
 
 
-static size_t
-GetStringsNumber (string_info* const text,
-                  sep_function separator)
+static text_separation*
+MakeFileSeparation (const char* const filename,
+                    sep_function separator,
+                    const separation_char_classes* const classes,
+                    const size_t threads_number)
+{
+    string_info* const buffer = ReadFile (filename);
+    if (buffer == NULL) return NULL;
+
+    text_separation* const text_sep =
+        MakeSeparation (buffer, separator, classes, threads_number);
+    if (text_sep == NULL)
+    {
+        BufferDestructor (buffer);
+        return NULL;
+    }
+
+    text_sep->text = buffer;
+    return text_sep;
+}
+
+
+static text_separation*
+MakeSeparation (string_info* const text,
+                sep_function separator,
+                const separation_char_classes* const classes,
+                const size_t threads_number)
 {
     assert (text);
-    assert (separator);
+    assert (separator || classes);
 
     const size_t char_num = text->chars_number;
     char* const buffer = text->begin_ptr;
 
-    separator_function_status_t status      = END_SEPARATION;
-    separator_function_status_t prev_status = END_SEPARATION;
+    strings_vector  strings = {0};
+    tokenize_result result  = {0};
+
+    if (StringsVectorConstructor (&strings) == SEPARATION_ERROR)
+        return NULL;
 
-    size_t strings_num = 0;
+    separation_error_t status =
+        TokenizeRangeParallel (separator, classes, buffer, char_num,
+                               threads_number, &strings, &result);
 
-    for (size_t i = 0; i < char_num; ++i)
+    if (status == SEPARATION_SUCCESS && result.tail_offset < char_num)
+        status = StringsVectorPush (&strings, buffer + result.tail_offset,
+                                    char_num - result.tail_offset);
+
+    if (status == SEPARATION_ERROR)
     {
-        prev_status = status;
-        status = separator (buffer + i);
+        StringsArrayDestructor (strings.data);
+        return NULL;
+    }
+
+    text_separation* const text_sep =
+        TextSeparationConstructor (NULL, strings.data, strings.size);
+    if (text_sep == NULL)
+        StringsArrayDestructor (strings.data);
+
+    return text_sep;
+}
+
+
+static separation_error_t
+TokenizeRange (sep_function separator,
+               const separation_char_classes* const classes,
+               char* const begin,
+               const size_t size,
+               strings_vector* const strings,
+               tokenize_result* const result)
+{
+    if (classes != NULL)
+        return TokenizeByClasses (classes, begin, size, strings, result);
+
+    return TokenizeBySeparator (separator, begin, size, strings, result);
+}
 
-        if (status == END_SEPARATION) break;
 
-        if (prev_status != NOT_SEPARATOR_ELEMENT &&
-            status      == NOT_SEPARATOR_ELEMENT)
-            ++strings_num;
+static separation_error_t
+TokenizeRangeParallel (sep_function separator,
+                       const separation_char_classes* const classes,
+                       char* const begin,
+                       const size_t size,
+                       const size_t threads_number,
+                       strings_vector* const strings,
+                       tokenize_result* const result)
+{
+    assert (begin);
+    assert (strings);
+    assert (result);
+
+    const size_t threads = GetThreadsNumber (threads_number, size);
+    if (threads <= 1)
+        return TokenizeRange (separator, classes, begin, size, strings, result);
+
+    tokenize_task*  const tasks   =
+        TrackedCalloc (threads, sizeof (tokenize_task),  ALLOC_CATEGORY_TEXT);
+    strings_vector* const vectors =
+        TrackedCalloc (threads, sizeof (strings_vector), ALLOC_CATEGORY_TEXT);
+    pthread_t*      const ids     =
+        TrackedCalloc (threads, sizeof (pthread_t),      ALLOC_CATEGORY_TEXT);
+    int*            const started =
+        TrackedCalloc (threads, sizeof (int),            ALLOC_CATEGORY_TEXT);
+
+    separation_error_t status =
+        (tasks && vectors && ids && started) ? SEPARATION_SUCCESS :
+                                               SEPARATION_ERROR;
+    size_t range_begin = 0;
+
+    for (size_t i = 0; i < threads && status == SEPARATION_SUCCESS; ++i)
+    {
+        const size_t proposed  = size / threads * (i + 1);
+        const size_t range_end = (i == threads - 1) ? size :
+            FindRangeBoundary (separator, classes, begin, size,
+                               (proposed > range_begin) ? proposed : range_begin);
+
+        tasks[i].separator = separator;
+        tasks[i].classes   = classes;
+        tasks[i].begin     = begin + range_begin;
+        tasks[i].size      = range_end - range_begin;
+        tasks[i].is_last   = (i == threads - 1);
+        tasks[i].strings   = (i == 0) ? strings : vectors + i;
+
+        if (i != 0)
+            status = StringsVectorConstructor (vectors + i);
+
+        range_begin = range_end;
+    }
+
+    for (size_t i = 1; i < threads && status == SEPARATION_SUCCESS; ++i)
+        started[i] = (pthread_create (ids + i, NULL,
+                                      TokenizeTaskRun, tasks + i) == 0);
+
+    if (status == SEPARATION_SUCCESS)
+        TokenizeTaskRun (tasks);
+
+    for (size_t i = 1; i < threads && status == SEPARATION_SUCCESS; ++i)
+    {
+        if (started[i]) pthread_join (ids[i], NULL);
+        else            TokenizeTaskRun (tasks + i);
+    }
+
+    for (size_t i = 0; i < threads && status == SEPARATION_SUCCESS; ++i)
+    {
+        status = tasks[i].status;
+
+        if (i != 0 && status == SEPARATION_SUCCESS)
+            status = StringsVectorAppend (strings, vectors + i);
+
+        result->ended       = tasks[i].result.ended;
+        result->tail_offset = (size_t) (tasks[i].begin - begin) +
+                              tasks[i].result.tail_offset;
+
+        if (result->ended) break;
     }
 
-    return strings_num;
+    for (size_t i = 1; vectors != NULL && i < threads; ++i)
+        StringsArrayDestructor (vectors[i].data);
+
+    TrackedFree (started, ALLOC_CATEGORY_TEXT);
+    TrackedFree (ids, ALLOC_CATEGORY_TEXT);
+    TrackedFree (vectors, ALLOC_CATEGORY_TEXT);
+    TrackedFree (tasks, ALLOC_CATEGORY_TEXT);
+
+    return status;
 }
 
 
-static string_info**
-MakeSeparation (string_info* const text,
-                sep_function separator,
-                const size_t strings_num)
+static void*
+TokenizeTaskRun (void* const task)
 {
-    assert (text);
-    assert (separator);
+    assert (task);
 
-    string_info** strings_array = calloc (strings_num, sizeof (string_info*));
-    if (strings_array == NULL) return NULL;
+    tokenize_task* const range = (tokenize_task*) task;
 
-    const size_t char_num = text->chars_number;
-    char* const buffer = text->begin_ptr;
+    range->status = TokenizeRange (range->separator, range->classes,
+                                   range->begin, range->size,
+                                   range->strings, &range->result);
+
+    if (range->status        == SEPARATION_ERROR ||
+        range->is_last       ||
+        range->result.ended  ||
+        range->result.tail_offset == range->size)
+        return NULL;
 
-    char*  cur_string_begin = buffer;
-    size_t cur_string_index = 0;
+    range->status = StringsVectorPush (range->strings,
+                                       range->begin + range->result.tail_offset,
+                                       range->size  - range->result.tail_offset);
+    range->result.tail_offset = range->size;
+
+    return NULL;
+}
+
+
+static size_t
+FindRangeBoundary (sep_function separator,
+                   const separation_char_classes* const classes,
+                   char* const begin,
+                   const size_t size,
+                   size_t boundary)
+{
+    assert (separator || classes);
+    assert (begin);
+
+    if (classes != NULL)
+    {
+        while (boundary > 0 && boundary < size &&
+               classes->string_chars[(unsigned char) begin[boundary - 1]])
+            ++boundary;
+    }
+
+    else
+    {
+        while (boundary > 0 && boundary < size &&
+               separator (begin + boundary - 1) == NOT_SEPARATOR_ELEMENT)
+            ++boundary;
+    }
+
+    return (boundary < size) ? boundary : size;
+}
+
+
+static size_t
+GetThreadsNumber (const size_t threads_number,
+                  const size_t size)
+{
+    size_t threads = threads_number;
+
+    if (threads == 0)
+    {
+        const long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0) ? (size_t) cpus : 1;
+    }
+
+    const size_t max_threads = size / PARALLEL_MIN_RANGE_SIZE;
+    if (threads > max_threads) threads = max_threads;
+
+    return (threads == 0) ? 1 : threads;
+}
+
+
+static separation_error_t
+TokenizeBySeparator (sep_function separator,
+                     char* const begin,
+                     const size_t size,
+                     strings_vector* const strings,
+                     tokenize_result* const result)
+{
+    assert (separator);
+    assert (begin);
+    assert (strings);
+    assert (result);
+
+    char*  cur_string_begin = begin;
     size_t cur_string_size  = 0;
-    separator_function_status_t status = END_SEPARATION;
+    separator_function_status_t status = NOT_SEPARATOR_ELEMENT;
 
-    for (size_t i = 0; i < char_num; ++i)
+    result->ended = 0;
+
+    for (size_t i = 0; i < size && status != END_SEPARATION; ++i)
     {
-        status = separator (buffer + i);
+        status = separator (begin + i);
 
         switch (status)
         {
@@ -319,31 +1283,495 @@ MakeSeparation (string_info* const text,
                     break;
                 }
 
-                strings_array[cur_string_index] =
-                    StringInfoConstructor (cur_string_begin, cur_string_size);
-                ++cur_string_index;
-                cur_string_begin = buffer + i + 1;
+                if (StringsVectorPush (strings, cur_string_begin,
+                                       cur_string_size) == SEPARATION_ERROR)
+                    return SEPARATION_ERROR;
+
+                cur_string_begin = begin + i + 1;
                 cur_string_size  = 0;
                 break;
 
             case END_SEPARATION:
-                return strings_array;
+            default:
+                result->ended = 1;
+                break;
+        }
+    }
+
+    result->tail_offset = (cur_string_size == 0) ?
+                          size : (size_t) (cur_string_begin - begin);
+
+    return SEPARATION_SUCCESS;
+}
+
+
+static separation_error_t
+TokenizeByClasses (const separation_char_classes* const classes,
+                   char* const begin,
+                   const size_t size,
+                   strings_vector* const strings,
+                   tokenize_result* const result)
+{
+    assert (classes);
+    assert (begin);
+    assert (strings);
+    assert (result);
+
+    size_t string_begin = SIZE_MAX;
+    separation_error_t status = SEPARATION_SUCCESS;
+
+    result->ended = 0;
+
+    switch (GetSimdLevel (classes->simd_level))
+    {
+    #if SEPARATION_X86_SIMD
+        case SEPARATION_SIMD_AVX512:
+            status = TokenizeByClassesAvx512 (classes, begin, size,
+                                              strings, &string_begin);
+            break;
+
+        case SEPARATION_SIMD_AVX2:
+            status = TokenizeByClassesAvx2 (classes, begin, size,
+                                            strings, &string_begin);
+            break;
+    #endif
+
+        case SEPARATION_SIMD_SCALAR:
+        case SEPARATION_SIMD_AUTO:
+        default:
+            status = TokenizeByClassesScalar (classes, begin, size, 0,
+                                              strings, &string_begin);
+            break;
+    }
+
+    result->tail_offset = (string_begin == SIZE_MAX) ? size : string_begin;
+    return status;
+}
+
+
+static separation_error_t
+TokenizeByClassesScalar (const separation_char_classes* const classes,
+                         char* const begin,
+                         const size_t size,
+                         size_t start,
+                         strings_vector* const strings,
+                         size_t* const string_begin)
+{
+    assert (classes);
+    assert (begin);
+    assert (strings);
+    assert (string_begin);
+
+    const unsigned char* const string_chars = classes->string_chars;
+    size_t cur_string_begin = *string_begin;
+
+    for (size_t i = start; i < size; ++i)
+    {
+        const int is_string_char = string_chars[(unsigned char) begin[i]];
+
+        if (is_string_char && cur_string_begin == SIZE_MAX)
+            cur_string_begin = i;
+
+        else if (!is_string_char && cur_string_begin != SIZE_MAX)
+        {
+            if (StringsVectorPush (strings, begin + cur_string_begin,
+                                   i - cur_string_begin) == SEPARATION_ERROR)
+                return SEPARATION_ERROR;
+
+            cur_string_begin = SIZE_MAX;
+        }
+    }
+
+    *string_begin = cur_string_begin;
+    return SEPARATION_SUCCESS;
+}
+
+
+static inline separation_error_t
+PushBlockStrings (char* const begin,
+                  const size_t block_offset,
+                  uint64_t mask,
+                  const uint64_t prev_mask,
+                  strings_vector* const strings,
+                  size_t* const string_begin)
+{
+    uint64_t edges = mask ^ ((mask << 1) | (prev_mask >> 63));
+
+    while (edges != 0)
+    {
+        const size_t pos = block_offset + (size_t) __builtin_ctzll (edges);
+
+        if (*string_begin == SIZE_MAX)
+            *string_begin = pos;
+
+        else
+        {
+            if (StringsVectorPush (strings, begin + *string_begin,
+                                   pos - *string_begin) == SEPARATION_ERROR)
+                return SEPARATION_ERROR;
+
+            *string_begin = SIZE_MAX;
+        }
+
+        edges &= edges - 1;
+    }
+
+    return SEPARATION_SUCCESS;
+}
+
+#if SEPARATION_X86_SIMD
+
+/**
+ * @brief Classifies 32 characters with nibble lookups
+ *
+ * @details Bit (hi & 7) of the low nibble table entry tells whether
+ * character (hi << 4 | lo) is a string character, the tables for hi < 8
+ * and hi >= 8 are blended by the sign bit of the character
+ */
+__attribute__ ((target ("avx2,bmi")))
+static inline uint32_t
+ClassifyAvx2 (const __m256i chars,
+              const __m256i lo_bits,
+              const __m256i hi_bits,
+              const __m256i nibble_bit)
+{
+    const __m256i nibble_mask = _mm256_set1_epi8 (0x0f);
+
+    const __m256i low  = _mm256_and_si256 (chars, nibble_mask);
+    const __m256i high = _mm256_and_si256 (_mm256_srli_epi16 (chars, 4),
+                                           nibble_mask);
+
+    const __m256i row = _mm256_blendv_epi8 (_mm256_shuffle_epi8 (lo_bits, low),
+                                            _mm256_shuffle_epi8 (hi_bits, low),
+                                            chars);
+    const __m256i bit = _mm256_shuffle_epi8 (nibble_bit, high);
+
+    const __m256i not_string =
+        _mm256_cmpeq_epi8 (_mm256_and_si256 (row, bit),
+                           _mm256_setzero_si256 ());
+
+    return ~(uint32_t) _mm256_movemask_epi8 (not_string);
+}
+
+
+__attribute__ ((target ("avx2,bmi")))
+static separation_error_t
+TokenizeByClassesAvx2 (const separation_char_classes* const classes,
+                       char* const begin,
+                       const size_t size,
+                       strings_vector* const strings,
+                       size_t* const string_begin)
+{
+    assert (classes);
+    assert (begin);
+    assert (strings);
+    assert (string_begin);
+
+    const __m256i lo_bits = _mm256_broadcastsi128_si256 (
+        _mm_loadu_si128 ((const __m128i*) classes->low_nibble_lo_bits));
+    const __m256i hi_bits = _mm256_broadcastsi128_si256 (
+        _mm_loadu_si128 ((const __m128i*) classes->low_nibble_hi_bits));
+    const __m256i nibble_bit = _mm256_setr_epi8 (
+        1, 2, 4, 8, 16, 32, 64, (char) 128, 1, 2, 4, 8, 16, 32, 64, (char) 128,
+        1, 2, 4, 8, 16, 32, 64, (char) 128, 1, 2, 4, 8, 16, 32, 64, (char) 128);
+
+    uint64_t prev_mask = 0;
+    size_t   offset    = 0;
+
+    for (; offset + CLASSES_BLOCK_SIZE <= size; offset += CLASSES_BLOCK_SIZE)
+    {
+        const __m256i chars_lo = _mm256_loadu_si256 ((const __m256i*) (begin + offset));
+        const __m256i chars_hi = _mm256_loadu_si256 ((const __m256i*) (begin + offset + 32));
+
+        const uint64_t mask =
+            (uint64_t) ClassifyAvx2 (chars_lo, lo_bits, hi_bits, nibble_bit) |
+            (uint64_t) ClassifyAvx2 (chars_hi, lo_bits, hi_bits, nibble_bit) << 32;
+
+        if (PushBlockStrings (begin, offset, mask, prev_mask,
+                              strings, string_begin) == SEPARATION_ERROR)
+            return SEPARATION_ERROR;
+
+        prev_mask = mask;
+    }
+
+    return TokenizeByClassesScalar (classes, begin, size, offset,
+                                    strings, string_begin);
+}
+
+
+__attribute__ ((target ("avx512f,avx512bw,bmi")))
+static separation_error_t
+TokenizeByClassesAvx512 (const separation_char_classes* const classes,
+                         char* const begin,
+                         const size_t size,
+                         strings_vector* const strings,
+                         size_t* const string_begin)
+{
+    assert (classes);
+    assert (begin);
+    assert (strings);
+    assert (string_begin);
+
+    const __m512i lo_bits = _mm512_broadcast_i32x4 (
+        _mm_loadu_si128 ((const __m128i*) classes->low_nibble_lo_bits));
+    const __m512i hi_bits = _mm512_broadcast_i32x4 (
+        _mm_loadu_si128 ((const __m128i*) classes->low_nibble_hi_bits));
+    const __m512i nibble_bit  = _mm512_broadcast_i32x4 (_mm_setr_epi8 (
+        1, 2, 4, 8, 16, 32, 64, (char) 128, 1, 2, 4, 8, 16, 32, 64, (char) 128));
+    const __m512i nibble_mask = _mm512_set1_epi8 (0x0f);
+
+    uint64_t prev_mask = 0;
+    size_t   offset    = 0;
+
+    for (; offset + CLASSES_BLOCK_SIZE <= size; offset += CLASSES_BLOCK_SIZE)
+    {
+        const __m512i chars = _mm512_loadu_si512 (begin + offset);
+
+        const __m512i low  = _mm512_and_si512 (chars, nibble_mask);
+        const __m512i high = _mm512_and_si512 (_mm512_srli_epi16 (chars, 4),
+                                               nibble_mask);
+
+        const __m512i row = _mm512_mask_blend_epi8 (_mm512_movepi8_mask (chars),
+                                                    _mm512_shuffle_epi8 (lo_bits, low),
+                                                    _mm512_shuffle_epi8 (hi_bits, low));
+        const __m512i bit = _mm512_shuffle_epi8 (nibble_bit, high);
+
+        const uint64_t mask = _mm512_test_epi8_mask (row, bit);
+
+        if (PushBlockStrings (begin, offset, mask, prev_mask,
+                              strings, string_begin) == SEPARATION_ERROR)
+            return SEPARATION_ERROR;
+
+        prev_mask = mask;
+    }
+
+    return TokenizeByClassesScalar (classes, begin, size, offset,
+                                    strings, string_begin);
+}
+
+#endif // SEPARATION_X86_SIMD
+
+
+static separation_simd_level
+GetSimdLevel (const separation_simd_level requested)
+{
+#if SEPARATION_X86_SIMD
+    const int has_avx512 = __builtin_cpu_supports ("avx512bw") &&
+                           __builtin_cpu_supports ("bmi");
+    const int has_avx2   = __builtin_cpu_supports ("avx2") &&
+                           __builtin_cpu_supports ("bmi");
+
+    if (requested == SEPARATION_SIMD_SCALAR) return SEPARATION_SIMD_SCALAR;
+
+    if (requested != SEPARATION_SIMD_AVX2 && has_avx512)
+        return SEPARATION_SIMD_AVX512;
+
+    if (has_avx2) return SEPARATION_SIMD_AVX2;
+
+    return SEPARATION_SIMD_SCALAR;
+#else
+    (void) requested;
+    return SEPARATION_SIMD_SCALAR;
+#endif
+}
+
+
+static void
+BuildNibbleTables (separation_char_classes* const classes)
+{
+    assert (classes);
+
+    memset (classes->low_nibble_lo_bits, 0, sizeof (classes->low_nibble_lo_bits));
+    memset (classes->low_nibble_hi_bits, 0, sizeof (classes->low_nibble_hi_bits));
+
+    for (size_t i = 0; i < sizeof (classes->string_chars); ++i)
+    {
+        if (classes->string_chars[i] == 0) continue;
+
+        const size_t low  = i & 0x0f;
+        const size_t high = i >> 4;
+
+        if (high < 8)
+            classes->low_nibble_lo_bits[low] |= (unsigned char) (1u << high);
+        else
+            classes->low_nibble_hi_bits[low] |= (unsigned char) (1u << (high - 8));
+    }
+}
+
+
+static separation_stream*
+StreamConstructor (const char* const filename,
+                   const size_t chunk_size,
+                   sep_function separator,
+                   const separation_char_classes* const classes)
+{
+    assert (separator || classes);
+
+    if (filename == NULL) return NULL;
+
+    separation_stream* const stream =
+        TrackedCalloc (1, sizeof (separation_stream), ALLOC_CATEGORY_TEXT);
+    if (stream == NULL) return NULL;
+
+    stream->separator      = separator;
+    stream->classes        = classes;
+    stream->threads_number = 1;
+    stream->capacity  = (chunk_size == 0) ? STREAM_DEFAULT_CHUNK_SIZE :
+                                            chunk_size;
+
+    stream->file = fopen (filename, "rb");
+    if (stream->file == NULL)
+        return SeparationStreamDestructor (stream);
+
+    // the stream reads whole chunks itself, stdio buffer is only a copy
+    setvbuf (stream->file, NULL, _IONBF, 0);
+
+    stream->buffer = TrackedMalloc (stream->capacity, ALLOC_CATEGORY_TEXT);
+    if (stream->buffer == NULL)
+        return SeparationStreamDestructor (stream);
+
+    if (StringsVectorConstructor (&stream->strings) == SEPARATION_ERROR)
+        return SeparationStreamDestructor (stream);
+
+    return stream;
+}
+
+
+static separation_error_t
+ReadNextChunk (separation_stream* const stream)
+{
+    assert (stream);
+    assert (stream->buffer);
+
+    const size_t tail_size = stream->data_size - stream->tail_offset;
+    memmove (stream->buffer, stream->buffer + stream->tail_offset, tail_size);
+
+    if (tail_size == stream->capacity)
+    {
+        const size_t new_capacity = stream->capacity * 2;
+        char* const new_buffer = TrackedRealloc (stream->buffer, new_capacity,
+                                                 ALLOC_CATEGORY_TEXT);
+        if (new_buffer == NULL) return SEPARATION_ERROR;
+
+        stream->buffer   = new_buffer;
+        stream->capacity = new_capacity;
+    }
+
+    const size_t read_size = fread (stream->buffer + tail_size, sizeof (char),
+                                    stream->capacity - tail_size, stream->file);
+
+    stream->data_size     = tail_size + read_size;
+    stream->strings.size  = 0;
+    stream->next_string   = 0;
+
+    tokenize_result result = {0};
+    if (TokenizeRangeParallel (stream->separator, stream->classes,
+                               stream->buffer, stream->data_size,
+                               stream->threads_number,
+                               &stream->strings, &result) == SEPARATION_ERROR)
+        return SEPARATION_ERROR;
+
+    stream->tail_offset = result.tail_offset;
+
+    if (read_size == 0 || result.ended)
+    {
+        stream->finished = 1;
+
+        if (result.tail_offset < stream->data_size &&
+            StringsVectorPush (&stream->strings,
+                               stream->buffer   + result.tail_offset,
+                               stream->data_size - result.tail_offset)
+            == SEPARATION_ERROR)
+            return SEPARATION_ERROR;
+
+        stream->tail_offset = stream->data_size;
+    }
+
+    if (stream->hasher.update == NULL)
+        return SEPARATION_SUCCESS;
+
+    return HashChunkStrings (stream);
+}
+
+
+static separation_error_t
+HashChunkStrings (separation_stream* const stream)
+{
+    assert (stream);
+    assert (stream->hasher.update);
+
+    const separation_hasher* const hasher = &stream->hasher;
+    const size_t strings_num = stream->strings.size;
+
+    if (strings_num > stream->hashes_capacity)
+    {
+        size_t* const new_hashes =
+            TrackedRealloc (stream->hashes,
+                            stream->strings.capacity * sizeof (size_t),
+                            ALLOC_CATEGORY_TEXT);
+        if (new_hashes == NULL) return SEPARATION_ERROR;
+
+        stream->hashes          = new_hashes;
+        stream->hashes_capacity = stream->strings.capacity;
+    }
+
+    for (size_t i = 0; i < strings_num; ++i)
+    {
+        const string_info* const string = stream->strings.data + i;
+        size_t hashed = 0;
+
+        if (i == 0 && stream->tail_hashed != 0)
+        {
+            assert (string->begin_ptr    == stream->buffer);
+            assert (string->chars_number >= stream->tail_hashed);
+
+            memcpy (stream->string_state, stream->tail_state, hasher->state_size);
+            hashed = stream->tail_hashed;
         }
+
+        else
+            memcpy (stream->string_state, hasher->initial_state,
+                    hasher->state_size);
+
+        hasher->update (stream->string_state, string->begin_ptr + hashed,
+                        string->chars_number - hashed);
+        stream->hashes[i] = hasher->final (stream->string_state);
     }
 
-    return strings_array;
+    const size_t tail_offset = stream->tail_offset;
+    const size_t tail_size   = stream->data_size - tail_offset;
+
+    if (tail_size == 0)
+    {
+        stream->tail_hashed = 0;
+        return SEPARATION_SUCCESS;
+    }
+
+    // the whole chunk is one unfinished string, continue its state
+    if (tail_offset != 0 || stream->tail_hashed == 0)
+    {
+        memcpy (stream->tail_state, hasher->initial_state, hasher->state_size);
+        stream->tail_hashed = 0;
+    }
+
+    hasher->update (stream->tail_state,
+                    stream->buffer + tail_offset + stream->tail_hashed,
+                    tail_size - stream->tail_hashed);
+    stream->tail_hashed = tail_size;
+
+    return SEPARATION_SUCCESS;
 }
 
 
 static text_separation*
 TextSeparationConstructor (string_info* const text,
-                           string_info** const strings_array,
+                           string_info* const strings_array,
                            const size_t strings_num)
 {
-    assert (text);
     assert (strings_array);
 
-    text_separation* text_sep = malloc (sizeof (text_separation));
+    text_separation* text_sep = TrackedMalloc (sizeof (text_separation),
+                                               ALLOC_CATEGORY_TEXT);
     if (text_sep == NULL) return NULL;
 
     text_sep->text           = text;
@@ -354,38 +1782,93 @@ TextSeparationConstructor (string_info* const text,
 }
 
 
-static text_separation*
-AbortSeparation (string_info* const text,
-                 string_info** const strings_array,
-                 const size_t strings_num)
+static string_info*
+BufferDestructor (string_info* const text)
 {
-    BufferDestructor (text);
-    StringsArrayDestructor (strings_array, strings_num);
+    if (text == NULL) return NULL;
 
-    return NULL;
+    TrackedFree (text->begin_ptr, ALLOC_CATEGORY_TEXT);
+    return StringInfoDestructor (text);
 }
 
 
-static string_info*
-BufferDestructor (string_info* const text)
+static separation_error_t
+StringsVectorConstructor (strings_vector* const strings)
 {
-    if (text == NULL) return NULL;
+    assert (strings);
 
-    free (text->begin_ptr);
-    return StringInfoDestructor (text);
+    strings->data = TrackedMalloc (STRINGS_ARRAY_MIN_CAPACITY *
+                                   sizeof (string_info),
+                                   ALLOC_CATEGORY_TEXT);
+    if (strings->data == NULL) return SEPARATION_ERROR;
+
+    strings->size     = 0;
+    strings->capacity = STRINGS_ARRAY_MIN_CAPACITY;
+
+    return SEPARATION_SUCCESS;
 }
 
 
-static string_info**
-StringsArrayDestructor (string_info** const strings_array,
-                        const size_t strings_num)
+static inline separation_error_t
+StringsVectorPush (strings_vector* const strings,
+                   char* const begin_ptr,
+                   const size_t chars_number)
 {
-    if (strings_array == NULL) return NULL;
+    assert (strings);
+    assert (strings->data);
+
+    if (strings->size == strings->capacity)
+    {
+        const size_t new_capacity = strings->capacity * 2;
+        string_info* const new_data =
+            TrackedRealloc (strings->data, new_capacity * sizeof (string_info),
+                            ALLOC_CATEGORY_TEXT);
+        if (new_data == NULL) return SEPARATION_ERROR;
+
+        strings->data     = new_data;
+        strings->capacity = new_capacity;
+    }
+
+    strings->data[strings->size].begin_ptr    = begin_ptr;
+    strings->data[strings->size].chars_number = chars_number;
+    ++strings->size;
+
+    return SEPARATION_SUCCESS;
+}
 
-    for (size_t i = 0; i < strings_num; ++i)
-        strings_array[i] = StringInfoDestructor (strings_array[i]);
 
-    free (strings_array);
+static separation_error_t
+StringsVectorAppend (strings_vector* const strings,
+                     const strings_vector* const source)
+{
+    assert (strings);
+    assert (source);
+
+    const size_t new_size = strings->size + source->size;
+
+    if (new_size > strings->capacity)
+    {
+        string_info* const new_data =
+            TrackedRealloc (strings->data, new_size * sizeof (string_info),
+                            ALLOC_CATEGORY_TEXT);
+        if (new_data == NULL) return SEPARATION_ERROR;
+
+        strings->data     = new_data;
+        strings->capacity = new_size;
+    }
+
+    memcpy (strings->data + strings->size, source->data,
+            source->size * sizeof (string_info));
+    strings->size = new_size;
+
+    return SEPARATION_SUCCESS;
+}
+
+
+static string_info*
+StringsArrayDestructor (string_info* const strings_array)
+{
+    TrackedFree (strings_array, ALLOC_CATEGORY_TEXT);
     return NULL;
 }
 
@@ -394,7 +1877,8 @@ static string_info*
 StringInfoConstructor (char* const begin_ptr,
                        const size_t chars_number)
 {
-    string_info* const string = malloc (sizeof (string_info));
+    string_info* const string = TrackedMalloc (sizeof (string_info),
+                                               ALLOC_CATEGORY_TEXT);
     if (string == NULL) return NULL;
 
     string->begin_ptr    = begin_ptr;
@@ -411,7 +1895,7 @@ StringInfoDestructor (string_info* const string)
 
     string->begin_ptr    = NULL;
     string->chars_number = 0;
-    free (string);
+    TrackedFree (string, ALLOC_CATEGORY_TEXT);
 
     return NULL;
 }
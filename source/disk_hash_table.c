@@ -0,0 +1,1041 @@
+#include "disk_hash_table.h"
+#include "doubly_linked_list.h"
+#include <assert.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+
+//-----------------------------------------------------------------------------
+// Consts
+//-----------------------------------------------------------------------------
+
+/// @brief Size of one page of the file
+static const size_t DISK_PAGE_SIZE = 4096;
+
+
+/// @brief Default number of pages in the cache
+static const size_t DISK_DEFAULT_CACHE_PAGES = 1024;
+
+
+/// @brief Minimal number of pages in the cache, a split needs two pages
+static const size_t DISK_MIN_CACHE_PAGES = 2;
+
+
+/// @brief Maximal number of hash bits indexing the directory
+static const size_t DISK_MAX_GLOBAL_DEPTH = 32;
+
+
+/// @brief Index of the page with the file description
+static const uint64_t DISK_META_PAGE = 0;
+
+
+/// @brief Index of the first data page of the new file
+static const uint64_t DISK_FIRST_PAGE = 1;
+
+
+/// @brief Magic bytes of the file, the last ones are the version
+static const char DISK_MAGIC[8] = {'H', 'T', 'D', 'I', 'S', 'K', '0', '1'};
+
+
+/// @brief Key hashed to check the hash function of the opened file
+static const char DISK_PROBE_KEY[] = "disk hash table probe key";
+
+
+/// @brief Alignment of the records and the values in the page
+static const size_t DISK_RECORD_ALIGNMENT = 8;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static structures
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Description of the file, kept in the first page
+ */
+typedef
+struct disk_meta
+{
+    char     magic[8];          ///< DISK_MAGIC
+    uint64_t page_size;         ///< DISK_PAGE_SIZE
+    uint64_t global_depth;      ///< number of hash bits indexing the directory
+    uint64_t pages_number;      ///< number of pages including this one
+    uint64_t elem_number;       ///< number of elements
+    uint64_t directory_offset;  ///< offset of the saved directory
+    uint64_t probe_hash;        ///< whole hash of DISK_PROBE_KEY
+}
+disk_meta;
+
+
+/**
+ * @brief Header of the data page, the records follow it
+ */
+typedef
+struct page_header
+{
+    uint32_t local_depth;       ///< number of hash bits common for the page
+    uint32_t records_number;    ///< number of records in the page
+    uint32_t used_bytes;        ///< bytes taken by the header and the records
+    uint32_t reserved;          ///< zero
+}
+page_header;
+
+
+/**
+ * @brief Header of the record, the key and the value bytes follow it
+ */
+typedef
+struct record_header
+{
+    uint64_t hash;              ///< whole hash of the key
+    uint32_t key_size;          ///< size of the key
+    uint32_t value_size;        ///< size of the value
+}
+record_header;
+
+
+/**
+ * @brief Frame of the page cache
+ */
+typedef
+struct cache_frame
+{
+    uint64_t page_index;        ///< cached page, DISK_META_PAGE if free
+    char*    data;              ///< page bytes
+    int      dirty;             ///< non-zero if the page must be written
+    int      referenced;        ///< non-zero if used since the clock hand
+}
+cache_frame;
+
+
+struct disk_hash_table
+{
+    int           fd;               ///< file descriptor
+    hash_function h_func;           ///< hash function
+
+    uint64_t* directory;            ///< 2^global_depth page indexes
+    size_t    global_depth;         ///< number of hash bits of the directory
+    size_t    pages_number;         ///< number of pages including meta page
+    size_t    elem_number;          ///< number of elements
+
+    cache_frame* frames;            ///< page cache
+    char*        frames_data;       ///< bytes of all frames
+    size_t       frames_number;     ///< number of frames
+    size_t       clock_hand;        ///< next frame checked for the eviction
+    size_t       last_frame;        ///< frame never evicted by the next miss
+
+    uint32_t* page_frames;          ///< frame + 1 of every page, 0 if none
+    size_t    page_frames_capacity; ///< number of allocated page_frames
+
+    char* split_buffer;             ///< copy of the page being split
+
+    disk_hash_table_stats stats;    ///< counters
+};
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static functions prototypes
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Makes the meta page, the first data page and the directory
+ * of the new file
+ */
+static hash_table_error_status
+CreateFile (disk_hash_table* const table);
+
+
+/**
+ * @brief Reads the meta page and the directory of the existing file
+ */
+static hash_table_error_status
+OpenFile (disk_hash_table* const table,
+          const size_t file_size);
+
+
+/**
+ * @brief Writes the meta page and the directory after the last page
+ */
+static hash_table_error_status
+SaveDirectory (disk_hash_table* const table);
+
+
+/**
+ * @brief Gets the page from the cache, reads it if missed
+ *
+ * @param table Pointer to the disk hash table
+ * @param page_index Index of the page
+ * @param is_new Non-zero if the page is not in the file yet
+ *
+ * @retval Pointer to the page bytes
+ * @retval NULL if the file can not be read or written
+ *
+ * @details The returned frame is not evicted by the next miss
+ */
+static char*
+GetPage (disk_hash_table* const table,
+         const uint64_t page_index,
+         const int is_new);
+
+
+/**
+ * @brief Selects the frame to evict by the clock algorithm
+ */
+static size_t
+SelectVictim (disk_hash_table* const table);
+
+
+/**
+ * @brief Writes the frame page to the file
+ */
+static hash_table_error_status
+WriteFrame (disk_hash_table* const table,
+            cache_frame* const frame);
+
+
+/**
+ * @brief Marks the last got page dirty
+ */
+static void
+MarkDirty (disk_hash_table* const table);
+
+
+/**
+ * @brief Makes the new empty page at the end of the file
+ *
+ * @retval Index of the page
+ * @retval DISK_META_PAGE if error occured
+ */
+static uint64_t
+AllocatePage (disk_hash_table* const table,
+              const uint32_t local_depth);
+
+
+/**
+ * @brief Splits the page by one more hash bit
+ *
+ * @param table Pointer to the disk hash table
+ * @param page_index Index of the full page
+ * @param hash Any hash mapped to the page
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_ERROR if the records and the hash share the split bit
+ * @retval HASH_TABLE_ERROR if the directory can not grow
+ * @retval HASH_TABLE_ERROR if the file can not be read or written
+ */
+static hash_table_error_status
+SplitPage (disk_hash_table* const table,
+           const uint64_t page_index,
+           const uint64_t hash);
+
+
+/**
+ * @brief Checks if some split of the page can ever separate its records
+ *
+ * @details One split may leave every record on one side, the next ones use
+ * the next hash bits, so only the records with the same directory bits
+ * never separate.
+ *
+ * @param page Full page to split
+ * @param hash Hash of the record to insert
+ *
+ * @retval 1 if the records and the hash differ in the DISK_MAX_GLOBAL_DEPTH low bits
+ * @retval 0 if all of them are equal in these bits
+ */
+static int
+SplitSeparates (const char* const page,
+                const uint64_t hash);
+
+
+/**
+ * @brief Doubles the directory
+ */
+static hash_table_error_status
+DoubleDirectory (disk_hash_table* const table);
+
+
+/**
+ * @brief Finds the record with the key in the page
+ *
+ * @retval Pointer to the record
+ * @retval NULL if not found
+ */
+static record_header*
+FindRecord (char* const page,
+            hash_table_key* const key,
+            const uint64_t hash,
+            hash_table_key_comparator key_cmp);
+
+
+/**
+ * @brief Appends the record to the page, it must fit
+ */
+static void
+AppendRecord (char* const page,
+              const uint64_t hash,
+              const void* const key,
+              const size_t key_size,
+              const void* const value,
+              const size_t value_size);
+
+
+/**
+ * @brief Number of bytes taken by the record with the key and the value
+ */
+static size_t
+GetRecordSize (const size_t key_size,
+               const size_t value_size);
+
+
+/**
+ * @brief Offset of the value from the record beginning, the value is aligned
+ */
+static size_t
+GetValueOffset (const size_t key_size);
+
+
+/**
+ * @brief Gets the page containing the hash
+ */
+static uint64_t
+GetPageIndex (const disk_hash_table* const table,
+              const uint64_t hash);
+
+
+/**
+ * @brief Hashes DISK_PROBE_KEY by the function
+ */
+static hash_table_index
+GetProbeHash (hash_function h_func);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Disk hash table functions implementation
+//-----------------------------------------------------------------------------
+
+disk_hash_table*
+DiskHashTableConstructor (const char* const filename,
+                          hash_function h_func,
+                          const size_t cache_pages)
+{
+    if (filename == NULL ||
+        h_func   == NULL)
+        return NULL;
+
+    disk_hash_table* const table = calloc (1, sizeof (disk_hash_table));
+    if (table == NULL) return NULL;
+
+    table->fd     = open (filename, O_RDWR | O_CREAT, 0644);
+    table->h_func = h_func;
+
+    table->frames_number = (cache_pages == 0) ? DISK_DEFAULT_CACHE_PAGES :
+                           (cache_pages < DISK_MIN_CACHE_PAGES) ?
+                           DISK_MIN_CACHE_PAGES : cache_pages;
+    table->last_frame    = table->frames_number;
+
+    table->frames       = calloc (table->frames_number, sizeof (cache_frame));
+    table->frames_data  = calloc (table->frames_number, DISK_PAGE_SIZE);
+    table->split_buffer = calloc (1, DISK_PAGE_SIZE);
+
+    struct stat file_stat = {0};
+
+    if (table->fd           == -1   ||
+        table->frames       == NULL ||
+        table->frames_data  == NULL ||
+        table->split_buffer == NULL ||
+        fstat (table->fd, &file_stat) == -1)
+        return DiskHashTableDestructor (table);
+
+    for (size_t i = 0; i < table->frames_number; ++i)
+        table->frames[i].data = table->frames_data + i * DISK_PAGE_SIZE;
+
+    const hash_table_error_status status = (file_stat.st_size == 0) ?
+        CreateFile (table) : OpenFile (table, (size_t) file_stat.st_size);
+
+    if (status == HASH_TABLE_ERROR)
+    {
+        // the file is not ours, it must not be changed by the destructor
+        free (table->directory);
+        table->directory = NULL;
+
+        return DiskHashTableDestructor (table);
+    }
+
+    return table;
+}
+
+
+disk_hash_table*
+DiskHashTableDestructor (disk_hash_table* const table)
+{
+    if (table == NULL) return NULL;
+
+    if (table->directory != NULL)
+        SaveDirectory (table);
+
+    if (table->fd != -1)
+        close (table->fd);
+
+    free (table->directory);
+    free (table->frames);
+    free (table->frames_data);
+    free (table->page_frames);
+    free (table->split_buffer);
+    free (table);
+
+    return NULL;
+}
+
+
+hash_table_error_status
+DiskHashTableInsert (disk_hash_table*  const table,
+                     hash_table_key*   const key,
+                     hash_table_value* const value,
+                     hash_table_key_comparator key_cmp)
+{
+    if (table   == NULL ||
+        key     == NULL ||
+        key_cmp == NULL)
+        return HASH_TABLE_ERROR;
+
+    const void*  const value_buffer = (value != NULL) ? value->value      : NULL;
+    const size_t       value_size   = (value != NULL) ? value->value_size : 0;
+
+    const size_t record_size = GetRecordSize (key->key_size, value_size);
+    if (record_size > DISK_PAGE_SIZE - sizeof (page_header))
+        return HASH_TABLE_ERROR;
+
+    const uint64_t hash = table->h_func (key, HASH_TABLE_FULL_RANGE);
+
+    while (1)
+    {
+        const uint64_t page_index = GetPageIndex (table, hash);
+
+        char* const page = GetPage (table, page_index, 0);
+        if (page == NULL) return HASH_TABLE_ERROR;
+
+        if (FindRecord (page, key, hash, key_cmp) != NULL)
+            return HASH_TABLE_SUCCESS;
+
+        if (((page_header*) page)->used_bytes + record_size <= DISK_PAGE_SIZE)
+        {
+            AppendRecord (page, hash, key->key, key->key_size,
+                          value_buffer, value_size);
+            MarkDirty (table);
+
+            ++table->elem_number;
+            return HASH_TABLE_SUCCESS;
+        }
+
+        if (SplitPage (table, page_index, hash) == HASH_TABLE_ERROR)
+            return HASH_TABLE_ERROR;
+    }
+}
+
+
+hash_table_error_status
+DiskHashTableDelete (disk_hash_table* const table,
+                     hash_table_key*  const key,
+                     hash_table_key_comparator key_cmp)
+{
+    if (table   == NULL ||
+        key     == NULL ||
+        key_cmp == NULL)
+        return HASH_TABLE_ERROR;
+
+    const uint64_t hash = table->h_func (key, HASH_TABLE_FULL_RANGE);
+
+    char* const page = GetPage (table, GetPageIndex (table, hash), 0);
+    if (page == NULL) return HASH_TABLE_ERROR;
+
+    record_header* const record = FindRecord (page, key, hash, key_cmp);
+    if (record == NULL) return HASH_TABLE_ERROR;
+
+    page_header* const header = (page_header*) page;
+    const size_t record_size  = GetRecordSize (record->key_size,
+                                               record->value_size);
+    const size_t tail_offset  = (size_t) ((char*) record - page) + record_size;
+
+    memmove (record, page + tail_offset, header->used_bytes - tail_offset);
+
+    --header->records_number;
+    header->used_bytes -= (uint32_t) record_size;
+    MarkDirty (table);
+
+    --table->elem_number;
+    return HASH_TABLE_SUCCESS;
+}
+
+
+hash_table_error_status
+DiskHashTableFind (disk_hash_table* const table,
+                   hash_table_key*  const key,
+                   hash_table_key_comparator key_cmp,
+                   hash_table_value* const found_value)
+{
+    if (table   == NULL ||
+        key     == NULL ||
+        key_cmp == NULL)
+        return HASH_TABLE_ERROR;
+
+    const uint64_t hash = table->h_func (key, HASH_TABLE_FULL_RANGE);
+
+    char* const page = GetPage (table, GetPageIndex (table, hash), 0);
+    if (page == NULL) return HASH_TABLE_ERROR;
+
+    record_header* const record = FindRecord (page, key, hash, key_cmp);
+    if (record == NULL) return HASH_TABLE_ERROR;
+
+    if (found_value != NULL)
+    {
+        found_value->value_size = record->value_size;
+        found_value->value      = (record->value_size == 0) ? NULL :
+            (char*) record + GetValueOffset (record->key_size);
+    }
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+hash_table_error_status
+DiskHashTableFlush (disk_hash_table* const table)
+{
+    if (table == NULL) return HASH_TABLE_ERROR;
+
+    hash_table_error_status status = HASH_TABLE_SUCCESS;
+
+    for (size_t i = 0; i < table->frames_number; ++i)
+        if (table->frames[i].dirty &&
+            WriteFrame (table, table->frames + i) == HASH_TABLE_ERROR)
+            status = HASH_TABLE_ERROR;
+
+    return status;
+}
+
+
+hash_table_error_status
+DiskHashTableStats (const disk_hash_table* const table,
+                    disk_hash_table_stats* const stats)
+{
+    if (table == NULL ||
+        stats == NULL)
+        return HASH_TABLE_ERROR;
+
+    *stats = table->stats;
+
+    stats->elem_number  = table->elem_number;
+    stats->pages_number = table->pages_number - DISK_FIRST_PAGE;
+    stats->global_depth = table->global_depth;
+
+    return HASH_TABLE_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// File static functions implementation
+//-----------------------------------------------------------------------------
+
+static hash_table_error_status
+CreateFile (disk_hash_table* const table)
+{
+    assert (table);
+
+    table->directory = calloc (1, sizeof (uint64_t));
+    if (table->directory == NULL) return HASH_TABLE_ERROR;
+
+    table->global_depth = 0;
+    table->pages_number = DISK_FIRST_PAGE;
+
+    table->directory[0] = AllocatePage (table, 0);
+    if (table->directory[0] == DISK_META_PAGE)
+        return HASH_TABLE_ERROR;
+
+    return SaveDirectory (table);
+}
+
+
+static hash_table_error_status
+OpenFile (disk_hash_table* const table,
+          const size_t file_size)
+{
+    assert (table);
+
+    disk_meta meta = {0};
+
+    if (pread (table->fd, &meta, sizeof (meta), 0) != (ssize_t) sizeof (meta))
+        return HASH_TABLE_ERROR;
+
+    if (memcmp (meta.magic, DISK_MAGIC, sizeof (DISK_MAGIC)) != 0 ||
+        meta.page_size    != DISK_PAGE_SIZE                      ||
+        meta.global_depth >  DISK_MAX_GLOBAL_DEPTH               ||
+        meta.probe_hash   != GetProbeHash (table->h_func))
+        return HASH_TABLE_ERROR;
+
+    const size_t directory_size = ((size_t) 1 << meta.global_depth) *
+                                  sizeof (uint64_t);
+
+    if (meta.directory_offset > file_size ||
+        directory_size > file_size - meta.directory_offset)
+        return HASH_TABLE_ERROR;
+
+    table->directory = malloc (directory_size);
+    if (table->directory == NULL) return HASH_TABLE_ERROR;
+
+    if (pread (table->fd, table->directory, directory_size,
+               (off_t) meta.directory_offset) != (ssize_t) directory_size)
+        return HASH_TABLE_ERROR;
+
+    table->global_depth = meta.global_depth;
+    table->pages_number = meta.pages_number;
+    table->elem_number  = meta.elem_number;
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+static hash_table_error_status
+SaveDirectory (disk_hash_table* const table)
+{
+    assert (table);
+    assert (table->directory);
+
+    if (DiskHashTableFlush (table) == HASH_TABLE_ERROR)
+        return HASH_TABLE_ERROR;
+
+    // new pages overwrite the directory, it is read when the file is opened
+    disk_meta meta =
+    {
+        .page_size        = DISK_PAGE_SIZE,
+        .global_depth     = table->global_depth,
+        .pages_number     = table->pages_number,
+        .elem_number      = table->elem_number,
+        .directory_offset = table->pages_number * DISK_PAGE_SIZE,
+        .probe_hash       = GetProbeHash (table->h_func)
+    };
+
+    memcpy (meta.magic, DISK_MAGIC, sizeof (DISK_MAGIC));
+
+    const size_t directory_size = ((size_t) 1 << table->global_depth) *
+                                  sizeof (uint64_t);
+
+    if (pwrite (table->fd, table->directory, directory_size,
+                (off_t) meta.directory_offset) != (ssize_t) directory_size ||
+        pwrite (table->fd, &meta, sizeof (meta),
+                (off_t) (DISK_META_PAGE * DISK_PAGE_SIZE)) !=
+        (ssize_t) sizeof (meta))
+        return HASH_TABLE_ERROR;
+
+    return HASH_TABLE_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Page cache static functions implementation
+//-----------------------------------------------------------------------------
+
+static char*
+GetPage (disk_hash_table* const table,
+         const uint64_t page_index,
+         const int is_new)
+{
+    assert (table);
+    assert (page_index != DISK_META_PAGE);
+
+    if (page_index < table->page_frames_capacity &&
+        table->page_frames[page_index] != 0)
+    {
+        const size_t frame_index = table->page_frames[page_index] - 1;
+
+        table->frames[frame_index].referenced = 1;
+        table->last_frame = frame_index;
+        ++table->stats.cache_hits;
+
+        return table->frames[frame_index].data;
+    }
+
+    if (page_index >= table->page_frames_capacity)
+    {
+        size_t new_capacity = (table->page_frames_capacity == 0) ?
+                              table->frames_number : table->page_frames_capacity;
+        while (new_capacity <= page_index) new_capacity *= 2;
+
+        uint32_t* const new_page_frames =
+            realloc (table->page_frames, new_capacity * sizeof (uint32_t));
+        if (new_page_frames == NULL) return NULL;
+
+        memset (new_page_frames + table->page_frames_capacity, 0,
+                (new_capacity - table->page_frames_capacity) * sizeof (uint32_t));
+
+        table->page_frames          = new_page_frames;
+        table->page_frames_capacity = new_capacity;
+    }
+
+    const size_t frame_index = SelectVictim (table);
+    cache_frame* const frame = table->frames + frame_index;
+
+    if (frame->page_index != DISK_META_PAGE)
+    {
+        if (frame->dirty && WriteFrame (table, frame) == HASH_TABLE_ERROR)
+            return NULL;
+
+        table->page_frames[frame->page_index] = 0;
+        frame->page_index = DISK_META_PAGE;
+    }
+
+    if (is_new)
+        memset (frame->data, 0, DISK_PAGE_SIZE);
+
+    else
+    {
+        ++table->stats.cache_misses;
+
+        if (pread (table->fd, frame->data, DISK_PAGE_SIZE,
+                   (off_t) (page_index * DISK_PAGE_SIZE)) !=
+            (ssize_t) DISK_PAGE_SIZE)
+            return NULL;
+    }
+
+    frame->page_index = page_index;
+    frame->dirty      = is_new;
+    frame->referenced = 1;
+
+    table->page_frames[page_index] = (uint32_t) (frame_index + 1);
+    table->last_frame = frame_index;
+
+    return frame->data;
+}
+
+
+static size_t
+SelectVictim (disk_hash_table* const table)
+{
+    assert (table);
+
+    // at least two frames, so the last got one is always skipped
+    while (1)
+    {
+        const size_t frame_index = table->clock_hand;
+        cache_frame* const frame = table->frames + frame_index;
+
+        table->clock_hand = (frame_index + 1) % table->frames_number;
+
+        if (frame->page_index == DISK_META_PAGE) return frame_index;
+        if (frame_index == table->last_frame) continue;
+
+        if (frame->referenced)
+        {
+            frame->referenced = 0;
+            continue;
+        }
+
+        return frame_index;
+    }
+}
+
+
+static hash_table_error_status
+WriteFrame (disk_hash_table* const table,
+            cache_frame* const frame)
+{
+    assert (table);
+    assert (frame);
+
+    if (pwrite (table->fd, frame->data, DISK_PAGE_SIZE,
+                (off_t) (frame->page_index * DISK_PAGE_SIZE)) !=
+        (ssize_t) DISK_PAGE_SIZE)
+        return HASH_TABLE_ERROR;
+
+    frame->dirty = 0;
+    ++table->stats.page_writes;
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+static void
+MarkDirty (disk_hash_table* const table)
+{
+    assert (table);
+    assert (table->last_frame < table->frames_number);
+
+    table->frames[table->last_frame].dirty = 1;
+}
+
+
+static uint64_t
+AllocatePage (disk_hash_table* const table,
+              const uint32_t local_depth)
+{
+    assert (table);
+
+    const uint64_t page_index = table->pages_number;
+
+    char* const page = GetPage (table, page_index, 1);
+    if (page == NULL) return DISK_META_PAGE;
+
+    ++table->pages_number;
+
+    page_header* const header = (page_header*) page;
+
+    header->local_depth    = local_depth;
+    header->records_number = 0;
+    header->used_bytes     = sizeof (page_header);
+
+    return page_index;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Extendible hashing static functions implementation
+//-----------------------------------------------------------------------------
+
+static hash_table_error_status
+SplitPage (disk_hash_table* const table,
+           const uint64_t page_index,
+           const uint64_t hash)
+{
+    assert (table);
+
+    char* const page = GetPage (table, page_index, 0);
+    if (page == NULL) return HASH_TABLE_ERROR;
+
+    const uint32_t local_depth = ((page_header*) page)->local_depth;
+
+    // equal directory bits never separate, splitting them only grows the directory
+    if (!SplitSeparates (page, hash))
+        return HASH_TABLE_ERROR;
+
+    if (local_depth == table->global_depth &&
+        DoubleDirectory (table) == HASH_TABLE_ERROR)
+        return HASH_TABLE_ERROR;
+
+    memcpy (table->split_buffer, page, DISK_PAGE_SIZE);
+
+    // the old page is the last got one, so it stays in the cache
+    const uint64_t new_page_index = AllocatePage (table, local_depth + 1);
+    if (new_page_index == DISK_META_PAGE) return HASH_TABLE_ERROR;
+
+    char* const new_page = table->frames[table->last_frame].data;
+    MarkDirty (table);
+
+    page_header* const header = (page_header*) page;
+
+    header->local_depth    = local_depth + 1;
+    header->records_number = 0;
+    header->used_bytes     = sizeof (page_header);
+
+    table->frames[table->page_frames[page_index] - 1].dirty = 1;
+
+    const page_header* const old_header = (page_header*) table->split_buffer;
+    const char* record_ptr = table->split_buffer + sizeof (page_header);
+
+    for (uint32_t i = 0; i < old_header->records_number; ++i)
+    {
+        const record_header* const record = (const record_header*) record_ptr;
+        const char* const key = record_ptr + sizeof (record_header);
+
+        AppendRecord (((record->hash >> local_depth) & 1) ? new_page : page,
+                      record->hash, key, record->key_size,
+                      record_ptr + GetValueOffset (record->key_size),
+                      record->value_size);
+
+        record_ptr += GetRecordSize (record->key_size, record->value_size);
+    }
+
+    // the directory entries of the old page having the new bit go to the new one
+    const uint64_t step = (uint64_t) 1 << local_depth;
+    const uint64_t directory_size = (uint64_t) 1 << table->global_depth;
+
+    for (uint64_t i = hash & (step - 1); i < directory_size; i += step)
+        if ((i >> local_depth) & 1)
+            table->directory[i] = new_page_index;
+
+    ++table->stats.splits;
+    return HASH_TABLE_SUCCESS;
+}
+
+
+static int
+SplitSeparates (const char* const page,
+                const uint64_t hash)
+{
+    assert (page);
+
+    const page_header* const header = (const page_header*) page;
+    const uint64_t mask = ((uint64_t) 1 << DISK_MAX_GLOBAL_DEPTH) - 1;
+
+    const char* record_ptr = page + sizeof (page_header);
+
+    for (uint32_t i = 0; i < header->records_number; ++i)
+    {
+        const record_header* const record = (const record_header*) record_ptr;
+
+        if (((record->hash ^ hash) & mask) != 0)
+            return 1;
+
+        record_ptr += GetRecordSize (record->key_size, record->value_size);
+    }
+
+    return 0;
+}
+
+
+static hash_table_error_status
+DoubleDirectory (disk_hash_table* const table)
+{
+    assert (table);
+
+    if (table->global_depth == DISK_MAX_GLOBAL_DEPTH)
+        return HASH_TABLE_ERROR;
+
+    const size_t directory_size = (size_t) 1 << table->global_depth;
+
+    uint64_t* const new_directory =
+        realloc (table->directory, 2 * directory_size * sizeof (uint64_t));
+    if (new_directory == NULL) return HASH_TABLE_ERROR;
+
+    memcpy (new_directory + directory_size, new_directory,
+            directory_size * sizeof (uint64_t));
+
+    table->directory = new_directory;
+    ++table->global_depth;
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+static record_header*
+FindRecord (char* const page,
+            hash_table_key* const key,
+            const uint64_t hash,
+            hash_table_key_comparator key_cmp)
+{
+    assert (page);
+    assert (key);
+    assert (key_cmp);
+
+    const page_header* const header = (page_header*) page;
+    char* record_ptr = page + sizeof (page_header);
+
+    for (uint32_t i = 0; i < header->records_number; ++i)
+    {
+        record_header* const record = (record_header*) record_ptr;
+
+        if (record->hash == hash)
+        {
+            hash_table_key record_key =
+            {
+                .key      = record_ptr + sizeof (record_header),
+                .key_size = record->key_size
+            };
+
+            if (key_cmp (&record_key, key) == HASH_TABLE_KEY_CMP_EQUAL)
+                return record;
+        }
+
+        record_ptr += GetRecordSize (record->key_size, record->value_size);
+    }
+
+    return NULL;
+}
+
+
+static void
+AppendRecord (char* const page,
+              const uint64_t hash,
+              const void* const key,
+              const size_t key_size,
+              const void* const value,
+              const size_t value_size)
+{
+    assert (page);
+
+    page_header*   const header = (page_header*) page;
+    record_header* const record = (record_header*) (page + header->used_bytes);
+    char* const key_ptr = (char*) record + sizeof (record_header);
+
+    record->hash       = hash;
+    record->key_size   = (uint32_t) key_size;
+    record->value_size = (uint32_t) value_size;
+
+    if (key_size   != 0) memcpy (key_ptr, key, key_size);
+    if (value_size != 0)
+        memcpy ((char*) record + GetValueOffset (key_size), value, value_size);
+
+    ++header->records_number;
+    header->used_bytes += (uint32_t) GetRecordSize (key_size, value_size);
+}
+
+
+static size_t
+GetRecordSize (const size_t key_size,
+               const size_t value_size)
+{
+    const size_t size = GetValueOffset (key_size) + value_size;
+
+    return (size + DISK_RECORD_ALIGNMENT - 1) & ~(DISK_RECORD_ALIGNMENT - 1);
+}
+
+
+static size_t
+GetValueOffset (const size_t key_size)
+{
+    const size_t offset = sizeof (record_header) + key_size;
+
+    return (offset + DISK_RECORD_ALIGNMENT - 1) & ~(DISK_RECORD_ALIGNMENT - 1);
+}
+
+
+static uint64_t
+GetPageIndex (const disk_hash_table* const table,
+              const uint64_t hash)
+{
+    assert (table);
+
+    const uint64_t mask = ((uint64_t) 1 << table->global_depth) - 1;
+
+    return table->directory[hash & mask];
+}
+
+
+static hash_table_index
+GetProbeHash (hash_function h_func)
+{
+    assert (h_func);
+
+    hash_table_key probe_key =
+    {
+        .key      = (void*) DISK_PROBE_KEY,
+        .key_size = sizeof (DISK_PROBE_KEY) - 1
+    };
+
+    return h_func (&probe_key, HASH_TABLE_FULL_RANGE);
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
@@ -1,4 +1,5 @@
 #include "doubly_linked_list.h"
+#include "alloc_tracking.h"
 
 
 
@@ -18,6 +19,18 @@ static list_error_status
 ListLinkNodes (list_node* const node1,
                list_node* const node2);
 
+
+static list_node*
+ListLayoutNodeConstructor (const list_key* const key,
+                           const list_value* const value,
+                           const list_node_layout layout,
+                           const size_t extra_size);
+
+
+static list_node*
+ListLayoutNodeDestructor (list_node* const node,
+                          const list_node_layout layout);
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 
@@ -30,8 +43,29 @@ ListLinkNodes (list_node* const node1,
 list_t*
 ListConstructor (void)
 {
-    list_t* const list = calloc (1, sizeof (list_t));
-    return list; // if NULL returns NULL
+    return ListConstructorWithLayout (LIST_NODE_KEY_VALUE);
+}
+
+
+list_t*
+ListConstructorWithLayout (const list_node_layout layout)
+{
+    return ListConstructorWithExtra (layout, 0);
+}
+
+
+list_t*
+ListConstructorWithExtra (const list_node_layout layout,
+                          const size_t extra_size)
+{
+    list_t* const list = TrackedCalloc (1, sizeof (list_t),
+                                        ALLOC_CATEGORY_BUCKETS);
+    if (list == NULL) return NULL;
+
+    list->layout     = layout;
+    list->extra_size = extra_size;
+
+    return list;
 }
 
 
@@ -44,7 +78,7 @@ ListDestructor (list_t* const list)
     for (size_t i = 0; i < elem_number; ++i)
         ListDeleteNode (list, list->head);
 
-    free (list);
+    TrackedFree (list, ALLOC_CATEGORY_BUCKETS);
     return NULL;
 }
 
@@ -59,7 +93,9 @@ ListInsert (list_t*     const list,
         key  == NULL)
         return LIST_ERROR;
 
-    list_node* const node = ListNodeConstructor (key, value);
+    list_node* const node = ListLayoutNodeConstructor (key, value,
+                                                       list->layout,
+                                                       list->extra_size);
     if (node == NULL) return LIST_ERROR;
 
     if (list->head == NULL)
@@ -88,6 +124,21 @@ ListPushBack (list_t*     const list,
 }
 
 
+list_error_status
+ListPushBackHashed (list_t*     const list,
+                    list_key*   const key,
+                    list_value* const value,
+                    const size_t hash)
+{
+    if (ListPushBack (list, key, value) == LIST_ERROR)
+        return LIST_ERROR;
+
+    list->head->prev->hash = hash;
+
+    return LIST_SUCCESS;
+}
+
+
 list_error_status
 ListPushFront (list_t*     const list,
                list_key*   const key,
@@ -112,11 +163,12 @@ ListDeleteNode (list_t*    const list,
 
     list_node* const head = list->head;
 
-    if (node == head) list->head = head->next;
+    if (node == head)
+        list->head = (list->elem_number == 1) ? NULL : head->next;
 
     ListLinkNodes (node->prev, node->next);
 
-    ListNodeDestructor (node);
+    ListLayoutNodeDestructor (node, list->layout);
 
     --list->elem_number;
 
@@ -150,33 +202,64 @@ ListFindNode (list_t* const list,
 
 
 list_node*
-ListNodeConstructor (const list_key* const key,
-                     const list_value* const value)
+ListFindNodeHashed (list_t* const list,
+                    list_key* const key,
+                    const size_t hash,
+                    list_key_cmp key_cmp)
 {
-    list_node* const node = (list_node*) malloc (sizeof (list_node));
-    if (node == NULL) return NULL;
+    if (list    == NULL ||
+        key     == NULL ||
+        key_cmp == NULL)
+        return NULL;
 
-    node->key   = ListKeyCopy   (key);
-    node->value = ListValueCopy (value);
-    node->next  = node;
-    node->prev  = node;
+    const size_t elem_number = list->elem_number;
+    list_node* cur_node = list->head;
 
-    return node;
+    for (size_t i = 0; i < elem_number; ++i)
+    {
+        if (cur_node->hash == hash &&
+            key_cmp (cur_node->key, key) == LIST_KEY_CMP_EQUAL)
+            return cur_node;
+
+        cur_node = cur_node->next;
+    }
+
+    return NULL;
+}
+
+
+list_node*
+ListNodeConstructor (const list_key* const key,
+                     const list_value* const value)
+{
+    return ListLayoutNodeConstructor (key, value, LIST_NODE_KEY_VALUE, 0);
 }
 
 
 list_node*
 ListNodeDestructor (list_node* const node)
 {
-    if (node == NULL) return NULL;
+    return ListLayoutNodeDestructor (node, LIST_NODE_KEY_VALUE);
+}
 
-    node->key   = ListKeyDestructor   (node->key);
-    node->value = ListValueDestructor (node->value);
-    node->next  = NULL;
-    node->prev  = NULL;
 
-    free (node);
-    return NULL;
+size_t
+ListNodeSize (const list_node_layout layout)
+{
+    if (layout == LIST_NODE_KEY_ONLY)
+        return offsetof (list_node, value);
+
+    return sizeof (list_node);
+}
+
+
+void*
+ListNodeExtra (list_node* const node,
+               const list_node_layout layout)
+{
+    if (node == NULL) return NULL;
+
+    return (char*) node + ListNodeSize (layout);
 }
 
 
@@ -184,14 +267,15 @@ list_key*
 ListKeyConstructor (const void* const key_buffer,
                     const size_t key_size)
 {
-    list_key* const key = calloc (1, sizeof (list_key));
+    list_key* const key = TrackedCalloc (1, sizeof (list_key),
+                                         ALLOC_CATEGORY_KEYS);
     if (key == NULL) return NULL;
 
     if (key_buffer == NULL || key_size == 0)
         return key;
 
     key->key_size = key_size;
-    key->key = malloc (key_size);
+    key->key = TrackedMalloc (key_size, ALLOC_CATEGORY_KEYS);
     if (key->key == NULL)
         return ListKeyDestructor (key);
 
@@ -206,8 +290,8 @@ ListKeyDestructor (list_key* const key)
 {
     if (key == NULL) return NULL;
 
-    free (key->key);
-    free (key);
+    TrackedFree (key->key, ALLOC_CATEGORY_KEYS);
+    TrackedFree (key, ALLOC_CATEGORY_KEYS);
     return NULL;
 }
 
@@ -216,14 +300,15 @@ list_value*
 ListValueConstructor (const void* const value_buffer,
                       const size_t value_size)
 {
-    list_value* const value = calloc (1, sizeof (list_value));
+    list_value* const value = TrackedCalloc (1, sizeof (list_value),
+                                             ALLOC_CATEGORY_VALUES);
     if (value == NULL) return NULL;
 
     if (value_buffer == NULL || value_size == 0)
         return value;
 
     value->value_size = value_size;
-    value->value = malloc (value_size);
+    value->value = TrackedMalloc (value_size, ALLOC_CATEGORY_VALUES);
     if (value->value == NULL)
         return ListValueDestructor (value);
 
@@ -238,8 +323,8 @@ ListValueDestructor (list_value* const value)
 {
     if (value == NULL) return NULL;
 
-    free (value->value);
-    free (value);
+    TrackedFree (value->value, ALLOC_CATEGORY_VALUES);
+    TrackedFree (value, ALLOC_CATEGORY_VALUES);
     return NULL;
 }
 
@@ -270,6 +355,50 @@ ListValueCopy (const list_value* const value)
 }
 
 
+static list_node*
+ListLayoutNodeConstructor (const list_key* const key,
+                           const list_value* const value,
+                           const list_node_layout layout,
+                           const size_t extra_size)
+{
+    list_node* const node =
+        (list_node*) TrackedMalloc (ListNodeSize (layout) + extra_size,
+                                    ALLOC_CATEGORY_NODES);
+    if (node == NULL) return NULL;
+
+    if (extra_size != 0)
+        memset (ListNodeExtra (node, layout), 0, extra_size);
+
+    node->key   = ListKeyCopy (key);
+    node->next  = node;
+    node->prev  = node;
+    node->hash  = 0;
+
+    if (layout == LIST_NODE_KEY_VALUE)
+        node->value = ListValueCopy (value);
+
+    return node;
+}
+
+
+static list_node*
+ListLayoutNodeDestructor (list_node* const node,
+                          const list_node_layout layout)
+{
+    if (node == NULL) return NULL;
+
+    node->key  = ListKeyDestructor (node->key);
+    node->next = NULL;
+    node->prev = NULL;
+
+    if (layout == LIST_NODE_KEY_VALUE)
+        node->value = ListValueDestructor (node->value);
+
+    TrackedFree (node, ALLOC_CATEGORY_NODES);
+    return NULL;
+}
+
+
 static list_error_status
 ListLinkNodes (list_node* const node1,
                list_node* const node2)
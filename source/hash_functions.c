@@ -10,6 +10,61 @@
 
 
 
+//-----------------------------------------------------------------------------
+// Consts
+//-----------------------------------------------------------------------------
+
+/// @brief Initial value of the djb2 hash
+static const hash_table_index DJB2_INITIAL_HASH = 5381;
+
+
+/// @brief Initial value of the crc32 hash
+static const uint32_t CRC32_INITIAL_HASH = 0xffffffff;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static functions prototypes
+//-----------------------------------------------------------------------------
+
+
+/**
+ * @brief Continues djb2 hash with the given characters
+ *
+ * @param hash Hash of the previous characters
+ * @param str Characters
+ * @param len Number of characters
+ *
+ * @retval Hash of all characters
+ */
+static inline hash_table_index
+Djb2Update (hash_table_index hash,
+            const unsigned char* const str,
+            const size_t len);
+
+
+/**
+ * @brief Continues crc32 hash with the given characters
+ *
+ * @param hash Not inverted crc32 of the previous characters
+ * @param str Characters
+ * @param len Number of characters
+ *
+ * @retval Not inverted crc32 of all characters
+ */
+static inline uint32_t
+Crc32Update (uint32_t hash,
+             const unsigned char* const str,
+             const size_t len);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
 //-----------------------------------------------------------------------------
 // Hash functions implementation (except CRC32)
 //-----------------------------------------------------------------------------
@@ -21,6 +76,8 @@ HashFunctionZero (hash_table_key* const key,
     assert (key);
     assert (key->key);
     assert (buckets_num > 0);
+    (void) key;
+    (void) buckets_num;
 
     return 0;
 }
@@ -87,14 +144,22 @@ HashFunctionDjb2 (hash_table_key* const key,
     assert (key->key);
     assert (buckets_num > 0);
 
-    hash_table_index hash = 5381;
-    const size_t len = key->key_size;
-    const unsigned char* const str = key->key;
+    const hash_table_index hash =
+        Djb2Update (DJB2_INITIAL_HASH, key->key, key->key_size);
+
+    return hash % buckets_num;
+}
+
 
+static inline hash_table_index
+Djb2Update (hash_table_index hash,
+            const unsigned char* const str,
+            const size_t len)
+{
     for (size_t i = 0; i < len; ++i)
         hash = ((hash << 5) + hash) + str[i];
 
-    return hash % buckets_num;
+    return hash;
 }
 
 //-----------------------------------------------------------------------------
@@ -182,16 +247,105 @@ HashFunctionCrc32 (hash_table_key* const key,
     assert (key->key);
     assert (buckets_num > 0);
 
-    uint32_t hash = 0xffffffff;
-    const size_t len = key->key_size;
-    const unsigned char* const str = key->key;
+    const uint32_t hash =
+        Crc32Update (CRC32_INITIAL_HASH, key->key, key->key_size);
+
+    return ~hash % buckets_num;
+}
 
+
+static inline uint32_t
+Crc32Update (uint32_t hash,
+             const unsigned char* const str,
+             const size_t len)
+{
     for (size_t i = 0; i < len; ++i)
     {
         hash = (hash >> 8) ^ crc32_table [(hash ^ str[i]) & 0xff];
     }
 
-    return ~hash % buckets_num;
+    return hash;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Incremental hashing implementation
+//-----------------------------------------------------------------------------
+
+hash_table_error_status
+HashStateInit (hash_state* const state,
+               hash_function h_func)
+{
+    if (state == NULL) return HASH_TABLE_ERROR;
+
+    state->h_func = h_func;
+    state->length = 0;
+
+    if (h_func == HashFunctionDjb2)
+        state->value = DJB2_INITIAL_HASH;
+
+    else if (h_func == HashFunctionCrc32)
+        state->value = CRC32_INITIAL_HASH;
+
+    else if (h_func == HashFunctionZero       ||
+             h_func == HashFunctionFirstASCII ||
+             h_func == HashFunctionStringLength ||
+             h_func == HashFunctionSumASCII)
+        state->value = 0;
+
+    else
+        return HASH_TABLE_ERROR;
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+void
+HashStateUpdate (hash_state* const state,
+                 const void* const buffer,
+                 const size_t size)
+{
+    assert (state);
+    assert (buffer || size == 0);
+
+    const unsigned char* const str = buffer;
+    const hash_function h_func = state->h_func;
+
+    if (h_func == HashFunctionDjb2)
+        state->value = Djb2Update (state->value, str, size);
+
+    else if (h_func == HashFunctionCrc32)
+        state->value = Crc32Update ((uint32_t) state->value, str, size);
+
+    else if (h_func == HashFunctionSumASCII)
+        for (size_t i = 0; i < size; ++i)
+            state->value += str[i];
+
+    else if (h_func == HashFunctionFirstASCII && state->length == 0 && size > 0)
+        state->value = str[0];
+
+    state->length += size;
+}
+
+
+hash_table_index
+HashStateFinal (const hash_state* const state)
+{
+    assert (state);
+
+    hash_table_index hash = state->value;
+
+    if (state->h_func == HashFunctionCrc32)
+        hash = (uint32_t) ~state->value;
+
+    else if (state->h_func == HashFunctionStringLength)
+        hash = state->length;
+
+    return hash % HASH_TABLE_FULL_RANGE;
 }
 
 //-----------------------------------------------------------------------------
@@ -1,5 +1,212 @@
 #include "hash_table.h"
+#include "doubly_linked_list.h"
+#include "hash_table_probes.h"
 #include <assert.h>
+#include <time.h>
+
+#ifdef HASH_TABLE_INSTRUMENT
+    #include <pthread.h>
+#endif
+
+#if defined (HASH_TABLE_INSTRUMENT) && (defined (__x86_64__) || defined (__i386__))
+    #define LATENCY_RDTSC 1
+    #include <x86intrin.h>
+#else
+    #define LATENCY_RDTSC 0
+#endif
+
+
+
+//-----------------------------------------------------------------------------
+// Consts
+//-----------------------------------------------------------------------------
+
+/// @brief Number of levels of the timing wheel
+#define TTL_WHEEL_LEVELS 4
+
+
+/// @brief Number of bits of the expiration time taken by one level
+#define TTL_WHEEL_SLOT_BITS 6
+
+
+/// @brief Number of slots in one level of the timing wheel
+#define TTL_WHEEL_SLOTS (1 << TTL_WHEEL_SLOT_BITS)
+
+
+/// @brief Mask of the slot index bits
+static const uint64_t TTL_WHEEL_SLOT_MASK = TTL_WHEEL_SLOTS - 1;
+
+
+/// @brief Maximum number of nodes moved or deleted by the wheel per insert
+static const size_t TTL_INSERT_WORK = 4;
+
+
+/// @brief Nanoseconds in one millisecond for the default clock
+static const uint64_t NSEC_PER_MSEC = 1000000;
+
+
+/// @brief Milliseconds in one second for the default clock
+static const uint64_t MSEC_PER_SEC = 1000;
+
+#ifdef HASH_TABLE_INSTRUMENT
+
+/// @brief Number of bits of the latency kept by the histogram bin
+#define LATENCY_SUB_BITS 4
+
+
+/// @brief Number of histogram bins per power of two
+#define LATENCY_SUB_BINS (1 << LATENCY_SUB_BITS)
+
+
+/// @brief Number of histogram bins covering 64-bit latencies
+#define LATENCY_BINS ((64 - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BINS)
+
+
+/// @brief Number of hash_table_operation values
+#define LATENCY_OPERATIONS 3
+
+
+/// @brief Number of hash_table_latency_part values
+#define LATENCY_PARTS 3
+
+
+/// @brief Default number of operations per sample
+static const size_t LATENCY_DEFAULT_PERIOD = 256;
+
+
+/// @brief Time of measuring the ticks per nanosecond
+static const uint64_t LATENCY_CALIBRATION_NSEC = 10000000;
+
+
+/// @brief Nanoseconds in one second
+static const uint64_t NSEC_PER_SEC = 1000000000;
+
+
+/// @brief Percentiles printed by HashTableLatencyDump()
+static const double LATENCY_DUMP_PERCENTILES[] = {50.0, 90.0, 99.0, 99.9, 100.0};
+
+#endif
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static structures
+//-----------------------------------------------------------------------------
+
+struct hash_table_lru
+{
+    hash_table_node* head;          ///< most recently used node
+    size_t           max_elems;     ///< elements budget, 0 for no limit
+    size_t           max_bytes;     ///< bytes budget, 0 for no limit
+    hash_table_lru_stats stats;     ///< counters
+};
+
+
+/**
+ * @brief Hierarchical timing wheel
+ *
+ * @details Level l slot s keeps the nodes expiring in
+ * [64^l, 64^(l + 1)) ticks whose expiration time bits [6l, 6l + 6) equal s.
+ * When the current tick reaches the beginning of a slot of the upper level,
+ * its nodes are moved to the lower levels, so every node is moved at most
+ * TTL_WHEEL_LEVELS times. Empty slots are skipped with the occupancy masks.
+ */
+struct hash_table_ttl
+{
+    hash_table_clock clock;         ///< clock of the expiration times
+    uint64_t         now;           ///< last clock reading, the time of finds
+    uint64_t         current;       ///< first tick not expired yet
+    size_t           cascade_level; ///< upper levels left to move at current
+    size_t           nodes_number;  ///< number of nodes in the wheel
+    uint64_t         occupied[TTL_WHEEL_LEVELS];    ///< non-empty slots masks
+    hash_table_node* slots[TTL_WHEEL_LEVELS][TTL_WHEEL_SLOTS];
+};
+
+
+/**
+ * @brief Extra bytes of the nodes of LRU and expiring table buckets
+ *
+ * @details The recency list and the timing wheel slots are cycled and
+ * intrusive like the buckets lists
+ */
+typedef
+struct node_extra
+{
+    hash_table_node*  lru_next;     ///< less recently used node
+    hash_table_node*  lru_prev;     ///< more recently used node
+    size_t            bytes;        ///< bytes counted for the node
+    hash_table_node*  ttl_next;     ///< next node in the wheel slot
+    hash_table_node*  ttl_prev;     ///< previous node in the wheel slot
+    hash_table_node** ttl_slot;     ///< wheel slot, NULL if never expires
+    uint64_t          expire_time;  ///< tick when the node expires
+}
+node_extra;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Probes semaphores
+//-----------------------------------------------------------------------------
+
+HASH_TABLE_PROBE_SEMAPHORE (insert);
+HASH_TABLE_PROBE_SEMAPHORE (find_hit);
+HASH_TABLE_PROBE_SEMAPHORE (find_miss);
+HASH_TABLE_PROBE_SEMAPHORE (delete);
+HASH_TABLE_PROBE_SEMAPHORE (bucket_create);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Latency instrumentation structures
+//-----------------------------------------------------------------------------
+
+#ifdef HASH_TABLE_INSTRUMENT
+
+/**
+ * @brief Timestamps of the measured operation
+ */
+typedef
+struct latency_sample
+{
+    uint64_t begin;     ///< ticks at the beginning
+    uint64_t split;     ///< ticks after hashing
+    int      sampled;   ///< non-zero if the operation is measured
+}
+latency_sample;
+
+
+/// @brief Samples of every operation and part, updated atomically
+static uint64_t latency_bins[LATENCY_OPERATIONS][LATENCY_PARTS][LATENCY_BINS];
+
+
+/// @brief Number of operations per sample
+static size_t latency_period = LATENCY_DEFAULT_PERIOD;
+
+
+/// @brief Operations of the thread left until the next sample
+static _Thread_local size_t latency_countdown = 1;
+
+
+/// @brief Nanoseconds in one tick, measured on the first use
+static double latency_nsec_per_tick = 1.0;
+
+
+/// @brief Makes the ticks measured once
+static pthread_once_t latency_calibration = PTHREAD_ONCE_INIT;
+
+#endif
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
 
 
 
@@ -7,20 +214,1427 @@
 // Static functions prototypes
 //-----------------------------------------------------------------------------
 
-/**
- * @brief Get the bucket for the given key
- *
- * @param table Hash table
- * @param key Key to find bucket
- *
- * @retval Pointer to the bucket
- * @retval NULL if bad input error occurred
- *
- * @details If the bucket was not constructed yet, constructs and returns it
- */
+/**
+ * @brief Get the bucket for the given hash
+ *
+ * @param table Hash table
+ * @param hash Whole hash of the key
+ *
+ * @retval Pointer to the bucket
+ * @retval NULL if allocation error occurred
+ *
+ * @details If the bucket was not constructed yet, constructs and returns it,
+ * so it is only called by insert
+ */
+static hash_table_bucket*
+GetBucket (hash_table_t* const table,
+           const hash_table_index hash);
+
+
+/**
+ * @brief Get the bucket for the given hash without constructing it
+ *
+ * @param table Hash table
+ * @param hash Whole hash of the key
+ *
+ * @retval Pointer to the bucket
+ * @retval NULL if the bucket was not constructed yet
+ *
+ * @details Find and delete do not allocate an empty bucket on a miss
+ */
+static inline hash_table_bucket*
+FindBucket (const hash_table_t* const table,
+            const hash_table_index hash);
+
+
+/**
+ * @brief Gets the number of nodes in the bucket, 0 if it is NULL
+ */
+static inline size_t
+GetChainLength (const hash_table_bucket* const bucket);
+
+
+/**
+ * @brief Constructor for hash table structure of any mode
+ */
+static hash_table_t*
+TableConstructor (const size_t buckets_number,
+                  hash_function h_func,
+                  const hash_table_mode mode,
+                  const size_t value_size);
+
+
+/**
+ * @brief Same as HashTableInsertHashed(), but sets the time to live
+ *
+ * @details ttl is NULL for the plain inserts, they keep the expiration of
+ * the present key, otherwise the key expires after *ttl ticks or never
+ * if it is 0
+ */
+static hash_table_error_status
+InsertNode (hash_table_t*     const table,
+            hash_table_key*   const key,
+            hash_table_value* const value,
+            hash_table_key_comparator key_cmp,
+            const hash_table_index hash,
+            const uint64_t* const ttl);
+
+
+/**
+ * @brief Appends the value to the values array of the multimap node
+ *
+ * @details The capacity is the least power of two not less than the number
+ * of values, so the array is reallocated when the number is a power of two
+ */
+static hash_table_error_status
+AppendValue (hash_table_t* const table,
+             hash_table_node* const node,
+             const hash_table_value* const value);
+
+
+/**
+ * @brief Unlinks the node from the recency list and the timing wheel
+ * and deletes it from the bucket
+ */
+static hash_table_error_status
+DeleteNode (hash_table_t*      const table,
+            hash_table_bucket* const bucket,
+            hash_table_node*   const node);
+
+
+/**
+ * @brief Moves the bucket of the given length to the next length
+ * in the chain counters, called before the node is pushed
+ *
+ * @details The counters capacity is the least power of two greater than
+ * the longest length, so they are reallocated when the new longest length
+ * is a power of two
+ */
+static hash_table_error_status
+ChainGrow (hash_table_t* const table,
+           const size_t length);
+
+
+/**
+ * @brief Moves the bucket of the given length to the previous length
+ * in the chain counters, called after the node is deleted
+ */
+static void
+ChainShrink (hash_table_t* const table,
+             const size_t length);
+
+
+/**
+ * @brief Get the bucket of the node by its stored hash
+ */
+static hash_table_bucket*
+GetNodeBucket (const hash_table_t* const table,
+               const hash_table_node* const node);
+
+
+/**
+ * @brief Destructs the buckets of the empty table,
+ * so the new ones get the current node extra size
+ */
+static void
+ResetBuckets (hash_table_t* const table);
+
+
+/**
+ * @brief Get the layout of the bucket nodes for the table mode
+ */
+static list_node_layout
+GetNodeLayout (const hash_table_mode mode);
+
+
+/**
+ * @brief Get the extra bytes of the node, the table must have extras
+ */
+static node_extra*
+GetNodeExtra (const hash_table_t* const table,
+              hash_table_node* const node);
+
+
+/**
+ * @brief Number of bytes counted for the node with given key and value
+ */
+static size_t
+GetNodeBytes (const hash_table_t* const table,
+              const hash_table_key* const key,
+              const hash_table_value* const value);
+
+
+/**
+ * @brief Links the node to the front of the recency list
+ */
+static void
+LruPushFront (hash_table_t* const table,
+              hash_table_node* const node,
+              const size_t bytes);
+
+
+/**
+ * @brief Unlinks the node from the recency list
+ */
+static void
+LruUnlink (hash_table_t* const table,
+           hash_table_node* const node);
+
+
+/**
+ * @brief Moves the node to the front of the recency list
+ */
+static void
+LruTouch (hash_table_t* const table,
+          hash_table_node* const node);
+
+
+/**
+ * @brief Deletes the least recently used nodes while the budget is exceeded
+ */
+static void
+LruEvict (hash_table_t* const table);
+
+
+/**
+ * @brief Default clock, milliseconds of CLOCK_MONOTONIC
+ */
+static uint64_t
+TtlMonotonicClock (void);
+
+
+/**
+ * @brief Links the node to the wheel slot of its expiration time
+ *
+ * @details Unlinks the node from its previous slot first
+ */
+static void
+TtlPlace (hash_table_t* const table,
+          hash_table_node* const node,
+          const uint64_t expire_time);
+
+
+/**
+ * @brief Unlinks the node from the timing wheel
+ */
+static void
+TtlUnlink (hash_table_t* const table,
+           hash_table_node* const node);
+
+
+/**
+ * @brief Checks if the node has expired
+ *
+ * @param table Hash table
+ * @param node Node of the table
+ * @param read_clock Non-zero to read the clock if the last reading
+ * is before the expiration time
+ *
+ * @retval Non-zero if the node has expired
+ *
+ * @details The clock is read only for the nodes that expire,
+ * the timing wheel is not advanced
+ */
+static int
+TtlIsExpired (hash_table_t* const table,
+              hash_table_node* const node,
+              const int read_clock);
+
+
+/**
+ * @brief Moves the current tick to the next one with nodes to move or delete
+ *
+ * @details Jumps over the empty slots, but not further than now + 1
+ */
+static void
+TtlNextTick (hash_table_ttl* const ttl,
+             const uint64_t now);
+
+
+/**
+ * @brief Highest level whose slot begins at the tick
+ */
+static size_t
+TtlCascadeLevel (const uint64_t tick);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Latency instrumentation static functions prototypes
+//-----------------------------------------------------------------------------
+
+#ifdef HASH_TABLE_INSTRUMENT
+
+/// @brief Starts measuring the operation if it is sampled
+#define LATENCY_BEGIN(sample) latency_sample sample; LatencyBegin (&sample)
+
+
+/// @brief Marks the end of hashing of the measured operation
+#define LATENCY_SPLIT(sample) LatencySplit (&sample)
+
+
+/// @brief Records the latencies of the measured operation
+#define LATENCY_END(sample, operation) LatencyEnd (&sample, operation)
+
+
+/**
+ * @brief Gets the timestamp, the TSC on x86 or nanoseconds otherwise
+ */
+static inline uint64_t
+LatencyTicks (void);
+
+
+/**
+ * @brief Decides whether the operation is sampled and starts it
+ */
+static inline void
+LatencyBegin (latency_sample* const sample);
+
+
+/**
+ * @brief Marks the end of hashing of the sampled operation
+ */
+static inline void
+LatencySplit (latency_sample* const sample);
+
+
+/**
+ * @brief Adds the latencies of the sampled operation to the histograms
+ */
+static inline void
+LatencyEnd (const latency_sample* const sample,
+            const hash_table_operation operation);
+
+
+/**
+ * @brief Gets the histogram bin of the latency
+ *
+ * @details Latencies below LATENCY_SUB_BINS have their own bins, the others
+ * are rounded down to LATENCY_SUB_BITS + 1 significant bits
+ */
+static size_t
+LatencyBin (const uint64_t ticks);
+
+
+/**
+ * @brief Gets the largest latency of the histogram bin
+ */
+static uint64_t
+LatencyBinMaxTicks (const size_t bin);
+
+
+/**
+ * @brief Gets the nanoseconds in one tick, measures them on the first call
+ */
+static double
+LatencyNsecPerTick (void);
+
+
+/**
+ * @brief Measures the nanoseconds in one tick by the monotonic clock
+ */
+static void
+LatencyCalibrate (void);
+
+#else
+
+#define LATENCY_BEGIN(sample)
+#define LATENCY_SPLIT(sample)
+#define LATENCY_END(sample, operation)
+
+#endif
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Interface functions implementation
+//-----------------------------------------------------------------------------
+
+hash_table_t*
+HashTableConstructor (const size_t buckets_number,
+                      hash_function h_func)
+{
+    return HashTableConstructorWithMode (buckets_number, h_func,
+                                         HASH_TABLE_MAP);
+}
+
+
+hash_table_t*
+HashTableConstructorWithMode (const size_t buckets_number,
+                              hash_function h_func,
+                              const hash_table_mode mode)
+{
+    if (mode == HASH_TABLE_MULTIMAP) return NULL;
+
+    return TableConstructor (buckets_number, h_func, mode, 0);
+}
+
+
+hash_table_t*
+HashTableMultimapConstructor (const size_t buckets_number,
+                              hash_function h_func,
+                              const size_t value_size)
+{
+    if (value_size == 0) return NULL;
+
+    return TableConstructor (buckets_number, h_func, HASH_TABLE_MULTIMAP,
+                             value_size);
+}
+
+
+
+hash_table_t*
+HashTableDestructor (hash_table_t* const table)
+{
+    if (table == NULL) return NULL;
+
+    const size_t buckets_number = table->buckets_num;
+    hash_table_bucket** buckets = table->buckets;
+
+    if (buckets != NULL)
+        for (size_t i = 0; i < buckets_number; ++i)
+            buckets[i] = ListDestructor (buckets[i]);
+
+    TrackedFree (buckets, ALLOC_CATEGORY_BUCKETS);
+    TrackedFree (table->lru, ALLOC_CATEGORY_TABLE);
+    TrackedFree (table->ttl, ALLOC_CATEGORY_TABLE);
+    TrackedFree (table->chain_counts, ALLOC_CATEGORY_TABLE);
+    TrackedFree (table, ALLOC_CATEGORY_TABLE);
+
+    return NULL;
+}
+
+
+hash_table_key*
+HashTableKeyConstructor (const void* const key_buffer,
+                         const size_t key_size)
+{
+    return ListKeyConstructor (key_buffer, key_size);
+}
+
+
+hash_table_key*
+HashTableKeyDestructor (hash_table_key* const key)
+{
+    return ListKeyDestructor (key);
+}
+
+
+hash_table_value*
+HashTableValueConstructor (const void* const value_buffer,
+                           const size_t value_size)
+{
+    return ListValueConstructor (value_buffer, value_size);
+}
+
+
+hash_table_value*
+HashTableValueDestructor (hash_table_value* const value)
+{
+    return ListValueDestructor (value);
+}
+
+
+hash_table_error_status
+HashTableInsert (hash_table_t*     const table,
+                 hash_table_key*   const key,
+                 hash_table_value* const value,
+                 hash_table_key_comparator key_cmp)
+{
+    LATENCY_BEGIN (sample);
+    const hash_table_index hash = HashTableKeyHash (table, key);
+    LATENCY_SPLIT (sample);
+
+    const hash_table_error_status status =
+        HashTableInsertHashed (table, key, value, key_cmp, hash);
+    LATENCY_END (sample, HASH_TABLE_OP_INSERT);
+
+    return status;
+}
+
+
+hash_table_error_status
+HashTableInsertHashed (hash_table_t*     const table,
+                       hash_table_key*   const key,
+                       hash_table_value* const value,
+                       hash_table_key_comparator key_cmp,
+                       const hash_table_index hash)
+{
+    return InsertNode (table, key, value, key_cmp, hash, NULL);
+}
+
+
+hash_table_error_status
+HashTableInsertTtl (hash_table_t*     const table,
+                    hash_table_key*   const key,
+                    hash_table_value* const value,
+                    hash_table_key_comparator key_cmp,
+                    const uint64_t ttl)
+{
+    if (table      == NULL ||
+        table->ttl == NULL)
+        return HASH_TABLE_ERROR;
+
+    return InsertNode (table, key, value, key_cmp,
+                       HashTableKeyHash (table, key), &ttl);
+}
+
+
+hash_table_error_status
+HashTableDelete (hash_table_t*   const table,
+                 hash_table_key* const key,
+                 hash_table_key_comparator key_cmp)
+{
+    LATENCY_BEGIN (sample);
+    const hash_table_index hash = HashTableKeyHash (table, key);
+    LATENCY_SPLIT (sample);
+
+    const hash_table_error_status status =
+        HashTableDeleteHashed (table, key, key_cmp, hash);
+    LATENCY_END (sample, HASH_TABLE_OP_DELETE);
+
+    return status;
+}
+
+
+hash_table_error_status
+HashTableDeleteHashed (hash_table_t*   const table,
+                       hash_table_key* const key,
+                       hash_table_key_comparator key_cmp,
+                       const hash_table_index hash)
+{
+    if (table == NULL ||
+        key   == NULL)
+        return HASH_TABLE_ERROR;
+
+    hash_table_bucket* const bucket = FindBucket (table, hash);
+    hash_table_node*   const node   = ListFindNodeHashed (bucket, key, hash,
+                                                          key_cmp);
+
+    HASH_TABLE_PROBE3 (delete, key->key_size, GetChainLength (bucket),
+                       hash % table->buckets_num);
+
+    if (node == NULL) return HASH_TABLE_ERROR;
+
+    ++table->changes_number;
+    return DeleteNode (table, bucket, node);
+}
+
+
+hash_table_node*
+HashTableFind (hash_table_t*   const table,
+               hash_table_key* const key,
+               hash_table_key_comparator key_cmp)
+{
+    LATENCY_BEGIN (sample);
+    const hash_table_index hash = HashTableKeyHash (table, key);
+    LATENCY_SPLIT (sample);
+
+    hash_table_node* const node = HashTableFindHashed (table, key, key_cmp, hash);
+    LATENCY_END (sample, HASH_TABLE_OP_FIND);
+
+    return node;
+}
+
+
+hash_table_node*
+HashTableFindHashed (hash_table_t*   const table,
+                     hash_table_key* const key,
+                     hash_table_key_comparator key_cmp,
+                     const hash_table_index hash)
+{
+    if (table == NULL ||
+        key   == NULL)
+        return NULL;
+
+    hash_table_bucket* const bucket = FindBucket (table, hash);
+    hash_table_node*         node   = ListFindNodeHashed (bucket, key, hash,
+                                                          key_cmp);
+
+    if (node != NULL)
+        HASH_TABLE_PROBE3 (find_hit, key->key_size, GetChainLength (bucket),
+                           hash % table->buckets_num);
+    else
+        HASH_TABLE_PROBE3 (find_miss, key->key_size, GetChainLength (bucket),
+                           hash % table->buckets_num);
+
+    if (node != NULL && TtlIsExpired (table, node, 1))
+    {
+        DeleteNode (table, bucket, node);
+        node = NULL;
+    }
+
+    if (table->lru != NULL)
+    {
+        if (node == NULL)
+            ++table->lru->stats.misses;
+
+        else
+        {
+            ++table->lru->stats.hits;
+            LruTouch (table, node);
+        }
+    }
+
+    return node;
+}
+
+
+hash_table_node*
+HashTableFindBytes (hash_table_t* const table,
+                    const void* const key_buffer,
+                    const size_t key_size,
+                    hash_table_key_comparator key_cmp)
+{
+    if (key_buffer == NULL) return NULL;
+
+    // the key is only read, the buffer is not modified
+    hash_table_key key = {.key = (void*) key_buffer, .key_size = key_size};
+
+    return HashTableFind (table, &key, key_cmp);
+}
+
+
+hash_table_error_status
+HashTableDeleteBytes (hash_table_t* const table,
+                      const void* const key_buffer,
+                      const size_t key_size,
+                      hash_table_key_comparator key_cmp)
+{
+    if (key_buffer == NULL) return HASH_TABLE_ERROR;
+
+    hash_table_key key = {.key = (void*) key_buffer, .key_size = key_size};
+
+    return HashTableDelete (table, &key, key_cmp);
+}
+
+
+const void*
+HashTableNodeValues (const hash_table_t* const table,
+                     const hash_table_node* const node,
+                     size_t* const values_number)
+{
+    if (table         == NULL ||
+        table->mode   != HASH_TABLE_MULTIMAP ||
+        node          == NULL ||
+        values_number == NULL)
+        return NULL;
+
+    *values_number = node->value->value_size / table->value_size;
+
+    return node->value->value;
+}
+
+
+hash_table_error_status
+HashTableSetLru (hash_table_t* const table,
+                 const size_t max_elems,
+                 const size_t max_bytes)
+{
+    if (table              == NULL ||
+        table->elem_number != 0)
+        return HASH_TABLE_ERROR;
+
+    if (table->lru == NULL)
+    {
+        alloc_counters* const scope = AllocTrackingSetScope (&table->memory);
+        table->lru = TrackedCalloc (1, sizeof (hash_table_lru),
+                                    ALLOC_CATEGORY_TABLE);
+        AllocTrackingSetScope (scope);
+
+        if (table->lru == NULL) return HASH_TABLE_ERROR;
+
+        ResetBuckets (table);
+    }
+
+    table->lru->max_elems = max_elems;
+    table->lru->max_bytes = max_bytes;
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+hash_table_error_status
+HashTableLruStats (const hash_table_t* const table,
+                   hash_table_lru_stats* const stats)
+{
+    if (table      == NULL ||
+        table->lru == NULL ||
+        stats      == NULL)
+        return HASH_TABLE_ERROR;
+
+    *stats = table->lru->stats;
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+hash_table_error_status
+HashTableSetTtl (hash_table_t* const table,
+                 hash_table_clock clock)
+{
+    if (table              == NULL ||
+        table->elem_number != 0)
+        return HASH_TABLE_ERROR;
+
+    if (table->ttl == NULL)
+    {
+        alloc_counters* const scope = AllocTrackingSetScope (&table->memory);
+        table->ttl = TrackedCalloc (1, sizeof (hash_table_ttl),
+                                    ALLOC_CATEGORY_TABLE);
+        AllocTrackingSetScope (scope);
+
+        if (table->ttl == NULL) return HASH_TABLE_ERROR;
+
+        ResetBuckets (table);
+    }
+
+    table->ttl->clock   = (clock != NULL) ? clock : TtlMonotonicClock;
+    table->ttl->now     = table->ttl->clock ();
+    table->ttl->current = table->ttl->now;
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+size_t
+HashTableExpire (hash_table_t* const table,
+                 const size_t max_work)
+{
+    if (table      == NULL ||
+        table->ttl == NULL)
+        return 0;
+
+    hash_table_ttl* const ttl = table->ttl;
+    const uint64_t now = ttl->clock ();
+    ttl->now = now;
+
+    size_t work    = 0;
+    size_t expired = 0;
+
+    while (ttl->current <= now)
+    {
+        // nodes of the upper levels slots beginning at the current tick
+        // go down, so the current level 0 slot gets all nodes expiring now
+        for (; ttl->cascade_level != 0; --ttl->cascade_level)
+        {
+            const size_t level = ttl->cascade_level;
+            hash_table_node** const slot =
+                &ttl->slots[level][(ttl->current >>
+                                    (level * TTL_WHEEL_SLOT_BITS)) &
+                                   TTL_WHEEL_SLOT_MASK];
+
+            for (; *slot != NULL; ++work)
+            {
+                if (work == max_work && max_work != 0) return expired;
+
+                TtlPlace (table, *slot, GetNodeExtra (table, *slot)->expire_time);
+            }
+        }
+
+        hash_table_node** const slot =
+            &ttl->slots[0][ttl->current & TTL_WHEEL_SLOT_MASK];
+
+        for (; *slot != NULL; ++work, ++expired)
+        {
+            if (work == max_work && max_work != 0) return expired;
+
+            DeleteNode (table, GetNodeBucket (table, *slot), *slot);
+        }
+
+        TtlNextTick (ttl, now);
+    }
+
+    return expired;
+}
+
+
+size_t
+HashTableNodeSize (const hash_table_mode mode)
+{
+    return ListNodeSize (GetNodeLayout (mode));
+}
+
+
+size_t
+HashTableModeSavedBytes (const hash_table_mode mode)
+{
+    // the smaller node saves nothing if it falls in the same size class
+    const size_t map_bytes  = AllocUsableSize (HashTableNodeSize (HASH_TABLE_MAP));
+    const size_t mode_bytes = AllocUsableSize (HashTableNodeSize (mode));
+
+    return (map_bytes > mode_bytes) ? map_bytes - mode_bytes : 0;
+}
+
+
+hash_table_index
+HashTableKeyHash (const hash_table_t* const table,
+                  hash_table_key* const key)
+{
+    if (table         == NULL ||
+        table->h_func == NULL ||
+        key           == NULL)
+        return 0;
+
+    return table->h_func (key, HASH_TABLE_FULL_RANGE);
+}
+
+
+hash_table_error_status
+HashTableGetStats (const hash_table_t* const table,
+                   hash_table_stats* const stats)
+{
+    if (table == NULL ||
+        stats == NULL)
+        return HASH_TABLE_ERROR;
+
+    const size_t buckets_number = table->buckets_num;
+    const size_t full_buckets   = buckets_number - table->chain_counts[0];
+
+    const double exp_value         = (double) table->elem_number /
+                                     buckets_number;
+    const double exp_value_squares = (double) table->sum_of_squares /
+                                     buckets_number;
+
+    *stats = (hash_table_stats)
+    {
+        .elem_number    = table->elem_number,
+        .buckets_number = buckets_number,
+        .empty_buckets  = table->chain_counts[0],
+        .max_chain      = table->max_chain,
+        .load_factor    = exp_value,
+        .mean_chain     = (full_buckets == 0) ? 0.0 :
+                          (double) table->elem_number / full_buckets,
+        .variance       = exp_value_squares - exp_value * exp_value
+    };
+
+    for (size_t i = 0; i <= table->max_chain; ++i)
+    {
+        const size_t bin = (i < HASH_TABLE_STATS_HISTOGRAM_SIZE) ?
+                           i : HASH_TABLE_STATS_HISTOGRAM_SIZE - 1;
+
+        stats->chain_histogram[bin] += table->chain_counts[i];
+    }
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+hash_table_error_status
+HashTableMemoryUsage (const hash_table_t* const table,
+                      hash_table_memory_usage* const usage)
+{
+    if (table == NULL ||
+        usage == NULL)
+        return HASH_TABLE_ERROR;
+
+#ifndef HASH_TABLE_TRACK_ALLOC
+    *usage = (hash_table_memory_usage) {0};
+    return HASH_TABLE_ERROR;
+#else
+    const alloc_counters* const memory = &table->memory;
+
+    *usage = (hash_table_memory_usage)
+    {
+        .table_bytes    = memory->live_bytes[ALLOC_CATEGORY_TABLE],
+        .buckets_bytes  = memory->live_bytes[ALLOC_CATEGORY_BUCKETS],
+        .nodes_bytes    = memory->live_bytes[ALLOC_CATEGORY_NODES],
+        .keys_bytes     = memory->live_bytes[ALLOC_CATEGORY_KEYS],
+        .values_bytes   = memory->live_bytes[ALLOC_CATEGORY_VALUES],
+        .changes_number = table->changes_number
+    };
+
+    for (size_t i = 0; i < ALLOC_CATEGORIES_NUMBER; ++i)
+    {
+        usage->total_bytes += memory->live_bytes[i];
+        usage->allocations += memory->allocations[i];
+        usage->frees       += memory->frees[i];
+    }
+
+    usage->live_blocks = usage->allocations - usage->frees;
+
+    usage->allocations_per_change = (table->changes_number == 0) ? 0.0 :
+        (double) usage->allocations / table->changes_number;
+    usage->bytes_per_element = (table->elem_number == 0) ? 0.0 :
+        (double) usage->total_bytes / table->elem_number;
+
+    return HASH_TABLE_SUCCESS;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Latency instrumentation functions implementation
+//-----------------------------------------------------------------------------
+
+#ifdef HASH_TABLE_INSTRUMENT
+
+hash_table_error_status
+HashTableLatencySetPeriod (const size_t period)
+{
+    if (period == 0) return HASH_TABLE_ERROR;
+
+    __atomic_store_n (&latency_period, period, __ATOMIC_RELAXED);
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+hash_table_error_status
+HashTableLatencyPercentile (const hash_table_operation operation,
+                            const hash_table_latency_part part,
+                            const double percentile,
+                            double* const nanoseconds)
+{
+    if ((size_t) operation >= LATENCY_OPERATIONS ||
+        (size_t) part      >= LATENCY_PARTS      ||
+        !(percentile >= 0.0 && percentile <= 100.0) ||
+        nanoseconds == NULL)
+        return HASH_TABLE_ERROR;
+
+    const uint64_t* const bins = latency_bins[operation][part];
+    uint64_t samples = 0;
+
+    for (size_t i = 0; i < LATENCY_BINS; ++i)
+        samples += __atomic_load_n (bins + i, __ATOMIC_RELAXED);
+
+    if (samples == 0) return HASH_TABLE_ERROR;
+
+    // the rank of the sample, at least the first one
+    uint64_t rank = (uint64_t) (percentile / 100.0 * (double) samples + 0.5);
+    if (rank == 0) rank = 1;
+
+    uint64_t counted = 0;
+    size_t   bin     = 0;
+
+    for (; bin + 1 < LATENCY_BINS; ++bin)
+    {
+        counted += __atomic_load_n (bins + bin, __ATOMIC_RELAXED);
+        if (counted >= rank) break;
+    }
+
+    *nanoseconds = (double) LatencyBinMaxTicks (bin) * LatencyNsecPerTick ();
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+size_t
+HashTableLatencySamples (const hash_table_operation operation)
+{
+    if ((size_t) operation >= LATENCY_OPERATIONS) return 0;
+
+    const uint64_t* const bins = latency_bins[operation][HASH_TABLE_LATENCY_TOTAL];
+    size_t samples = 0;
+
+    for (size_t i = 0; i < LATENCY_BINS; ++i)
+        samples += __atomic_load_n (bins + i, __ATOMIC_RELAXED);
+
+    return samples;
+}
+
+
+void
+HashTableLatencyDump (FILE* const file)
+{
+    if (file == NULL) return;
+
+    static const char* const operation_names[LATENCY_OPERATIONS] =
+        {"insert", "find", "delete"};
+    static const char* const part_names[LATENCY_PARTS] =
+        {"hash", "probe", "total"};
+
+    const size_t percentiles_number = sizeof (LATENCY_DUMP_PERCENTILES) /
+                                      sizeof (LATENCY_DUMP_PERCENTILES[0]);
+
+    fprintf (file, "%-8s %-6s %10s", "op", "part", "samples");
+    for (size_t i = 0; i < percentiles_number; ++i)
+        fprintf (file, " %7.1lf%%", LATENCY_DUMP_PERCENTILES[i]);
+    fprintf (file, "  (ns)\n");
+
+    for (size_t op = 0; op < LATENCY_OPERATIONS; ++op)
+    {
+        const size_t samples = HashTableLatencySamples (op);
+        if (samples == 0) continue;
+
+        for (size_t part = 0; part < LATENCY_PARTS; ++part)
+        {
+            fprintf (file, "%-8s %-6s %10zu",
+                     operation_names[op], part_names[part], samples);
+
+            for (size_t i = 0; i < percentiles_number; ++i)
+            {
+                double nanoseconds = 0.0;
+                HashTableLatencyPercentile (op, part,
+                                            LATENCY_DUMP_PERCENTILES[i],
+                                            &nanoseconds);
+                fprintf (file, " %8.0lf", nanoseconds);
+            }
+
+            fprintf (file, "\n");
+        }
+    }
+}
+
+
+void
+HashTableLatencyReset (void)
+{
+    memset (latency_bins, 0, sizeof (latency_bins));
+}
+
+#else
+
+hash_table_error_status
+HashTableLatencySetPeriod (const size_t period)
+{
+    (void) period;
+    return HASH_TABLE_ERROR;
+}
+
+
+hash_table_error_status
+HashTableLatencyPercentile (const hash_table_operation operation,
+                            const hash_table_latency_part part,
+                            const double percentile,
+                            double* const nanoseconds)
+{
+    (void) operation;
+    (void) part;
+    (void) percentile;
+    (void) nanoseconds;
+
+    return HASH_TABLE_ERROR;
+}
+
+
+size_t
+HashTableLatencySamples (const hash_table_operation operation)
+{
+    (void) operation;
+    return 0;
+}
+
+
+void
+HashTableLatencyDump (FILE* const file)
+{
+    if (file == NULL) return;
+
+    fprintf (file, "latency instrumentation is off, "
+                   "build with -DHASH_TABLE_INSTRUMENT\n");
+}
+
+
+void
+HashTableLatencyReset (void)
+{
+}
+
+#endif
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static functions implementation
+//-----------------------------------------------------------------------------
+
+static hash_table_bucket*
+GetBucket (hash_table_t* const table,
+           const hash_table_index hash)
+{
+    assert (table);
+
+    const hash_table_index index = hash % table->buckets_num;
+
+    if (table->buckets[index] == NULL)
+    {
+        alloc_counters* const scope = AllocTrackingSetScope (&table->memory);
+
+        table->buckets[index] =
+            ListConstructorWithExtra (GetNodeLayout (table->mode),
+                                      (table->lru != NULL ||
+                                       table->ttl != NULL) ?
+                                      sizeof (node_extra) : 0);
+
+        AllocTrackingSetScope (scope);
+
+        HASH_TABLE_PROBE2 (bucket_create, index, table->buckets_num);
+    }
+
+    return table->buckets[index];
+}
+
+
+static inline hash_table_bucket*
+FindBucket (const hash_table_t* const table,
+            const hash_table_index hash)
+{
+    assert (table);
+
+    return table->buckets[hash % table->buckets_num];
+}
+
+
+static inline size_t
+GetChainLength (const hash_table_bucket* const bucket)
+{
+    if (bucket == NULL) return 0;
+
+    return bucket->elem_number;
+}
+
+
+static hash_table_t*
+TableConstructor (const size_t buckets_number,
+                  hash_function h_func,
+                  const hash_table_mode mode,
+                  const size_t value_size)
+{
+    if (buckets_number == 0 ||
+        h_func         == NULL)
+        return NULL;
+
+    // the table structure is counted before the table has its counters
+    alloc_counters  memory = {0};
+    alloc_counters* scope  = AllocTrackingSetScope (&memory);
+
+    hash_table_t* table = TrackedCalloc (1, sizeof (hash_table_t),
+                                         ALLOC_CATEGORY_TABLE);
+    AllocTrackingSetScope (scope);
+
+    if (table == NULL) return NULL;
+
+    table->memory = memory;
+    scope = AllocTrackingSetScope (&table->memory);
+
+    table->buckets      = TrackedCalloc (buckets_number,
+                                         sizeof (hash_table_bucket*),
+                                         ALLOC_CATEGORY_BUCKETS);
+    table->chain_counts = TrackedCalloc (1, sizeof (size_t),
+                                         ALLOC_CATEGORY_TABLE);
+    AllocTrackingSetScope (scope);
+
+    if (table->buckets      == NULL ||
+        table->chain_counts == NULL)
+        return HashTableDestructor (table);
+
+    table->buckets_num = buckets_number;
+    table->h_func      = h_func;
+    table->elem_number = 0;
+    table->mode        = mode;
+    table->value_size  = value_size;
+    table->lru         = NULL;
+    table->ttl         = NULL;
+
+    table->chain_counts[0] = buckets_number;
+    table->max_chain       = 0;
+    table->sum_of_squares  = 0;
+    table->changes_number  = 0;
+
+    return table;
+}
+
+
+static hash_table_error_status
+InsertNode (hash_table_t*     const table,
+            hash_table_key*   const key,
+            hash_table_value* const value,
+            hash_table_key_comparator key_cmp,
+            const hash_table_index hash,
+            const uint64_t* const ttl)
+{
+    if (table   == NULL ||
+        key     == NULL ||
+        key_cmp == NULL)
+        return HASH_TABLE_ERROR;
+
+    if (table->mode == HASH_TABLE_MULTIMAP &&
+        (value == NULL || value->value_size != table->value_size))
+        return HASH_TABLE_ERROR;
+
+    ++table->changes_number;
+
+    if (table->ttl != NULL)
+        HashTableExpire (table, TTL_INSERT_WORK);
+
+    hash_table_bucket* const bucket = GetBucket (table, hash);
+    if (bucket == NULL) return HASH_TABLE_ERROR;
+
+    hash_table_node* node = ListFindNodeHashed (bucket, key, hash, key_cmp);
+
+    HASH_TABLE_PROBE3 (insert, key->key_size, bucket->elem_number,
+                       hash % table->buckets_num);
+
+    // the clock is just read by HashTableExpire()
+    if (node != NULL && TtlIsExpired (table, node, 0))
+    {
+        DeleteNode (table, bucket, node);
+        node = NULL;
+    }
+
+    if (node != NULL)
+    {
+        // the grown node would be evicted right after the append
+        if (table->mode == HASH_TABLE_MULTIMAP &&
+            table->lru != NULL &&
+            table->lru->max_bytes != 0 &&
+            GetNodeExtra (table, node)->bytes + table->value_size >
+            table->lru->max_bytes)
+            return HASH_TABLE_ERROR;
+
+        if (table->mode == HASH_TABLE_MULTIMAP &&
+            AppendValue (table, node, value) == HASH_TABLE_ERROR)
+            return HASH_TABLE_ERROR;
+
+        if (table->lru != NULL) LruTouch (table, node);
+        if (ttl != NULL && *ttl != 0)
+            TtlPlace (table, node, table->ttl->now + *ttl);
+        else if (ttl != NULL)
+            TtlUnlink (table, node);
+
+        if (table->lru != NULL && table->mode == HASH_TABLE_MULTIMAP)
+            LruEvict (table);
+
+        return HASH_TABLE_SUCCESS;
+    }
+
+    const size_t bytes = (table->lru != NULL) ?
+                         GetNodeBytes (table, key, value) : 0;
+
+    if (table->lru != NULL &&
+        table->lru->max_bytes != 0 &&
+        bytes > table->lru->max_bytes)
+        return HASH_TABLE_ERROR;
+
+    if (ChainGrow (table, bucket->elem_number) == HASH_TABLE_ERROR)
+        return HASH_TABLE_ERROR;
+
+    alloc_counters* const scope = AllocTrackingSetScope (&table->memory);
+    const list_error_status push_status =
+        ListPushBackHashed (bucket, key, value, hash);
+    AllocTrackingSetScope (scope);
+
+    if (push_status == LIST_ERROR)
+    {
+        ChainShrink (table, bucket->elem_number + 1);
+        return HASH_TABLE_ERROR;
+    }
+
+    ++table->elem_number;
+    node = bucket->head->prev;
+
+    if (ttl != NULL && *ttl != 0)
+        TtlPlace (table, node, table->ttl->now + *ttl);
+
+    if (table->lru != NULL)
+    {
+        LruPushFront (table, node, bytes);
+        LruEvict (table);
+    }
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+static hash_table_error_status
+AppendValue (hash_table_t* const table,
+             hash_table_node* const node,
+             const hash_table_value* const value)
+{
+    assert (table);
+    assert (node);
+    assert (value);
+
+    hash_table_value* const values = node->value;
+    const size_t value_size    = table->value_size;
+    const size_t values_number = values->value_size / value_size;
+
+    if ((values_number & (values_number - 1)) == 0)
+    {
+        alloc_counters* const scope = AllocTrackingSetScope (&table->memory);
+        void* const new_buffer = TrackedRealloc (values->value,
+                                                 2 * values_number * value_size,
+                                                 ALLOC_CATEGORY_VALUES);
+        AllocTrackingSetScope (scope);
+
+        if (new_buffer == NULL) return HASH_TABLE_ERROR;
+
+        values->value = new_buffer;
+    }
+
+    memcpy ((char*) values->value + values->value_size,
+            value->value, value_size);
+    values->value_size += value_size;
+
+    if (table->lru != NULL)
+    {
+        GetNodeExtra (table, node)->bytes += value_size;
+        table->lru->stats.bytes           += value_size;
+    }
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+static hash_table_error_status
+DeleteNode (hash_table_t*      const table,
+            hash_table_bucket* const bucket,
+            hash_table_node*   const node)
+{
+    assert (table);
+
+    if (table->lru != NULL) LruUnlink (table, node);
+    if (table->ttl != NULL) TtlUnlink (table, node);
+
+    alloc_counters* const scope = AllocTrackingSetScope (&table->memory);
+    const list_error_status delete_status = ListDeleteNode (bucket, node);
+    AllocTrackingSetScope (scope);
+
+    if (delete_status == LIST_ERROR)
+        return HASH_TABLE_ERROR;
+
+    ChainShrink (table, bucket->elem_number + 1);
+
+    --table->elem_number;
+    return HASH_TABLE_SUCCESS;
+}
+
+
+static hash_table_error_status
+ChainGrow (hash_table_t* const table,
+           const size_t length)
+{
+    assert (table);
+    assert (length <= table->max_chain);
+
+    const size_t new_length = length + 1;
+
+    if (new_length > table->max_chain &&
+        (new_length & (new_length - 1)) == 0)
+    {
+        alloc_counters* const scope = AllocTrackingSetScope (&table->memory);
+        size_t* const new_counts =
+            TrackedRealloc (table->chain_counts,
+                            2 * new_length * sizeof (size_t),
+                            ALLOC_CATEGORY_TABLE);
+        AllocTrackingSetScope (scope);
+
+        if (new_counts == NULL) return HASH_TABLE_ERROR;
+
+        table->chain_counts = new_counts;
+    }
+
+    if (new_length > table->max_chain)
+    {
+        table->chain_counts[new_length] = 0;
+        table->max_chain = new_length;
+    }
+
+    --table->chain_counts[length];
+    ++table->chain_counts[new_length];
+
+    // (l + 1)^2 - l^2 = 2l + 1
+    table->sum_of_squares += 2 * length + 1;
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+static void
+ChainShrink (hash_table_t* const table,
+             const size_t length)
+{
+    assert (table);
+    assert (length != 0);
+    assert (length <= table->max_chain);
+
+    --table->chain_counts[length];
+    ++table->chain_counts[length - 1];
+
+    // the bucket is now one shorter, so the next length is not empty
+    if (length == table->max_chain && table->chain_counts[length] == 0)
+        --table->max_chain;
+
+    table->sum_of_squares -= 2 * length - 1;
+}
+
+
 static hash_table_bucket*
-GetBucket (hash_table_t* const table,
-           hash_table_key* const key);
+GetNodeBucket (const hash_table_t* const table,
+               const hash_table_node* const node)
+{
+    assert (table);
+    assert (node);
+
+    return table->buckets[node->hash % table->buckets_num];
+}
+
+
+static void
+ResetBuckets (hash_table_t* const table)
+{
+    assert (table);
+    assert (table->elem_number == 0);
+
+    alloc_counters* const scope = AllocTrackingSetScope (&table->memory);
+
+    for (size_t i = 0; i < table->buckets_num; ++i)
+        table->buckets[i] = ListDestructor (table->buckets[i]);
+
+    AllocTrackingSetScope (scope);
+}
+
+
+static list_node_layout
+GetNodeLayout (const hash_table_mode mode)
+{
+    if (mode == HASH_TABLE_SET) return LIST_NODE_KEY_ONLY;
+
+    return LIST_NODE_KEY_VALUE;
+}
+
+
+static node_extra*
+GetNodeExtra (const hash_table_t* const table,
+              hash_table_node* const node)
+{
+    assert (table);
+    assert (node);
+
+    return ListNodeExtra (node, GetNodeLayout (table->mode));
+}
+
+
+static size_t
+GetNodeBytes (const hash_table_t* const table,
+              const hash_table_key* const key,
+              const hash_table_value* const value)
+{
+    assert (table);
+    assert (key);
+
+    size_t bytes = HashTableNodeSize (table->mode) + sizeof (node_extra) +
+                   sizeof (hash_table_key) + key->key_size;
+
+    if (table->mode != HASH_TABLE_SET && value != NULL)
+        bytes += sizeof (hash_table_value) + value->value_size;
+
+    return bytes;
+}
 
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
@@ -28,141 +1642,308 @@ GetBucket (hash_table_t* const table,
 
 
 //-----------------------------------------------------------------------------
-// Interface functions implementation
+// LRU static functions implementation
 //-----------------------------------------------------------------------------
 
-hash_table_t*
-HashTableConstructor (const size_t buckets_number,
-                      hash_function h_func)
+static void
+LruPushFront (hash_table_t* const table,
+              hash_table_node* const node,
+              const size_t bytes)
 {
-    if (buckets_number == 0 ||
-        h_func         == NULL)
-        return NULL;
+    assert (table);
+    assert (table->lru);
+    assert (node);
 
-    hash_table_t* table = malloc(sizeof (hash_table_t));
-    if (table == NULL) return NULL;
+    hash_table_lru* const lru   = table->lru;
+    node_extra*     const extra = GetNodeExtra (table, node);
 
-    table->buckets = calloc (buckets_number, sizeof (hash_table_bucket*));
-    if (table->buckets == NULL)
-        return HashTableDestructor (table);
+    extra->bytes = bytes;
+    lru->stats.bytes += bytes;
 
-    table->buckets_num = buckets_number;
-    table->h_func      = h_func;
-    table->elem_number = 0;
+    if (lru->head == NULL)
+    {
+        extra->lru_next = node;
+        extra->lru_prev = node;
+    }
 
-    return table;
+    else
+    {
+        hash_table_node* const tail = GetNodeExtra (table, lru->head)->lru_prev;
+
+        extra->lru_next = lru->head;
+        extra->lru_prev = tail;
+
+        GetNodeExtra (table, lru->head)->lru_prev = node;
+        GetNodeExtra (table, tail)->lru_next      = node;
+    }
+
+    lru->head = node;
 }
 
 
-hash_table_t*
-HashTableDestructor (hash_table_t* const table)
+static void
+LruUnlink (hash_table_t* const table,
+           hash_table_node* const node)
 {
-    if (table == NULL) return NULL;
+    assert (table);
+    assert (table->lru);
+    assert (node);
 
-    const size_t buckets_number = table->buckets_num;
-    hash_table_bucket** buckets = table->buckets;
+    hash_table_lru* const lru   = table->lru;
+    node_extra*     const extra = GetNodeExtra (table, node);
 
-    if (buckets != NULL)
-        for (size_t i = 0; i < buckets_number; ++i)
-            buckets[i] = ListDestructor (buckets[i]);
+    lru->stats.bytes -= extra->bytes;
 
-    free (buckets);
-    free (table);
+    if (extra->lru_next == node)
+        lru->head = NULL;
 
-    return NULL;
+    else
+    {
+        GetNodeExtra (table, extra->lru_prev)->lru_next = extra->lru_next;
+        GetNodeExtra (table, extra->lru_next)->lru_prev = extra->lru_prev;
+
+        if (lru->head == node)
+            lru->head = extra->lru_next;
+    }
+
+    extra->lru_next = NULL;
+    extra->lru_prev = NULL;
 }
 
 
-hash_table_key*
-HashTableKeyConstructor (const void* const key_buffer,
-                         const size_t key_size)
+static void
+LruTouch (hash_table_t* const table,
+          hash_table_node* const node)
 {
-    return ListKeyConstructor (key_buffer, key_size);
+    assert (table);
+    assert (table->lru);
+    assert (node);
+
+    if (table->lru->head == node) return;
+
+    const size_t bytes = GetNodeExtra (table, node)->bytes;
+
+    LruUnlink    (table, node);
+    LruPushFront (table, node, bytes);
 }
 
 
-hash_table_key*
-HashTableKeyDestructor (hash_table_key* const key)
+static void
+LruEvict (hash_table_t* const table)
 {
-    return ListKeyDestructor (key);
+    assert (table);
+    assert (table->lru);
+
+    hash_table_lru* const lru = table->lru;
+
+    while ((lru->max_elems != 0 && table->elem_number > lru->max_elems) ||
+           (lru->max_bytes != 0 && lru->stats.bytes  > lru->max_bytes))
+    {
+        hash_table_node* const tail = GetNodeExtra (table, lru->head)->lru_prev;
+
+        DeleteNode (table, GetNodeBucket (table, tail), tail);
+        ++lru->stats.evictions;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Timing wheel static functions implementation
+//-----------------------------------------------------------------------------
+
+static uint64_t
+TtlMonotonicClock (void)
+{
+    struct timespec time = {0};
+    clock_gettime (CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * MSEC_PER_SEC +
+           (uint64_t) time.tv_nsec / NSEC_PER_MSEC;
 }
 
 
-hash_table_value*
-HashTableValueConstructor (const void* const value_buffer,
-                           const size_t value_size)
+static void
+TtlPlace (hash_table_t* const table,
+          hash_table_node* const node,
+          const uint64_t expire_time)
 {
-    return ListValueConstructor (value_buffer, value_size);
+    assert (table);
+    assert (table->ttl);
+    assert (node);
+
+    hash_table_ttl* const ttl   = table->ttl;
+    node_extra*     const extra = GetNodeExtra (table, node);
+
+    TtlUnlink (table, node);
+
+    // expired nodes go to the current slot, too far ones to the last level
+    // and are moved again when the current tick reaches them
+    uint64_t time = (expire_time < ttl->current) ? ttl->current : expire_time;
+    const uint64_t delta = time - ttl->current;
+
+    size_t level = 0;
+    while (level < TTL_WHEEL_LEVELS - 1 &&
+           delta >> ((level + 1) * TTL_WHEEL_SLOT_BITS) != 0)
+        ++level;
+
+    if (delta >> (TTL_WHEEL_LEVELS * TTL_WHEEL_SLOT_BITS) != 0)
+        time = ttl->current +
+               (1ull << (TTL_WHEEL_LEVELS * TTL_WHEEL_SLOT_BITS)) - 1;
+
+    const size_t slot_index =
+        (time >> (level * TTL_WHEEL_SLOT_BITS)) & TTL_WHEEL_SLOT_MASK;
+    hash_table_node** const slot = &ttl->slots[level][slot_index];
+
+    if (*slot == NULL)
+    {
+        extra->ttl_next = node;
+        extra->ttl_prev = node;
+        ttl->occupied[level] |= 1ull << slot_index;
+    }
+
+    else
+    {
+        node_extra* const head_extra = GetNodeExtra (table, *slot);
+
+        extra->ttl_next = *slot;
+        extra->ttl_prev = head_extra->ttl_prev;
+
+        GetNodeExtra (table, head_extra->ttl_prev)->ttl_next = node;
+        head_extra->ttl_prev = node;
+    }
+
+    *slot = node;
+    extra->ttl_slot    = slot;
+    extra->expire_time = expire_time;
+
+    ++ttl->nodes_number;
 }
 
 
-hash_table_value*
-HashTableValueDestructor (hash_table_value* const value)
+static void
+TtlUnlink (hash_table_t* const table,
+           hash_table_node* const node)
 {
-    return ListValueDestructor (value);
+    assert (table);
+    assert (table->ttl);
+    assert (node);
+
+    hash_table_ttl* const ttl   = table->ttl;
+    node_extra*     const extra = GetNodeExtra (table, node);
+
+    hash_table_node** const slot = extra->ttl_slot;
+    if (slot == NULL) return;
+
+    if (extra->ttl_next == node)
+    {
+        const size_t slot_number = (size_t) (slot - &ttl->slots[0][0]);
+
+        *slot = NULL;
+        ttl->occupied[slot_number / TTL_WHEEL_SLOTS] &=
+            ~(1ull << (slot_number % TTL_WHEEL_SLOTS));
+    }
+
+    else
+    {
+        GetNodeExtra (table, extra->ttl_prev)->ttl_next = extra->ttl_next;
+        GetNodeExtra (table, extra->ttl_next)->ttl_prev = extra->ttl_prev;
+
+        if (*slot == node)
+            *slot = extra->ttl_next;
+    }
+
+    extra->ttl_next = NULL;
+    extra->ttl_prev = NULL;
+    extra->ttl_slot = NULL;
+
+    --ttl->nodes_number;
 }
 
 
-hash_table_error_status
-HashTableInsert (hash_table_t*     const table,
-                 hash_table_key*   const key,
-                 hash_table_value* const value,
-                 hash_table_key_comparator key_cmp)
+static int
+TtlIsExpired (hash_table_t* const table,
+              hash_table_node* const node,
+              const int read_clock)
 {
-    if (table         == NULL ||
-        table->h_func == NULL ||
-        key           == NULL ||
-        key_cmp       == NULL)
-        return HASH_TABLE_ERROR;
+    assert (table);
+    assert (node);
 
-    hash_table_bucket* const bucket = GetBucket (table, key);
-    hash_table_node*   const node   = ListFindNode (bucket, key, key_cmp);
+    hash_table_ttl* const ttl = table->ttl;
+    if (ttl == NULL) return 0;
 
-    if (node != NULL) return HASH_TABLE_SUCCESS;
+    const node_extra* const extra = GetNodeExtra (table, node);
 
-    if (ListPushBack (bucket, key, value) == LIST_ERROR)
-        return HASH_TABLE_ERROR;
+    if (extra->ttl_slot    == NULL) return 0;
+    if (extra->expire_time <= ttl->now) return 1;
+    if (!read_clock) return 0;
 
-    ++table->elem_number;
-    return HASH_TABLE_SUCCESS;
+    // the wheel catches up with the reading on the next insert or expire
+    const uint64_t now = ttl->clock ();
+    if (now > ttl->now) ttl->now = now;
+
+    return extra->expire_time <= ttl->now;
 }
 
 
-hash_table_error_status
-HashTableDelete (hash_table_t*   const table,
-                 hash_table_key* const key,
-                 hash_table_key_comparator key_cmp)
+static void
+TtlNextTick (hash_table_ttl* const ttl,
+             const uint64_t now)
 {
-    if (table         == NULL ||
-        table->h_func == NULL ||
-        key           == NULL)
-        return HASH_TABLE_ERROR;
+    assert (ttl);
 
-    hash_table_bucket* const bucket = GetBucket (table, key);
-    hash_table_node*   const node   = ListFindNode (bucket, key, key_cmp);
+    const uint64_t tick = ttl->current;
+    uint64_t next_tick  = now + 1;
 
-    if (node == NULL) return HASH_TABLE_ERROR;
+    for (size_t level = 0; level < TTL_WHEEL_LEVELS; ++level)
+    {
+        const size_t   shift      = level * TTL_WHEEL_SLOT_BITS;
+        const uint64_t slot_index = (tick >> shift) & TTL_WHEEL_SLOT_MASK;
 
-    if (ListDeleteNode (bucket, node) == LIST_ERROR)
-        return HASH_TABLE_ERROR;
+        const uint64_t later_slots = (slot_index == TTL_WHEEL_SLOT_MASK) ? 0 :
+            ttl->occupied[level] & (~0ull << (slot_index + 1));
 
-    --table->elem_number;
-    return HASH_TABLE_SUCCESS;
+        // the next non-empty slot of this level in the current round
+        if (later_slots != 0)
+        {
+            const uint64_t slot_tick =
+                ((tick >> shift) +
+                 (uint64_t) __builtin_ctzll (later_slots) - slot_index) << shift;
+
+            if (slot_tick < next_tick) next_tick = slot_tick;
+            break;
+        }
+
+        // the slots of the next round begin with the upper level slot
+        if (ttl->occupied[level] != 0)
+        {
+            const uint64_t round_tick =
+                ((tick >> (shift + TTL_WHEEL_SLOT_BITS)) + 1) <<
+                (shift + TTL_WHEEL_SLOT_BITS);
+
+            if (round_tick < next_tick) next_tick = round_tick;
+            break;
+        }
+    }
+
+    ttl->current       = next_tick;
+    ttl->cascade_level = TtlCascadeLevel (next_tick);
 }
 
 
-hash_table_node*
-HashTableFind (hash_table_t*   const table,
-               hash_table_key* const key,
-               hash_table_key_comparator key_cmp)
+static size_t
+TtlCascadeLevel (const uint64_t tick)
 {
-    if (table         == NULL ||
-        table->h_func == NULL ||
-        key           == NULL)
-        return NULL;
+    size_t level = 0;
 
-    hash_table_bucket* const bucket = GetBucket (table, key);
-    return ListFindNode (bucket, key, key_cmp);
+    while (level < TTL_WHEEL_LEVELS - 1 &&
+           (tick & ((1ull << ((level + 1) * TTL_WHEEL_SLOT_BITS)) - 1)) == 0)
+        ++level;
+
+    return level;
 }
 
 //-----------------------------------------------------------------------------
@@ -171,25 +1952,133 @@ HashTableFind (hash_table_t*   const table,
 
 
 //-----------------------------------------------------------------------------
-// Static functions implementation
+// Latency instrumentation static functions implementation
 //-----------------------------------------------------------------------------
 
-static hash_table_bucket*
-GetBucket (hash_table_t* const table,
-           hash_table_key* const key)
+#ifdef HASH_TABLE_INSTRUMENT
+
+static inline uint64_t
+LatencyTicks (void)
 {
-    assert (table);
-    assert (table->h_func);
-    assert (key);
+#if LATENCY_RDTSC
+    return __rdtsc ();
+#else
+    struct timespec time = {0};
+    clock_gettime (CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * NSEC_PER_SEC + (uint64_t) time.tv_nsec;
+#endif
+}
 
-    const hash_table_index index = table->h_func (key, table->buckets_num);
-    if (index >= table->buckets_num) return NULL;
 
-    if (table->buckets[index] == NULL)
-        table->buckets[index] = ListConstructor ();
+static inline void
+LatencyBegin (latency_sample* const sample)
+{
+    assert (sample);
 
-    return table->buckets[index];
+    sample->sampled = (--latency_countdown == 0);
+    if (!sample->sampled) return;
+
+    latency_countdown = __atomic_load_n (&latency_period, __ATOMIC_RELAXED);
+
+    sample->begin = LatencyTicks ();
+    sample->split = sample->begin;
+}
+
+
+static inline void
+LatencySplit (latency_sample* const sample)
+{
+    assert (sample);
+
+    if (sample->sampled) sample->split = LatencyTicks ();
+}
+
+
+static inline void
+LatencyEnd (const latency_sample* const sample,
+            const hash_table_operation operation)
+{
+    assert (sample);
+
+    if (!sample->sampled) return;
+
+    const uint64_t end = LatencyTicks ();
+    uint64_t (*const bins)[LATENCY_BINS] = latency_bins[operation];
+
+    __atomic_fetch_add (&bins[HASH_TABLE_LATENCY_HASH]
+                             [LatencyBin (sample->split - sample->begin)],
+                        1, __ATOMIC_RELAXED);
+    __atomic_fetch_add (&bins[HASH_TABLE_LATENCY_PROBE]
+                             [LatencyBin (end - sample->split)],
+                        1, __ATOMIC_RELAXED);
+    __atomic_fetch_add (&bins[HASH_TABLE_LATENCY_TOTAL]
+                             [LatencyBin (end - sample->begin)],
+                        1, __ATOMIC_RELAXED);
+}
+
+
+static size_t
+LatencyBin (const uint64_t ticks)
+{
+    if (ticks < LATENCY_SUB_BINS) return (size_t) ticks;
+
+    const size_t exponent = 63 - (size_t) __builtin_clzll (ticks);
+    const size_t sub_bin  = (size_t) (ticks >> (exponent - LATENCY_SUB_BITS)) &
+                            (LATENCY_SUB_BINS - 1);
+
+    return (exponent - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BINS + sub_bin;
+}
+
+
+static uint64_t
+LatencyBinMaxTicks (const size_t bin)
+{
+    if (bin < LATENCY_SUB_BINS) return bin;
+
+    const size_t exponent = bin / LATENCY_SUB_BINS + LATENCY_SUB_BITS - 1;
+    const size_t sub_bin  = bin % LATENCY_SUB_BINS;
+    const size_t shift    = exponent - LATENCY_SUB_BITS;
+
+    return (((uint64_t) (LATENCY_SUB_BINS + sub_bin) + 1) << shift) - 1;
+}
+
+
+static double
+LatencyNsecPerTick (void)
+{
+    pthread_once (&latency_calibration, LatencyCalibrate);
+
+    return latency_nsec_per_tick;
+}
+
+
+static void
+LatencyCalibrate (void)
+{
+    // nanoseconds are counted without the TSC
+    if (!LATENCY_RDTSC) return;
+
+    struct timespec begin_time = {0};
+    struct timespec time       = {0};
+    clock_gettime (CLOCK_MONOTONIC, &begin_time);
+
+    const uint64_t begin_ticks = LatencyTicks ();
+    uint64_t nanoseconds = 0;
+
+    while (nanoseconds < LATENCY_CALIBRATION_NSEC)
+    {
+        clock_gettime (CLOCK_MONOTONIC, &time);
+        nanoseconds = (uint64_t) (time.tv_sec - begin_time.tv_sec) *
+                      NSEC_PER_SEC + (uint64_t) time.tv_nsec -
+                      (uint64_t) begin_time.tv_nsec;
+    }
+
+    latency_nsec_per_tick = (double) nanoseconds /
+                            (double) (LatencyTicks () - begin_ticks);
 }
 
+#endif
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
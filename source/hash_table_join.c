@@ -0,0 +1,699 @@
+#include "hash_table_join.h"
+#include "doubly_linked_list.h"
+#include <assert.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+
+
+//-----------------------------------------------------------------------------
+// Consts
+//-----------------------------------------------------------------------------
+
+/// @brief Number of joined tables
+#define JOIN_SIDES 2
+
+
+/// @brief Index of the left table
+static const size_t JOIN_LEFT = 0;
+
+
+/// @brief Index of the right table
+static const size_t JOIN_RIGHT = 1;
+
+
+/// @brief Desired number of right table nodes in one partition
+static const size_t JOIN_PARTITION_SIZE = 1 << 12;
+
+
+/// @brief Maximum number of the hash bits taking the partition
+static const size_t JOIN_MAX_RADIX_BITS = 14;
+
+
+/// @brief Minimal number of partitions per thread for the load balance
+static const size_t JOIN_PARTITIONS_PER_THREAD = 4;
+
+
+/// @brief Minimal number of nodes joined by one thread
+static const size_t JOIN_MIN_THREAD_NODES = 1 << 14;
+
+
+/// @brief Multiplier mixing the hash bits before taking the partition
+static const uint64_t JOIN_PARTITION_MULTIPLIER = 0x9e3779b97f4a7c15ull;
+
+
+/// @brief Multiplier mixing the hash bits before taking the slot
+static const uint64_t JOIN_SLOT_MULTIPLIER = 0xff51afd7ed558ccdull;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static structures
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Node with its stored hash, copied to be partitioned
+ */
+typedef
+struct join_entry
+{
+    size_t           hash;  ///< stored hash of the node key
+    hash_table_node* node;  ///< node of the table
+}
+join_entry;
+
+
+/**
+ * @brief Data shared by all join threads
+ */
+typedef
+struct join_context
+{
+    hash_table_t* tables[JOIN_SIDES];       ///< left and right tables
+    hash_table_join_type      type;         ///< type of the join
+    hash_table_key_comparator key_cmp;      ///< key comparator function
+    hash_table_join_callback  callback;     ///< result callback
+    void*                     arg;          ///< callback argument
+
+    size_t threads_number;                  ///< number of threads
+    size_t radix_bits;                      ///< hash bits of the partition
+    size_t partitions_number;               ///< 2^radix_bits
+
+    join_entry* entries[JOIN_SIDES];        ///< partitioned nodes
+    size_t* offsets[JOIN_SIDES];            ///< [thread][partition] counters
+    size_t* partition_begin[JOIN_SIDES];    ///< partitions_number + 1 offsets
+
+    size_t next_partition;                  ///< next partition to join
+    hash_table_error_status status;         ///< error of any join thread
+}
+join_context;
+
+
+/**
+ * @brief One thread of the join
+ */
+typedef
+struct join_task
+{
+    join_context* context;          ///< shared data
+    size_t        thread_index;     ///< index of the thread
+
+    size_t*        slots;           ///< open addressing table of a partition
+    unsigned char* matched;         ///< matched right nodes of a partition
+    size_t         slots_capacity;  ///< number of allocated slots
+}
+join_task;
+
+
+/**
+ * @brief A signature for a thread function of the join phase
+ */
+typedef
+void* (*join_phase) (void* const);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static functions prototypes
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Runs the phase function for every task, task 0 on the caller thread
+ *
+ * @details If a thread can not be created, its task is run by the caller
+ */
+static void
+RunJoinPhase (join_task* const tasks,
+              const size_t threads_number,
+              join_phase phase);
+
+
+/**
+ * @brief Thread function, counts the nodes of every partition in
+ * the thread range of buckets of both tables
+ */
+static void*
+CountTaskRun (void* const task);
+
+
+/**
+ * @brief Thread function, copies the nodes of the thread range of buckets
+ * of both tables to their partitions
+ */
+static void*
+ScatterTaskRun (void* const task);
+
+
+/**
+ * @brief Thread function, joins partitions while there are any left
+ */
+static void*
+JoinTaskRun (void* const task);
+
+
+/**
+ * @brief Joins one partition of the left table with one of the right table
+ *
+ * @retval HASH_TABLE_SUCCESS if function ended successfully
+ * @retval HASH_TABLE_ERROR if allocation error occured
+ */
+static hash_table_error_status
+JoinPartition (join_task* const task,
+               const size_t partition);
+
+
+/**
+ * @brief Turns the counters of all threads into the write offsets
+ */
+static void
+MakePartitionOffsets (join_context* const context,
+                      const size_t side);
+
+
+/**
+ * @brief Gets the first bucket of the thread range
+ */
+static size_t
+GetRangeBegin (const hash_table_t* const table,
+               const size_t thread_index,
+               const size_t threads_number);
+
+
+/**
+ * @brief Gets the partition of the hash
+ */
+static size_t
+GetPartition (const size_t hash,
+              const size_t radix_bits);
+
+
+/**
+ * @brief Gets the slot of the hash in the table of 2^slot_bits slots
+ */
+static size_t
+GetSlot (const size_t hash,
+         const size_t slot_bits);
+
+
+/**
+ * @brief Gets the number of the join threads
+ *
+ * @param threads_number Requested number of threads, 0 for the number of CPUs
+ * @param nodes_number Number of nodes in both tables
+ *
+ * @retval Number of threads, every thread gets at least
+ * JOIN_MIN_THREAD_NODES nodes
+ */
+static size_t
+GetJoinThreadsNumber (const size_t threads_number,
+                      const size_t nodes_number);
+
+
+/**
+ * @brief Gets the number of hash bits taking the partition
+ */
+static size_t
+GetRadixBits (const size_t right_nodes_number,
+              const size_t threads_number);
+
+
+/**
+ * @brief Frees the arrays of the context and the tasks
+ */
+static void
+JoinContextDestructor (join_context* const context,
+                       join_task* const tasks);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Join functions implementation
+//-----------------------------------------------------------------------------
+
+hash_table_error_status
+HashTableJoin (hash_table_t* const left,
+               hash_table_t* const right,
+               const hash_table_join_type type,
+               hash_table_key_comparator key_cmp,
+               const size_t threads_number,
+               hash_table_join_callback callback,
+               void* const arg)
+{
+    if (left     == NULL ||
+        right    == NULL ||
+        key_cmp  == NULL ||
+        callback == NULL)
+        return HASH_TABLE_ERROR;
+
+    // stored hashes are comparable only if made by the same function
+    if (left->h_func != right->h_func)
+        return HASH_TABLE_ERROR;
+
+    join_context context =
+    {
+        .tables   = {left, right},
+        .type     = type,
+        .key_cmp  = key_cmp,
+        .callback = callback,
+        .arg      = arg,
+        .status   = HASH_TABLE_SUCCESS
+    };
+
+    context.threads_number =
+        GetJoinThreadsNumber (threads_number,
+                              left->elem_number + right->elem_number);
+    context.radix_bits = GetRadixBits (right->elem_number,
+                                       context.threads_number);
+    context.partitions_number = (size_t) 1 << context.radix_bits;
+
+    const size_t counters_number =
+        context.threads_number * context.partitions_number;
+
+    join_task* const tasks = calloc (context.threads_number, sizeof (join_task));
+    hash_table_error_status status = (tasks != NULL) ? HASH_TABLE_SUCCESS :
+                                                       HASH_TABLE_ERROR;
+
+    for (size_t side = 0; side < JOIN_SIDES && status == HASH_TABLE_SUCCESS;
+         ++side)
+    {
+        // one more entry, so calloc does not return NULL for empty tables
+        context.entries[side] =
+            calloc (context.tables[side]->elem_number + 1, sizeof (join_entry));
+        context.offsets[side] = calloc (counters_number, sizeof (size_t));
+        context.partition_begin[side] =
+            calloc (context.partitions_number + 1, sizeof (size_t));
+
+        if (context.entries[side]         == NULL ||
+            context.offsets[side]         == NULL ||
+            context.partition_begin[side] == NULL)
+            status = HASH_TABLE_ERROR;
+    }
+
+    if (status == HASH_TABLE_ERROR)
+    {
+        JoinContextDestructor (&context, tasks);
+        return HASH_TABLE_ERROR;
+    }
+
+    for (size_t i = 0; i < context.threads_number; ++i)
+    {
+        tasks[i].context      = &context;
+        tasks[i].thread_index = i;
+    }
+
+    RunJoinPhase (tasks, context.threads_number, CountTaskRun);
+
+    MakePartitionOffsets (&context, JOIN_LEFT);
+    MakePartitionOffsets (&context, JOIN_RIGHT);
+
+    RunJoinPhase (tasks, context.threads_number, ScatterTaskRun);
+    RunJoinPhase (tasks, context.threads_number, JoinTaskRun);
+
+    status = context.status;
+
+    JoinContextDestructor (&context, tasks);
+    return status;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static functions implementation
+//-----------------------------------------------------------------------------
+
+static void
+RunJoinPhase (join_task* const tasks,
+              const size_t threads_number,
+              join_phase phase)
+{
+    assert (tasks);
+    assert (phase);
+
+    pthread_t* const ids     = calloc (threads_number, sizeof (pthread_t));
+    int*       const started = calloc (threads_number, sizeof (int));
+
+    for (size_t i = 1; i < threads_number && ids && started; ++i)
+        started[i] = (pthread_create (ids + i, NULL, phase, tasks + i) == 0);
+
+    phase (tasks);
+
+    for (size_t i = 1; i < threads_number; ++i)
+    {
+        if (started && started[i]) pthread_join (ids[i], NULL);
+        else                       phase (tasks + i);
+    }
+
+    free (started);
+    free (ids);
+}
+
+
+static void*
+CountTaskRun (void* const task)
+{
+    assert (task);
+
+    join_task*    const join    = task;
+    join_context* const context = join->context;
+
+    const size_t thread_index = join->thread_index;
+
+    for (size_t side = 0; side < JOIN_SIDES; ++side)
+    {
+        const hash_table_t* const table = context->tables[side];
+        size_t* const counters =
+            context->offsets[side] + thread_index * context->partitions_number;
+
+        const size_t range_begin =
+            GetRangeBegin (table, thread_index,     context->threads_number);
+        const size_t range_end   =
+            GetRangeBegin (table, thread_index + 1, context->threads_number);
+
+        for (size_t i = range_begin; i < range_end; ++i)
+        {
+            const hash_table_bucket* const bucket = table->buckets[i];
+            if (bucket == NULL) continue;
+
+            const list_node* node = bucket->head;
+
+            for (size_t j = 0; j < bucket->elem_number; ++j, node = node->next)
+                ++counters[GetPartition (node->hash, context->radix_bits)];
+        }
+    }
+
+    return NULL;
+}
+
+
+static void*
+ScatterTaskRun (void* const task)
+{
+    assert (task);
+
+    join_task*    const join    = task;
+    join_context* const context = join->context;
+
+    const size_t thread_index = join->thread_index;
+
+    for (size_t side = 0; side < JOIN_SIDES; ++side)
+    {
+        const hash_table_t* const table = context->tables[side];
+        join_entry* const entries = context->entries[side];
+        size_t* const offsets =
+            context->offsets[side] + thread_index * context->partitions_number;
+
+        const size_t range_begin =
+            GetRangeBegin (table, thread_index,     context->threads_number);
+        const size_t range_end   =
+            GetRangeBegin (table, thread_index + 1, context->threads_number);
+
+        for (size_t i = range_begin; i < range_end; ++i)
+        {
+            const hash_table_bucket* const bucket = table->buckets[i];
+            if (bucket == NULL) continue;
+
+            list_node* node = bucket->head;
+
+            for (size_t j = 0; j < bucket->elem_number; ++j, node = node->next)
+            {
+                const size_t partition =
+                    GetPartition (node->hash, context->radix_bits);
+
+                entries[offsets[partition]++] =
+                    (join_entry) {.hash = node->hash, .node = node};
+            }
+        }
+    }
+
+    return NULL;
+}
+
+
+static void*
+JoinTaskRun (void* const task)
+{
+    assert (task);
+
+    join_task*    const join    = task;
+    join_context* const context = join->context;
+
+    size_t partition = 0;
+
+    while ((partition = __atomic_fetch_add (&context->next_partition, 1,
+                                            __ATOMIC_RELAXED)) <
+           context->partitions_number)
+    {
+        if (JoinPartition (join, partition) == HASH_TABLE_ERROR)
+        {
+            __atomic_store_n (&context->status, HASH_TABLE_ERROR,
+                              __ATOMIC_RELAXED);
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+
+static hash_table_error_status
+JoinPartition (join_task* const task,
+               const size_t partition)
+{
+    assert (task);
+
+    join_context* const context = task->context;
+
+    const join_entry* const left  = context->entries[JOIN_LEFT] +
+                                    context->partition_begin[JOIN_LEFT][partition];
+    const join_entry* const right = context->entries[JOIN_RIGHT] +
+                                    context->partition_begin[JOIN_RIGHT][partition];
+
+    const size_t left_number  = context->partition_begin[JOIN_LEFT][partition + 1] -
+                                context->partition_begin[JOIN_LEFT][partition];
+    const size_t right_number = context->partition_begin[JOIN_RIGHT][partition + 1] -
+                                context->partition_begin[JOIN_RIGHT][partition];
+
+    const hash_table_join_type type = context->type;
+    const size_t thread_index       = task->thread_index;
+
+    // at least twice more slots than nodes, so probe sequences are short
+    size_t slot_bits = 0;
+    while (((size_t) 1 << slot_bits) < 2 * right_number) ++slot_bits;
+
+    const size_t slots_number = (size_t) 1 << slot_bits;
+    const size_t slots_mask   = slots_number - 1;
+
+    if (task->slots_capacity < slots_number)
+    {
+        free (task->slots);
+        free (task->matched);
+
+        task->slots   = calloc (slots_number, sizeof (size_t));
+        task->matched = calloc (slots_number, sizeof (unsigned char));
+        task->slots_capacity = slots_number;
+
+        if (task->slots == NULL || task->matched == NULL)
+        {
+            task->slots_capacity = 0;
+            return HASH_TABLE_ERROR;
+        }
+    }
+
+    size_t*        const slots   = task->slots;
+    unsigned char* const matched = task->matched;
+
+    memset (slots,   0, slots_number * sizeof (size_t));
+    memset (matched, 0, right_number * sizeof (unsigned char));
+
+    // slots keep the right entry index + 1, 0 for the empty slot
+    for (size_t i = 0; i < right_number; ++i)
+    {
+        size_t slot = GetSlot (right[i].hash, slot_bits);
+        while (slots[slot] != 0) slot = (slot + 1) & slots_mask;
+
+        slots[slot] = i + 1;
+    }
+
+    for (size_t i = 0; i < left_number; ++i)
+    {
+        size_t slot  = GetSlot (left[i].hash, slot_bits);
+        size_t found = 0;
+
+        for (; slots[slot] != 0; slot = (slot + 1) & slots_mask)
+        {
+            const join_entry* const candidate = right + slots[slot] - 1;
+
+            if (candidate->hash == left[i].hash &&
+                context->key_cmp (left[i].node->key, candidate->node->key) ==
+                HASH_TABLE_KEY_CMP_EQUAL)
+            {
+                found = slots[slot];
+                break;
+            }
+        }
+
+        if (found != 0)
+        {
+            matched[found - 1] = 1;
+
+            if (type != HASH_TABLE_JOIN_DIFFERENCE)
+                context->callback (left[i].node, right[found - 1].node,
+                                   thread_index, context->arg);
+        }
+
+        else if (type != HASH_TABLE_JOIN_INTERSECT)
+            context->callback (left[i].node, NULL, thread_index, context->arg);
+    }
+
+    if (type == HASH_TABLE_JOIN_UNION)
+        for (size_t i = 0; i < right_number; ++i)
+            if (!matched[i])
+                context->callback (NULL, right[i].node, thread_index,
+                                   context->arg);
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+static void
+MakePartitionOffsets (join_context* const context,
+                      const size_t side)
+{
+    assert (context);
+
+    size_t* const offsets         = context->offsets[side];
+    size_t* const partition_begin = context->partition_begin[side];
+
+    const size_t partitions_number = context->partitions_number;
+    size_t offset = 0;
+
+    // partitions are contiguous, threads write their nodes one after another
+    for (size_t partition = 0; partition < partitions_number; ++partition)
+    {
+        partition_begin[partition] = offset;
+
+        for (size_t i = 0; i < context->threads_number; ++i)
+        {
+            size_t* const counter = offsets + i * partitions_number + partition;
+            const size_t number = *counter;
+
+            *counter = offset;
+            offset  += number;
+        }
+    }
+
+    partition_begin[partitions_number] = offset;
+}
+
+
+static size_t
+GetRangeBegin (const hash_table_t* const table,
+               const size_t thread_index,
+               const size_t threads_number)
+{
+    assert (table);
+
+    const size_t remainder = table->buckets_num % threads_number;
+
+    // the first remainder ranges are one bucket longer
+    return table->buckets_num / threads_number * thread_index +
+           ((thread_index < remainder) ? thread_index : remainder);
+}
+
+
+static size_t
+GetPartition (const size_t hash,
+              const size_t radix_bits)
+{
+    if (radix_bits == 0) return 0;
+
+    return (size_t) (((uint64_t) hash * JOIN_PARTITION_MULTIPLIER) >>
+                     (64 - radix_bits));
+}
+
+
+static size_t
+GetSlot (const size_t hash,
+         const size_t slot_bits)
+{
+    if (slot_bits == 0) return 0;
+
+    const uint64_t mixed = (uint64_t) hash ^ ((uint64_t) hash >> 32);
+
+    return (size_t) ((mixed * JOIN_SLOT_MULTIPLIER) >> (64 - slot_bits));
+}
+
+
+static size_t
+GetJoinThreadsNumber (const size_t threads_number,
+                      const size_t nodes_number)
+{
+    size_t threads = threads_number;
+
+    if (threads == 0)
+    {
+        const long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0) ? (size_t) cpus : 1;
+    }
+
+    const size_t max_threads = nodes_number / JOIN_MIN_THREAD_NODES;
+    if (threads > max_threads) threads = max_threads;
+
+    return (threads == 0) ? 1 : threads;
+}
+
+
+static size_t
+GetRadixBits (const size_t right_nodes_number,
+              const size_t threads_number)
+{
+    size_t radix_bits = 0;
+
+    while (radix_bits < JOIN_MAX_RADIX_BITS &&
+           (((size_t) 1 << radix_bits) * JOIN_PARTITION_SIZE <
+            right_nodes_number ||
+            ((size_t) 1 << radix_bits) <
+            threads_number * JOIN_PARTITIONS_PER_THREAD))
+        ++radix_bits;
+
+    return radix_bits;
+}
+
+
+static void
+JoinContextDestructor (join_context* const context,
+                       join_task* const tasks)
+{
+    assert (context);
+
+    for (size_t side = 0; side < JOIN_SIDES; ++side)
+    {
+        free (context->entries[side]);
+        free (context->offsets[side]);
+        free (context->partition_begin[side]);
+    }
+
+    for (size_t i = 0; tasks != NULL && i < context->threads_number; ++i)
+    {
+        free (tasks[i].slots);
+        free (tasks[i].matched);
+    }
+
+    free (tasks);
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
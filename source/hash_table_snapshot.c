@@ -0,0 +1,666 @@
+#include "hash_table_snapshot.h"
+#include "doubly_linked_list.h"
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+
+//-----------------------------------------------------------------------------
+// Consts
+//-----------------------------------------------------------------------------
+
+/// @brief Magic bytes of the snapshot file, the last ones are the version
+static const char SNAPSHOT_MAGIC[8] = {'H', 'T', 'S', 'N', 'A', 'P', '0', '1'};
+
+
+/// @brief Written as is to check the byte order of the reader
+static const uint64_t SNAPSHOT_BYTE_ORDER = 0x0102030405060708ull;
+
+
+/// @brief Key hashed to check the hash function of the loaded snapshot
+static const char SNAPSHOT_PROBE_KEY[] = "hash table snapshot probe key";
+
+
+/// @brief Alignment of the key and value blobs
+static const uint64_t SNAPSHOT_BLOB_ALIGNMENT = 8;
+
+
+/// @brief Size of the buffer of the written file
+static const size_t SNAPSHOT_WRITE_BUFFER_SIZE = 1 << 20;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static structures
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Header of the snapshot file
+ */
+typedef
+struct snapshot_header
+{
+    char     magic[8];          ///< SNAPSHOT_MAGIC
+    uint64_t byte_order;        ///< SNAPSHOT_BYTE_ORDER
+    uint64_t buckets_num;       ///< number of buckets
+    uint64_t elem_number;       ///< number of entries
+    uint64_t mode;              ///< hash_table_mode of the saved table
+    uint64_t value_size;        ///< size of one multimap value
+    uint64_t probe_hash;        ///< whole hash of SNAPSHOT_PROBE_KEY
+    uint64_t buckets_offset;    ///< offset of the bucket indexes
+    uint64_t entries_offset;    ///< offset of the entries
+    uint64_t blobs_offset;      ///< offset of the key and value bytes
+    uint64_t file_size;         ///< size of the whole file
+}
+snapshot_header;
+
+
+/**
+ * @brief Entry of the snapshot file, one per node
+ */
+typedef
+struct snapshot_entry
+{
+    uint64_t hash;              ///< stored hash of the key
+    uint64_t key_offset;        ///< offset of the key from the blobs offset
+    uint64_t key_size;          ///< size of the key
+    uint64_t value_offset;      ///< offset of the value from the blobs offset
+    uint64_t value_size;        ///< size of the value, 0 if none
+}
+snapshot_entry;
+
+
+struct hash_table_snapshot
+{
+    const char*            data;        ///< mapped file
+    size_t                 size;        ///< size of the mapped file
+    const snapshot_header* header;      ///< header of the file
+    const uint64_t*        buckets;     ///< first entry of every bucket
+    const snapshot_entry*  entries;     ///< entries of all buckets
+    const char*            blobs;       ///< key and value bytes
+    hash_function          h_func;      ///< hash function of the table
+};
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static functions prototypes
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Writes the bucket indexes of the table
+ */
+static hash_table_error_status
+WriteBuckets (const hash_table_t* const table,
+              FILE* const file);
+
+
+/**
+ * @brief Writes the entries of the table
+ */
+static hash_table_error_status
+WriteEntries (const hash_table_t* const table,
+              FILE* const file);
+
+
+/**
+ * @brief Writes the keys and values of the table
+ */
+static hash_table_error_status
+WriteBlobs (const hash_table_t* const table,
+            FILE* const file);
+
+
+/**
+ * @brief Writes the bytes padded to SNAPSHOT_BLOB_ALIGNMENT
+ */
+static hash_table_error_status
+WriteBlob (const void* const buffer,
+           const size_t size,
+           FILE* const file);
+
+
+/**
+ * @brief Gets the saved value of the node
+ *
+ * @retval Pointer to the value
+ * @retval NULL if the node has no value
+ */
+static const hash_table_value*
+GetNodeValue (const hash_table_t* const table,
+              const hash_table_node* const node);
+
+
+/**
+ * @brief Gets the number of bytes taken by the blob
+ */
+static uint64_t
+GetAlignedSize (const uint64_t size);
+
+
+/**
+ * @brief Hashes SNAPSHOT_PROBE_KEY by the function
+ */
+static hash_table_index
+GetProbeHash (hash_function h_func);
+
+
+/**
+ * @brief Checks the sizes and the offsets of the header
+ *
+ * @retval HASH_TABLE_SUCCESS if the header describes the file of this size
+ * @retval HASH_TABLE_ERROR otherwise
+ */
+static hash_table_error_status
+CheckHeader (const snapshot_header* const header,
+             const size_t size);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Snapshot functions implementation
+//-----------------------------------------------------------------------------
+
+hash_table_error_status
+HashTableSave (const hash_table_t* const table,
+               const char* const filename)
+{
+    if (table    == NULL ||
+        filename == NULL)
+        return HASH_TABLE_ERROR;
+
+    uint64_t blobs_size = 0;
+
+    for (size_t i = 0; i < table->buckets_num; ++i)
+    {
+        const hash_table_bucket* const bucket = table->buckets[i];
+        if (bucket == NULL) continue;
+
+        const hash_table_node* node = bucket->head;
+
+        for (size_t j = 0; j < bucket->elem_number; ++j, node = node->next)
+        {
+            const hash_table_value* const value = GetNodeValue (table, node);
+
+            blobs_size += GetAlignedSize (node->key->key_size);
+            if (value != NULL)
+                blobs_size += GetAlignedSize (value->value_size);
+        }
+    }
+
+    snapshot_header header =
+    {
+        .byte_order     = SNAPSHOT_BYTE_ORDER,
+        .buckets_num    = table->buckets_num,
+        .elem_number    = table->elem_number,
+        .mode           = table->mode,
+        .value_size     = table->value_size,
+        .probe_hash     = GetProbeHash (table->h_func),
+        .buckets_offset = sizeof (snapshot_header)
+    };
+
+    memcpy (header.magic, SNAPSHOT_MAGIC, sizeof (SNAPSHOT_MAGIC));
+
+    header.entries_offset = header.buckets_offset +
+                            (header.buckets_num + 1) * sizeof (uint64_t);
+    header.blobs_offset   = header.entries_offset +
+                            header.elem_number * sizeof (snapshot_entry);
+    header.file_size      = header.blobs_offset + blobs_size;
+
+    FILE* const file = fopen (filename, "wb");
+    if (file == NULL) return HASH_TABLE_ERROR;
+
+    setvbuf (file, NULL, _IOFBF, SNAPSHOT_WRITE_BUFFER_SIZE);
+
+    hash_table_error_status status =
+        (fwrite (&header, sizeof (header), 1, file) == 1) ? HASH_TABLE_SUCCESS :
+                                                            HASH_TABLE_ERROR;
+
+    if (status == HASH_TABLE_SUCCESS) status = WriteBuckets (table, file);
+    if (status == HASH_TABLE_SUCCESS) status = WriteEntries (table, file);
+    if (status == HASH_TABLE_SUCCESS) status = WriteBlobs   (table, file);
+
+    if (fclose (file) != 0) status = HASH_TABLE_ERROR;
+
+    return status;
+}
+
+
+hash_table_snapshot*
+HashTableLoad (const char* const filename,
+               hash_function h_func)
+{
+    if (filename == NULL ||
+        h_func   == NULL)
+        return NULL;
+
+    const int fd = open (filename, O_RDONLY);
+    if (fd == -1) return NULL;
+
+    struct stat file_stat = {0};
+    if (fstat (fd, &file_stat) == -1 ||
+        (size_t) file_stat.st_size < sizeof (snapshot_header))
+    {
+        close (fd);
+        return NULL;
+    }
+
+    const size_t size = (size_t) file_stat.st_size;
+    void* const data  = mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // the mapping stays valid after the file is closed
+    close (fd);
+    if (data == MAP_FAILED) return NULL;
+
+    const snapshot_header* const header = data;
+
+    if (CheckHeader (header, size)           == HASH_TABLE_ERROR ||
+        GetProbeHash (h_func) != header->probe_hash)
+    {
+        munmap (data, size);
+        return NULL;
+    }
+
+    hash_table_snapshot* const snapshot = calloc (1, sizeof (hash_table_snapshot));
+    if (snapshot == NULL)
+    {
+        munmap (data, size);
+        return NULL;
+    }
+
+    snapshot->data    = data;
+    snapshot->size    = size;
+    snapshot->header  = header;
+    snapshot->buckets = (const uint64_t*) (snapshot->data +
+                                           header->buckets_offset);
+    snapshot->entries = (const snapshot_entry*) (snapshot->data +
+                                                 header->entries_offset);
+    snapshot->blobs   = snapshot->data + header->blobs_offset;
+    snapshot->h_func  = h_func;
+
+    return snapshot;
+}
+
+
+hash_table_snapshot*
+HashTableSnapshotDestructor (hash_table_snapshot* const snapshot)
+{
+    if (snapshot == NULL) return NULL;
+
+    munmap ((void*) snapshot->data, snapshot->size);
+    free (snapshot);
+
+    return NULL;
+}
+
+
+hash_table_error_status
+HashTableSnapshotFind (const hash_table_snapshot* const snapshot,
+                       const void* const key_buffer,
+                       const size_t key_size,
+                       hash_table_key_comparator key_cmp,
+                       hash_table_key* const found_key,
+                       hash_table_value* const found_value)
+{
+    if (snapshot   == NULL ||
+        key_buffer == NULL ||
+        key_cmp    == NULL)
+        return HASH_TABLE_ERROR;
+
+    // the keys are only read, the mapping is read-only
+    hash_table_key key = {.key = (void*) key_buffer, .key_size = key_size};
+
+    const snapshot_header* const header = snapshot->header;
+    const uint64_t hash = snapshot->h_func (&key, HASH_TABLE_FULL_RANGE);
+    const uint64_t bucket = hash % header->buckets_num;
+
+    const uint64_t begin = snapshot->buckets[bucket];
+    const uint64_t end   = snapshot->buckets[bucket + 1];
+    const uint64_t blobs_size = header->file_size - header->blobs_offset;
+
+    if (begin > end || end > header->elem_number)
+        return HASH_TABLE_ERROR;
+
+    for (uint64_t i = begin; i < end; ++i)
+    {
+        const snapshot_entry* const entry = snapshot->entries + i;
+
+        if (entry->hash != hash ||
+            entry->key_offset   > blobs_size ||
+            entry->key_size     > blobs_size - entry->key_offset ||
+            entry->value_offset > blobs_size ||
+            entry->value_size   > blobs_size - entry->value_offset)
+            continue;
+
+        hash_table_key saved_key =
+        {
+            .key      = (void*) (snapshot->blobs + entry->key_offset),
+            .key_size = entry->key_size
+        };
+
+        if (key_cmp (&saved_key, &key) != HASH_TABLE_KEY_CMP_EQUAL)
+            continue;
+
+        if (found_key != NULL)
+            *found_key = saved_key;
+
+        if (found_value != NULL)
+        {
+            found_value->value = (entry->value_size == 0) ? NULL :
+                (void*) (snapshot->blobs + entry->value_offset);
+            found_value->value_size = entry->value_size;
+        }
+
+        return HASH_TABLE_SUCCESS;
+    }
+
+    return HASH_TABLE_ERROR;
+}
+
+
+size_t
+HashTableSnapshotSize (const hash_table_snapshot* const snapshot)
+{
+    if (snapshot == NULL) return 0;
+
+    return snapshot->header->elem_number;
+}
+
+
+hash_table_t*
+HashTableSnapshotToTable (const hash_table_snapshot* const snapshot,
+                          hash_table_key_comparator key_cmp)
+{
+    if (snapshot == NULL ||
+        key_cmp  == NULL)
+        return NULL;
+
+    const snapshot_header* const header = snapshot->header;
+
+    hash_table_t* table =
+        (header->mode == HASH_TABLE_MULTIMAP) ?
+        HashTableMultimapConstructor (header->buckets_num, snapshot->h_func,
+                                      header->value_size) :
+        (header->mode == HASH_TABLE_MAP || header->mode == HASH_TABLE_SET) ?
+        HashTableConstructorWithMode (header->buckets_num, snapshot->h_func,
+                                      (hash_table_mode) header->mode) :
+        NULL;
+    if (table == NULL) return NULL;
+
+    const uint64_t blobs_size = header->file_size - header->blobs_offset;
+
+    for (uint64_t i = 0; i < header->elem_number; ++i)
+    {
+        const snapshot_entry* const entry = snapshot->entries + i;
+
+        if (entry->key_offset   > blobs_size ||
+            entry->key_size     > blobs_size - entry->key_offset ||
+            entry->value_offset > blobs_size ||
+            entry->value_size   > blobs_size - entry->value_offset)
+            return HashTableDestructor (table);
+
+        // the key and the values are copied by the insertion
+        hash_table_key key =
+        {
+            .key      = (void*) (snapshot->blobs + entry->key_offset),
+            .key_size = entry->key_size
+        };
+
+        hash_table_value value =
+        {
+            .value      = (void*) (snapshot->blobs + entry->value_offset),
+            .value_size = entry->value_size
+        };
+
+        if (header->mode != HASH_TABLE_MULTIMAP)
+        {
+            if (HashTableInsertHashed (table, &key,
+                                       (entry->value_size == 0) ? NULL : &value,
+                                       key_cmp, entry->hash) == HASH_TABLE_ERROR)
+                return HashTableDestructor (table);
+
+            continue;
+        }
+
+        if (entry->value_size % header->value_size != 0)
+            return HashTableDestructor (table);
+
+        value.value_size = header->value_size;
+
+        for (uint64_t j = 0; j < entry->value_size / header->value_size; ++j)
+        {
+            value.value = (void*) (snapshot->blobs + entry->value_offset +
+                                   j * header->value_size);
+
+            if (HashTableInsertHashed (table, &key, &value, key_cmp,
+                                       entry->hash) == HASH_TABLE_ERROR)
+                return HashTableDestructor (table);
+        }
+    }
+
+    return table;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static functions implementation
+//-----------------------------------------------------------------------------
+
+static hash_table_error_status
+WriteBuckets (const hash_table_t* const table,
+              FILE* const file)
+{
+    assert (table);
+    assert (file);
+
+    uint64_t first_entry = 0;
+
+    for (size_t i = 0; i < table->buckets_num; ++i)
+    {
+        if (fwrite (&first_entry, sizeof (first_entry), 1, file) != 1)
+            return HASH_TABLE_ERROR;
+
+        if (table->buckets[i] != NULL)
+            first_entry += table->buckets[i]->elem_number;
+    }
+
+    if (fwrite (&first_entry, sizeof (first_entry), 1, file) != 1)
+        return HASH_TABLE_ERROR;
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+static hash_table_error_status
+WriteEntries (const hash_table_t* const table,
+              FILE* const file)
+{
+    assert (table);
+    assert (file);
+
+    uint64_t blob_offset = 0;
+
+    for (size_t i = 0; i < table->buckets_num; ++i)
+    {
+        const hash_table_bucket* const bucket = table->buckets[i];
+        if (bucket == NULL) continue;
+
+        const hash_table_node* node = bucket->head;
+
+        for (size_t j = 0; j < bucket->elem_number; ++j, node = node->next)
+        {
+            const hash_table_value* const value = GetNodeValue (table, node);
+
+            snapshot_entry entry =
+            {
+                .hash       = node->hash,
+                .key_offset = blob_offset,
+                .key_size   = node->key->key_size
+            };
+
+            blob_offset += GetAlignedSize (entry.key_size);
+
+            if (value != NULL)
+            {
+                entry.value_offset = blob_offset;
+                entry.value_size   = value->value_size;
+
+                blob_offset += GetAlignedSize (entry.value_size);
+            }
+
+            if (fwrite (&entry, sizeof (entry), 1, file) != 1)
+                return HASH_TABLE_ERROR;
+        }
+    }
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+static hash_table_error_status
+WriteBlobs (const hash_table_t* const table,
+            FILE* const file)
+{
+    assert (table);
+    assert (file);
+
+    for (size_t i = 0; i < table->buckets_num; ++i)
+    {
+        const hash_table_bucket* const bucket = table->buckets[i];
+        if (bucket == NULL) continue;
+
+        const hash_table_node* node = bucket->head;
+
+        for (size_t j = 0; j < bucket->elem_number; ++j, node = node->next)
+        {
+            const hash_table_value* const value = GetNodeValue (table, node);
+
+            if (WriteBlob (node->key->key, node->key->key_size, file) ==
+                HASH_TABLE_ERROR)
+                return HASH_TABLE_ERROR;
+
+            if (value != NULL &&
+                WriteBlob (value->value, value->value_size, file) ==
+                HASH_TABLE_ERROR)
+                return HASH_TABLE_ERROR;
+        }
+    }
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+static hash_table_error_status
+WriteBlob (const void* const buffer,
+           const size_t size,
+           FILE* const file)
+{
+    assert (file);
+
+    static const char padding[8] = {0};
+
+    if (size != 0 && fwrite (buffer, 1, size, file) != size)
+        return HASH_TABLE_ERROR;
+
+    const size_t padding_size = GetAlignedSize (size) - size;
+
+    if (padding_size != 0 &&
+        fwrite (padding, 1, padding_size, file) != padding_size)
+        return HASH_TABLE_ERROR;
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+static const hash_table_value*
+GetNodeValue (const hash_table_t* const table,
+              const hash_table_node* const node)
+{
+    assert (table);
+    assert (node);
+
+    // set nodes have no value field
+    if (table->mode == HASH_TABLE_SET) return NULL;
+
+    return node->value;
+}
+
+
+static uint64_t
+GetAlignedSize (const uint64_t size)
+{
+    return (size + SNAPSHOT_BLOB_ALIGNMENT - 1) & ~(SNAPSHOT_BLOB_ALIGNMENT - 1);
+}
+
+
+static hash_table_index
+GetProbeHash (hash_function h_func)
+{
+    assert (h_func);
+
+    hash_table_key probe_key =
+    {
+        .key      = (void*) SNAPSHOT_PROBE_KEY,
+        .key_size = sizeof (SNAPSHOT_PROBE_KEY) - 1
+    };
+
+    return h_func (&probe_key, HASH_TABLE_FULL_RANGE);
+}
+
+
+static hash_table_error_status
+CheckHeader (const snapshot_header* const header,
+             const size_t size)
+{
+    assert (header);
+
+    if (memcmp (header->magic, SNAPSHOT_MAGIC, sizeof (SNAPSHOT_MAGIC)) != 0 ||
+        header->byte_order     != SNAPSHOT_BYTE_ORDER     ||
+        header->file_size      != size                    ||
+        header->buckets_num    == 0                       ||
+        header->buckets_offset != sizeof (snapshot_header))
+        return HASH_TABLE_ERROR;
+
+    // offsets are checked by division, so huge sizes do not overflow
+    const uint64_t buckets_bytes = header->entries_offset -
+                                   header->buckets_offset;
+    const uint64_t entries_bytes = header->blobs_offset -
+                                   header->entries_offset;
+
+    if (header->entries_offset <  header->buckets_offset ||
+        header->blobs_offset   <  header->entries_offset ||
+        header->blobs_offset   >  size                   ||
+        buckets_bytes / sizeof (uint64_t) != header->buckets_num + 1 ||
+        buckets_bytes % sizeof (uint64_t) != 0                       ||
+        entries_bytes / sizeof (snapshot_entry) != header->elem_number ||
+        entries_bytes % sizeof (snapshot_entry) != 0)
+        return HASH_TABLE_ERROR;
+
+    const uint64_t* const buckets =
+        (const uint64_t*) ((const char*) header + header->buckets_offset);
+
+    if (buckets[header->buckets_num] != header->elem_number)
+        return HASH_TABLE_ERROR;
+
+    return HASH_TABLE_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
@@ -0,0 +1,729 @@
+#include "hash_table_wal.h"
+#include "hash_table_snapshot.h"
+#include "hash_functions.h"
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+
+//-----------------------------------------------------------------------------
+// Consts
+//-----------------------------------------------------------------------------
+
+/// @brief Initial size of every record buffer
+static const size_t WAL_BUFFER_SIZE = 1 << 16;
+
+
+/// @brief Size of the buffer of the replayed file
+static const size_t WAL_READ_BUFFER_SIZE = 1 << 20;
+
+
+/// @brief Suffix of the snapshot file written by the compaction
+static const char WAL_TEMP_SUFFIX[] = ".tmp";
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static structures
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Change made by the record
+ */
+typedef
+enum wal_record_type
+{
+    WAL_RECORD_INSERT = 1,      ///< HashTableInsert()
+    WAL_RECORD_DELETE = 2       ///< HashTableDelete()
+}
+wal_record_type;
+
+
+/**
+ * @brief Header of the record, the key and the value bytes follow it
+ */
+typedef
+struct wal_record_header
+{
+    uint32_t checksum;          ///< crc32 of the record after this field
+    uint32_t type;              ///< wal_record_type
+    uint32_t key_size;          ///< size of the key
+    uint32_t value_size;        ///< size of the value, 0 if none
+}
+wal_record_header;
+
+
+/**
+ * @brief Bytes of the records
+ */
+typedef
+struct wal_buffer
+{
+    char*  data;                ///< records
+    size_t size;                ///< bytes taken
+    size_t capacity;            ///< bytes allocated
+}
+wal_buffer;
+
+
+struct hash_table_wal
+{
+    int                       fd;           ///< log file descriptor
+    hash_table_t*             table;        ///< logged table
+    hash_table_key_comparator key_cmp;      ///< key comparator function
+    hash_table_wal_sync       sync;         ///< when the changes are returned
+
+    pthread_mutex_t mutex;                  ///< guards the table and the log
+    pthread_cond_t  written;                ///< signaled after every group
+
+    wal_buffer filling;                     ///< records of the next group
+    wal_buffer writing;                     ///< records of the written group
+
+    uint64_t appended;                      ///< number of appended records
+    uint64_t durable;                       ///< number of written records
+    int      writing_group;                 ///< non-zero while group is written
+    int      failed;                        ///< non-zero after write error,
+                                            ///< the table must be recovered
+
+    hash_table_wal_stats stats;             ///< counters
+};
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static functions prototypes
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Appends the record to the filling buffer, the mutex must be locked
+ */
+static hash_table_error_status
+AppendRecord (hash_table_wal* const wal,
+              const wal_record_type type,
+              const hash_table_key* const key,
+              const hash_table_value* const value);
+
+
+/**
+ * @brief Removes the last appended record, the mutex must be locked
+ *
+ * @param wal Pointer to the log
+ * @param filling_size Size of the filling buffer before the record
+ */
+static void
+TakeBackRecord (hash_table_wal* const wal,
+                const size_t filling_size);
+
+
+/**
+ * @brief Waits until the first records_number records are written,
+ * writes the groups while it is the leader, the mutex must be locked
+ *
+ * @retval HASH_TABLE_SUCCESS if the records are written
+ * @retval HASH_TABLE_ERROR if the log failed
+ */
+static hash_table_error_status
+WaitRecords (hash_table_wal* const wal,
+             const uint64_t records_number);
+
+
+/**
+ * @brief Writes and syncs the filling buffer as one group,
+ * the mutex is unlocked while writing
+ */
+static void
+WriteGroup (hash_table_wal* const wal);
+
+
+/**
+ * @brief Writes all bytes to the file
+ */
+static hash_table_error_status
+WriteAll (const int fd,
+          const char* buffer,
+          size_t size);
+
+
+/**
+ * @brief Applies the record to the table
+ */
+static hash_table_error_status
+ApplyRecord (hash_table_t* const table,
+             const wal_record_header* const header,
+             hash_table_key_comparator key_cmp);
+
+
+/**
+ * @brief Computes the checksum of the record
+ */
+static uint32_t
+GetChecksum (const wal_record_header* const header);
+
+
+/**
+ * @brief Makes sure the buffer can take size more bytes
+ */
+static hash_table_error_status
+ReserveBuffer (wal_buffer* const buffer,
+               const size_t size);
+
+
+/**
+ * @brief Calls fsync() for the file
+ */
+static hash_table_error_status
+SyncFile (const char* const filename);
+
+
+/**
+ * @brief Calls fsync() for the directory of the file, so its rename is kept
+ */
+static hash_table_error_status
+SyncDirectory (const char* const filename);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Write-ahead log functions implementation
+//-----------------------------------------------------------------------------
+
+hash_table_wal*
+HashTableWalConstructor (const char* const filename,
+                         hash_table_t* const table,
+                         hash_table_key_comparator key_cmp,
+                         const hash_table_wal_sync sync)
+{
+    if (filename == NULL ||
+        table    == NULL ||
+        key_cmp  == NULL)
+        return NULL;
+
+    hash_table_wal* const wal = calloc (1, sizeof (hash_table_wal));
+    if (wal == NULL) return NULL;
+
+    wal->fd = open (filename, O_WRONLY | O_CREAT | O_APPEND, 0644);
+
+    if (wal->fd == -1 ||
+        ReserveBuffer (&wal->filling, WAL_BUFFER_SIZE) == HASH_TABLE_ERROR ||
+        ReserveBuffer (&wal->writing, WAL_BUFFER_SIZE) == HASH_TABLE_ERROR)
+    {
+        if (wal->fd != -1) close (wal->fd);
+
+        free (wal->filling.data);
+        free (wal->writing.data);
+        free (wal);
+
+        return NULL;
+    }
+
+    wal->table   = table;
+    wal->key_cmp = key_cmp;
+    wal->sync    = sync;
+
+    pthread_mutex_init (&wal->mutex,   NULL);
+    pthread_cond_init  (&wal->written, NULL);
+
+    return wal;
+}
+
+
+hash_table_wal*
+HashTableWalDestructor (hash_table_wal* const wal)
+{
+    if (wal == NULL) return NULL;
+
+    pthread_mutex_lock (&wal->mutex);
+    WaitRecords (wal, wal->appended);
+    pthread_mutex_unlock (&wal->mutex);
+
+    close (wal->fd);
+
+    pthread_mutex_destroy (&wal->mutex);
+    pthread_cond_destroy  (&wal->written);
+
+    free (wal->filling.data);
+    free (wal->writing.data);
+    free (wal);
+
+    return NULL;
+}
+
+
+hash_table_error_status
+HashTableWalInsert (hash_table_wal*   const wal,
+                    hash_table_key*   const key,
+                    hash_table_value* const value)
+{
+    if (wal == NULL ||
+        key == NULL)
+        return HASH_TABLE_ERROR;
+
+    pthread_mutex_lock (&wal->mutex);
+
+    const size_t filling_size = wal->filling.size;
+
+    // the record goes first, so the table never has a change the log lacks
+    hash_table_error_status status = wal->failed ? HASH_TABLE_ERROR :
+        AppendRecord (wal, WAL_RECORD_INSERT, key, value);
+
+    // the record is still in the filling buffer, nobody has waited for it
+    if (status == HASH_TABLE_SUCCESS &&
+        HashTableInsert (wal->table, key, value,
+                         wal->key_cmp) == HASH_TABLE_ERROR)
+    {
+        TakeBackRecord (wal, filling_size);
+        status = HASH_TABLE_ERROR;
+    }
+
+    else if (status == HASH_TABLE_SUCCESS)
+        status = WaitRecords (wal, wal->appended);
+
+    pthread_mutex_unlock (&wal->mutex);
+
+    return status;
+}
+
+
+hash_table_error_status
+HashTableWalDelete (hash_table_wal*  const wal,
+                    hash_table_key*  const key)
+{
+    if (wal == NULL ||
+        key == NULL)
+        return HASH_TABLE_ERROR;
+
+    pthread_mutex_lock (&wal->mutex);
+
+    hash_table_error_status status =
+        (wal->failed ||
+         HashTableFind (wal->table, key, wal->key_cmp) == NULL) ?
+        HASH_TABLE_ERROR : AppendRecord (wal, WAL_RECORD_DELETE, key, NULL);
+
+    if (status == HASH_TABLE_SUCCESS)
+    {
+        HashTableDelete (wal->table, key, wal->key_cmp);
+        status = WaitRecords (wal, wal->appended);
+    }
+
+    pthread_mutex_unlock (&wal->mutex);
+
+    return status;
+}
+
+
+hash_table_error_status
+HashTableWalCompact (hash_table_wal* const wal,
+                     const char* const snapshot_filename)
+{
+    if (wal               == NULL ||
+        snapshot_filename == NULL)
+        return HASH_TABLE_ERROR;
+
+    const size_t name_size = strlen (snapshot_filename) +
+                             sizeof (WAL_TEMP_SUFFIX);
+
+    char* const temp_filename = malloc (name_size);
+    if (temp_filename == NULL) return HASH_TABLE_ERROR;
+
+    snprintf (temp_filename, name_size, "%s%s",
+              snapshot_filename, WAL_TEMP_SUFFIX);
+
+    pthread_mutex_lock (&wal->mutex);
+
+    // the group being written must not reach the file after the truncation
+    while (wal->writing_group)
+        pthread_cond_wait (&wal->written, &wal->mutex);
+
+    hash_table_error_status status = wal->failed ? HASH_TABLE_ERROR :
+                                     HashTableSave (wal->table, temp_filename);
+
+    if (status == HASH_TABLE_SUCCESS)
+        status = SyncFile (temp_filename);
+
+    if (status == HASH_TABLE_SUCCESS &&
+        rename (temp_filename, snapshot_filename) == -1)
+        status = HASH_TABLE_ERROR;
+
+    if (status == HASH_TABLE_SUCCESS)
+        status = SyncDirectory (snapshot_filename);
+
+    // the buffered records are in the snapshot too
+    if (status == HASH_TABLE_SUCCESS &&
+        (ftruncate (wal->fd, 0) == -1 || fdatasync (wal->fd) == -1))
+        status = HASH_TABLE_ERROR;
+
+    if (status == HASH_TABLE_SUCCESS)
+    {
+        wal->filling.size = 0;
+        wal->durable      = wal->appended;
+
+        pthread_cond_broadcast (&wal->written);
+    }
+
+    pthread_mutex_unlock (&wal->mutex);
+
+    if (status == HASH_TABLE_ERROR) unlink (temp_filename);
+    free (temp_filename);
+
+    return status;
+}
+
+
+hash_table_error_status
+HashTableWalReplay (const char* const filename,
+                    hash_table_t* const table,
+                    hash_table_key_comparator key_cmp,
+                    size_t* const records_number)
+{
+    if (filename == NULL ||
+        table    == NULL ||
+        key_cmp  == NULL)
+        return HASH_TABLE_ERROR;
+
+    if (records_number != NULL) *records_number = 0;
+
+    const int fd = open (filename, O_RDWR);
+    if (fd == -1) return (errno == ENOENT) ? HASH_TABLE_SUCCESS :
+                                             HASH_TABLE_ERROR;
+
+    struct stat file_stat = {0};
+    FILE* const file = (fstat (fd, &file_stat) == -1) ? NULL : fdopen (fd, "r");
+    if (file == NULL)
+    {
+        close (fd);
+        return HASH_TABLE_ERROR;
+    }
+
+    setvbuf (file, NULL, _IOFBF, WAL_READ_BUFFER_SIZE);
+
+    const size_t file_size = (size_t) file_stat.st_size;
+    size_t       offset    = 0;
+
+    wal_buffer record = {0};
+    hash_table_error_status status =
+        ReserveBuffer (&record, sizeof (wal_record_header));
+
+    while (status == HASH_TABLE_SUCCESS &&
+           fread (record.data, sizeof (wal_record_header), 1, file) == 1)
+    {
+        const wal_record_header* header = (wal_record_header*) record.data;
+        const size_t data_size = (size_t) header->key_size + header->value_size;
+
+        // the sizes of the torn record may be garbage
+        if (data_size > file_size - offset - sizeof (wal_record_header))
+            break;
+
+        record.size = sizeof (wal_record_header);
+        status = ReserveBuffer (&record, data_size);
+        if (status == HASH_TABLE_ERROR) break;
+
+        header = (wal_record_header*) record.data;
+
+        if (fread (record.data + sizeof (wal_record_header), 1, data_size,
+                   file) != data_size ||
+            header->checksum != GetChecksum (header))
+            break;
+
+        status = ApplyRecord (table, header, key_cmp);
+        if (status == HASH_TABLE_ERROR) break;
+
+        offset += sizeof (wal_record_header) + data_size;
+        if (records_number != NULL) ++*records_number;
+    }
+
+    if (status == HASH_TABLE_SUCCESS && offset < file_size &&
+        ftruncate (fd, (off_t) offset) == -1)
+        status = HASH_TABLE_ERROR;
+
+    free (record.data);
+    fclose (file);
+
+    return status;
+}
+
+
+hash_table_error_status
+HashTableWalStats (hash_table_wal* const wal,
+                   hash_table_wal_stats* const stats)
+{
+    if (wal   == NULL ||
+        stats == NULL)
+        return HASH_TABLE_ERROR;
+
+    pthread_mutex_lock (&wal->mutex);
+    *stats = wal->stats;
+    pthread_mutex_unlock (&wal->mutex);
+
+    return HASH_TABLE_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static functions implementation
+//-----------------------------------------------------------------------------
+
+static hash_table_error_status
+AppendRecord (hash_table_wal* const wal,
+              const wal_record_type type,
+              const hash_table_key* const key,
+              const hash_table_value* const value)
+{
+    assert (wal);
+    assert (key);
+
+    const size_t value_size = (value != NULL) ? value->value_size : 0;
+
+    if (key->key_size > UINT32_MAX ||
+        value_size    > UINT32_MAX)
+        return HASH_TABLE_ERROR;
+
+    const size_t record_size = sizeof (wal_record_header) +
+                               key->key_size + value_size;
+
+    if (ReserveBuffer (&wal->filling, record_size) == HASH_TABLE_ERROR)
+        return HASH_TABLE_ERROR;
+
+    wal_record_header* const header =
+        (wal_record_header*) (wal->filling.data + wal->filling.size);
+    char* const key_ptr = (char*) header + sizeof (wal_record_header);
+
+    header->type       = type;
+    header->key_size   = (uint32_t) key->key_size;
+    header->value_size = (uint32_t) value_size;
+
+    if (key->key_size != 0) memcpy (key_ptr, key->key, key->key_size);
+    if (value_size    != 0) memcpy (key_ptr + key->key_size, value->value,
+                                    value_size);
+
+    header->checksum = GetChecksum (header);
+
+    wal->filling.size += record_size;
+    ++wal->appended;
+    ++wal->stats.records_number;
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+static void
+TakeBackRecord (hash_table_wal* const wal,
+                const size_t filling_size)
+{
+    assert (wal);
+    assert (filling_size < wal->filling.size);
+
+    wal->filling.size = filling_size;
+    --wal->appended;
+    --wal->stats.records_number;
+}
+
+
+
+static hash_table_error_status
+WaitRecords (hash_table_wal* const wal,
+             const uint64_t records_number)
+{
+    assert (wal);
+
+    while (wal->durable < records_number && !wal->failed)
+    {
+        if (wal->writing_group)
+            pthread_cond_wait (&wal->written, &wal->mutex);
+
+        else
+            WriteGroup (wal);
+    }
+
+    return wal->failed ? HASH_TABLE_ERROR : HASH_TABLE_SUCCESS;
+}
+
+
+static void
+WriteGroup (hash_table_wal* const wal)
+{
+    assert (wal);
+
+    const wal_buffer group = wal->filling;
+    const uint64_t   group_end = wal->appended;
+
+    wal->filling         = wal->writing;
+    wal->filling.size    = 0;
+    wal->writing         = group;
+    wal->writing_group   = 1;
+
+    // the next callers append to the other buffer meanwhile
+    pthread_mutex_unlock (&wal->mutex);
+
+    hash_table_error_status status = WriteAll (wal->fd, group.data, group.size);
+
+    if (status == HASH_TABLE_SUCCESS &&
+        wal->sync == HASH_TABLE_WAL_SYNC &&
+        fdatasync (wal->fd) == -1)
+        status = HASH_TABLE_ERROR;
+
+    pthread_mutex_lock (&wal->mutex);
+
+    ++wal->stats.groups_number;
+    wal->stats.bytes_number += group.size;
+    if (wal->sync == HASH_TABLE_WAL_SYNC) ++wal->stats.syncs_number;
+
+    // a part of the group may be in the file, so the changes of the group
+    // and of the next ones are neither durable nor undone
+    if (status == HASH_TABLE_SUCCESS)
+        wal->durable = group_end;
+    else
+        wal->failed  = 1;
+
+    wal->writing_group = 0;
+    pthread_cond_broadcast (&wal->written);
+}
+
+
+static hash_table_error_status
+WriteAll (const int fd,
+          const char* buffer,
+          size_t size)
+{
+    assert (buffer);
+
+    while (size != 0)
+    {
+        const ssize_t written = write (fd, buffer, size);
+
+        if (written == -1 && errno == EINTR) continue;
+        if (written <= 0) return HASH_TABLE_ERROR;
+
+        buffer += written;
+        size   -= (size_t) written;
+    }
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+static hash_table_error_status
+ApplyRecord (hash_table_t* const table,
+             const wal_record_header* const header,
+             hash_table_key_comparator key_cmp)
+{
+    assert (table);
+    assert (header);
+
+    char* const key_ptr = (char*) header + sizeof (wal_record_header);
+
+    hash_table_key   key   = {.key = key_ptr, .key_size = header->key_size};
+    hash_table_value value = {.value      = key_ptr + header->key_size,
+                              .value_size = header->value_size};
+
+    switch (header->type)
+    {
+        case WAL_RECORD_INSERT:
+            return HashTableInsert (table, &key,
+                                    (header->value_size == 0) ? NULL : &value,
+                                    key_cmp);
+
+        case WAL_RECORD_DELETE:
+            // the key may be deleted already if the snapshot is newer
+            HashTableDelete (table, &key, key_cmp);
+            return HASH_TABLE_SUCCESS;
+
+        default:
+            return HASH_TABLE_ERROR;
+    }
+}
+
+
+static uint32_t
+GetChecksum (const wal_record_header* const header)
+{
+    assert (header);
+
+    hash_table_key record =
+    {
+        .key      = (char*) header + sizeof (header->checksum),
+        .key_size = sizeof (wal_record_header) - sizeof (header->checksum) +
+                    header->key_size + header->value_size
+    };
+
+    return (uint32_t) HashFunctionCrc32 (&record, HASH_TABLE_FULL_RANGE);
+}
+
+
+static hash_table_error_status
+ReserveBuffer (wal_buffer* const buffer,
+               const size_t size)
+{
+    assert (buffer);
+
+    if (buffer->size + size <= buffer->capacity)
+        return HASH_TABLE_SUCCESS;
+
+    size_t new_capacity = (buffer->capacity == 0) ? WAL_BUFFER_SIZE :
+                                                    buffer->capacity;
+    while (new_capacity < buffer->size + size) new_capacity *= 2;
+
+    char* const new_data = realloc (buffer->data, new_capacity);
+    if (new_data == NULL) return HASH_TABLE_ERROR;
+
+    buffer->data     = new_data;
+    buffer->capacity = new_capacity;
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+static hash_table_error_status
+SyncFile (const char* const filename)
+{
+    assert (filename);
+
+    const int fd = open (filename, O_RDONLY);
+    if (fd == -1) return HASH_TABLE_ERROR;
+
+    const int result = fsync (fd);
+    close (fd);
+
+    return (result == 0) ? HASH_TABLE_SUCCESS : HASH_TABLE_ERROR;
+}
+
+
+static hash_table_error_status
+SyncDirectory (const char* const filename)
+{
+    assert (filename);
+
+    const char* const last_slash = strrchr (filename, '/');
+    if (last_slash == NULL) return SyncFile (".");
+
+    const size_t name_size = (last_slash == filename) ?
+                             1 : (size_t) (last_slash - filename);
+
+    char* const directory = strndup (filename, name_size);
+    if (directory == NULL) return HASH_TABLE_ERROR;
+
+    const hash_table_error_status status = SyncFile (directory);
+    free (directory);
+
+    return status;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
@@ -0,0 +1,232 @@
+"""
+Compares benchmark runs with a stored baseline.
+
+Every file is the JSON array printed by bench_hash_table or bench_compare,
+one file per repeat. The runs of the same configuration are matched by
+their identity fields, and every metric is compared by its mean over the
+repeats. A metric regresses when it gets worse by more than its threshold
+and by more than SIGMA standard errors of the difference, so the noise
+of the repeats is not taken for a regression.
+
+Exit code is 0 if nothing regressed, 1 on a regression, 2 on bad input.
+
+python3 test/compare_bench.py --baseline output/baseline/*.json \
+                              --current  output/current/*.json
+"""
+
+import argparse
+import json
+import math
+import statistics
+import sys
+
+
+SCHEMA_VERSION = 1
+
+# Fields of a run object that tell its configuration
+IDENTITY_FIELDS = ["benchmark", "implementation", "elements", "buckets",
+                   "load_factor", "operations", "mix", "hit_percent",
+                   "key_size", "distribution", "zipf_theta", "hash_function",
+                   "sample_period", "seed", "text"]
+
+# Operations with the latency percentiles
+LATENCY_OPERATIONS = ["insert", "find", "delete"]
+
+# Default thresholds in percents
+THROUGHPUT_THRESHOLD = 5.0
+LATENCY_THRESHOLD    = 10.0
+MEMORY_THRESHOLD     = 1.0
+
+# Standard errors of the difference the change must exceed
+SIGMA = 3.0
+
+EXIT_SUCCESS    = 0
+EXIT_REGRESSION = 1
+EXIT_BAD_INPUT  = 2
+
+
+class BadInput(Exception):
+    pass
+
+
+def run_identity(run):
+    """Returns the key matching the run to the runs of the same configuration."""
+    return json.dumps({field: run.get(field) for field in IDENTITY_FIELDS},
+                      sort_keys=True)
+
+
+def run_name(run):
+    """Returns a short name of the run for the report."""
+    name = run.get("benchmark", "")
+    if run.get("implementation") not in (None, name):
+        name += "/" + run["implementation"]
+
+    name += " " + str(run.get("elements", run.get("text", "")))
+
+    if run.get("distribution") not in (None, "uniform"):
+        name += " " + run["distribution"]
+
+    return name
+
+
+def run_metrics(run):
+    """Returns {metric: (value, higher_is_better, threshold kind)} of the run."""
+    metrics = {}
+
+    if run.get("ops_per_sec") is not None:
+        metrics["ops_per_sec"] = (run["ops_per_sec"], True, "throughput")
+
+    latencies = run.get("latency_ns") or {}
+    for operation in LATENCY_OPERATIONS:
+        p99 = (latencies.get(operation) or {}).get("p99")
+        if p99 is not None:
+            metrics[operation + "_p99_ns"] = (p99, False, "latency")
+
+    bytes_per_element = (run.get("memory") or {}).get("bytes_per_element")
+    if bytes_per_element is not None:
+        metrics["bytes_per_element"] = (bytes_per_element, False, "memory")
+
+    return metrics
+
+
+def load_runs(file_names):
+    """Returns {identity: {"name", "metrics": {metric: [values]}, ...}}."""
+    runs = {}
+
+    for file_name in file_names:
+        try:
+            with open(file_name) as file:
+                document = json.load(file)
+        except (OSError, ValueError) as error:
+            raise BadInput(f"{file_name}: {error}")
+
+        if not isinstance(document, list):
+            raise BadInput(f"{file_name}: expected an array of runs")
+
+        for run in document:
+            version = run.get("schema_version")
+            if version != SCHEMA_VERSION:
+                raise BadInput(f"{file_name}: schema_version {version}, "
+                               f"expected {SCHEMA_VERSION}")
+
+            entry = runs.setdefault(run_identity(run),
+                                    {"name": run_name(run), "metrics": {},
+                                     "kinds": {}})
+
+            for metric, (value, higher_better, kind) in run_metrics(run).items():
+                entry["metrics"].setdefault(metric, []).append(value)
+                entry["kinds"][metric] = (higher_better, kind)
+
+    return runs
+
+
+def mean_and_error(values):
+    """Returns the mean and its squared standard error."""
+    mean = statistics.fmean(values)
+    if len(values) < 2:
+        return mean, 0.0
+
+    return mean, statistics.variance(values) / len(values)
+
+
+def compare(baseline, current, thresholds, sigma):
+    """Prints the comparison table, returns the number of regressions."""
+    regressions = 0
+    lines = []
+
+    for identity, current_entry in current.items():
+        baseline_entry = baseline.get(identity)
+        if baseline_entry is None:
+            lines.append((current_entry["name"], "-", "-", "-", "-", "new run"))
+            continue
+
+        for metric, values in current_entry["metrics"].items():
+            baseline_values = baseline_entry["metrics"].get(metric)
+            if not baseline_values:
+                continue
+
+            higher_better, kind = current_entry["kinds"][metric]
+
+            baseline_mean, baseline_error = mean_and_error(baseline_values)
+            current_mean,  current_error  = mean_and_error(values)
+
+            if baseline_mean == 0:
+                continue
+
+            change = (current_mean - baseline_mean) / baseline_mean * 100
+            worse  = -change if higher_better else change
+            noise  = sigma * math.sqrt(baseline_error + current_error)
+
+            significant = (abs(current_mean - baseline_mean) > noise and
+                           abs(change) > thresholds[kind])
+
+            if significant and worse > 0:
+                verdict = "REGRESSION"
+                regressions += 1
+            elif significant:
+                verdict = "improvement"
+            else:
+                verdict = "ok"
+
+            lines.append((current_entry["name"], metric,
+                          f"{baseline_mean:.2f}", f"{current_mean:.2f}",
+                          f"{change:+.1f}%", verdict))
+
+    for identity, baseline_entry in baseline.items():
+        if identity not in current:
+            lines.append((baseline_entry["name"], "-", "-", "-", "-", "missing"))
+
+    header = ("run", "metric", "baseline", "current", "change", "verdict")
+    widths = [max(len(line[i]) for line in lines + [header])
+              for i in range(len(header))]
+
+    for line in [header] + lines:
+        print("  ".join(cell.ljust(width) for cell, width in zip(line, widths)))
+
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Compares benchmark runs with a stored baseline")
+    parser.add_argument("--baseline", nargs="+", required=True,
+                        help="JSON files of the baseline repeats")
+    parser.add_argument("--current", nargs="+", required=True,
+                        help="JSON files of the current repeats")
+    parser.add_argument("--throughput", type=float, default=THROUGHPUT_THRESHOLD,
+                        help="ops/s drop in percents to report")
+    parser.add_argument("--latency", type=float, default=LATENCY_THRESHOLD,
+                        help="p99 latency growth in percents to report")
+    parser.add_argument("--memory", type=float, default=MEMORY_THRESHOLD,
+                        help="bytes per element growth in percents to report")
+    parser.add_argument("--sigma", type=float, default=SIGMA,
+                        help="standard errors of the difference to exceed")
+    arguments = parser.parse_args()
+
+    try:
+        baseline = load_runs(arguments.baseline)
+        current  = load_runs(arguments.current)
+    except BadInput as error:
+        print(error, file=sys.stderr)
+        return EXIT_BAD_INPUT
+
+    if not baseline or not current:
+        print("no runs to compare", file=sys.stderr)
+        return EXIT_BAD_INPUT
+
+    if len(arguments.baseline) < 2 or len(arguments.current) < 2:
+        print("one repeat has no noise estimate, only the thresholds "
+              "are applied", file=sys.stderr)
+
+    thresholds = {"throughput": arguments.throughput,
+                  "latency":    arguments.latency,
+                  "memory":     arguments.memory}
+
+    regressions = compare(baseline, current, thresholds, arguments.sigma)
+
+    print(f"\n{regressions} regressions", file=sys.stderr)
+    return EXIT_REGRESSION if regressions else EXIT_SUCCESS
+
+
+if __name__ == "__main__":
+    sys.exit(main())
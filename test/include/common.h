@@ -1,6 +1,77 @@
 #include "hash_functions.h"
 #include "separation_lib.h"
 #include <ctype.h>
+#include <stdint.h>
+
+
+
+//-----------------------------------------------------------------------------
+// Common test consts
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Version of the JSON run objects the benchmarks print, it changes
+ * when a field is renamed, removed or changes its meaning,
+ * see test/compare_bench.py
+ */
+#define BENCH_SCHEMA_VERSION 1
+
+
+/// @brief Maximal number of table sizes in one benchmark run
+#define BENCH_MAX_SIZES 16
+
+
+/// @brief Nanoseconds in one second
+static const double NSEC_PER_SEC = 1e9;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Common test structures
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Table sizes of the benchmark, one run each
+ */
+typedef
+struct bench_sizes
+{
+    size_t elements[BENCH_MAX_SIZES];   ///< table sizes
+    size_t sizes_number;                ///< number of table sizes
+}
+bench_sizes;
+
+
+/**
+ * @brief Parses the value of the name=value argument
+ *
+ * @param value Text after the '='
+ * @param target Pointer to save the parsed value
+ *
+ * @retval 1 if the value is set
+ * @retval 0 if the value is bad
+ */
+typedef int (*bench_argument_parser) (const char* const value,
+                                      void* const target);
+
+
+/**
+ * @brief name=value argument of the benchmark
+ */
+typedef
+struct bench_argument
+{
+    const char*           name;     ///< name before the '='
+    bench_argument_parser parse;    ///< parser of the value
+    void*                 target;   ///< where the parser saves the value
+}
+bench_argument;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
 
 
 
@@ -17,8 +88,12 @@
  *
  * @retval Pointer to hash table
  *
+ * @details The file is read by chunks, every word is inserted as soon as
+ * the tokenizer finds it, so the whole text and its words array are never
+ * in memory at once
+ *
  * @note Function falls with assert() if filename or hash function NULL,
- * file not found or empty or allocation error occurred
+ * file not found or allocation error occurred
  */
 hash_table_t*
 FillHashTable (const char* const filename,
@@ -61,5 +136,102 @@ Separator (const char* const symbol);
 hash_function
 GetHashFunctionPointer (const size_t hash_function_index);
 
+
+/**
+ * @brief Gets name of the hash function, the same as its output file name
+ *
+ * @param hash_function_index Index of the hash function,
+ * see GetHashFunctionPointer()
+ *
+ * @retval Name of the hash function
+ * @retval NULL if index out of range
+ */
+const char*
+GetHashFunctionName (const size_t hash_function_index);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Benchmark functions prototypes
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Parses name=value arguments of the benchmark
+ *
+ * @param argc Number of the command line arguments
+ * @param argv Command line arguments, the first one is skipped
+ * @param arguments Known arguments
+ * @param arguments_number Number of the known arguments
+ *
+ * @retval 1 if every argument is set
+ * @retval 0 if an argument is unknown or its value is bad,
+ * the known names are printed to stderr
+ */
+int
+BenchParseArguments (const int argc,
+                     const char** const argv,
+                     const bench_argument* const arguments,
+                     const size_t arguments_number);
+
+
+/**
+ * @brief Parses decimal size_t, see bench_argument_parser
+ */
+int
+BenchParseSize (const char* const value,
+                void* const size);
+
+
+/**
+ * @brief Parses decimal uint64_t, see bench_argument_parser
+ */
+int
+BenchParseUint64 (const char* const value,
+                  void* const number);
+
+
+/**
+ * @brief Parses double, see bench_argument_parser
+ */
+int
+BenchParseDouble (const char* const value,
+                  void* const number);
+
+
+/**
+ * @brief Saves the value itself to const char*, see bench_argument_parser
+ */
+int
+BenchParseString (const char* const value,
+                  void* const string);
+
+
+/**
+ * @brief Parses comma separated table sizes to bench_sizes,
+ * "0" sets no sizes, see bench_argument_parser
+ */
+int
+BenchParseSizes (const char* const value,
+                 void* const sizes);
+
+
+/**
+ * @brief Returns the next pseudo-random number of xorshift64
+ *
+ * @param state Nonzero state of the generator
+ */
+uint64_t
+NextRandom (uint64_t* const state);
+
+
+/**
+ * @brief Returns monotonic time in seconds
+ */
+double
+GetTime (void);
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
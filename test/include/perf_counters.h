@@ -0,0 +1,152 @@
+/**
+ * @file perf_counters.h
+ * @author SeveraTheDuck
+ * @brief Hardware performance counters of the benchmark phases
+ *
+ * @details
+ * The counters are opened with perf_event_open() for the calling thread,
+ * user space only, so a perf_event_paranoid of 2 is enough. The counters are
+ * one group led by the cycles: the kernel puts them on the PMU together, so
+ * the ratios of the events are taken over the same time. The ones the CPU,
+ * the kernel or the container do not give are marked unavailable and the
+ * others are still counted, alone if the cycles are not given. When the
+ * kernel multiplexes the group, the values are scaled by the time it counted.
+ * @code
+ * perf_counters* counters = PerfCountersConstructor ();
+ * perf_counters_values values = {0};
+ *
+ * PerfCountersStart (counters);
+ * Phase ();
+ * PerfCountersStop  (counters, &values);
+ * @endcode
+ */
+
+
+
+#pragma once
+
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+
+//-----------------------------------------------------------------------------
+// Performance counters structures
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Counted hardware events
+ */
+typedef
+enum perf_counter
+{
+    PERF_COUNTER_CYCLES        = 0, ///< CPU cycles
+    PERF_COUNTER_INSTRUCTIONS  = 1, ///< retired instructions
+    PERF_COUNTER_L1D_MISSES    = 2, ///< L1 data cache read misses
+    PERF_COUNTER_LLC_MISSES    = 3, ///< last level cache misses
+    PERF_COUNTER_DTLB_MISSES   = 4, ///< data TLB read misses
+    PERF_COUNTER_BRANCH_MISSES = 5  ///< mispredicted branches
+}
+perf_counter;
+
+
+/**
+ * @brief Number of the counted events
+ */
+#define PERF_COUNTERS_NUMBER 6
+
+
+/**
+ * @brief Opened counters of one thread
+ */
+typedef struct perf_counters perf_counters;
+
+
+/**
+ * @brief Counted values of one phase
+ */
+typedef
+struct perf_counters_values
+{
+    uint64_t values   [PERF_COUNTERS_NUMBER];   ///< scaled event counts
+    int      available[PERF_COUNTERS_NUMBER];   ///< 0 if the event is not counted
+}
+perf_counters_values;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Performance counters interface
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Opens the counters of the calling thread
+ *
+ * @retval Pointer to the counters, some or all of them may be unavailable
+ * @retval NULL if allocation error occurred
+ */
+perf_counters*
+PerfCountersConstructor (void);
+
+
+/**
+ * @brief Closes the counters
+ *
+ * @param counters Pointer to the counters, may be NULL
+ *
+ * @retval NULL
+ */
+perf_counters*
+PerfCountersDestructor (perf_counters* const counters);
+
+
+/**
+ * @brief Resets and starts the available counters
+ *
+ * @param counters Pointer to the counters, may be NULL
+ */
+void
+PerfCountersStart (perf_counters* const counters);
+
+
+/**
+ * @brief Stops the counters and reads the values counted since the start
+ *
+ * @param counters Pointer to the counters, may be NULL
+ * @param values Pointer to save the values, every event is unavailable
+ * if counters is NULL
+ */
+void
+PerfCountersStop (perf_counters* const counters,
+                  perf_counters_values* const values);
+
+
+/**
+ * @brief Gets the name of the event
+ *
+ * @param counter The event
+ *
+ * @retval Name of the event
+ * @retval NULL if counter is out of range
+ */
+const char*
+PerfCounterName (const perf_counter counter);
+
+
+/**
+ * @brief Gets the number of the available counters
+ *
+ * @param counters Pointer to the counters, may be NULL
+ *
+ * @retval Number of the events that are counted
+ */
+size_t
+PerfCountersAvailable (const perf_counters* const counters);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
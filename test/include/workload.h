@@ -0,0 +1,264 @@
+/**
+ * @file workload.h
+ * @author SeveraTheDuck
+ * @brief Seeded synthetic key streams for the benchmarks
+ *
+ * @details
+ * A workload is a key space of keys_number keys and a stream of key indexes
+ * drawn from it. A key is made from its index only, so the keys are never
+ * stored: its first 8 bytes are the index, so the keys are unique, and the
+ * rest are letters up to a length from key_min to key_max. With key_min and
+ * key_max equal to 8 the keys are the 64-bit integers themselves.
+ *
+ * The indexes follow one of the distributions:
+ * - uniform: every key equally often
+ * - zipf: key of rank r with probability proportional to 1 / r^theta,
+ *   the ranks are scrambled over the key space, so the hot keys are not
+ *   neighbours
+ * - sequential: 0, 1, 2, ... wrapping at keys_number
+ * - colliding: uniform, but the key space is made of the keys the table hash
+ *   function sends to one bucket, found by trying the candidate keys,
+ *   so only this distribution stores the indexes of its keys
+ *
+ * The same seed gives the same stream. The timed loops take the keys of a
+ * bounded chunk of indexes made by WorkloadKeysMake() before the chunk,
+ * so a stream of any length takes the memory of one chunk.
+ * @code
+ * workload_config config = {.distribution = WORKLOAD_ZIPF, .keys_number = 1000000,
+ *                           .key_min = 8, .key_max = 32, .zipf_theta = 0.99,
+ *                           .seed = 1};
+ * workload* load = WorkloadConstructor (&config);
+ * char buffer[32] = "";
+ * hash_table_key key = {0};
+ *
+ * for (size_t i = 0; i < operations; ++i)
+ * {
+ *     WorkloadNext (load, buffer, &key);
+ *     HashTableFind (table, &key, KeyCmpFunction);
+ * }
+ * @endcode
+ */
+
+
+
+#pragma once
+
+
+
+#include "hash_table.h"
+#include "doubly_linked_list.h"
+#include <stdint.h>
+
+
+
+//-----------------------------------------------------------------------------
+// Workload structures
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Distributions of the key indexes
+ */
+typedef
+enum workload_distribution
+{
+    WORKLOAD_UNIFORM    = 0,    ///< every key equally often
+    WORKLOAD_ZIPF       = 1,    ///< few hot keys, scrambled zipfian
+    WORKLOAD_SEQUENTIAL = 2,    ///< keys in index order
+    WORKLOAD_COLLIDING  = 3     ///< keys of one bucket of the table
+}
+workload_distribution;
+
+
+/**
+ * @brief Parameters of the workload
+ */
+typedef
+struct workload_config
+{
+    workload_distribution distribution; ///< distribution of the indexes
+    size_t        keys_number;          ///< number of keys in the key space
+    size_t        key_min;              ///< minimal key size, at least 8
+    size_t        key_max;              ///< maximal key size
+    double        zipf_theta;           ///< zipf skew, from 0 to 1 exclusive
+    uint64_t      seed;                 ///< seed of the stream and the keys
+    hash_function h_func;               ///< table hash function for colliding
+    size_t        buckets_number;       ///< table buckets number for colliding
+}
+workload_config;
+
+
+/**
+ * @brief Workload stream
+ */
+typedef struct workload workload;
+
+
+/**
+ * @brief Keys of a chunk of indexes stored one after another
+ */
+typedef
+struct workload_keys
+{
+    char*   buffer;         ///< keys bytes
+    size_t* offsets;        ///< key i is buffer[offsets[i], offsets[i + 1])
+    size_t  keys_number;    ///< number of made keys
+    size_t  capacity;       ///< maximal number of keys
+}
+workload_keys;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Workload interface
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Makes the workload stream
+ *
+ * @param config Parameters of the workload
+ *
+ * @retval Pointer to the workload
+ * @retval NULL if the parameters are bad
+ * @retval NULL if allocation error occurred
+ *
+ * @details The zipf constants are computed in O(min(keys_number, 2^20))
+ */
+workload*
+WorkloadConstructor (const workload_config* const config);
+
+
+/**
+ * @brief Destroys the workload
+ *
+ * @param load Pointer to the workload, may be NULL
+ *
+ * @retval NULL
+ */
+workload*
+WorkloadDestructor (workload* const load);
+
+
+/**
+ * @brief Gets the next key index of the stream
+ *
+ * @param load Pointer to the workload
+ *
+ * @retval Index from 0 to keys_number - 1
+ */
+size_t
+WorkloadNextIndex (workload* const load);
+
+
+/**
+ * @brief Makes the key of the index
+ *
+ * @param load Pointer to the workload
+ * @param index Index of the key, taken modulo keys_number
+ * @param buffer Buffer of at least key_max bytes for the key
+ * @param key Pointer to save the key, it points to the buffer
+ *
+ * @details The colliding keys are searched for the first time they are
+ * asked, about buckets_number candidates for every key. The keys of the
+ * other distributions are made from the index only, so several threads
+ * may make them at once.
+ */
+void
+WorkloadKey (workload* const load,
+             const size_t index,
+             char* const buffer,
+             hash_table_key* const key);
+
+
+/**
+ * @brief Allocates the keys of a chunk, so the benchmarks do not make
+ * them in the timed loops
+ *
+ * @param load Pointer to the workload
+ * @param capacity Maximal number of keys of one chunk
+ *
+ * @retval Pointer to the keys
+ * @retval NULL if allocation error occurred
+ */
+workload_keys*
+WorkloadKeysConstructor (const workload* const load,
+                         const size_t capacity);
+
+
+/**
+ * @brief Makes the keys of the indexes, they replace the previous ones
+ *
+ * @param load Pointer to the workload
+ * @param keys Pointer to the keys
+ * @param indexes Indexes of the keys, see WorkloadKey()
+ * @param keys_number Number of the indexes, at most the capacity
+ */
+void
+WorkloadKeysMake (workload* const load,
+                  workload_keys* const keys,
+                  const size_t* const indexes,
+                  const size_t keys_number);
+
+
+/**
+ * @brief Frees the stored keys
+ *
+ * @param keys Pointer to the keys, may be NULL
+ *
+ * @retval NULL
+ */
+workload_keys*
+WorkloadKeysDestructor (workload_keys* const keys);
+
+
+/**
+ * @brief Makes the next key of the stream
+ *
+ * @param load Pointer to the workload
+ * @param buffer Buffer of at least key_max bytes for the key
+ * @param key Pointer to save the key, it points to the buffer
+ *
+ * @retval Index of the key
+ */
+size_t
+WorkloadNext (workload* const load,
+              char* const buffer,
+              hash_table_key* const key);
+
+
+/**
+ * @brief Gets the distribution by its name
+ *
+ * @param name uniform, zipf, sequential or colliding
+ * @param distribution Pointer to save the distribution
+ *
+ * @retval 1 if the name is known
+ * @retval 0 otherwise
+ */
+int
+WorkloadParseDistribution (const char* const name,
+                           workload_distribution* const distribution);
+
+
+/**
+ * @brief WorkloadParseDistribution() as the parser of the benchmark
+ * arguments, see bench_argument_parser
+ */
+int
+WorkloadDistributionArgument (const char* const value,
+                              void* const distribution);
+
+
+/**
+ * @brief Gets the name of the distribution
+ *
+ * @retval Name of the distribution
+ * @retval NULL if distribution is out of range
+ */
+const char*
+WorkloadDistributionName (const workload_distribution distribution);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
@@ -0,0 +1,1027 @@
+extern "C"
+{
+#include "common.h"
+#include "workload.h"
+}
+
+#include <malloc.h>
+#include <new>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+
+
+//-----------------------------------------------------------------------------
+// Consts
+//-----------------------------------------------------------------------------
+
+/// @brief Table sizes of the default run, from L1-resident to many times LLC
+static const size_t BENCH_COMPARE_DEFAULT_ELEMENTS[] =
+    {1 << 10, 1 << 14, 1 << 18, 1 << 22};
+
+
+/// @brief Key pool is this many times larger than the table,
+/// the keys out of the table are the misses
+static const size_t BENCH_COMPARE_POOL_FACTOR = 2;
+
+
+/// @brief Keys start with their 8-byte number, so they are unique
+static const size_t BENCH_COMPARE_MIN_KEY_SIZE = sizeof (uint64_t);
+
+
+/// @brief The flat table grows when it is more than half full,
+/// so the probe sequences stay short
+static const size_t FLAT_TABLE_MAX_LOAD_PERCENT = 50;
+
+
+/// @brief Minimal capacity of the flat table
+static const size_t FLAT_TABLE_MIN_CAPACITY = 16;
+
+
+/// @brief Keys of one chunk, they are made before the chunk is timed,
+/// so the keys of a run take the memory of one chunk
+static const size_t BENCH_COMPARE_CHUNK = 1 << 16;
+
+
+/// @brief Names of the implementations in the report
+static const char* const BENCH_COMPARE_NAMES[] =
+    {"hash_table", "unordered_map", "linear_probing"};
+
+
+/// @brief Names of the timed phases in the report
+static const char* const BENCH_COMPARE_PHASE_NAMES[] =
+    {"build", "find", "delete"};
+
+
+/// @brief Number of the timed phases
+#define BENCH_COMPARE_PHASES_NUMBER 3
+
+
+/// @brief Percents in the whole
+static const size_t PERCENTS = 100;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static structures
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Compared implementations
+ */
+enum bench_compare_implementation
+{
+    BENCH_COMPARE_HASH_TABLE     = 0,   ///< hash_table_t of this repository
+    BENCH_COMPARE_UNORDERED_MAP  = 1,   ///< std::unordered_map<std::string>
+    BENCH_COMPARE_LINEAR_PROBING = 2    ///< flat_table of this file
+};
+
+
+/**
+ * @brief Parameters of the benchmark, set by name=value arguments
+ */
+struct bench_compare_config
+{
+    bench_sizes sizes;                          ///< table sizes, one run each
+    size_t operations;                          ///< finds of one run
+    size_t hit_percent;                         ///< finds of the keys in the table
+    size_t key_min;                             ///< minimal key size
+    size_t key_max;                             ///< maximal key size
+    double load_factor;                         ///< elements per bucket
+    size_t hash_index;                          ///< see GetHashFunctionPointer()
+    uint64_t seed;                              ///< seed of keys and finds
+    workload_distribution distribution;         ///< distribution of the finds
+    double zipf_theta;                          ///< skew of the zipf distribution
+};
+
+
+/**
+ * @brief Results of one implementation on one table size
+ */
+struct bench_compare_result
+{
+    double seconds[BENCH_COMPARE_PHASES_NUMBER];    ///< time of every phase
+    size_t operations[BENCH_COMPARE_PHASES_NUMBER]; ///< operations of every phase
+    size_t found;                                   ///< successful finds
+    size_t memory_bytes;                            ///< live bytes after build
+};
+
+
+/**
+ * @brief Key indexes of one chunk and their keys
+ */
+struct bench_compare_chunk
+{
+    size_t*        indexes;         ///< key indexes
+    workload_keys* keys;            ///< keys of the indexes
+};
+
+
+/**
+ * @brief Slot of the flat table, empty if the key is NULL
+ */
+struct flat_slot
+{
+    uint64_t hash;          ///< full hash of the key
+    char*    key;           ///< copy of the key
+    size_t   key_size;      ///< size of the key in bytes
+    uint64_t value;         ///< value of the key
+};
+
+
+/**
+ * @brief Open addressing table with linear probing, the baseline
+ *
+ * @details The capacity is a power of two, deletion shifts the following
+ * slots of the probe sequence back instead of leaving tombstones
+ */
+struct flat_table
+{
+    flat_slot*    slots;        ///< array of capacity slots
+    size_t        capacity;     ///< number of slots
+    size_t        elements;     ///< number of used slots
+    hash_function h_func;       ///< hash function
+};
+
+
+/**
+ * @brief Hash of std::unordered_map by the hash function of the run,
+ * transparent to find by std::string_view without a copy
+ */
+struct bench_compare_hasher
+{
+    using is_transparent = void;
+
+    hash_function h_func;
+
+    size_t
+    operator() (const std::string_view key) const
+    {
+        hash_table_key table_key = {const_cast<char*> (key.data ()), key.size ()};
+
+        return h_func (&table_key, HASH_TABLE_FULL_RANGE);
+    }
+};
+
+
+/**
+ * @brief std::unordered_map of the benchmark
+ */
+using bench_compare_map =
+    std::unordered_map<std::string, uint64_t, bench_compare_hasher, std::equal_to<>>;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static variables
+//-----------------------------------------------------------------------------
+
+/// @brief Usable bytes of the operator new and the flat table not freed yet
+static size_t counted_live_bytes = 0;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Benchmark static functions prototypes
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Makes the workload of the run, the same for every implementation
+ */
+static workload*
+MakeWorkload (const bench_compare_config* const config,
+              const size_t elements);
+
+
+/**
+ * @brief Makes the keys of the chunk of indexes from first on
+ *
+ * @retval Number of the keys, at most BENCH_COMPARE_CHUNK
+ */
+static size_t
+MakeKeys (workload* const load,
+          bench_compare_chunk* const chunk,
+          const size_t first,
+          const size_t keys_number);
+
+
+/**
+ * @brief Generates the next finds and makes their keys, a hit takes a key
+ * of the table, a miss takes a key out of it
+ *
+ * @retval Number of the finds, at most BENCH_COMPARE_CHUNK
+ */
+static size_t
+MakeFinds (const bench_compare_config* const config,
+           const size_t elements,
+           workload* const load,
+           uint64_t* const state,
+           bench_compare_chunk* const chunk,
+           const size_t finds_number);
+
+
+/**
+ * @brief Number of buckets of the hash table and std::unordered_map
+ * for the load factor
+ */
+static size_t
+GetBucketsNumber (const bench_compare_config* const config,
+                  const size_t elements);
+
+
+/**
+ * @brief Builds the table of the elements first keys, does the finds
+ * and deletes every key
+ */
+static void
+BenchImplementation (const bench_compare_config* const config,
+                     const bench_compare_implementation implementation,
+                     const size_t elements,
+                     bench_compare_result* const result);
+
+
+/**
+ * @brief Runs every implementation on the table size and prints
+ * their JSON objects
+ */
+static void
+BenchRun (const bench_compare_config* const config,
+          const size_t elements,
+          const int first);
+
+
+/**
+ * @brief Prints the JSON object of the implementation
+ */
+static void
+PrintResult (const bench_compare_config* const config,
+             const bench_compare_implementation implementation,
+             const size_t elements,
+             const bench_compare_result* const result,
+             const int first);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Flat table static functions prototypes
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Makes the flat table for the number of elements without growing
+ *
+ * @retval Pointer to the table
+ * @retval NULL if allocation error occurred
+ */
+static flat_table*
+FlatTableConstructor (const size_t elements,
+                      hash_function h_func);
+
+
+/**
+ * @brief Frees the table and its keys
+ *
+ * @retval NULL
+ */
+static flat_table*
+FlatTableDestructor (flat_table* const table);
+
+
+/**
+ * @brief Inserts the key, nothing is done if it is already in the table
+ *
+ * @retval HASH_TABLE_SUCCESS if the key is inserted or found
+ * @retval HASH_TABLE_ERROR if allocation error occurred
+ */
+static hash_table_error_status
+FlatTableInsert (flat_table* const table,
+                 hash_table_key* const key,
+                 const uint64_t value);
+
+
+/**
+ * @brief Finds the key
+ *
+ * @retval Pointer to the slot of the key
+ * @retval NULL if the key is not in the table
+ */
+static flat_slot*
+FlatTableFind (flat_table* const table,
+               hash_table_key* const key);
+
+
+/**
+ * @brief Deletes the key and shifts the following slots of its probe
+ * sequence back
+ */
+static void
+FlatTableDelete (flat_table* const table,
+                 hash_table_key* const key);
+
+
+/**
+ * @brief Finds the slot of the key or the empty slot to insert it
+ */
+static flat_slot*
+FlatTableProbe (const flat_table* const table,
+                const hash_table_key* const key,
+                const uint64_t hash);
+
+
+/**
+ * @brief Doubles the capacity and moves the slots
+ *
+ * @retval HASH_TABLE_SUCCESS if the table has grown
+ * @retval HASH_TABLE_ERROR if allocation error occurred
+ */
+static hash_table_error_status
+FlatTableGrow (flat_table* const table);
+
+
+/**
+ * @brief Same as malloc(), counts the usable bytes
+ */
+static void*
+CountedMalloc (const size_t size);
+
+
+/**
+ * @brief Same as calloc(), counts the usable bytes
+ */
+static void*
+CountedCalloc (const size_t number,
+               const size_t size);
+
+
+/**
+ * @brief Same as free(), counts the usable bytes
+ */
+static void
+CountedFree (void* const pointer);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Operator new replacement
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Counts the memory of std::unordered_map and its strings the same way
+ * as the hash table counts its own, by the usable sizes
+ *
+ * @details Not inlined, GCC takes the inlined free() of operator new memory
+ * for a mismatched deallocation
+ */
+__attribute__ ((noinline)) void*
+operator new (const size_t size)
+{
+    void* const pointer = CountedMalloc ((size != 0) ? size : 1);
+    if (pointer == NULL) throw std::bad_alloc ();
+
+    return pointer;
+}
+
+
+__attribute__ ((noinline)) void
+operator delete (void* const pointer) noexcept
+{
+    CountedFree (pointer);
+}
+
+
+__attribute__ ((noinline)) void
+operator delete (void* const pointer,
+                 const size_t size) noexcept
+{
+    (void) size;
+
+    CountedFree (pointer);
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Benchmark static functions implementation
+//-----------------------------------------------------------------------------
+
+static workload*
+MakeWorkload (const bench_compare_config* const config,
+              const size_t elements)
+{
+    assert (config);
+
+    const workload_config load_config =
+    {
+        .distribution   = config->distribution,
+        .keys_number    = elements * BENCH_COMPARE_POOL_FACTOR,
+        .key_min        = config->key_min,
+        .key_max        = config->key_max,
+        .zipf_theta     = config->zipf_theta,
+        .seed           = config->seed,
+        .h_func         = GetHashFunctionPointer (config->hash_index),
+        .buckets_number = elements
+    };
+
+    workload* const load = WorkloadConstructor (&load_config);
+    assert (load);
+
+    return load;
+}
+
+
+static size_t
+MakeKeys (workload* const load,
+          bench_compare_chunk* const chunk,
+          const size_t first,
+          const size_t keys_number)
+{
+    assert (load);
+    assert (chunk);
+
+    const size_t chunk_size = (keys_number - first < BENCH_COMPARE_CHUNK) ?
+                              keys_number - first : BENCH_COMPARE_CHUNK;
+
+    for (size_t i = 0; i < chunk_size; ++i) chunk->indexes[i] = first + i;
+    WorkloadKeysMake (load, chunk->keys, chunk->indexes, chunk_size);
+
+    return chunk_size;
+}
+
+
+static size_t
+MakeFinds (const bench_compare_config* const config,
+           const size_t elements,
+           workload* const load,
+           uint64_t* const state,
+           bench_compare_chunk* const chunk,
+           const size_t finds_number)
+{
+    assert (config);
+    assert (load);
+    assert (state);
+    assert (chunk);
+
+    const size_t chunk_size = (finds_number < BENCH_COMPARE_CHUNK) ?
+                              finds_number : BENCH_COMPARE_CHUNK;
+    const size_t misses_number = elements * (BENCH_COMPARE_POOL_FACTOR - 1);
+
+    for (size_t i = 0; i < chunk_size; ++i)
+    {
+        const size_t index = WorkloadNextIndex (load);
+
+        if (NextRandom (state) % PERCENTS < config->hit_percent)
+            chunk->indexes[i] = index % elements;
+        else
+            chunk->indexes[i] = elements + index % misses_number;
+    }
+
+    WorkloadKeysMake (load, chunk->keys, chunk->indexes, chunk_size);
+
+    return chunk_size;
+}
+
+
+static size_t
+GetBucketsNumber (const bench_compare_config* const config,
+                  const size_t elements)
+{
+    assert (config);
+
+    const size_t buckets = (size_t) ((double) elements / config->load_factor);
+
+    return (buckets != 0) ? buckets : 1;
+}
+
+
+static void
+BenchImplementation (const bench_compare_config* const config,
+                     const bench_compare_implementation implementation,
+                     const size_t elements,
+                     bench_compare_result* const result)
+{
+    assert (config);
+    assert (result);
+
+    // every implementation streams the same keys from the same seed
+    workload* const load = MakeWorkload (config, elements);
+
+    bench_compare_chunk chunk =
+    {
+        .indexes = static_cast<size_t*> (calloc (BENCH_COMPARE_CHUNK,
+                                                 sizeof (size_t))),
+        .keys    = WorkloadKeysConstructor (load, BENCH_COMPARE_CHUNK)
+    };
+    assert (chunk.indexes && chunk.keys);
+
+    const workload_keys* const keys = chunk.keys;
+
+    hash_function h_func = GetHashFunctionPointer (config->hash_index);
+
+    const size_t buckets = GetBucketsNumber (config, elements);
+
+    hash_table_t*      table = NULL;
+    bench_compare_map* map   = NULL;
+    flat_table*        flat  = NULL;
+
+    const size_t live_bytes_before = counted_live_bytes;
+
+    switch (implementation)
+    {
+        case BENCH_COMPARE_HASH_TABLE:
+            table = HashTableConstructor (buckets, h_func);
+            assert (table);
+            break;
+
+        case BENCH_COMPARE_UNORDERED_MAP:
+            map = new bench_compare_map (buckets, bench_compare_hasher {h_func});
+            map->max_load_factor (static_cast<float> (config->load_factor));
+            break;
+
+        case BENCH_COMPARE_LINEAR_PROBING:
+        default:
+            flat = FlatTableConstructor (elements, h_func);
+            assert (flat);
+            break;
+    }
+
+    hash_table_key   key   = {};
+    uint64_t         number = 0;
+    hash_table_value value = {&number, sizeof (number)};
+    size_t found = 0;
+
+    #define KEY_OF(index)                                                   \
+        key.key      = keys->buffer + keys->offsets[index];                 \
+        key.key_size = keys->offsets[(index) + 1] - keys->offsets[index];
+
+    #define KEY_VIEW                                                        \
+        std::string_view (static_cast<const char*> (key.key), key.key_size)
+
+    // build
+    for (size_t done = 0; done < elements; done += keys->keys_number)
+    {
+        const size_t chunk_size = MakeKeys (load, &chunk, done, elements);
+        const double begin_time = GetTime ();
+
+        for (size_t i = 0; i < chunk_size; ++i)
+        {
+            KEY_OF (i);
+            number = chunk.indexes[i];
+
+            if      (table != NULL) HashTableInsert (table, &key, &value, KeyCmpFunction);
+            else if (map   != NULL) map->emplace (KEY_VIEW, number);
+            else                    FlatTableInsert (flat, &key, number);
+        }
+
+        result->seconds[0] += GetTime () - begin_time;
+    }
+
+    result->operations[0] = elements;
+
+    if (table != NULL)
+    {
+        hash_table_memory_usage usage = {};
+        HashTableMemoryUsage (table, &usage);
+        result->memory_bytes = usage.total_bytes;
+    }
+    else
+        result->memory_bytes = counted_live_bytes - live_bytes_before;
+
+    // find
+    uint64_t state = config->seed ^ elements;
+
+    for (size_t done = 0; done < config->operations; done += keys->keys_number)
+    {
+        const size_t chunk_size = MakeFinds (config, elements, load, &state,
+                                             &chunk, config->operations - done);
+        const double begin_time = GetTime ();
+
+        for (size_t i = 0; i < chunk_size; ++i)
+        {
+            KEY_OF (i);
+
+            if      (table != NULL) found += HashTableFind (table, &key, KeyCmpFunction) != NULL;
+            else if (map   != NULL) found += map->find (KEY_VIEW) != map->end ();
+            else                    found += FlatTableFind (flat, &key) != NULL;
+        }
+
+        result->seconds[1] += GetTime () - begin_time;
+    }
+
+    result->operations[1] = config->operations;
+    result->found         = found;
+
+    // delete
+    for (size_t done = 0; done < elements; done += keys->keys_number)
+    {
+        const size_t chunk_size = MakeKeys (load, &chunk, done, elements);
+        const double begin_time = GetTime ();
+
+        for (size_t i = 0; i < chunk_size; ++i)
+        {
+            KEY_OF (i);
+
+            if (table != NULL) HashTableDelete (table, &key, KeyCmpFunction);
+            else if (map != NULL)
+            {
+                const bench_compare_map::iterator node = map->find (KEY_VIEW);
+                if (node != map->end ()) map->erase (node);
+            }
+            else FlatTableDelete (flat, &key);
+        }
+
+        result->seconds[2] += GetTime () - begin_time;
+    }
+
+    result->operations[2] = elements;
+
+    #undef KEY_VIEW
+    #undef KEY_OF
+
+    assert (table == NULL || table->elem_number == 0);
+    assert (map   == NULL || map->empty ());
+    assert (flat  == NULL || flat->elements == 0);
+
+    HashTableDestructor (table);
+    delete map;
+    FlatTableDestructor (flat);
+
+    free (chunk.indexes);
+    WorkloadKeysDestructor (chunk.keys);
+    WorkloadDestructor (load);
+}
+
+
+static void
+BenchRun (const bench_compare_config* const config,
+          const size_t elements,
+          const int first)
+{
+    assert (config);
+
+    const size_t implementations_number =
+        sizeof (BENCH_COMPARE_NAMES) / sizeof (BENCH_COMPARE_NAMES[0]);
+
+    for (size_t i = 0; i < implementations_number; ++i)
+    {
+        const bench_compare_implementation implementation =
+            static_cast<bench_compare_implementation> (i);
+
+        bench_compare_result result = {};
+        BenchImplementation (config, implementation, elements, &result);
+        PrintResult (config, implementation, elements, &result, first && i == 0);
+    }
+}
+
+
+static void
+PrintResult (const bench_compare_config* const config,
+             const bench_compare_implementation implementation,
+             const size_t elements,
+             const bench_compare_result* const result,
+             const int first)
+{
+    assert (config);
+    assert (result);
+
+    printf ("%s  {\n", first ? "" : ",\n");
+    printf ("    \"schema_version\": %d,\n",   BENCH_SCHEMA_VERSION);
+    printf ("    \"benchmark\": \"compare\",\n");
+    printf ("    \"implementation\": \"%s\",\n", BENCH_COMPARE_NAMES[implementation]);
+    printf ("    \"elements\": %zu,\n",          elements);
+    printf ("    \"buckets\": %zu,\n",           GetBucketsNumber (config, elements));
+    printf ("    \"load_factor\": %.3lf,\n",     config->load_factor);
+    printf ("    \"operations\": %zu,\n",        config->operations);
+    printf ("    \"hit_percent\": %zu,\n",       config->hit_percent);
+    printf ("    \"found\": %zu,\n",             result->found);
+    printf ("    \"key_size\": {\"min\": %zu, \"max\": %zu},\n",
+            config->key_min, config->key_max);
+    printf ("    \"distribution\": \"%s\",\n",
+            WorkloadDistributionName (config->distribution));
+
+    if (config->distribution == WORKLOAD_ZIPF)
+        printf ("    \"zipf_theta\": %.3lf,\n",  config->zipf_theta);
+
+    printf ("    \"hash_function\": %zu,\n",     config->hash_index);
+    printf ("    \"seed\": %llu,\n",             (unsigned long long) config->seed);
+
+    // the finds are the main operation of the comparison
+    const double find_seconds = result->seconds[1];
+
+    printf ("    \"ops_per_sec\": %.0lf,\n",     config->operations / find_seconds);
+    printf ("    \"ns_per_op\": %.2lf,\n",
+            find_seconds * NSEC_PER_SEC / config->operations);
+    printf ("    \"memory\": {\"total_bytes\": %zu, \"bytes_per_element\": %.2lf},\n",
+            result->memory_bytes, (double) result->memory_bytes / elements);
+    printf ("    \"phases\": {\n");
+
+    for (size_t i = 0; i < BENCH_COMPARE_PHASES_NUMBER; ++i)
+    {
+        const double seconds    = result->seconds[i];
+        const size_t operations = result->operations[i];
+
+        printf ("      \"%s\": {\"operations\": %zu, \"seconds\": %.6lf, "
+                "\"ops_per_sec\": %.0lf, \"ns_per_op\": %.2lf}%s\n",
+                BENCH_COMPARE_PHASE_NAMES[i], operations, seconds,
+                operations / seconds, seconds * NSEC_PER_SEC / operations,
+                (i + 1 == BENCH_COMPARE_PHASES_NUMBER) ? "" : ",");
+    }
+
+    printf ("    }\n  }");
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Flat table static functions implementation
+//-----------------------------------------------------------------------------
+
+static flat_table*
+FlatTableConstructor (const size_t elements,
+                      hash_function h_func)
+{
+    assert (h_func);
+
+    flat_table* const table = static_cast<flat_table*> (CountedCalloc (1, sizeof (flat_table)));
+    if (table == NULL) return NULL;
+
+    size_t capacity = FLAT_TABLE_MIN_CAPACITY;
+    while (capacity * FLAT_TABLE_MAX_LOAD_PERCENT < elements * PERCENTS)
+        capacity *= 2;
+
+    table->slots = static_cast<flat_slot*> (CountedCalloc (capacity, sizeof (flat_slot)));
+    if (table->slots == NULL) return FlatTableDestructor (table);
+
+    table->capacity = capacity;
+    table->h_func   = h_func;
+
+    return table;
+}
+
+
+static flat_table*
+FlatTableDestructor (flat_table* const table)
+{
+    if (table == NULL) return NULL;
+
+    if (table->slots != NULL)
+        for (size_t i = 0; i < table->capacity; ++i)
+            CountedFree (table->slots[i].key);
+
+    CountedFree (table->slots);
+    CountedFree (table);
+
+    return NULL;
+}
+
+
+static hash_table_error_status
+FlatTableInsert (flat_table* const table,
+                 hash_table_key* const key,
+                 const uint64_t value)
+{
+    assert (table);
+    assert (key);
+
+    if ((table->elements + 1) * PERCENTS > table->capacity * FLAT_TABLE_MAX_LOAD_PERCENT &&
+        FlatTableGrow (table) != HASH_TABLE_SUCCESS)
+        return HASH_TABLE_ERROR;
+
+    const uint64_t hash = table->h_func (key, HASH_TABLE_FULL_RANGE);
+    flat_slot* const slot = FlatTableProbe (table, key, hash);
+
+    if (slot->key != NULL) return HASH_TABLE_SUCCESS;
+
+    slot->key = static_cast<char*> (CountedMalloc (key->key_size));
+    if (slot->key == NULL) return HASH_TABLE_ERROR;
+
+    memcpy (slot->key, key->key, key->key_size);
+    slot->hash     = hash;
+    slot->key_size = key->key_size;
+    slot->value    = value;
+    ++table->elements;
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+static flat_slot*
+FlatTableFind (flat_table* const table,
+               hash_table_key* const key)
+{
+    assert (table);
+    assert (key);
+
+    flat_slot* const slot =
+        FlatTableProbe (table, key, table->h_func (key, HASH_TABLE_FULL_RANGE));
+
+    return (slot->key != NULL) ? slot : NULL;
+}
+
+
+static void
+FlatTableDelete (flat_table* const table,
+                 hash_table_key* const key)
+{
+    assert (table);
+    assert (key);
+
+    flat_slot* const slot = FlatTableFind (table, key);
+    if (slot == NULL) return;
+
+    CountedFree (slot->key);
+    --table->elements;
+
+    const size_t mask = table->capacity - 1;
+    size_t hole = (size_t) (slot - table->slots);
+
+    // a slot moves to the hole if its home is not between the hole and it
+    for (size_t next = (hole + 1) & mask; table->slots[next].key != NULL;
+         next = (next + 1) & mask)
+    {
+        const size_t home = table->slots[next].hash & mask;
+
+        if (((next - home) & mask) >= ((next - hole) & mask))
+        {
+            table->slots[hole] = table->slots[next];
+            hole = next;
+        }
+    }
+
+    table->slots[hole] = flat_slot {};
+}
+
+
+static flat_slot*
+FlatTableProbe (const flat_table* const table,
+                const hash_table_key* const key,
+                const uint64_t hash)
+{
+    assert (table);
+    assert (key);
+
+    const size_t mask = table->capacity - 1;
+
+    for (size_t index = hash & mask; ; index = (index + 1) & mask)
+    {
+        flat_slot* const slot = table->slots + index;
+
+        if (slot->key == NULL ||
+            (slot->hash == hash && slot->key_size == key->key_size &&
+             memcmp (slot->key, key->key, key->key_size) == 0))
+            return slot;
+    }
+}
+
+
+static hash_table_error_status
+FlatTableGrow (flat_table* const table)
+{
+    assert (table);
+
+    const size_t new_capacity = 2 * table->capacity;
+    const size_t mask = new_capacity - 1;
+
+    flat_slot* const new_slots =
+        static_cast<flat_slot*> (CountedCalloc (new_capacity, sizeof (flat_slot)));
+    if (new_slots == NULL) return HASH_TABLE_ERROR;
+
+    for (size_t i = 0; i < table->capacity; ++i)
+    {
+        if (table->slots[i].key == NULL) continue;
+
+        size_t index = table->slots[i].hash & mask;
+        while (new_slots[index].key != NULL) index = (index + 1) & mask;
+
+        new_slots[index] = table->slots[i];
+    }
+
+    CountedFree (table->slots);
+    table->slots    = new_slots;
+    table->capacity = new_capacity;
+
+    return HASH_TABLE_SUCCESS;
+}
+
+
+static void*
+CountedMalloc (const size_t size)
+{
+    void* const pointer = malloc (size);
+    if (pointer != NULL) counted_live_bytes += malloc_usable_size (pointer);
+
+    return pointer;
+}
+
+
+static void*
+CountedCalloc (const size_t number,
+               const size_t size)
+{
+    void* const pointer = calloc (number, size);
+    if (pointer != NULL) counted_live_bytes += malloc_usable_size (pointer);
+
+    return pointer;
+}
+
+
+static void
+CountedFree (void* const pointer)
+{
+    if (pointer != NULL) counted_live_bytes -= malloc_usable_size (pointer);
+    free (pointer);
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Main function
+//-----------------------------------------------------------------------------
+
+int main (const int argc, const char** const argv)
+{
+    assert (argv);
+
+    bench_compare_config config = {};
+    config.sizes.sizes_number = sizeof (BENCH_COMPARE_DEFAULT_ELEMENTS) /
+                                sizeof (BENCH_COMPARE_DEFAULT_ELEMENTS[0]);
+    config.operations   = 2000000;
+    config.hit_percent  = 90;
+    config.key_min      = 8;
+    config.key_max      = 32;
+    config.load_factor  = 1.0;
+    config.hash_index   = 5;
+    config.seed         = 1;
+    config.distribution = WORKLOAD_UNIFORM;
+    config.zipf_theta   = 0.99;
+
+    memcpy (config.sizes.elements, BENCH_COMPARE_DEFAULT_ELEMENTS,
+            sizeof (BENCH_COMPARE_DEFAULT_ELEMENTS));
+
+    const bench_argument arguments[] =
+    {
+        {"elements",   BenchParseSizes,              &config.sizes},
+        {"operations", BenchParseSize,               &config.operations},
+        {"hit",        BenchParseSize,               &config.hit_percent},
+        {"key_min",    BenchParseSize,               &config.key_min},
+        {"key_max",    BenchParseSize,               &config.key_max},
+        {"load",       BenchParseDouble,             &config.load_factor},
+        {"hash",       BenchParseSize,               &config.hash_index},
+        {"seed",       BenchParseUint64,             &config.seed},
+        {"dist",       WorkloadDistributionArgument, &config.distribution},
+        {"theta",      BenchParseDouble,             &config.zipf_theta}
+    };
+
+    if (!BenchParseArguments (argc, argv, arguments,
+                              sizeof (arguments) / sizeof (arguments[0])))
+        return 1;
+
+    if (config.hit_percent > PERCENTS ||
+        config.key_min < BENCH_COMPARE_MIN_KEY_SIZE || config.key_max < config.key_min ||
+        !(config.load_factor > 0) || config.operations == 0 || config.seed == 0 ||
+        GetHashFunctionPointer (config.hash_index) == NULL ||
+        !(config.zipf_theta > 0 && config.zipf_theta < 1) ||
+        config.distribution == WORKLOAD_COLLIDING)
+    {
+        fprintf (stderr, "bad parameters: hit must be at most 100, key_min "
+                 "at least 8 and at most key_max, load, operations and seed "
+                 "positive, hash a known index, theta between 0 and 1, "
+                 "dist not colliding\n");
+        return 1;
+    }
+
+    printf ("[\n");
+
+    for (size_t i = 0; i < config.sizes.sizes_number; ++i)
+        BenchRun (&config, config.sizes.elements[i], i == 0);
+
+    printf ("\n]\n");
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
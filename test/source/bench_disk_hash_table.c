@@ -0,0 +1,253 @@
+#include "common.h"
+#include "disk_hash_table.h"
+#include "workload.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+
+
+//-----------------------------------------------------------------------------
+// Consts
+//-----------------------------------------------------------------------------
+
+/// @brief exe_file, table_file_name, elements_number, cache_pages
+static const int BENCH_DISK_ARGS_NUMBER = 4;
+
+
+/// @brief table_file_name argument index, the file is rewritten
+static const size_t BENCH_DISK_FILE_ARG = 1;
+
+
+/// @brief elements_number argument index
+static const size_t BENCH_DISK_ELEMENTS_ARG = 2;
+
+
+/// @brief cache_pages argument index
+static const size_t BENCH_DISK_CACHE_ARG = 3;
+
+
+/// @brief Minimal size of the generated key
+static const size_t BENCH_DISK_KEY_MIN = 8;
+
+
+/// @brief Maximal size of the generated key
+#define BENCH_DISK_KEY_MAX 32
+
+
+/// @brief Seed of the keys and the finds
+static const uint64_t BENCH_DISK_SEED = 0x9e3779b97f4a7c15;
+
+
+/// @brief Finds between the drops of the file pages from the OS cache,
+/// so they miss both the table cache and the OS one
+static const size_t BENCH_DISK_DROP_PERIOD = 4096;
+
+
+/// @brief Bytes in one megabyte
+static const double BYTES_PER_MB = 1024.0 * 1024.0;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Benchmark static functions prototypes
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Syncs the file and drops its pages from the OS page cache
+ */
+static void
+DropPageCache (const char* const filename);
+
+
+/**
+ * @brief Prints the throughput and the cache counters of the phase
+ *
+ * @param name Name of the phase
+ * @param table Pointer to the disk hash table
+ * @param operations Number of operations made
+ * @param seconds Time of the phase
+ * @param before Counters before the phase
+ */
+static void
+PrintPhase (const char* const name,
+            const disk_hash_table* const table,
+            const size_t operations,
+            const double seconds,
+            const disk_hash_table_stats* const before);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Benchmark static functions implementation
+//-----------------------------------------------------------------------------
+
+static void
+DropPageCache (const char* const filename)
+{
+    assert (filename);
+
+    const int fd = open (filename, O_RDONLY);
+    if (fd == -1) return;
+
+    // the dirty pages are not dropped
+    fsync (fd);
+    posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
+
+    close (fd);
+}
+
+
+static void
+PrintPhase (const char* const name,
+            const disk_hash_table* const table,
+            const size_t operations,
+            const double seconds,
+            const disk_hash_table_stats* const before)
+{
+    assert (name);
+    assert (table);
+    assert (before);
+
+    disk_hash_table_stats stats = {0};
+    DiskHashTableStats (table, &stats);
+
+    const size_t hits   = stats.cache_hits   - before->cache_hits;
+    const size_t misses = stats.cache_misses - before->cache_misses;
+    const size_t pages  = hits + misses;
+
+    printf ("%-8s %12.0lf ops/s %10zu misses %7.2lf%% hits %10zu writes\n",
+            name, operations / seconds, misses,
+            (pages == 0) ? 0.0 : 100.0 * hits / pages,
+            stats.page_writes - before->page_writes);
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Main function
+//-----------------------------------------------------------------------------
+
+int main (const int argc, const char** const argv)
+{
+    assert (argv);
+
+    if (argc != BENCH_DISK_ARGS_NUMBER)
+    {
+        fprintf (stderr, "usage: %s table_file elements_number cache_pages\n",
+                 argv[0]);
+        return 1;
+    }
+
+    const char* const filename = argv[BENCH_DISK_FILE_ARG];
+    const size_t elements = atoll (argv[BENCH_DISK_ELEMENTS_ARG]);
+    const size_t cache    = atoll (argv[BENCH_DISK_CACHE_ARG]);
+
+    // the finds are uniform over the inserted keys
+    const workload_config load_config =
+    {
+        .distribution = WORKLOAD_UNIFORM,
+        .keys_number  = elements,
+        .key_min      = BENCH_DISK_KEY_MIN,
+        .key_max      = BENCH_DISK_KEY_MAX,
+        .seed         = BENCH_DISK_SEED
+    };
+
+    workload* const load = WorkloadConstructor (&load_config);
+
+    if (load == NULL)
+    {
+        fprintf (stderr, "elements number must be positive\n");
+        return 1;
+    }
+
+    unlink (filename);
+
+    disk_hash_table* table =
+        DiskHashTableConstructor (filename, HashFunctionCrc32, cache);
+
+    if (table == NULL)
+    {
+        fprintf (stderr, "can not create %s\n", filename);
+        WorkloadDestructor (load);
+        return 1;
+    }
+
+    char key_buffer[BENCH_DISK_KEY_MAX] = "";
+    hash_table_key key = {.key = key_buffer, .key_size = 0};
+
+    disk_hash_table_stats before = {0};
+    double begin_time = GetTime ();
+
+    for (size_t i = 0; i < elements; ++i)
+    {
+        hash_table_value value = {.value = (void*) &i, .value_size = sizeof (i)};
+        WorkloadKey (load, i, key_buffer, &key);
+
+        const hash_table_error_status status =
+            DiskHashTableInsert (table, &key, &value, KeyCmpFunction);
+        assert (status == HASH_TABLE_SUCCESS);
+        (void) status;
+    }
+
+    DiskHashTableFlush (table);
+    PrintPhase ("insert", table, elements, GetTime () - begin_time, &before);
+
+    DiskHashTableStats (table, &before);
+    size_t found = 0;
+    double find_time = 0;
+
+    // the drops are not timed
+    for (size_t i = 0; i < elements; ++i)
+    {
+        if (i % BENCH_DISK_DROP_PERIOD == 0)
+        {
+            DropPageCache (filename);
+            begin_time = GetTime ();
+        }
+
+        hash_table_value value = {0};
+        const size_t number = WorkloadNext (load, key_buffer, &key);
+
+        if (DiskHashTableFind (table, &key, KeyCmpFunction, &value) ==
+            HASH_TABLE_SUCCESS &&
+            *(const size_t*) value.value == number)
+            ++found;
+
+        if ((i + 1) % BENCH_DISK_DROP_PERIOD == 0 || i + 1 == elements)
+            find_time += GetTime () - begin_time;
+    }
+
+    PrintPhase ("find", table, elements, find_time, &before);
+
+    disk_hash_table_stats stats = {0};
+    DiskHashTableStats (table, &stats);
+
+    table = DiskHashTableDestructor (table);
+    WorkloadDestructor (load);
+
+    FILE* const file = fopen (filename, "rb");
+    assert (file);
+
+    fseek (file, 0, SEEK_END);
+    const double file_mb = ftell (file) / BYTES_PER_MB;
+    fclose (file);
+
+    printf ("found %zu of %zu, %zu pages, depth %zu, %zu splits\n",
+            found, elements, stats.pages_number, stats.global_depth,
+            stats.splits);
+    printf ("file %.1lf MB, cache %zu pages\n", file_mb, cache);
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
@@ -0,0 +1,883 @@
+#include "common.h"
+#include "perf_counters.h"
+#include "workload.h"
+#include <stdint.h>
+
+
+
+//-----------------------------------------------------------------------------
+// Consts
+//-----------------------------------------------------------------------------
+
+/// @brief Table sizes of the default run, from L1-resident to many times LLC
+static const size_t BENCH_TABLE_DEFAULT_ELEMENTS[] =
+    {1 << 10, 1 << 14, 1 << 18, 1 << 22};
+
+
+/// @brief Key pool is this many times larger than the table,
+/// the keys out of the table are the misses
+static const size_t BENCH_TABLE_POOL_FACTOR = 2;
+
+
+/// @brief Keys start with their 8-byte number, so they are unique
+static const size_t BENCH_TABLE_MIN_KEY_SIZE = sizeof (uint64_t);
+
+
+/// @brief Largest table of the colliding keys, they are searched
+/// by buckets number tries each and make one chain
+static const size_t BENCH_TABLE_MAX_COLLIDING = 1 << 14;
+
+
+/// @brief Operations of one chunk, their keys are made before the chunk
+/// is timed, so the keys of a run take the memory of one chunk
+static const size_t BENCH_TABLE_CHUNK = 1 << 16;
+
+
+/// @brief Percentiles of the latencies in the report
+static const double BENCH_TABLE_PERCENTILES[] = {50.0, 90.0, 99.0, 99.9};
+
+
+/// @brief Names of the percentiles in the report
+static const char* const BENCH_TABLE_PERCENTILE_NAMES[] =
+    {"p50", "p90", "p99", "p999"};
+
+
+/// @brief Names of the operations in the report
+static const char* const BENCH_TABLE_OPERATION_NAMES[] =
+    {"insert", "find", "delete"};
+
+
+/// @brief Phases of one run
+#define BENCH_TABLE_MAX_PHASES 4
+
+
+/// @brief Percents in the whole
+static const size_t PERCENTS = 100;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static structures
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Parameters of the benchmark, set by name=value arguments
+ */
+typedef
+struct bench_table_config
+{
+    bench_sizes sizes;                      ///< table sizes, one run each
+    size_t operations;                      ///< timed operations of one run
+    size_t insert_percent;                  ///< inserts in the mix
+    size_t find_percent;                    ///< finds in the mix
+    size_t delete_percent;                  ///< deletes in the mix
+    size_t hit_percent;                     ///< finds of the keys in the table
+    size_t key_min;                         ///< minimal key size
+    size_t key_max;                         ///< maximal key size
+    double load_factor;                     ///< elements per bucket
+    size_t hash_index;                      ///< see GetHashFunctionPointer()
+    size_t sample_period;                   ///< every period-th op is timed
+    uint64_t seed;                          ///< seed of keys and operations
+    workload_distribution distribution;     ///< distribution of the keys
+    double zipf_theta;                      ///< skew of the zipf distribution
+    const char* text;                       ///< text to tokenize, NULL if none
+    perf_counters* counters;                ///< counters of the phases
+}
+bench_table_config;
+
+
+/**
+ * @brief Keys [lo, hi) of the pool in the table, see MakeOperations()
+ */
+typedef
+struct bench_table_window
+{
+    uint64_t state;                     ///< random state of the mix
+    size_t   lo;                        ///< first key in the table
+    size_t   hi;                        ///< key after the last one
+}
+bench_table_window;
+
+
+/**
+ * @brief Operations of one chunk and their keys
+ */
+typedef
+struct bench_table_chunk
+{
+    hash_table_operation* types;        ///< operation types
+    size_t*               indexes;      ///< key indexes of the operations
+    workload_keys*        keys;         ///< keys of the indexes
+}
+bench_table_chunk;
+
+
+/**
+ * @brief Time and hardware counters of one phase of a run
+ */
+typedef
+struct bench_table_phase
+{
+    const char*          name;          ///< name of the phase
+    size_t               operations;    ///< operations of the phase
+    double               begin_time;    ///< monotonic time of the start
+    double               seconds;       ///< time of the phase
+    perf_counters_values counters;      ///< counted events
+}
+bench_table_phase;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Benchmark static functions prototypes
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Makes the workload of the run, its key space is the pool
+ */
+static workload*
+MakeWorkload (const bench_table_config* const config,
+              const size_t pool_size,
+              const size_t buckets);
+
+
+/**
+ * @brief Generates the next operations of the mix on the sliding window
+ * of keys and makes their keys
+ *
+ * @details Keys [lo, hi) of the pool are in the table, taken by modulo of
+ * the pool size. Insert adds the key hi, delete removes the key lo, so the
+ * table size stays near the given one for a balanced mix. A hit find takes
+ * a key of the window, a miss find takes a key out of it, both by the next
+ * index of the workload modulo the window or the rest of the pool.
+ */
+static void
+MakeOperations (const bench_table_config* const config,
+                const size_t pool_size,
+                workload* const load,
+                bench_table_window* const window,
+                bench_table_chunk* const chunk,
+                const size_t operations_number);
+
+
+/**
+ * @brief Runs the operations on the table filled with elements keys
+ * and prints the JSON object of the run
+ */
+static void
+BenchRun (const bench_table_config* const config,
+          const size_t elements,
+          const int first);
+
+
+/**
+ * @brief Tokenizes the text, builds the table of its words, finds every word
+ * and destroys the table, prints the JSON object of the run
+ */
+static void
+BenchText (const bench_table_config* const config,
+           const int first);
+
+
+/**
+ * @brief Starts the time and the counters of the phase
+ */
+static void
+PhaseBegin (const bench_table_config* const config,
+            bench_table_phase* const phase,
+            const char* const name,
+            const size_t operations);
+
+
+/**
+ * @brief Names the phase and zeroes its time and counters, not starting it
+ */
+static void
+PhaseInit (bench_table_phase* const phase,
+           const char* const name,
+           const size_t operations);
+
+
+/**
+ * @brief Starts the time and the counters of the phase again,
+ * the chunks of the phase are made between PhaseEnd() and it
+ */
+static void
+PhaseResume (const bench_table_config* const config,
+             bench_table_phase* const phase);
+
+
+/**
+ * @brief Stops the time and the counters of the phase, adds them to the phase
+ */
+static void
+PhaseEnd (const bench_table_config* const config,
+          bench_table_phase* const phase);
+
+
+/**
+ * @brief Prints the phases as JSON object with the counters
+ * and their ratios per operation, null for the unavailable counters
+ */
+static void
+PrintPhases (const bench_table_phase* const phases,
+             const size_t phases_number);
+
+
+/**
+ * @brief Prints the memory usage of the table as JSON object
+ */
+static void
+PrintMemory (const hash_table_memory_usage* const usage);
+
+
+/**
+ * @brief Prints the latency percentiles of the operation as JSON object
+ */
+static void
+PrintLatencies (const hash_table_operation operation);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Benchmark static functions implementation
+//-----------------------------------------------------------------------------
+
+static workload*
+MakeWorkload (const bench_table_config* const config,
+              const size_t pool_size,
+              const size_t buckets)
+{
+    assert (config);
+
+    const workload_config load_config =
+    {
+        .distribution   = config->distribution,
+        .keys_number    = pool_size,
+        .key_min        = config->key_min,
+        .key_max        = config->key_max,
+        .zipf_theta     = config->zipf_theta,
+        .seed           = config->seed,
+        .h_func         = GetHashFunctionPointer (config->hash_index),
+        .buckets_number = buckets
+    };
+
+    workload* const load = WorkloadConstructor (&load_config);
+    assert (load);
+
+    return load;
+}
+
+
+static void
+MakeOperations (const bench_table_config* const config,
+                const size_t pool_size,
+                workload* const load,
+                bench_table_window* const window,
+                bench_table_chunk* const chunk,
+                const size_t operations_number)
+{
+    assert (config);
+    assert (load);
+    assert (window);
+    assert (chunk);
+
+    uint64_t state = window->state;
+    size_t lo = window->lo;
+    size_t hi = window->hi;
+
+    for (size_t i = 0; i < operations_number; ++i)
+    {
+        const size_t choice = NextRandom (&state) % PERCENTS;
+        const size_t size   = hi - lo;
+
+        hash_table_operation type = HASH_TABLE_OP_FIND;
+        size_t key = 0;
+
+        if (choice < config->insert_percent)
+        {
+            type = HASH_TABLE_OP_INSERT;
+
+            // the full pool makes the insert find the existing key
+            if (size < pool_size) key = hi++;
+            else                  key = lo;
+        }
+
+        else if (choice < config->insert_percent + config->find_percent)
+        {
+            const int hit = NextRandom (&state) % PERCENTS < config->hit_percent;
+
+            if ((hit && size != 0) || size == pool_size)
+                key = lo + WorkloadNextIndex (load) % size;
+            else
+                key = hi + WorkloadNextIndex (load) % (pool_size - size);
+        }
+
+        else
+        {
+            type = HASH_TABLE_OP_DELETE;
+
+            // the empty table makes the delete miss
+            if (size != 0) key = lo++;
+            else           key = hi;
+        }
+
+        chunk->types  [i] = type;
+        chunk->indexes[i] = key % pool_size;
+    }
+
+    window->state = state;
+    window->lo    = lo;
+    window->hi    = hi;
+
+    WorkloadKeysMake (load, chunk->keys, chunk->indexes, operations_number);
+}
+
+
+static void
+BenchRun (const bench_table_config* const config,
+          const size_t elements,
+          const int first)
+{
+    assert (config);
+
+    const size_t pool_size = elements * BENCH_TABLE_POOL_FACTOR;
+    size_t buckets = (size_t) ((double) elements / config->load_factor);
+    if (buckets == 0) buckets = 1;
+
+    workload* const load = MakeWorkload (config, pool_size, buckets);
+
+    bench_table_chunk chunk =
+    {
+        .types   = calloc (BENCH_TABLE_CHUNK, sizeof (hash_table_operation)),
+        .indexes = calloc (BENCH_TABLE_CHUNK, sizeof (size_t)),
+        .keys    = WorkloadKeysConstructor (load, BENCH_TABLE_CHUNK)
+    };
+    assert (chunk.types && chunk.indexes && chunk.keys);
+
+    const workload_keys* const keys = chunk.keys;
+
+    hash_table_t* const table =
+        HashTableConstructor (buckets, GetHashFunctionPointer (config->hash_index));
+    assert (table);
+
+    hash_table_key key = {0};
+    hash_table_value value = {0};
+
+    bench_table_phase phases[BENCH_TABLE_MAX_PHASES] = {0};
+    size_t phases_number = 0;
+
+    PhaseInit (phases + phases_number, "build", elements);
+
+    for (size_t done = 0; done < elements; done += keys->keys_number)
+    {
+        const size_t chunk_size = (elements - done < BENCH_TABLE_CHUNK) ?
+                                  elements - done : BENCH_TABLE_CHUNK;
+
+        for (size_t i = 0; i < chunk_size; ++i) chunk.indexes[i] = done + i;
+        WorkloadKeysMake (load, chunk.keys, chunk.indexes, chunk_size);
+
+        PhaseResume (config, phases + phases_number);
+
+        for (size_t i = 0; i < chunk_size; ++i)
+        {
+            key.key          = keys->buffer + keys->offsets[i];
+            key.key_size     = keys->offsets[i + 1] - keys->offsets[i];
+            value.value      = &chunk.indexes[i];
+            value.value_size = sizeof (chunk.indexes[i]);
+
+            HashTableInsert (table, &key, &value, KeyCmpFunction);
+        }
+
+        PhaseEnd (config, phases + phases_number);
+    }
+
+    ++phases_number;
+
+    HashTableLatencyReset ();
+
+    bench_table_window window = {.state = config->seed ^ elements,
+                                 .lo    = 0,
+                                 .hi    = elements};
+    size_t found = 0;
+
+    PhaseInit (phases + phases_number, "operations", config->operations);
+
+    for (size_t done = 0; done < config->operations; done += keys->keys_number)
+    {
+        const size_t chunk_size =
+            (config->operations - done < BENCH_TABLE_CHUNK) ?
+            config->operations - done : BENCH_TABLE_CHUNK;
+
+        MakeOperations (config, pool_size, load, &window, &chunk, chunk_size);
+
+        PhaseResume (config, phases + phases_number);
+
+        for (size_t i = 0; i < chunk_size; ++i)
+        {
+            key.key      = keys->buffer + keys->offsets[i];
+            key.key_size = keys->offsets[i + 1] - keys->offsets[i];
+
+            switch (chunk.types[i])
+            {
+                case HASH_TABLE_OP_INSERT:
+                    value.value      = &chunk.indexes[i];
+                    value.value_size = sizeof (chunk.indexes[i]);
+                    HashTableInsert (table, &key, &value, KeyCmpFunction);
+                    break;
+
+                case HASH_TABLE_OP_FIND:
+                    found += HashTableFind (table, &key, KeyCmpFunction) != NULL;
+                    break;
+
+                default:
+                    HashTableDelete (table, &key, KeyCmpFunction);
+                    break;
+            }
+        }
+
+        PhaseEnd (config, phases + phases_number);
+    }
+
+    const double seconds = phases[phases_number++].seconds;
+    const size_t final_elements = table->elem_number;
+
+    hash_table_memory_usage memory = {0};
+    HashTableMemoryUsage (table, &memory);
+
+    PhaseBegin (config, phases + phases_number, "destroy", final_elements);
+    HashTableDestructor (table);
+    PhaseEnd (config, phases + phases_number++);
+
+    printf ("%s  {\n", first ? "" : ",\n");
+    printf ("    \"schema_version\": %d,\n", BENCH_SCHEMA_VERSION);
+    printf ("    \"benchmark\": \"hash_table\",\n");
+    printf ("    \"implementation\": \"hash_table\",\n");
+    printf ("    \"elements\": %zu,\n",      elements);
+    printf ("    \"buckets\": %zu,\n",       buckets);
+    printf ("    \"load_factor\": %.3lf,\n", config->load_factor);
+    printf ("    \"final_elements\": %zu,\n", final_elements);
+    printf ("    \"operations\": %zu,\n",    config->operations);
+    printf ("    \"mix\": {\"insert\": %zu, \"find\": %zu, \"delete\": %zu},\n",
+            config->insert_percent, config->find_percent, config->delete_percent);
+    printf ("    \"hit_percent\": %zu,\n",   config->hit_percent);
+    printf ("    \"found\": %zu,\n",         found);
+    printf ("    \"key_size\": {\"min\": %zu, \"max\": %zu},\n",
+            config->key_min, config->key_max);
+    printf ("    \"distribution\": \"%s\",\n",
+            WorkloadDistributionName (config->distribution));
+
+    if (config->distribution == WORKLOAD_ZIPF)
+        printf ("    \"zipf_theta\": %.3lf,\n", config->zipf_theta);
+
+    printf ("    \"hash_function\": %zu,\n", config->hash_index);
+    printf ("    \"sample_period\": %zu,\n", config->sample_period);
+    printf ("    \"seed\": %llu,\n",         (unsigned long long) config->seed);
+    printf ("    \"seconds\": %.6lf,\n",     seconds);
+    printf ("    \"ops_per_sec\": %.0lf,\n", config->operations / seconds);
+    printf ("    \"ns_per_op\": %.2lf,\n",
+            seconds * NSEC_PER_SEC / config->operations);
+    printf ("    \"memory\": ");
+    PrintMemory (&memory);
+    printf (",\n");
+    printf ("    \"latency_ns\": {\n");
+
+    for (size_t i = HASH_TABLE_OP_INSERT; i <= HASH_TABLE_OP_DELETE; ++i)
+    {
+        printf ("      \"%s\": ", BENCH_TABLE_OPERATION_NAMES[i]);
+        PrintLatencies ((hash_table_operation) i);
+        printf ("%s\n", (i == HASH_TABLE_OP_DELETE) ? "" : ",");
+    }
+
+    printf ("    },\n");
+
+    PrintPhases (phases, phases_number);
+
+    printf ("\n  }");
+
+    free (chunk.types);
+    free (chunk.indexes);
+    WorkloadKeysDestructor (chunk.keys);
+    WorkloadDestructor (load);
+}
+
+
+static void
+BenchText (const bench_table_config* const config,
+           const int first)
+{
+    assert (config);
+    assert (config->text);
+
+    bench_table_phase phases[BENCH_TABLE_MAX_PHASES] = {0};
+    size_t phases_number = 0;
+
+    PhaseBegin (config, phases + phases_number, "tokenize", 0);
+    text_separation* text_sep = SeparateTextFile (config->text, Separator);
+    PhaseEnd (config, phases + phases_number++);
+
+    if (text_sep == NULL)
+    {
+        fprintf (stderr, "can not read the text %s\n", config->text);
+        return;
+    }
+
+    const size_t words_number = text_sep->strings_number;
+    phases[0].operations = words_number;
+
+    size_t buckets = (size_t) ((double) words_number / config->load_factor);
+    if (buckets == 0) buckets = 1;
+
+    hash_table_t* const table =
+        HashTableConstructor (buckets, GetHashFunctionPointer (config->hash_index));
+    assert (table);
+
+    hash_table_key key = {0};
+
+    PhaseBegin (config, phases + phases_number, "build", words_number);
+
+    for (size_t i = 0; i < words_number; ++i)
+    {
+        key.key      = text_sep->strings_array[i].begin_ptr;
+        key.key_size = text_sep->strings_array[i].chars_number;
+
+        HashTableInsert (table, &key, NULL, KeyCmpFunction);
+    }
+
+    PhaseEnd (config, phases + phases_number++);
+
+    size_t found = 0;
+    const size_t lookup_phase = phases_number;
+    PhaseBegin (config, phases + phases_number, "lookup", words_number);
+
+    for (size_t i = 0; i < words_number; ++i)
+    {
+        key.key      = text_sep->strings_array[i].begin_ptr;
+        key.key_size = text_sep->strings_array[i].chars_number;
+
+        found += HashTableFind (table, &key, KeyCmpFunction) != NULL;
+    }
+
+    PhaseEnd (config, phases + phases_number++);
+
+    const size_t unique_words = table->elem_number;
+
+    hash_table_memory_usage memory = {0};
+    HashTableMemoryUsage (table, &memory);
+
+    PhaseBegin (config, phases + phases_number, "destroy", unique_words);
+    HashTableDestructor (table);
+    PhaseEnd (config, phases + phases_number++);
+
+    text_sep = DestroySeparation (text_sep);
+
+    printf ("%s  {\n", first ? "" : ",\n");
+    printf ("    \"schema_version\": %d,\n", BENCH_SCHEMA_VERSION);
+    printf ("    \"benchmark\": \"hash_table_text\",\n");
+    printf ("    \"implementation\": \"hash_table\",\n");
+    printf ("    \"text\": \"%s\",\n",         config->text);
+    printf ("    \"words\": %zu,\n",           words_number);
+    printf ("    \"unique_words\": %zu,\n",    unique_words);
+    printf ("    \"buckets\": %zu,\n",         buckets);
+    printf ("    \"load_factor\": %.3lf,\n",   config->load_factor);
+    printf ("    \"found\": %zu,\n",           found);
+    printf ("    \"hash_function\": %zu,\n",   config->hash_index);
+    printf ("    \"sample_period\": %zu,\n",   config->sample_period);
+
+    // the lookups are the operations of the text run
+    const bench_table_phase* const lookup = phases + lookup_phase;
+
+    printf ("    \"ops_per_sec\": %.0lf,\n",   lookup->operations / lookup->seconds);
+    printf ("    \"ns_per_op\": %.2lf,\n",
+            lookup->seconds * NSEC_PER_SEC / lookup->operations);
+    printf ("    \"memory\": ");
+    PrintMemory (&memory);
+    printf (",\n");
+
+    PrintPhases (phases, phases_number);
+
+    printf ("\n  }");
+}
+
+
+static void
+PhaseBegin (const bench_table_config* const config,
+            bench_table_phase* const phase,
+            const char* const name,
+            const size_t operations)
+{
+    assert (config);
+    assert (phase);
+    assert (name);
+
+    PhaseInit   (phase, name, operations);
+    PhaseResume (config, phase);
+}
+
+
+static void
+PhaseInit (bench_table_phase* const phase,
+           const char* const name,
+           const size_t operations)
+{
+    assert (phase);
+    assert (name);
+
+    *phase = (bench_table_phase) {.name = name, .operations = operations};
+}
+
+
+static void
+PhaseResume (const bench_table_config* const config,
+             bench_table_phase* const phase)
+{
+    assert (config);
+    assert (phase);
+
+    PerfCountersStart (config->counters);
+    phase->begin_time = GetTime ();
+}
+
+
+static void
+PhaseEnd (const bench_table_config* const config,
+          bench_table_phase* const phase)
+{
+    assert (config);
+    assert (phase);
+
+    phase->seconds += GetTime () - phase->begin_time;
+
+    perf_counters_values counted = {0};
+    PerfCountersStop (config->counters, &counted);
+
+    for (size_t i = 0; i < PERF_COUNTERS_NUMBER; ++i)
+    {
+        phase->counters.values   [i] += counted.values[i];
+        phase->counters.available[i]  = counted.available[i];
+    }
+}
+
+
+static void
+PrintPhases (const bench_table_phase* const phases,
+             const size_t phases_number)
+{
+    assert (phases);
+
+    printf ("    \"phases\": {\n");
+
+    for (size_t i = 0; i < phases_number; ++i)
+    {
+        const bench_table_phase* const phase = phases + i;
+        const perf_counters_values* const counters = &phase->counters;
+
+        printf ("      \"%s\": {\"operations\": %zu, \"seconds\": %.6lf, "
+                "\"ns_per_op\": ", phase->name, phase->operations, phase->seconds);
+
+        if (phase->operations != 0)
+            printf ("%.2lf", phase->seconds * NSEC_PER_SEC / phase->operations);
+        else
+            printf ("null");
+
+        printf (",\n        \"counters\": {");
+
+        for (size_t j = 0; j < PERF_COUNTERS_NUMBER; ++j)
+        {
+            printf ("%s\"%s\": ", (j == 0) ? "" : ", ",
+                    PerfCounterName ((perf_counter) j));
+
+            if (counters->available[j])
+                printf ("%llu", (unsigned long long) counters->values[j]);
+            else
+                printf ("null");
+        }
+
+        printf ("},\n        \"per_op\": {");
+
+        for (size_t j = 0; j < PERF_COUNTERS_NUMBER; ++j)
+        {
+            printf ("%s\"%s\": ", (j == 0) ? "" : ", ",
+                    PerfCounterName ((perf_counter) j));
+
+            if (counters->available[j] && phase->operations != 0)
+                printf ("%.3lf", (double) counters->values[j] / phase->operations);
+            else
+                printf ("null");
+        }
+
+        printf ("},\n        \"ipc\": ");
+
+        if (counters->available[PERF_COUNTER_CYCLES] &&
+            counters->available[PERF_COUNTER_INSTRUCTIONS] &&
+            counters->values[PERF_COUNTER_CYCLES] != 0)
+            printf ("%.3lf", (double) counters->values[PERF_COUNTER_INSTRUCTIONS] /
+                             counters->values[PERF_COUNTER_CYCLES]);
+        else
+            printf ("null");
+
+        printf ("}%s\n", (i + 1 == phases_number) ? "" : ",");
+    }
+
+    printf ("    }");
+}
+
+
+static void
+PrintMemory (const hash_table_memory_usage* const usage)
+{
+    assert (usage);
+
+    printf ("{\"total_bytes\": %zu, \"table_bytes\": %zu, \"buckets_bytes\": %zu, "
+            "\"nodes_bytes\": %zu, \"keys_bytes\": %zu, \"values_bytes\": %zu, "
+            "\"bytes_per_element\": %.2lf, \"live_blocks\": %zu, "
+            "\"allocations_per_change\": %.3lf}",
+            usage->total_bytes, usage->table_bytes, usage->buckets_bytes,
+            usage->nodes_bytes, usage->keys_bytes, usage->values_bytes,
+            usage->bytes_per_element, usage->live_blocks,
+            usage->allocations_per_change);
+}
+
+
+static void
+PrintLatencies (const hash_table_operation operation)
+{
+    printf ("{\"samples\": %zu", HashTableLatencySamples (operation));
+
+    const size_t percentiles_number =
+        sizeof (BENCH_TABLE_PERCENTILES) / sizeof (BENCH_TABLE_PERCENTILES[0]);
+
+    for (size_t i = 0; i < percentiles_number; ++i)
+    {
+        double nanoseconds = 0;
+
+        if (HashTableLatencyPercentile (operation, HASH_TABLE_LATENCY_TOTAL,
+                                        BENCH_TABLE_PERCENTILES[i],
+                                        &nanoseconds) == HASH_TABLE_SUCCESS)
+            printf (", \"%s\": %.1lf", BENCH_TABLE_PERCENTILE_NAMES[i], nanoseconds);
+        else
+            printf (", \"%s\": null", BENCH_TABLE_PERCENTILE_NAMES[i]);
+    }
+
+    printf ("}");
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Main function
+//-----------------------------------------------------------------------------
+
+int main (const int argc, const char** const argv)
+{
+    assert (argv);
+
+    bench_table_config config =
+    {
+        .sizes          = {.sizes_number = sizeof (BENCH_TABLE_DEFAULT_ELEMENTS) /
+                                           sizeof (BENCH_TABLE_DEFAULT_ELEMENTS[0])},
+        .operations     = 2000000,
+        .insert_percent = 10,
+        .find_percent   = 80,
+        .delete_percent = 10,
+        .hit_percent    = 90,
+        .key_min        = 8,
+        .key_max        = 32,
+        .load_factor    = 1.0,
+        .hash_index     = 5,
+        .sample_period  = 16,
+        .seed           = 1,
+        .distribution   = WORKLOAD_UNIFORM,
+        .zipf_theta     = 0.99
+    };
+
+    memcpy (config.sizes.elements, BENCH_TABLE_DEFAULT_ELEMENTS,
+            sizeof (BENCH_TABLE_DEFAULT_ELEMENTS));
+
+    const bench_argument arguments[] =
+    {
+        {"elements",   BenchParseSizes,              &config.sizes},
+        {"operations", BenchParseSize,               &config.operations},
+        {"insert",     BenchParseSize,               &config.insert_percent},
+        {"find",       BenchParseSize,               &config.find_percent},
+        {"delete",     BenchParseSize,               &config.delete_percent},
+        {"hit",        BenchParseSize,               &config.hit_percent},
+        {"key_min",    BenchParseSize,               &config.key_min},
+        {"key_max",    BenchParseSize,               &config.key_max},
+        {"load",       BenchParseDouble,             &config.load_factor},
+        {"hash",       BenchParseSize,               &config.hash_index},
+        {"sample",     BenchParseSize,               &config.sample_period},
+        {"seed",       BenchParseUint64,             &config.seed},
+        {"text",       BenchParseString,             &config.text},
+        {"dist",       WorkloadDistributionArgument, &config.distribution},
+        {"theta",      BenchParseDouble,             &config.zipf_theta}
+    };
+
+    if (!BenchParseArguments (argc, argv, arguments,
+                              sizeof (arguments) / sizeof (arguments[0])))
+        return 1;
+
+    if (config.insert_percent + config.find_percent + config.delete_percent != PERCENTS ||
+        config.hit_percent > PERCENTS ||
+        config.key_min < BENCH_TABLE_MIN_KEY_SIZE || config.key_max < config.key_min ||
+        !(config.load_factor > 0) || config.operations == 0 || config.seed == 0 ||
+        GetHashFunctionPointer (config.hash_index) == NULL ||
+        !(config.zipf_theta > 0 && config.zipf_theta < 1))
+    {
+        fprintf (stderr, "bad parameters: the mix must sum to 100, hit must be "
+                 "at most 100, key_min at least 8 and at most key_max, "
+                 "load, operations and seed positive, hash a known index, "
+                 "theta between 0 and 1\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < config.sizes.sizes_number; ++i)
+    {
+        if (config.distribution == WORKLOAD_COLLIDING &&
+            config.sizes.elements[i] > BENCH_TABLE_MAX_COLLIDING)
+        {
+            fprintf (stderr, "colliding keys are for at most %zu elements\n",
+                     BENCH_TABLE_MAX_COLLIDING);
+            return 1;
+        }
+    }
+
+    if (HashTableLatencySetPeriod (config.sample_period) != HASH_TABLE_SUCCESS)
+        fprintf (stderr, "latencies are not measured, "
+                 "build with HASH_TABLE_INSTRUMENT and sample above 0\n");
+
+    config.counters = PerfCountersConstructor ();
+    if (PerfCountersAvailable (config.counters) != PERF_COUNTERS_NUMBER)
+        fprintf (stderr, "%zu of %d hardware counters are available, "
+                 "the others are null, see perf_event_paranoid\n",
+                 PerfCountersAvailable (config.counters), PERF_COUNTERS_NUMBER);
+
+    printf ("[\n");
+
+    for (size_t i = 0; i < config.sizes.sizes_number; ++i)
+        BenchRun (&config, config.sizes.elements[i], i == 0);
+
+    if (config.text != NULL)
+        BenchText (&config, config.sizes.sizes_number == 0);
+
+    printf ("\n]\n");
+
+    config.counters = PerfCountersDestructor (config.counters);
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
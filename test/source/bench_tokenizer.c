@@ -0,0 +1,189 @@
+#include "common.h"
+
+
+
+//-----------------------------------------------------------------------------
+// Consts
+//-----------------------------------------------------------------------------
+
+/// @brief exe_file, text_file_name, repeats_number, threads_number
+static const int BENCH_TOKENIZER_ARGS_NUMBER = 4;
+
+
+/// @brief text_file_name argument index
+static const size_t BENCH_TOKENIZER_TEXT_ARG = 1;
+
+
+/// @brief repeats_number argument index
+static const size_t BENCH_TOKENIZER_REPEATS_ARG = 2;
+
+
+/// @brief threads_number argument index, 0 for the number of CPUs
+static const size_t BENCH_TOKENIZER_THREADS_ARG = 3;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Benchmark static functions prototypes
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Reads the whole file into a new buffer
+ *
+ * @param filename Name of the file
+ * @param size Pointer to save the file size
+ *
+ * @retval Pointer to the buffer
+ * @retval NULL if the file can not be read
+ */
+static char*
+ReadWholeFile (const char* const filename,
+               size_t* const size);
+
+
+/**
+ * @brief Separates the buffer repeats times and prints the throughput
+ *
+ * @param name Name of the tokenizer to print
+ * @param buffer Buffer with the text
+ * @param size Number of characters in the buffer
+ * @param classes Character classes, separator function is used if NULL
+ * @param repeats Number of separations to make
+ * @param threads_number Number of threads, 1 for the single thread functions
+ */
+static void
+BenchTokenizer (const char* const name,
+                char* const buffer,
+                const size_t size,
+                const separation_char_classes* const classes,
+                const size_t repeats,
+                const size_t threads_number);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Benchmark static functions implementation
+//-----------------------------------------------------------------------------
+
+static char*
+ReadWholeFile (const char* const filename,
+               size_t* const size)
+{
+    assert (filename);
+    assert (size);
+
+    FILE* const file = fopen (filename, "rb");
+    if (file == NULL) return NULL;
+
+    fseek (file, 0, SEEK_END);
+    *size = ftell (file);
+    fseek (file, 0, SEEK_SET);
+
+    char* const buffer = malloc (*size);
+    if (buffer != NULL)
+        *size = fread (buffer, sizeof (char), *size, file);
+
+    fclose (file);
+    return buffer;
+}
+
+
+static void
+BenchTokenizer (const char* const name,
+                char* const buffer,
+                const size_t size,
+                const separation_char_classes* const classes,
+                const size_t repeats,
+                const size_t threads_number)
+{
+    assert (name);
+    assert (buffer);
+
+    size_t strings_number = 0;
+    const double begin_time = GetTime ();
+
+    for (size_t i = 0; i < repeats; ++i)
+    {
+        text_separation* text_sep = (threads_number != 1) ?
+            SeparateBufferParallel  (buffer, size, Separator, classes,
+                                     threads_number) :
+            (classes == NULL) ?
+            SeparateBuffer          (buffer, size, Separator) :
+            SeparateBufferByClasses (buffer, size, classes);
+        assert (text_sep);
+
+        strings_number = text_sep->strings_number;
+        text_sep = DestroySeparation (text_sep);
+    }
+
+    const double seconds = GetTime () - begin_time;
+    const double gbytes  = (double) size * repeats / NSEC_PER_SEC;
+
+    printf ("%-10s %10zu strings %8.3lf GB/s\n",
+            name, strings_number, gbytes / seconds);
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Main function
+//-----------------------------------------------------------------------------
+
+int main (const int argc, const char** const argv)
+{
+    assert (argv);
+
+    if (argc != BENCH_TOKENIZER_ARGS_NUMBER)
+    {
+        fprintf (stderr, "usage: %s text_file repeats_number threads_number\n",
+                 argv[0]);
+        return 1;
+    }
+
+    const size_t repeats = atoll (argv[BENCH_TOKENIZER_REPEATS_ARG]);
+    const size_t threads = atoll (argv[BENCH_TOKENIZER_THREADS_ARG]);
+
+    size_t size = 0;
+    char* const buffer = ReadWholeFile (argv[BENCH_TOKENIZER_TEXT_ARG], &size);
+
+    if (buffer == NULL)
+    {
+        fprintf (stderr, "can not read %s\n", argv[BENCH_TOKENIZER_TEXT_ARG]);
+        return 1;
+    }
+
+    separation_char_classes* classes =
+        SeparationCharClassesFromSeparator (Separator);
+    assert (classes);
+
+    BenchTokenizer ("separator", buffer, size, NULL, repeats, 1);
+
+    classes->simd_level = SEPARATION_SIMD_SCALAR;
+    BenchTokenizer ("scalar", buffer, size, classes, repeats, 1);
+
+    classes->simd_level = SEPARATION_SIMD_AVX2;
+    BenchTokenizer ("avx2", buffer, size, classes, repeats, 1);
+
+    classes->simd_level = SEPARATION_SIMD_AVX512;
+    BenchTokenizer ("avx512", buffer, size, classes, repeats, 1);
+
+    BenchTokenizer ("separator*", buffer, size, NULL,    repeats, threads);
+    BenchTokenizer ("avx512*",    buffer, size, classes, repeats, threads);
+
+    classes = SeparationCharClassesDestructor (classes);
+    free (buffer);
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
@@ -0,0 +1,395 @@
+#include "common.h"
+#include "hash_table_snapshot.h"
+#include "hash_table_wal.h"
+#include "workload.h"
+#include <pthread.h>
+#include <unistd.h>
+
+
+
+//-----------------------------------------------------------------------------
+// Consts
+//-----------------------------------------------------------------------------
+
+/// @brief exe_file, log_file_name, snapshot_file_name, operations, threads
+static const int BENCH_WAL_ARGS_NUMBER = 5;
+
+
+/// @brief log_file_name argument index, the file is rewritten
+static const size_t BENCH_WAL_LOG_ARG = 1;
+
+
+/// @brief snapshot_file_name argument index, the file is rewritten
+static const size_t BENCH_WAL_SNAPSHOT_ARG = 2;
+
+
+/// @brief operations argument index
+static const size_t BENCH_WAL_OPERATIONS_ARG = 3;
+
+
+/// @brief threads argument index
+static const size_t BENCH_WAL_THREADS_ARG = 4;
+
+
+/// @brief Number of buckets of the benchmarked tables
+static const size_t BENCH_WAL_BUCKETS = 1 << 16;
+
+
+/// @brief Minimal size of the generated key, its number
+static const size_t BENCH_WAL_KEY_MIN = 8;
+
+
+/// @brief Maximal size of the generated key
+#define BENCH_WAL_KEY_MAX 32
+
+
+/// @brief Seed of the generated keys
+static const uint64_t BENCH_WAL_SEED = 1;
+
+
+/// @brief Every DELETE_PERIOD-th operation deletes the previous key
+static const size_t BENCH_WAL_DELETE_PERIOD = 4;
+
+
+/// @brief Milliseconds in one second
+static const double MSEC_PER_SEC = 1e3;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static structures
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Operations of one thread
+ */
+typedef
+struct bench_wal_task
+{
+    hash_table_wal*  wal;           ///< log, the table is changed directly if NULL
+    hash_table_t*    table;         ///< table changed without the log
+    pthread_mutex_t* mutex;         ///< guards the table changed without the log
+    workload*        load;          ///< generator of the keys by their numbers
+    size_t           first_key;     ///< first key of the thread
+    size_t           operations;    ///< number of operations
+}
+bench_wal_task;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Benchmark static functions prototypes
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Runs the operations on the table from several threads
+ * and prints the throughput
+ *
+ * @param name Name of the phase
+ * @param table Hash table
+ * @param wal Log of the table, the table is changed directly if NULL
+ * @param load Generator of the keys
+ * @param operations Number of operations of all threads
+ * @param threads_number Number of threads
+ */
+static void
+BenchPhase (const char* const name,
+            hash_table_t* const table,
+            hash_table_wal* const wal,
+            workload* const load,
+            const size_t operations,
+            const size_t threads_number);
+
+
+/**
+ * @brief Makes the operations of the task, inserts the keys
+ * and deletes some of them
+ */
+static void*
+RunTask (void* const task_ptr);
+
+
+/**
+ * @brief Inserts or deletes the key through the log or under the mutex
+ */
+static void
+ChangeKey (const bench_wal_task* const task,
+           const size_t number,
+           const int insert);
+
+
+/**
+ * @brief Returns the size of the file
+ */
+static size_t
+GetFileSize (const char* const filename);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Benchmark static functions implementation
+//-----------------------------------------------------------------------------
+
+static void
+BenchPhase (const char* const name,
+            hash_table_t* const table,
+            hash_table_wal* const wal,
+            workload* const load,
+            const size_t operations,
+            const size_t threads_number)
+{
+    assert (name);
+    assert (table);
+    assert (load);
+    assert (threads_number);
+
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+    pthread_t*      const ids   = calloc (threads_number, sizeof (pthread_t));
+    bench_wal_task* const tasks = calloc (threads_number, sizeof (bench_wal_task));
+    assert (ids);
+    assert (tasks);
+
+    const double begin_time = GetTime ();
+
+    for (size_t i = 0; i < threads_number; ++i)
+    {
+        tasks[i] = (bench_wal_task)
+        {
+            .wal        = wal,
+            .table      = table,
+            .mutex      = &mutex,
+            .load       = load,
+            .first_key  = i * operations,
+            .operations = operations / threads_number
+        };
+
+        pthread_create (ids + i, NULL, RunTask, tasks + i);
+    }
+
+    for (size_t i = 0; i < threads_number; ++i)
+        pthread_join (ids[i], NULL);
+
+    const double seconds = GetTime () - begin_time;
+    const size_t done    = operations / threads_number * threads_number;
+
+    printf ("%-8s %12.0lf ops/s", name, done / seconds);
+
+    if (wal != NULL)
+    {
+        hash_table_wal_stats stats = {0};
+        HashTableWalStats (wal, &stats);
+
+        printf (" %8zu groups %7.1lf records/group %8zu syncs",
+                stats.groups_number,
+                (stats.groups_number == 0) ? 0.0 :
+                (double) stats.records_number / stats.groups_number,
+                stats.syncs_number);
+    }
+
+    printf ("\n");
+
+    free (ids);
+    free (tasks);
+}
+
+
+static void*
+RunTask (void* const task_ptr)
+{
+    assert (task_ptr);
+
+    const bench_wal_task* const task = task_ptr;
+
+    for (size_t i = 0; i < task->operations; ++i)
+    {
+        if (i % BENCH_WAL_DELETE_PERIOD == BENCH_WAL_DELETE_PERIOD - 1)
+            ChangeKey (task, task->first_key + i - 1, 0);
+
+        else
+            ChangeKey (task, task->first_key + i, 1);
+    }
+
+    return NULL;
+}
+
+
+static void
+ChangeKey (const bench_wal_task* const task,
+           const size_t number,
+           const int insert)
+{
+    assert (task);
+
+    // the keys of the uniform workload are made from the number only,
+    // so the threads make them at once
+    char   key_buffer[BENCH_WAL_KEY_MAX] = "";
+    size_t value_buffer = number;
+
+    hash_table_key   key   = {0};
+    hash_table_value value = {.value = &value_buffer,
+                              .value_size = sizeof (value_buffer)};
+
+    WorkloadKey (task->load, number, key_buffer, &key);
+
+    if (task->wal != NULL)
+    {
+        if (insert) HashTableWalInsert (task->wal, &key, &value);
+        else        HashTableWalDelete (task->wal, &key);
+
+        return;
+    }
+
+    pthread_mutex_lock (task->mutex);
+
+    if (insert) HashTableInsert (task->table, &key, &value, KeyCmpFunction);
+    else        HashTableDelete (task->table, &key, KeyCmpFunction);
+
+    pthread_mutex_unlock (task->mutex);
+}
+
+
+static size_t
+GetFileSize (const char* const filename)
+{
+    assert (filename);
+
+    FILE* const file = fopen (filename, "rb");
+    if (file == NULL) return 0;
+
+    fseek (file, 0, SEEK_END);
+    const size_t size = (size_t) ftell (file);
+    fclose (file);
+
+    return size;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Main function
+//-----------------------------------------------------------------------------
+
+int main (const int argc, const char** const argv)
+{
+    assert (argv);
+
+    const size_t threads = (argc == BENCH_WAL_ARGS_NUMBER) ?
+                           (size_t) atoll (argv[BENCH_WAL_THREADS_ARG]) : 0;
+
+    if (threads == 0)
+    {
+        fprintf (stderr, "usage: %s log_file snapshot_file operations "
+                         "threads_number\n", argv[0]);
+        return 1;
+    }
+
+    const char* const log_file      = argv[BENCH_WAL_LOG_ARG];
+    const char* const snapshot_file = argv[BENCH_WAL_SNAPSHOT_ARG];
+    const size_t operations = atoll (argv[BENCH_WAL_OPERATIONS_ARG]);
+
+    // every key number is a key of its own
+    const workload_config load_config =
+    {
+        .distribution = WORKLOAD_UNIFORM,
+        .keys_number  = SIZE_MAX,
+        .key_min      = BENCH_WAL_KEY_MIN,
+        .key_max      = BENCH_WAL_KEY_MAX,
+        .seed         = BENCH_WAL_SEED
+    };
+
+    workload* const load = WorkloadConstructor (&load_config);
+    assert (load);
+
+    hash_table_t* table = HashTableConstructor (BENCH_WAL_BUCKETS,
+                                                HashFunctionCrc32);
+    BenchPhase ("memory", table, NULL, load, operations, threads);
+    table = HashTableDestructor (table);
+
+    const hash_table_wal_sync syncs[] = {HASH_TABLE_WAL_NO_SYNC,
+                                         HASH_TABLE_WAL_SYNC};
+    const char* const names[] = {"no sync", "sync"};
+
+    for (size_t i = 0; i < sizeof (syncs) / sizeof (syncs[0]); ++i)
+    {
+        unlink (log_file);
+        table = HashTableConstructor (BENCH_WAL_BUCKETS, HashFunctionCrc32);
+
+        hash_table_wal* wal = HashTableWalConstructor (log_file, table,
+                                                       KeyCmpFunction, syncs[i]);
+        assert (wal);
+
+        BenchPhase (names[i], table, wal, load, operations, threads);
+
+        wal = HashTableWalDestructor (wal);
+        if (i + 1 != sizeof (syncs) / sizeof (syncs[0]))
+            table = HashTableDestructor (table);
+    }
+
+    // recovery from the log only
+    hash_table_t* recovered = HashTableConstructor (BENCH_WAL_BUCKETS,
+                                                    HashFunctionCrc32);
+    size_t records = 0;
+    double begin_time = GetTime ();
+
+    HashTableWalReplay (log_file, recovered, KeyCmpFunction, &records);
+
+    printf ("replay   %10zu records %9.1lf ms, %zu of %zu elements\n",
+            records, (GetTime () - begin_time) * MSEC_PER_SEC,
+            recovered->elem_number, table->elem_number);
+
+    // compaction, then recovery from the snapshot and the new log
+    hash_table_wal* wal = HashTableWalConstructor (log_file, recovered,
+                                                   KeyCmpFunction,
+                                                   HASH_TABLE_WAL_SYNC);
+    assert (wal);
+
+    const size_t log_size = GetFileSize (log_file);
+    begin_time = GetTime ();
+
+    HashTableWalCompact (wal, snapshot_file);
+
+    printf ("compact  %10zu bytes   %9.1lf ms, snapshot %zu bytes\n",
+            log_size, (GetTime () - begin_time) * MSEC_PER_SEC,
+            GetFileSize (snapshot_file));
+
+    ChangeKey (&(bench_wal_task) {.wal = wal, .load = load},
+               operations * threads, 1);
+    wal = HashTableWalDestructor (wal);
+
+    begin_time = GetTime ();
+
+    hash_table_snapshot* snapshot = HashTableLoad (snapshot_file,
+                                                   HashFunctionCrc32);
+    hash_table_t* restored = HashTableSnapshotToTable (snapshot, KeyCmpFunction);
+    snapshot = HashTableSnapshotDestructor (snapshot);
+    assert (restored);
+
+    HashTableWalReplay (log_file, restored, KeyCmpFunction, &records);
+
+    printf ("recover  %10zu records %9.1lf ms, %zu of %zu elements\n",
+            records, (GetTime () - begin_time) * MSEC_PER_SEC,
+            restored->elem_number, recovered->elem_number);
+
+    HashTableDestructor (restored);
+    HashTableDestructor (recovered);
+    HashTableDestructor (table);
+    WorkloadDestructor (load);
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
@@ -1,4 +1,63 @@
 #include "common.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+
+//-----------------------------------------------------------------------------
+// Static functions prototypes
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Separation callback, inserts the string into the hash table
+ *
+ * @param string String from the separation stream
+ * @param table Pointer to the hash table
+ *
+ * @retval SEPARATION_SUCCESS if the string is inserted
+ * @retval SEPARATION_ERROR if insertion error occurred
+ *
+ * @details The key points to the stream buffer, the table copies it
+ */
+static separation_error_t
+InsertString (const string_info* const string,
+              void* const table);
+
+
+/**
+ * @brief Separation callback, inserts the string with its hash
+ *
+ * @param string String from the separation stream
+ * @param hash Hash computed by the stream with the table hash function
+ * @param table Pointer to the hash table
+ *
+ * @retval SEPARATION_SUCCESS if the string is inserted
+ * @retval SEPARATION_ERROR if insertion error occurred
+ */
+static separation_error_t
+InsertHashedString (const string_info* const string,
+                    const size_t hash,
+                    void* const table);
+
+
+/**
+ * @brief Adapter of HashStateUpdate() for separation_hasher
+ */
+static void
+HasherUpdate (void* const state,
+              const char* const buffer,
+              const size_t size);
+
+
+/**
+ * @brief Adapter of HashStateFinal() for separation_hasher
+ */
+static size_t
+HasherFinal (const void* const state);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
 
 
 
@@ -14,22 +73,41 @@ FillHashTable (const char* const filename,
     assert (filename);
     assert (h_func);
 
-    hash_table_t* const table = HashTableConstructor (buckets_number, h_func);
+    hash_table_t* const table =
+        HashTableConstructorWithMode (buckets_number, h_func, HASH_TABLE_SET);
     assert (table);
 
-    text_separation* text_sep = SeparateTextFile (filename, Separator);
-    assert (text_sep);
+    separation_char_classes* classes =
+        SeparationCharClassesFromSeparator (Separator);
+    assert (classes);
 
-    const size_t words_number = text_sep->strings_number;
-    hash_table_key* cur_key = NULL;
+    separation_stream* stream =
+        SeparationStreamConstructorByClasses (filename, 0, classes);
+    assert (stream);
 
-    for (size_t i = 0; i < words_number; ++i)
+    hash_state initial_state = {0};
+    const separation_hasher hasher =
     {
-        cur_key = (hash_table_key*) text_sep->strings_array[i];
-        HashTableInsert (table, cur_key, NULL, KeyCmpFunction);
-    }
+        .update        = HasherUpdate,
+        .final         = HasherFinal,
+        .initial_state = &initial_state,
+        .state_size    = sizeof (hash_state)
+    };
 
-    text_sep = DestroySeparation (text_sep);
+    separation_error_t status = SEPARATION_ERROR;
+
+    // words are hashed by the stream if the function can be computed by parts
+    if (HashStateInit (&initial_state, h_func) == HASH_TABLE_SUCCESS &&
+        SeparationStreamSetHasher (stream, &hasher) == SEPARATION_SUCCESS)
+        status = SeparationStreamForEachHashed (stream, InsertHashedString, table);
+    else
+        status = SeparationStreamForEach (stream, InsertString, table);
+
+    assert (status == SEPARATION_SUCCESS);
+    (void) status;
+
+    stream  = SeparationStreamDestructor      (stream);
+    classes = SeparationCharClassesDestructor (classes);
 
     return table;
 }
@@ -84,5 +162,253 @@ GetHashFunctionPointer (const size_t hash_function_index)
     return functions_array[hash_function_index];
 }
 
+
+const char*
+GetHashFunctionName (const size_t hash_function_index)
+{
+    static const char* const names_array[] =
+    {
+        "zero_index",
+        "first_ascii",
+        "word_length",
+        "ascii_sum",
+        "djb2",
+        "crc32"
+    };
+
+    if (hash_function_index >= sizeof (names_array) / sizeof (names_array[0]))
+        return NULL;
+
+    return names_array[hash_function_index];
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static functions implementation
+//-----------------------------------------------------------------------------
+
+static separation_error_t
+InsertString (const string_info* const string,
+              void* const table)
+{
+    assert (string);
+    assert (table);
+
+    hash_table_key key =
+    {
+        .key      = string->begin_ptr,
+        .key_size = string->chars_number
+    };
+
+    if (HashTableInsert (table, &key, NULL, KeyCmpFunction) == HASH_TABLE_ERROR)
+        return SEPARATION_ERROR;
+
+    return SEPARATION_SUCCESS;
+}
+
+
+static separation_error_t
+InsertHashedString (const string_info* const string,
+                    const size_t hash,
+                    void* const table)
+{
+    assert (string);
+    assert (table);
+
+    hash_table_key key =
+    {
+        .key      = string->begin_ptr,
+        .key_size = string->chars_number
+    };
+
+    if (HashTableInsertHashed (table, &key, NULL, KeyCmpFunction, hash)
+        == HASH_TABLE_ERROR)
+        return SEPARATION_ERROR;
+
+    return SEPARATION_SUCCESS;
+}
+
+
+static void
+HasherUpdate (void* const state,
+              const char* const buffer,
+              const size_t size)
+{
+    HashStateUpdate (state, buffer, size);
+}
+
+
+static size_t
+HasherFinal (const void* const state)
+{
+    return HashStateFinal (state);
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Benchmark functions implementation
+//-----------------------------------------------------------------------------
+
+int
+BenchParseArguments (const int argc,
+                     const char** const argv,
+                     const bench_argument* const arguments,
+                     const size_t arguments_number)
+{
+    assert (argv);
+    assert (arguments);
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* const separator = strchr (argv[i], '=');
+        const size_t name_size = (separator != NULL) ?
+                                 (size_t) (separator - argv[i]) : 0;
+
+        size_t index = 0;
+        while (index < arguments_number &&
+               !(strlen (arguments[index].name) == name_size &&
+                 strncmp (argv[i], arguments[index].name, name_size) == 0))
+            ++index;
+
+        if (separator != NULL && separator[1] != '\0' &&
+            index < arguments_number &&
+            arguments[index].parse (separator + 1, arguments[index].target))
+            continue;
+
+        fprintf (stderr, "bad argument %s, expected name=value with names", argv[i]);
+
+        for (size_t j = 0; j < arguments_number; ++j)
+            fprintf (stderr, "%s %s", (j == 0) ? "" : ",", arguments[j].name);
+
+        fprintf (stderr, "\n");
+        return 0;
+    }
+
+    return 1;
+}
+
+
+int
+BenchParseSize (const char* const value,
+                void* const size)
+{
+    assert (value);
+    assert (size);
+
+    char* end = NULL;
+    const size_t number = strtoull (value, &end, 10);
+    if (end == value || *end != '\0') return 0;
+
+    *(size_t*) size = number;
+    return 1;
+}
+
+
+int
+BenchParseUint64 (const char* const value,
+                  void* const number)
+{
+    assert (value);
+    assert (number);
+
+    char* end = NULL;
+    const uint64_t parsed = strtoull (value, &end, 10);
+    if (end == value || *end != '\0') return 0;
+
+    *(uint64_t*) number = parsed;
+    return 1;
+}
+
+
+int
+BenchParseDouble (const char* const value,
+                  void* const number)
+{
+    assert (value);
+    assert (number);
+
+    char* end = NULL;
+    const double parsed = strtod (value, &end);
+    if (end == value || *end != '\0') return 0;
+
+    *(double*) number = parsed;
+    return 1;
+}
+
+
+int
+BenchParseString (const char* const value,
+                  void* const string)
+{
+    assert (value);
+    assert (string);
+
+    *(const char**) string = value;
+    return 1;
+}
+
+
+int
+BenchParseSizes (const char* const value,
+                 void* const sizes)
+{
+    assert (value);
+    assert (sizes);
+
+    bench_sizes* const list = sizes;
+    list->sizes_number = 0;
+
+    // only the runs without the table sizes
+    if (strcmp (value, "0") == 0) return 1;
+
+    const char* current = value;
+    while (*current != '\0')
+    {
+        if (list->sizes_number == BENCH_MAX_SIZES) return 0;
+
+        char* end = NULL;
+        const size_t size = strtoull (current, &end, 10);
+        if (end == current || size == 0) return 0;
+
+        list->elements[list->sizes_number++] = size;
+
+        current = end;
+        if (*current == ',') ++current;
+    }
+
+    return list->sizes_number != 0;
+}
+
+
+uint64_t
+NextRandom (uint64_t* const state)
+{
+    assert (state);
+
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+
+    return *state;
+}
+
+
+double
+GetTime (void)
+{
+    struct timespec time = {0};
+    clock_gettime (CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + time.tv_nsec / NSEC_PER_SEC;
+}
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
@@ -0,0 +1,288 @@
+#include "perf_counters.h"
+#include <assert.h>
+#include <stdlib.h>
+
+#ifdef __linux__
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+
+
+//-----------------------------------------------------------------------------
+// Static structures
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Opened counters of one thread
+ */
+struct perf_counters
+{
+    int descriptors[PERF_COUNTERS_NUMBER];  ///< -1 if the event is not counted
+};
+
+
+#ifdef __linux__
+/**
+ * @brief Values of one group read with the enabled and the running time
+ */
+typedef
+struct perf_counters_read
+{
+    uint64_t number;                        ///< number of the group events
+    uint64_t time_enabled;                  ///< nanoseconds the group was enabled
+    uint64_t time_running;                  ///< nanoseconds the group was on the PMU
+    uint64_t values[PERF_COUNTERS_NUMBER];  ///< event counts in the open order
+}
+perf_counters_read;
+#endif
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Consts
+//-----------------------------------------------------------------------------
+
+/// @brief Names of the events in the order of perf_counter
+static const char* const PERF_COUNTER_NAMES[PERF_COUNTERS_NUMBER] =
+{
+    "cycles",
+    "instructions",
+    "l1d_misses",
+    "llc_misses",
+    "dtlb_misses",
+    "branch_misses"
+};
+
+
+#ifdef __linux__
+/// @brief Cache event config: cache, operation and result
+#define PERF_CACHE_EVENT(cache, operation, result) \
+    ((cache) | ((operation) << 8) | ((result) << 16))
+
+
+/// @brief perf_event_attr type and config of the events
+static const struct
+{
+    uint32_t type;
+    uint64_t config;
+}
+PERF_COUNTER_EVENTS[PERF_COUNTERS_NUMBER] =
+{
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, PERF_CACHE_EVENT (PERF_COUNT_HW_CACHE_L1D,
+                                           PERF_COUNT_HW_CACHE_OP_READ,
+                                           PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_CACHE_EVENT (PERF_COUNT_HW_CACHE_DTLB,
+                                           PERF_COUNT_HW_CACHE_OP_READ,
+                                           PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}
+};
+#endif
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static functions prototypes
+//-----------------------------------------------------------------------------
+
+#ifdef __linux__
+/**
+ * @brief Checks if the counter leads a group: the cycles lead the others,
+ * the others lead themselves if the cycles are not counted
+ *
+ * @retval 1 if the counter is opened and leads a group
+ * @retval 0 otherwise
+ */
+static int
+PerfCounterIsLeader (const perf_counters* const counters,
+                     const size_t counter);
+#endif
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Performance counters implementation
+//-----------------------------------------------------------------------------
+
+perf_counters*
+PerfCountersConstructor (void)
+{
+    perf_counters* const counters = calloc (1, sizeof (perf_counters));
+    if (counters == NULL) return NULL;
+
+    for (size_t i = 0; i < PERF_COUNTERS_NUMBER; ++i)
+    {
+        counters->descriptors[i] = -1;
+
+#ifdef __linux__
+        struct perf_event_attr attributes = {0};
+
+        attributes.size           = sizeof (attributes);
+        attributes.type           = PERF_COUNTER_EVENTS[i].type;
+        attributes.config         = PERF_COUNTER_EVENTS[i].config;
+        attributes.disabled       = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv     = 1;
+        attributes.read_format    = PERF_FORMAT_GROUP              |
+                                    PERF_FORMAT_TOTAL_TIME_ENABLED |
+                                    PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        // the cycles lead the group, the others are alone without them
+        const int leader = counters->descriptors[PERF_COUNTER_CYCLES];
+
+        // this thread on any CPU, fails without the PMU or the permission
+        counters->descriptors[i] =
+            (int) syscall (SYS_perf_event_open, &attributes, 0, -1,
+                           (i == PERF_COUNTER_CYCLES) ? -1 : leader, 0);
+#endif
+    }
+
+    return counters;
+}
+
+
+perf_counters*
+PerfCountersDestructor (perf_counters* const counters)
+{
+    if (counters == NULL) return NULL;
+
+#ifdef __linux__
+    for (size_t i = 0; i < PERF_COUNTERS_NUMBER; ++i)
+        if (counters->descriptors[i] >= 0)
+            close (counters->descriptors[i]);
+#endif
+
+    free (counters);
+    return NULL;
+}
+
+
+void
+PerfCountersStart (perf_counters* const counters)
+{
+    if (counters == NULL) return;
+
+#ifdef __linux__
+    for (size_t i = 0; i < PERF_COUNTERS_NUMBER; ++i)
+    {
+        if (!PerfCounterIsLeader (counters, i)) continue;
+
+        // the whole group at once, so its events count the same time
+        ioctl (counters->descriptors[i], PERF_EVENT_IOC_RESET,
+               PERF_IOC_FLAG_GROUP);
+        ioctl (counters->descriptors[i], PERF_EVENT_IOC_ENABLE,
+               PERF_IOC_FLAG_GROUP);
+    }
+#endif
+}
+
+
+void
+PerfCountersStop (perf_counters* const counters,
+                  perf_counters_values* const values)
+{
+    assert (values);
+
+    *values = (perf_counters_values) {0};
+    if (counters == NULL) return;
+
+#ifdef __linux__
+    for (size_t i = 0; i < PERF_COUNTERS_NUMBER; ++i)
+        if (PerfCounterIsLeader (counters, i))
+            ioctl (counters->descriptors[i], PERF_EVENT_IOC_DISABLE,
+                   PERF_IOC_FLAG_GROUP);
+
+    for (size_t i = 0; i < PERF_COUNTERS_NUMBER; ++i)
+    {
+        if (!PerfCounterIsLeader (counters, i)) continue;
+
+        perf_counters_read counted = {0};
+        const ssize_t read_bytes =
+            read (counters->descriptors[i], &counted, sizeof (counted));
+        if (read_bytes < (ssize_t) (3 * sizeof (uint64_t)) ||
+            counted.time_running == 0)
+            continue;
+
+        // the group members follow the leader in the open order
+        size_t member = 0;
+        for (size_t event = i; event < PERF_COUNTERS_NUMBER &&
+                               member < counted.number; ++event)
+        {
+            if (counters->descriptors[event] < 0 ||
+                (event != i && i != PERF_COUNTER_CYCLES))
+                continue;
+
+            const uint64_t value = counted.values[member++];
+
+            // the group shared the PMU with others for a part of the time
+            values->values[event] =
+                (counted.time_running == counted.time_enabled) ? value :
+                (uint64_t) ((double) value * counted.time_enabled /
+                            counted.time_running);
+            values->available[event] = 1;
+        }
+    }
+#endif
+}
+
+
+const char*
+PerfCounterName (const perf_counter counter)
+{
+    if ((size_t) counter >= PERF_COUNTERS_NUMBER) return NULL;
+
+    return PERF_COUNTER_NAMES[counter];
+}
+
+
+size_t
+PerfCountersAvailable (const perf_counters* const counters)
+{
+    if (counters == NULL) return 0;
+
+    size_t available = 0;
+    for (size_t i = 0; i < PERF_COUNTERS_NUMBER; ++i)
+        available += counters->descriptors[i] >= 0;
+
+    return available;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static functions implementation
+//-----------------------------------------------------------------------------
+
+#ifdef __linux__
+static int
+PerfCounterIsLeader (const perf_counters* const counters,
+                     const size_t counter)
+{
+    assert (counters);
+
+    if (counters->descriptors[counter] < 0) return 0;
+
+    return counter == PERF_COUNTER_CYCLES ||
+           counters->descriptors[PERF_COUNTER_CYCLES] < 0;
+}
+#endif
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
@@ -1,4 +1,10 @@
 #include "common.h"
+#include <math.h>
+#include <time.h>
+
+#if defined (__x86_64__) || defined (__i386__)
+    #include <x86intrin.h>
+#endif
 
 
 
@@ -21,39 +27,94 @@ static const size_t TEST_HASH_FUNCTION_BUCKETS_NUMBER_ARG = 2;
 /// @brief hash_function_number argument index
 static const size_t TEST_HASH_FUNCTION_INDEX_ARG = 3;
 
+
+/// @brief exe_file, text_file_name, buckets_number:
+/// compares the quality and the speed of all the functions
+static const int TEST_HASH_FUNCTION_QUALITY_ARGS_NUMBER = 3;
+
+
+/// @brief Number of random keys flipped bit by bit for the avalanche
+static const size_t TEST_HASH_FUNCTION_AVALANCHE_KEYS = 1024;
+
+
+/// @brief Size of the avalanche keys, every bit of them is flipped
+#define TEST_HASH_FUNCTION_AVALANCHE_KEY_SIZE 16
+
+
+/// @brief Number of the input bits of the avalanche keys
+#define TEST_HASH_FUNCTION_INPUT_BITS (TEST_HASH_FUNCTION_AVALANCHE_KEY_SIZE * 8)
+
+
+/// @brief Number of bits of the full hash
+#define TEST_HASH_FUNCTION_OUTPUT_BITS 64
+
+
+/// @brief Key sizes of the speed measurement: short, medium and long
+static const size_t TEST_HASH_FUNCTION_SPEED_SIZES[] = {8, 64, 4096};
+
+
+/// @brief Bytes hashed to measure the speed for one key size
+static const size_t TEST_HASH_FUNCTION_SPEED_BYTES = 1 << 24;
+
+
+/// @brief Seed of the random keys
+static const uint64_t TEST_HASH_FUNCTION_SEED = 0x9E3779B97F4A7C15;
+
+
+#if defined (__x86_64__) || defined (__i386__)
+/// @brief Unit of the speed, time stamp counter ticks
+static const char* const TEST_HASH_FUNCTION_SPEED_UNIT = "cycles/byte";
+#else
+/// @brief Unit of the speed, no cycle counter is read on this target
+static const char* const TEST_HASH_FUNCTION_SPEED_UNIT = "ns/byte";
+#endif
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 
 
 
 //-----------------------------------------------------------------------------
-// Output static functions prototypes
+// Static structures
 //-----------------------------------------------------------------------------
 
 /**
- * @brief Prints number of buckets, number of elements in buckets
- * and dispersion for the elements distribution
- *
- * @param table Filled hash table
+ * @brief Quality and speed of one hash function
  */
-static void
-PrintResults (const hash_table_t* const table);
+typedef
+struct hash_quality
+{
+    size_t output_bits;     ///< bits up to the highest one set in any hash
+    double chi_squared;     ///< chi-squared of the buckets divided by its dof
+    size_t collisions;      ///< keys with the full hash of another key
+    double avalanche;       ///< mean |2 P(output bit flips) - 1|, 0 is ideal
+    double worst_avalanche; ///< the largest of the biases above
+    double independence;    ///< max |correlation| of two output bits flips
+    double speed[sizeof (TEST_HASH_FUNCTION_SPEED_SIZES) /
+                 sizeof (TEST_HASH_FUNCTION_SPEED_SIZES[0])]; ///< per size
+}
+hash_quality;
 
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Output static functions prototypes
+//-----------------------------------------------------------------------------
 
 /**
- * @brief Calculates dispersion for the elements distribution
+ * @brief Prints number of buckets, number of elements in buckets
+ * and dispersion for the elements distribution
  *
  * @param table Filled hash table
  *
- * @details $D\ksi = E(\ksi^2) - (E\ksi)^2$,
- * where D is dispersion, E is expected number, $\ksi$ is number of elements
- * in the bucket
- * If the distribution is uniform, k is number of buckets,
- * n is total number of elements, $\ksi_i$ is number of elements in the bucket,
- * $D\ksi = \frac{\[ \sum_{i=1}^{k} \ksi_i \]}{k} - (\frac{n}{k})^2$
+ * @details The dispersion and the chain lengths are taken from
+ * HashTableGetStats()
  */
-static double
-CalculateDispersion (const hash_table_t* const table);
+static void
+PrintResults (const hash_table_t* const table);
 
 
 /**
@@ -81,6 +142,92 @@ GetBucketElemNumber (const hash_table_bucket* const bucket);
 
 
 
+//-----------------------------------------------------------------------------
+// Quality static functions prototypes
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Evaluates every function of GetHashFunctionPointer()
+ * and prints one comparison table
+ *
+ * @param text_filename Name of the text, its unique words are the keys
+ * @param buckets_number Number of buckets for the chi-squared
+ */
+static void
+CompareHashFunctions (const char* const text_filename,
+                      const size_t buckets_number);
+
+
+/**
+ * @brief Gets pointers to the keys of the table nodes
+ *
+ * @retval Array of table->elem_number keys, valid while the table is
+ */
+static hash_table_key**
+CollectKeys (const hash_table_t* const table);
+
+
+/**
+ * @brief Computes the uniformity and the collisions on the given keys
+ *
+ * @details The bucket of a key is its full hash modulo buckets_number,
+ * as the table takes it
+ */
+static void
+MeasureDistribution (hash_quality* const quality,
+                     hash_function h_func,
+                     hash_table_key** const keys,
+                     const size_t keys_number,
+                     const size_t buckets_number);
+
+
+/**
+ * @brief Flips every bit of random keys and computes the avalanche
+ * and the bit independence of the quality->output_bits hash bits
+ */
+static void
+MeasureAvalanche (hash_quality* const quality,
+                  hash_function h_func);
+
+
+/**
+ * @brief Measures the hashing speed of the short, medium and long keys
+ */
+static void
+MeasureSpeed (hash_quality* const quality,
+              hash_function h_func);
+
+
+/**
+ * @brief Prints the table header and one line for every function
+ */
+static void
+PrintQualityTable (const hash_quality* const qualities,
+                   const size_t functions_number,
+                   const size_t keys_number,
+                   const size_t buckets_number);
+
+
+/**
+ * @brief Compares two hashes for qsort()
+ */
+static int
+CompareHashes (const void* const hash1,
+               const void* const hash2);
+
+
+/**
+ * @brief Returns cycle counter ticks if the target has one,
+ * monotonic nanoseconds otherwise
+ */
+static uint64_t
+GetTicks (void);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
 //-----------------------------------------------------------------------------
 // Output static functions implementation
 //-----------------------------------------------------------------------------
@@ -91,53 +238,378 @@ PrintResults (const hash_table_t* const table)
     assert (table);
 
     PrintBucketsCountArray (table);
-    fprintf (stderr, "Dispersion %lf\n", CalculateDispersion (table));
+
+    hash_table_stats stats = {0};
+    HashTableGetStats (table, &stats);
+
+    fprintf (stderr, "Dispersion %lf\n", stats.variance);
+    fprintf (stderr, "Load factor %lf, mean chain %lf, max chain %zu, "
+                     "empty buckets %zu\n",
+             stats.load_factor, stats.mean_chain, stats.max_chain,
+             stats.empty_buckets);
 }
 
 
-static double
-CalculateDispersion (const hash_table_t* const table)
+static void
+PrintBucketsCountArray (const hash_table_t* const table)
 {
     assert (table);
+    assert (table->buckets);
 
     const size_t buckets_number = table->buckets_num;
-    size_t cur_bucket_count     = 0;
-    size_t sum_of_squares       = 0;
-
     hash_table_bucket** buckets_array = table->buckets;
 
     for (size_t i = 0; i < buckets_number; ++i)
+        printf ("%zu %zu\n", i, GetBucketElemNumber (buckets_array[i]));
+}
+
+
+static size_t
+GetBucketElemNumber (const hash_table_bucket* const bucket)
+{
+    if (bucket == NULL) return 0;
+    return bucket->elem_number;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Quality static functions implementation
+//-----------------------------------------------------------------------------
+
+static void
+CompareHashFunctions (const char* const text_filename,
+                      const size_t buckets_number)
+{
+    assert (text_filename);
+    assert (buckets_number > 0);
+
+    // unique words of the text, the table hash function does not matter
+    hash_table_t* table = FillHashTable (text_filename, buckets_number,
+                                         HashFunctionCrc32);
+    assert (table);
+
+    hash_table_key** const keys = CollectKeys (table);
+    const size_t keys_number = table->elem_number;
+
+    size_t functions_number = 0;
+    while (GetHashFunctionPointer (functions_number) != NULL)
+        ++functions_number;
+
+    hash_quality* const qualities = calloc (functions_number,
+                                            sizeof (hash_quality));
+    assert (qualities);
+
+    for (size_t i = 0; i < functions_number; ++i)
     {
-        cur_bucket_count = GetBucketElemNumber (buckets_array[i]);
-        sum_of_squares  += cur_bucket_count * cur_bucket_count;
+        hash_function h_func = GetHashFunctionPointer (i);
+
+        MeasureDistribution (qualities + i, h_func, keys, keys_number,
+                             buckets_number);
+        MeasureAvalanche    (qualities + i, h_func);
+        MeasureSpeed        (qualities + i, h_func);
     }
 
-    const double exp_value = (double) table->elem_number / buckets_number;
-    const double exp_value_squares = (double) sum_of_squares / buckets_number;
+    PrintQualityTable (qualities, functions_number, keys_number, buckets_number);
 
-    return exp_value_squares - exp_value * exp_value;
+    free (qualities);
+    free (keys);
+    table = HashTableDestructor (table);
 }
 
 
-static void
-PrintBucketsCountArray (const hash_table_t* const table)
+static hash_table_key**
+CollectKeys (const hash_table_t* const table)
 {
     assert (table);
-    assert (table->buckets);
 
-    const size_t buckets_number = table->buckets_num;
-    hash_table_bucket** buckets_array = table->buckets;
+    hash_table_key** const keys = calloc (table->elem_number + 1,
+                                          sizeof (hash_table_key*));
+    assert (keys);
+
+    size_t keys_number = 0;
+
+    for (size_t i = 0; i < table->buckets_num; ++i)
+    {
+        const hash_table_bucket* const bucket = table->buckets[i];
+        if (bucket == NULL) continue;
+
+        const hash_table_node* node = bucket->head;
+        for (size_t j = 0; j < bucket->elem_number; ++j, node = node->next)
+            keys[keys_number++] = node->key;
+    }
+
+    assert (keys_number == table->elem_number);
+    return keys;
+}
+
+
+static void
+MeasureDistribution (hash_quality* const quality,
+                     hash_function h_func,
+                     hash_table_key** const keys,
+                     const size_t keys_number,
+                     const size_t buckets_number)
+{
+    assert (quality);
+    assert (h_func);
+    assert (keys);
+
+    size_t* const counts = calloc (buckets_number, sizeof (size_t));
+    size_t* const hashes = calloc (keys_number + 1, sizeof (size_t));
+    assert (counts);
+    assert (hashes);
+
+    size_t all_bits = 0;
+
+    for (size_t i = 0; i < keys_number; ++i)
+    {
+        hashes[i] = h_func (keys[i], HASH_TABLE_FULL_RANGE);
+        all_bits |= hashes[i];
+        ++counts[hashes[i] % buckets_number];
+    }
+
+    const double expected = (double) keys_number / buckets_number;
+    double chi_squared = 0;
 
     for (size_t i = 0; i < buckets_number; ++i)
-        printf ("%zu %zu\n", i, GetBucketElemNumber (buckets_array[i]));
+        chi_squared += (counts[i] - expected) * (counts[i] - expected) / expected;
+
+    quality->chi_squared = (buckets_number > 1) ?
+                           chi_squared / (buckets_number - 1) : 0.0;
+
+    qsort (hashes, keys_number, sizeof (size_t), CompareHashes);
+
+    quality->collisions = 0;
+    for (size_t i = 1; i < keys_number; ++i)
+        quality->collisions += hashes[i] == hashes[i - 1];
+
+    quality->output_bits = 0;
+    while (quality->output_bits < TEST_HASH_FUNCTION_OUTPUT_BITS &&
+           (all_bits >> quality->output_bits) != 0)
+        ++quality->output_bits;
+
+    free (counts);
+    free (hashes);
 }
 
 
-static size_t
-GetBucketElemNumber (const hash_table_bucket* const bucket)
+static void
+MeasureAvalanche (hash_quality* const quality,
+                  hash_function h_func)
 {
-    if (bucket == NULL) return 0;
-    return bucket->elem_number;
+    assert (quality);
+    assert (h_func);
+
+    const size_t bits = quality->output_bits;
+    const size_t keys_number = TEST_HASH_FUNCTION_AVALANCHE_KEYS;
+
+    quality->avalanche       = 1.0;
+    quality->worst_avalanche = 1.0;
+    quality->independence    = 1.0;
+    if (bits == 0) return;
+
+    const size_t mask = (bits == TEST_HASH_FUNCTION_OUTPUT_BITS) ?
+                        SIZE_MAX : ((size_t) 1 << bits) - 1;
+
+    // flips[i][j] - output bit j flipped by input bit i,
+    // pairs[i][j][k] - output bits j < k flipped together by input bit i
+    size_t (*flips)[TEST_HASH_FUNCTION_OUTPUT_BITS] =
+        calloc (TEST_HASH_FUNCTION_INPUT_BITS, sizeof (*flips));
+    size_t (*pairs)[TEST_HASH_FUNCTION_OUTPUT_BITS][TEST_HASH_FUNCTION_OUTPUT_BITS] =
+        calloc (TEST_HASH_FUNCTION_INPUT_BITS, sizeof (*pairs));
+    assert (flips);
+    assert (pairs);
+
+    unsigned char key_buffer[TEST_HASH_FUNCTION_AVALANCHE_KEY_SIZE] = {0};
+    hash_table_key key = {.key = key_buffer, .key_size = sizeof (key_buffer)};
+    uint64_t state = TEST_HASH_FUNCTION_SEED;
+
+    for (size_t sample = 0; sample < keys_number; ++sample)
+    {
+        for (size_t i = 0; i < sizeof (key_buffer); ++i)
+            key_buffer[i] = (unsigned char) NextRandom (&state);
+
+        const size_t hash = h_func (&key, HASH_TABLE_FULL_RANGE) & mask;
+
+        for (size_t i = 0; i < TEST_HASH_FUNCTION_INPUT_BITS; ++i)
+        {
+            key_buffer[i / 8] ^= (unsigned char) (1 << (i % 8));
+            size_t flipped = (h_func (&key, HASH_TABLE_FULL_RANGE) & mask) ^ hash;
+            key_buffer[i / 8] ^= (unsigned char) (1 << (i % 8));
+
+            while (flipped != 0)
+            {
+                const size_t j = (size_t) __builtin_ctzll (flipped);
+                flipped &= flipped - 1;
+
+                ++flips[i][j];
+                for (size_t rest = flipped; rest != 0; rest &= rest - 1)
+                    ++pairs[i][j][__builtin_ctzll (rest)];
+            }
+        }
+    }
+
+    double bias_sum = 0;
+    int    pairs_found = 0;
+    quality->worst_avalanche = 0;
+    quality->independence    = 0;
+
+    for (size_t i = 0; i < TEST_HASH_FUNCTION_INPUT_BITS; ++i)
+    {
+        for (size_t j = 0; j < bits; ++j)
+        {
+            const double bias = fabs (2.0 * flips[i][j] / keys_number - 1.0);
+
+            bias_sum += bias;
+            if (bias > quality->worst_avalanche) quality->worst_avalanche = bias;
+
+            // the bits that always or never flip are counted by the avalanche
+            for (size_t k = j + 1; k < bits; ++k)
+            {
+                const double flips_j = (double) flips[i][j];
+                const double flips_k = (double) flips[i][k];
+                const double spread  = flips_j * (keys_number - flips_j) *
+                                       flips_k * (keys_number - flips_k);
+                if (!(spread > 0)) continue;
+
+                pairs_found = 1;
+                const double correlation =
+                    fabs (keys_number * (double) pairs[i][j][k] - flips_j * flips_k) /
+                    sqrt (spread);
+
+                if (correlation > quality->independence)
+                    quality->independence = correlation;
+            }
+        }
+    }
+
+    quality->avalanche = bias_sum / (TEST_HASH_FUNCTION_INPUT_BITS * bits);
+
+    // no two bits flip at random, nothing to be independent
+    if (!pairs_found) quality->independence = 1.0;
+
+    free (flips);
+    free (pairs);
+}
+
+
+static void
+MeasureSpeed (hash_quality* const quality,
+              hash_function h_func)
+{
+    assert (quality);
+    assert (h_func);
+
+    const size_t sizes_number = sizeof (TEST_HASH_FUNCTION_SPEED_SIZES) /
+                                sizeof (TEST_HASH_FUNCTION_SPEED_SIZES[0]);
+    const size_t max_size = TEST_HASH_FUNCTION_SPEED_SIZES[sizes_number - 1];
+
+    unsigned char* const buffer = calloc (max_size, sizeof (unsigned char));
+    assert (buffer);
+
+    uint64_t state = TEST_HASH_FUNCTION_SEED;
+    for (size_t i = 0; i < max_size; ++i)
+        buffer[i] = (unsigned char) ('a' + NextRandom (&state) % 26);
+
+    for (size_t i = 0; i < sizes_number; ++i)
+    {
+        const size_t key_size = TEST_HASH_FUNCTION_SPEED_SIZES[i];
+        const size_t repeats  = TEST_HASH_FUNCTION_SPEED_BYTES / key_size;
+
+        hash_table_key key = {.key = buffer, .key_size = key_size};
+        volatile size_t sink = 0;
+
+        const uint64_t begin = GetTicks ();
+
+        // the first byte changes, so the calls are not merged
+        for (size_t j = 0; j < repeats; ++j)
+        {
+            buffer[0] = (unsigned char) j;
+            sink += h_func (&key, HASH_TABLE_FULL_RANGE);
+        }
+
+        quality->speed[i] = (double) (GetTicks () - begin) /
+                            (repeats * key_size);
+        (void) sink;
+    }
+
+    free (buffer);
+}
+
+
+static void
+PrintQualityTable (const hash_quality* const qualities,
+                   const size_t functions_number,
+                   const size_t keys_number,
+                   const size_t buckets_number)
+{
+    assert (qualities);
+
+    const size_t sizes_number = sizeof (TEST_HASH_FUNCTION_SPEED_SIZES) /
+                                sizeof (TEST_HASH_FUNCTION_SPEED_SIZES[0]);
+
+    printf ("%zu keys, %zu buckets, %zu random %d-byte avalanche keys, "
+            "speed in %s\n\n", keys_number, buckets_number,
+            TEST_HASH_FUNCTION_AVALANCHE_KEYS,
+            TEST_HASH_FUNCTION_AVALANCHE_KEY_SIZE,
+            TEST_HASH_FUNCTION_SPEED_UNIT);
+
+    printf ("%-12s %4s %10s %10s %9s %9s %9s",
+            "function", "bits", "chi2/dof", "collisions",
+            "avalanche", "worst", "bic");
+
+    for (size_t i = 0; i < sizes_number; ++i)
+        printf (" %6zu B", TEST_HASH_FUNCTION_SPEED_SIZES[i]);
+
+    printf ("\n");
+
+    for (size_t i = 0; i < functions_number; ++i)
+    {
+        const hash_quality* const quality = qualities + i;
+
+        printf ("%-12s %4zu %10.3lf %10zu %9.4lf %9.4lf %9.4lf",
+                GetHashFunctionName (i), quality->output_bits,
+                quality->chi_squared, quality->collisions,
+                quality->avalanche, quality->worst_avalanche,
+                quality->independence);
+
+        for (size_t j = 0; j < sizes_number; ++j)
+            printf (" %8.3lf", quality->speed[j]);
+
+        printf ("\n");
+    }
+}
+
+
+static int
+CompareHashes (const void* const hash1,
+               const void* const hash2)
+{
+    assert (hash1);
+    assert (hash2);
+
+    const size_t first  = *(const size_t*) hash1;
+    const size_t second = *(const size_t*) hash2;
+
+    return (first > second) - (first < second);
+}
+
+
+static uint64_t
+GetTicks (void)
+{
+#if defined (__x86_64__) || defined (__i386__)
+    return __rdtsc ();
+#else
+    struct timespec time = {0};
+    clock_gettime (CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000000000 + (uint64_t) time.tv_nsec;
+#endif
 }
 
 //-----------------------------------------------------------------------------
@@ -151,9 +623,24 @@ GetBucketElemNumber (const hash_table_bucket* const bucket)
 
 int main (const int argc, const char** const argv)
 {
-    assert (argc == TEST_HASH_FUNCTION_ARGS_NUMBER);
     assert (argv);
 
+    if (argc != TEST_HASH_FUNCTION_ARGS_NUMBER &&
+        argc != TEST_HASH_FUNCTION_QUALITY_ARGS_NUMBER)
+    {
+        fprintf (stderr, "usage: %s text_file buckets_number [hash_function_index]\n"
+                         "without the index all the functions are compared\n",
+                 argv[0]);
+        return 1;
+    }
+
+    if (argc == TEST_HASH_FUNCTION_QUALITY_ARGS_NUMBER)
+    {
+        CompareHashFunctions (argv[TEST_HASH_FUNCTION_TEXT_ARG],
+                              atoll (argv[TEST_HASH_FUNCTION_BUCKETS_NUMBER_ARG]));
+        return 0;
+    }
+
     const size_t buckets_number =
         atoll (argv[TEST_HASH_FUNCTION_BUCKETS_NUMBER_ARG]);
 
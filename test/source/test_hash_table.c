@@ -0,0 +1,933 @@
+#include "common.h"
+#include "disk_hash_table.h"
+#include "hash_table_snapshot.h"
+#include "hash_table_wal.h"
+#include <assert.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+
+//-----------------------------------------------------------------------------
+// Consts
+//-----------------------------------------------------------------------------
+
+/// @brief Buckets of the tested tables
+static const size_t TEST_TABLE_BUCKETS = 64;
+
+
+/// @brief File of the tested disk tables, removed after every test
+static const char* const TEST_DISK_FILE = "test_disk_table.bin";
+
+
+/// @brief Keys number of the disk table tests
+static const size_t TEST_DISK_KEYS = 2000;
+
+
+/// @brief Files of the tested logs and snapshots, removed after every test
+static const char* const TEST_LOG_FILE      = "test_table.log";
+static const char* const TEST_SNAPSHOT_FILE = "test_table.snapshot";
+
+
+/// @brief Keys number of the log tests
+static const size_t TEST_LOG_KEYS = 100;
+
+
+/// @brief Values of every multimap key, the values array grows through
+/// the capacities 1, 2, 4 and 8
+static const size_t TEST_MULTIMAP_VALUES = 9;
+
+
+/// @brief Maximum elements of the LRU tests
+static const size_t TEST_LRU_ELEMS = 3;
+
+
+/// @brief Size of the key buffers of the tests
+#define TEST_KEY_SIZE 16
+
+
+/// @brief Value size leaving two records in a page, so the pages often split
+/// with every record on one side
+#define TEST_DISK_VALUE_SIZE 1500
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static structures
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Test of the table behaviour
+ */
+typedef
+struct table_test
+{
+    const char* name;       ///< name of the test in the report
+    int (*run) (void);      ///< 1 if passed, 0 after printing the failed check
+}
+table_test;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static variables
+//-----------------------------------------------------------------------------
+
+/// @brief Time of FakeClock()
+static uint64_t fake_now = 0;
+
+
+/// @brief Number of FakeClock() calls
+static size_t fake_clock_calls = 0;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Test static functions prototypes
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Finds of the table that is only read miss the expired keys
+ */
+static int
+TestTtlFindAfterExpiry (void);
+
+
+/**
+ * @brief Insert with ttl 0 makes the present key never expire,
+ * the plain insert keeps its expiration
+ */
+static int
+TestTtlZeroClears (void);
+
+
+/**
+ * @brief Disk table with the values of 1500 bytes finds every inserted key
+ */
+static int
+TestDiskLargeValues (void);
+
+
+/**
+ * @brief The table recovered from the snapshot and the log after inserts,
+ * deletes and a compaction has the same keys and values
+ */
+static int
+TestWalReplayRoundTrip (void);
+
+
+/**
+ * @brief Replay cuts off the torn last record and applies the others
+ */
+static int
+TestWalTornTail (void);
+
+
+/**
+ * @brief After a failed write every change of the log fails
+ */
+static int
+TestWalFailed (void);
+
+
+/**
+ * @brief Map, set and multimap are found in the loaded snapshot and in the
+ * table made of it with the saved values
+ */
+static int
+TestSnapshotRoundTrip (void);
+
+
+/**
+ * @brief Load refuses the snapshot with a broken magic or a cut file
+ */
+static int
+TestSnapshotCorruptedHeader (void);
+
+
+/**
+ * @brief LRU table evicts the least recently inserted or found key
+ */
+static int
+TestLruEvictionOrder (void);
+
+
+/**
+ * @brief Multimap keeps the values of every key in the insertion order
+ */
+static int
+TestMultimapValuesOrder (void);
+
+
+/**
+ * @brief Saves the table of the mode with TEST_LOG_KEYS keys, loads it and
+ * checks the snapshot and the table made of it
+ *
+ * @retval 1 if passed
+ * @retval 0 after printing the failed check
+ */
+static int
+SnapshotRoundTrip (const hash_table_mode mode);
+
+
+/**
+ * @brief Checks the values of the key of the index saved by
+ * SnapshotRoundTrip(): none for the set, the index times
+ * TEST_MULTIMAP_VALUES for the map and the following ones for the multimap
+ *
+ * @retval 1 if the values are right
+ * @retval 0 after printing the failed check
+ */
+static int
+CheckTestValues (const hash_table_mode mode,
+                 const void* const values,
+                 const size_t values_size,
+                 const size_t index);
+
+
+/**
+ * @brief Writes "key<index>" into the buffer of TEST_KEY_SIZE bytes
+ */
+static void
+SetTestKey (hash_table_key* const key,
+            char* const key_buffer,
+            const size_t index);
+
+
+/**
+ * @brief Clock of the tests, returns fake_now
+ */
+static uint64_t
+FakeClock (void);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Test static functions implementation
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Fails the test if the condition is false
+ */
+#define TEST_CHECK(condition)                                               \
+    do                                                                      \
+    {                                                                       \
+        if (!(condition))                                                   \
+        {                                                                   \
+            fprintf (stderr, "%s:%d: %s failed\n",                          \
+                     __FILE__, __LINE__, #condition);                       \
+            return 0;                                                       \
+        }                                                                   \
+    }                                                                       \
+    while (0)
+
+
+static int
+TestTtlFindAfterExpiry (void)
+{
+    hash_table_t* const table = HashTableConstructor (TEST_TABLE_BUCKETS,
+                                                      HashFunctionCrc32);
+    TEST_CHECK (table != NULL);
+
+    fake_now = 0;
+    TEST_CHECK (HashTableSetTtl (table, FakeClock) == HASH_TABLE_SUCCESS);
+
+    char expiring_buffer[] = "session";
+    char lasting_buffer[]  = "config";
+    hash_table_key expiring = {.key = expiring_buffer, .key_size = 7};
+    hash_table_key lasting  = {.key = lasting_buffer,  .key_size = 6};
+
+    TEST_CHECK (HashTableInsertTtl (table, &expiring, NULL, KeyCmpFunction,
+                                    10) == HASH_TABLE_SUCCESS);
+    TEST_CHECK (HashTableInsert (table, &lasting, NULL, KeyCmpFunction) ==
+                HASH_TABLE_SUCCESS);
+
+    fake_now = 9;
+    TEST_CHECK (HashTableFind (table, &expiring, KeyCmpFunction) != NULL);
+
+    // the keys without the time to live do not read the clock
+    fake_clock_calls = 0;
+    TEST_CHECK (HashTableFind (table, &lasting, KeyCmpFunction) != NULL);
+    TEST_CHECK (fake_clock_calls == 0);
+
+    // nothing but finds after the expiration
+    fake_now = 1000000;
+    TEST_CHECK (HashTableFind (table, &expiring, KeyCmpFunction) == NULL);
+    TEST_CHECK (HashTableFind (table, &lasting,  KeyCmpFunction) != NULL);
+    TEST_CHECK (table->elem_number == 1);
+
+    HashTableDestructor (table);
+    return 1;
+}
+
+
+static int
+TestTtlZeroClears (void)
+{
+    hash_table_t* const table = HashTableConstructor (TEST_TABLE_BUCKETS,
+                                                      HashFunctionCrc32);
+    TEST_CHECK (table != NULL);
+
+    fake_now = 0;
+    TEST_CHECK (HashTableSetTtl (table, FakeClock) == HASH_TABLE_SUCCESS);
+
+    char cleared_buffer[] = "cleared";
+    char kept_buffer[]    = "kept";
+    hash_table_key cleared = {.key = cleared_buffer, .key_size = 7};
+    hash_table_key kept    = {.key = kept_buffer,    .key_size = 4};
+
+    TEST_CHECK (HashTableInsertTtl (table, &cleared, NULL, KeyCmpFunction,
+                                    10) == HASH_TABLE_SUCCESS);
+    TEST_CHECK (HashTableInsertTtl (table, &kept, NULL, KeyCmpFunction,
+                                    10) == HASH_TABLE_SUCCESS);
+
+    TEST_CHECK (HashTableInsertTtl (table, &cleared, NULL, KeyCmpFunction,
+                                    0) == HASH_TABLE_SUCCESS);
+    TEST_CHECK (HashTableInsert (table, &kept, NULL, KeyCmpFunction) ==
+                HASH_TABLE_SUCCESS);
+
+    fake_now = 1000000;
+    TEST_CHECK (HashTableExpire (table, 0) == 1);
+    TEST_CHECK (HashTableFind (table, &cleared, KeyCmpFunction) != NULL);
+    TEST_CHECK (HashTableFind (table, &kept,    KeyCmpFunction) == NULL);
+    TEST_CHECK (table->elem_number == 1);
+
+    HashTableDestructor (table);
+    return 1;
+}
+
+
+static int
+TestDiskLargeValues (void)
+{
+    unlink (TEST_DISK_FILE);
+
+    disk_hash_table* table = DiskHashTableConstructor (TEST_DISK_FILE,
+                                                       HashFunctionCrc32, 0);
+    TEST_CHECK (table != NULL);
+
+    char key_buffer[TEST_KEY_SIZE] = "";
+    char value_buffer[TEST_DISK_VALUE_SIZE] = "";
+
+    hash_table_key   key   = {};
+    hash_table_value value = {.value = value_buffer,
+                              .value_size = TEST_DISK_VALUE_SIZE};
+
+    for (size_t i = 0; i < TEST_DISK_KEYS; ++i)
+    {
+        SetTestKey (&key, key_buffer, i);
+        memset (value_buffer, (int) (i & 0xFF), TEST_DISK_VALUE_SIZE);
+
+        TEST_CHECK (DiskHashTableInsert (table, &key, &value, KeyCmpFunction)
+                    == HASH_TABLE_SUCCESS);
+    }
+
+    for (size_t i = 0; i < TEST_DISK_KEYS; ++i)
+    {
+        SetTestKey (&key, key_buffer, i);
+
+        hash_table_value found = {};
+        TEST_CHECK (DiskHashTableFind (table, &key, KeyCmpFunction, &found)
+                    == HASH_TABLE_SUCCESS);
+        TEST_CHECK (found.value_size == TEST_DISK_VALUE_SIZE);
+        TEST_CHECK (((const unsigned char*) found.value)[0] == (i & 0xFF));
+    }
+
+    table = DiskHashTableDestructor (table);
+    unlink (TEST_DISK_FILE);
+
+    return 1;
+}
+
+
+static int
+TestWalReplayRoundTrip (void)
+{
+    unlink (TEST_LOG_FILE);
+    unlink (TEST_SNAPSHOT_FILE);
+
+    hash_table_t* table = HashTableConstructor (TEST_TABLE_BUCKETS,
+                                                HashFunctionCrc32);
+    TEST_CHECK (table != NULL);
+
+    hash_table_wal* wal = HashTableWalConstructor (TEST_LOG_FILE, table,
+                                                   KeyCmpFunction,
+                                                   HASH_TABLE_WAL_SYNC);
+    TEST_CHECK (wal != NULL);
+
+    char key_buffer[TEST_KEY_SIZE] = "";
+    hash_table_key key = {};
+
+    // the first half goes to the snapshot, the second one to the new log
+    for (size_t half = 0; half < 2; ++half)
+    {
+        for (size_t i = half * TEST_LOG_KEYS; i < (half + 1) * TEST_LOG_KEYS;
+             ++i)
+        {
+            size_t value_buffer = i;
+            hash_table_value value = {.value      = &value_buffer,
+                                      .value_size = sizeof (value_buffer)};
+
+            SetTestKey (&key, key_buffer, i);
+            TEST_CHECK (HashTableWalInsert (wal, &key, &value) ==
+                        HASH_TABLE_SUCCESS);
+        }
+
+        for (size_t i = half * TEST_LOG_KEYS; i < (half + 1) * TEST_LOG_KEYS;
+             i += 3)
+        {
+            SetTestKey (&key, key_buffer, i);
+            TEST_CHECK (HashTableWalDelete (wal, &key) == HASH_TABLE_SUCCESS);
+        }
+
+        if (half == 0)
+            TEST_CHECK (HashTableWalCompact (wal, TEST_SNAPSHOT_FILE) ==
+                        HASH_TABLE_SUCCESS);
+    }
+
+    wal = HashTableWalDestructor (wal);
+
+    hash_table_snapshot* snapshot = HashTableLoad (TEST_SNAPSHOT_FILE,
+                                                   HashFunctionCrc32);
+    TEST_CHECK (snapshot != NULL);
+
+    hash_table_t* recovered = HashTableSnapshotToTable (snapshot,
+                                                        KeyCmpFunction);
+    snapshot = HashTableSnapshotDestructor (snapshot);
+    TEST_CHECK (recovered != NULL);
+
+    size_t records = 0;
+    TEST_CHECK (HashTableWalReplay (TEST_LOG_FILE, recovered, KeyCmpFunction,
+                                    &records) == HASH_TABLE_SUCCESS);
+
+    // the inserts and the deletes of every third key of the second half
+    TEST_CHECK (records == TEST_LOG_KEYS + (TEST_LOG_KEYS + 2) / 3);
+    TEST_CHECK (recovered->elem_number == table->elem_number);
+
+    for (size_t i = 0; i < 2 * TEST_LOG_KEYS; ++i)
+    {
+        SetTestKey (&key, key_buffer, i);
+
+        const hash_table_node* const node =
+            HashTableFind (recovered, &key, KeyCmpFunction);
+
+        // every third key of each half is deleted
+        if ((i % TEST_LOG_KEYS) % 3 == 0)
+        {
+            TEST_CHECK (node == NULL);
+            continue;
+        }
+
+        TEST_CHECK (node != NULL);
+        TEST_CHECK (node->value->value_size == sizeof (size_t));
+        TEST_CHECK (*(const size_t*) node->value->value == i);
+    }
+
+    recovered = HashTableDestructor (recovered);
+    table     = HashTableDestructor (table);
+
+    unlink (TEST_LOG_FILE);
+    unlink (TEST_SNAPSHOT_FILE);
+
+    return 1;
+}
+
+
+static int
+TestWalTornTail (void)
+{
+    unlink (TEST_LOG_FILE);
+
+    hash_table_t* table = HashTableConstructor (TEST_TABLE_BUCKETS,
+                                                HashFunctionCrc32);
+    TEST_CHECK (table != NULL);
+
+    hash_table_wal* wal = HashTableWalConstructor (TEST_LOG_FILE, table,
+                                                   KeyCmpFunction,
+                                                   HASH_TABLE_WAL_NO_SYNC);
+    TEST_CHECK (wal != NULL);
+
+    char key_buffer[TEST_KEY_SIZE] = "";
+    hash_table_key key = {};
+
+    for (size_t i = 0; i < TEST_LOG_KEYS; ++i)
+    {
+        SetTestKey (&key, key_buffer, i);
+        TEST_CHECK (HashTableWalInsert (wal, &key, NULL) == HASH_TABLE_SUCCESS);
+    }
+
+    wal   = HashTableWalDestructor (wal);
+    table = HashTableDestructor (table);
+
+    // a crash in the middle of the last record
+    struct stat log_stat = {};
+    TEST_CHECK (stat (TEST_LOG_FILE, &log_stat) == 0);
+
+    const off_t torn_size = log_stat.st_size - 1;
+    TEST_CHECK (truncate (TEST_LOG_FILE, torn_size) == 0);
+
+    off_t replayed_size = 0;
+
+    for (size_t replay = 0; replay < 2; ++replay)
+    {
+        table = HashTableConstructor (TEST_TABLE_BUCKETS, HashFunctionCrc32);
+        TEST_CHECK (table != NULL);
+
+        size_t records = 0;
+        TEST_CHECK (HashTableWalReplay (TEST_LOG_FILE, table, KeyCmpFunction,
+                                        &records) == HASH_TABLE_SUCCESS);
+        TEST_CHECK (records            == TEST_LOG_KEYS - 1);
+        TEST_CHECK (table->elem_number == TEST_LOG_KEYS - 1);
+
+        SetTestKey (&key, key_buffer, TEST_LOG_KEYS - 1);
+        TEST_CHECK (HashTableFind (table, &key, KeyCmpFunction) == NULL);
+
+        table = HashTableDestructor (table);
+
+        // the first replay cuts off the torn bytes, the second one keeps all
+        TEST_CHECK (stat (TEST_LOG_FILE, &log_stat) == 0);
+        TEST_CHECK (log_stat.st_size < torn_size);
+
+        if (replay == 0) replayed_size = log_stat.st_size;
+        TEST_CHECK (log_stat.st_size == replayed_size);
+    }
+
+    unlink (TEST_LOG_FILE);
+
+    return 1;
+}
+
+
+static int
+TestWalFailed (void)
+{
+    hash_table_t* table = HashTableConstructor (TEST_TABLE_BUCKETS,
+                                                HashFunctionCrc32);
+    TEST_CHECK (table != NULL);
+
+    // every write to /dev/full fails with ENOSPC
+    hash_table_wal* wal = HashTableWalConstructor ("/dev/full", table,
+                                                   KeyCmpFunction,
+                                                   HASH_TABLE_WAL_SYNC);
+    TEST_CHECK (wal != NULL);
+
+    char key_buffer[TEST_KEY_SIZE] = "";
+    hash_table_key key = {};
+
+    SetTestKey (&key, key_buffer, 0);
+    TEST_CHECK (HashTableWalInsert (wal, &key, NULL) == HASH_TABLE_ERROR);
+
+    // the table keeps the change, which may be in the log or not
+    TEST_CHECK (HashTableFind (table, &key, KeyCmpFunction) != NULL);
+
+    TEST_CHECK (HashTableWalDelete (wal, &key) == HASH_TABLE_ERROR);
+    TEST_CHECK (HashTableFind (table, &key, KeyCmpFunction) != NULL);
+
+    SetTestKey (&key, key_buffer, 1);
+    TEST_CHECK (HashTableWalInsert (wal, &key, NULL) == HASH_TABLE_ERROR);
+    TEST_CHECK (HashTableFind (table, &key, KeyCmpFunction) == NULL);
+
+    TEST_CHECK (HashTableWalCompact (wal, TEST_SNAPSHOT_FILE) ==
+                HASH_TABLE_ERROR);
+
+    wal   = HashTableWalDestructor (wal);
+    table = HashTableDestructor (table);
+
+    return 1;
+}
+
+
+static int
+TestSnapshotRoundTrip (void)
+{
+    static const hash_table_mode modes[] =
+    {
+        HASH_TABLE_MAP,
+        HASH_TABLE_SET,
+        HASH_TABLE_MULTIMAP
+    };
+
+    for (size_t i = 0; i < sizeof (modes) / sizeof (modes[0]); ++i)
+        TEST_CHECK (SnapshotRoundTrip (modes[i]));
+
+    return 1;
+}
+
+
+static int
+TestSnapshotCorruptedHeader (void)
+{
+    unlink (TEST_SNAPSHOT_FILE);
+
+    hash_table_t* table = HashTableConstructor (TEST_TABLE_BUCKETS,
+                                                HashFunctionCrc32);
+    TEST_CHECK (table != NULL);
+
+    char key_buffer[TEST_KEY_SIZE] = "";
+    hash_table_key key = {};
+
+    for (size_t i = 0; i < TEST_LOG_KEYS; ++i)
+    {
+        SetTestKey (&key, key_buffer, i);
+        TEST_CHECK (HashTableInsert (table, &key, NULL, KeyCmpFunction) ==
+                    HASH_TABLE_SUCCESS);
+    }
+
+    TEST_CHECK (HashTableSave (table, TEST_SNAPSHOT_FILE) == HASH_TABLE_SUCCESS);
+
+    hash_table_snapshot* snapshot = HashTableLoad (TEST_SNAPSHOT_FILE,
+                                                   HashFunctionCrc32);
+    TEST_CHECK (snapshot != NULL);
+    snapshot = HashTableSnapshotDestructor (snapshot);
+
+    // the first byte of the magic
+    FILE* const file = fopen (TEST_SNAPSHOT_FILE, "r+b");
+    TEST_CHECK (file != NULL);
+    TEST_CHECK (fputc ('X', file) != EOF);
+    TEST_CHECK (fclose (file) == 0);
+
+    TEST_CHECK (HashTableLoad (TEST_SNAPSHOT_FILE, HashFunctionCrc32) == NULL);
+
+    // the size differs from the saved one
+    TEST_CHECK (HashTableSave (table, TEST_SNAPSHOT_FILE) == HASH_TABLE_SUCCESS);
+
+    struct stat snapshot_stat = {};
+    TEST_CHECK (stat (TEST_SNAPSHOT_FILE, &snapshot_stat) == 0);
+    TEST_CHECK (truncate (TEST_SNAPSHOT_FILE, snapshot_stat.st_size - 8) == 0);
+
+    TEST_CHECK (HashTableLoad (TEST_SNAPSHOT_FILE, HashFunctionCrc32) == NULL);
+
+    table = HashTableDestructor (table);
+    unlink (TEST_SNAPSHOT_FILE);
+
+    return 1;
+}
+
+
+static int
+TestLruEvictionOrder (void)
+{
+    hash_table_t* const table = HashTableConstructor (TEST_TABLE_BUCKETS,
+                                                      HashFunctionCrc32);
+    TEST_CHECK (table != NULL);
+    TEST_CHECK (HashTableSetLru (table, TEST_LRU_ELEMS, 0) ==
+                HASH_TABLE_SUCCESS);
+
+    char key_buffer[TEST_KEY_SIZE] = "";
+    hash_table_key key = {};
+
+    // the recency list from the front is key2, key1, key0
+    for (size_t i = 0; i < TEST_LRU_ELEMS; ++i)
+    {
+        SetTestKey (&key, key_buffer, i);
+        TEST_CHECK (HashTableInsert (table, &key, NULL, KeyCmpFunction) ==
+                    HASH_TABLE_SUCCESS);
+    }
+
+    // key0, key2, key1
+    SetTestKey (&key, key_buffer, 0);
+    TEST_CHECK (HashTableFind (table, &key, KeyCmpFunction) != NULL);
+
+    // key3, key0, key2 after evicting key1
+    SetTestKey (&key, key_buffer, 3);
+    TEST_CHECK (HashTableInsert (table, &key, NULL, KeyCmpFunction) ==
+                HASH_TABLE_SUCCESS);
+
+    // key2, key3, key0
+    SetTestKey (&key, key_buffer, 2);
+    TEST_CHECK (HashTableInsert (table, &key, NULL, KeyCmpFunction) ==
+                HASH_TABLE_SUCCESS);
+
+    // key4, key2, key3 after evicting key0
+    SetTestKey (&key, key_buffer, 4);
+    TEST_CHECK (HashTableInsert (table, &key, NULL, KeyCmpFunction) ==
+                HASH_TABLE_SUCCESS);
+
+    hash_table_lru_stats stats = {0};
+    TEST_CHECK (HashTableLruStats (table, &stats) == HASH_TABLE_SUCCESS);
+    TEST_CHECK (stats.evictions == 2);
+    TEST_CHECK (table->elem_number == TEST_LRU_ELEMS);
+
+    static const int present[] = {0, 0, 1, 1, 1};
+
+    for (size_t i = 0; i < sizeof (present) / sizeof (present[0]); ++i)
+    {
+        SetTestKey (&key, key_buffer, i);
+        TEST_CHECK ((HashTableFind (table, &key, KeyCmpFunction) != NULL) ==
+                    present[i]);
+    }
+
+    HashTableDestructor (table);
+    return 1;
+}
+
+
+static int
+TestMultimapValuesOrder (void)
+{
+    hash_table_t* const table =
+        HashTableMultimapConstructor (TEST_TABLE_BUCKETS, HashFunctionCrc32,
+                                      sizeof (size_t));
+    TEST_CHECK (table != NULL);
+
+    char key_buffer[TEST_KEY_SIZE] = "";
+    hash_table_key key = {};
+
+    // the values of the two keys are appended in turn
+    for (size_t i = 0; i < TEST_MULTIMAP_VALUES; ++i)
+    {
+        for (size_t index = 0; index < 2; ++index)
+        {
+            size_t value_buffer = index * TEST_MULTIMAP_VALUES + i;
+            hash_table_value value = {.value      = &value_buffer,
+                                      .value_size = sizeof (value_buffer)};
+
+            SetTestKey (&key, key_buffer, index);
+            TEST_CHECK (HashTableInsert (table, &key, &value, KeyCmpFunction)
+                        == HASH_TABLE_SUCCESS);
+        }
+    }
+
+    TEST_CHECK (table->elem_number == 2);
+
+    for (size_t index = 0; index < 2; ++index)
+    {
+        SetTestKey (&key, key_buffer, index);
+
+        const hash_table_node* const node =
+            HashTableFind (table, &key, KeyCmpFunction);
+        TEST_CHECK (node != NULL);
+
+        size_t values_number = 0;
+        const void* const values = HashTableNodeValues (table, node,
+                                                        &values_number);
+
+        TEST_CHECK (values != NULL);
+        TEST_CHECK (CheckTestValues (HASH_TABLE_MULTIMAP, values,
+                                     values_number * sizeof (size_t), index));
+    }
+
+    HashTableDestructor (table);
+    return 1;
+}
+
+
+static int
+SnapshotRoundTrip (const hash_table_mode mode)
+{
+    unlink (TEST_SNAPSHOT_FILE);
+
+    hash_table_t* table = (mode == HASH_TABLE_MULTIMAP) ?
+        HashTableMultimapConstructor (TEST_TABLE_BUCKETS, HashFunctionCrc32,
+                                      sizeof (size_t)) :
+        HashTableConstructorWithMode (TEST_TABLE_BUCKETS, HashFunctionCrc32,
+                                      mode);
+    TEST_CHECK (table != NULL);
+
+    const size_t values_number = (mode == HASH_TABLE_MULTIMAP) ?
+                                 TEST_MULTIMAP_VALUES : 1;
+
+    char key_buffer[TEST_KEY_SIZE] = "";
+    hash_table_key key = {};
+
+    for (size_t i = 0; i < TEST_LOG_KEYS; ++i)
+    {
+        SetTestKey (&key, key_buffer, i);
+
+        for (size_t j = 0; j < values_number; ++j)
+        {
+            size_t value_buffer = i * TEST_MULTIMAP_VALUES + j;
+            hash_table_value value = {.value      = &value_buffer,
+                                      .value_size = sizeof (value_buffer)};
+
+            TEST_CHECK (HashTableInsert (table, &key,
+                                         (mode == HASH_TABLE_SET) ? NULL : &value,
+                                         KeyCmpFunction) == HASH_TABLE_SUCCESS);
+        }
+    }
+
+    TEST_CHECK (HashTableSave (table, TEST_SNAPSHOT_FILE) == HASH_TABLE_SUCCESS);
+    table = HashTableDestructor (table);
+
+    hash_table_snapshot* snapshot = HashTableLoad (TEST_SNAPSHOT_FILE,
+                                                   HashFunctionCrc32);
+    TEST_CHECK (snapshot != NULL);
+    TEST_CHECK (HashTableSnapshotSize (snapshot) == TEST_LOG_KEYS);
+
+    for (size_t i = 0; i < TEST_LOG_KEYS; ++i)
+    {
+        SetTestKey (&key, key_buffer, i);
+
+        hash_table_key   found_key   = {};
+        hash_table_value found_value = {};
+
+        TEST_CHECK (HashTableSnapshotFind (snapshot, key.key, key.key_size,
+                                           KeyCmpFunction, &found_key,
+                                           &found_value) == HASH_TABLE_SUCCESS);
+        TEST_CHECK (found_key.key_size == key.key_size);
+        TEST_CHECK (memcmp (found_key.key, key.key, key.key_size) == 0);
+        TEST_CHECK (CheckTestValues (mode, found_value.value,
+                                     found_value.value_size, i));
+    }
+
+    SetTestKey (&key, key_buffer, TEST_LOG_KEYS);
+    TEST_CHECK (HashTableSnapshotFind (snapshot, key.key, key.key_size,
+                                       KeyCmpFunction, NULL, NULL) ==
+                HASH_TABLE_ERROR);
+
+    hash_table_t* loaded = HashTableSnapshotToTable (snapshot, KeyCmpFunction);
+    snapshot = HashTableSnapshotDestructor (snapshot);
+
+    TEST_CHECK (loaded != NULL);
+    TEST_CHECK (loaded->mode        == mode);
+    TEST_CHECK (loaded->elem_number == TEST_LOG_KEYS);
+
+    for (size_t i = 0; i < TEST_LOG_KEYS; ++i)
+    {
+        SetTestKey (&key, key_buffer, i);
+
+        const hash_table_node* const node =
+            HashTableFind (loaded, &key, KeyCmpFunction);
+        TEST_CHECK (node != NULL);
+
+        // the nodes of the set have no value
+        const void* values      = NULL;
+        size_t      values_size = 0;
+
+        if (mode == HASH_TABLE_MULTIMAP)
+        {
+            size_t found_number = 0;
+            values      = HashTableNodeValues (loaded, node, &found_number);
+            values_size = found_number * sizeof (size_t);
+        }
+
+        else if (mode == HASH_TABLE_MAP)
+        {
+            values      = node->value->value;
+            values_size = node->value->value_size;
+        }
+
+        TEST_CHECK (CheckTestValues (mode, values, values_size, i));
+    }
+
+    SetTestKey (&key, key_buffer, TEST_LOG_KEYS);
+    TEST_CHECK (HashTableFind (loaded, &key, KeyCmpFunction) == NULL);
+
+    loaded = HashTableDestructor (loaded);
+    unlink (TEST_SNAPSHOT_FILE);
+
+    return 1;
+}
+
+
+static int
+CheckTestValues (const hash_table_mode mode,
+                 const void* const values,
+                 const size_t values_size,
+                 const size_t index)
+{
+    if (mode == HASH_TABLE_SET)
+    {
+        TEST_CHECK (values_size == 0);
+        return 1;
+    }
+
+    const size_t values_number = (mode == HASH_TABLE_MULTIMAP) ?
+                                 TEST_MULTIMAP_VALUES : 1;
+
+    TEST_CHECK (values != NULL);
+    TEST_CHECK (values_size == values_number * sizeof (size_t));
+
+    for (size_t i = 0; i < values_number; ++i)
+    {
+        // the values buffer is any pointer the table or the snapshot gives
+        size_t value = 0;
+        memcpy (&value, (const char*) values + i * sizeof (size_t),
+                sizeof (value));
+
+        TEST_CHECK (value == index * TEST_MULTIMAP_VALUES + i);
+    }
+
+    return 1;
+}
+
+
+static void
+SetTestKey (hash_table_key* const key,
+            char* const key_buffer,
+            const size_t index)
+{
+    assert (key);
+    assert (key_buffer);
+
+    key->key      = key_buffer;
+    key->key_size = (size_t) snprintf (key_buffer, TEST_KEY_SIZE, "key%zu",
+                                       index);
+}
+
+
+static uint64_t
+FakeClock (void)
+{
+    ++fake_clock_calls;
+    return fake_now;
+}
+
+#undef TEST_CHECK
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Main function
+//-----------------------------------------------------------------------------
+
+int main (void)
+{
+    static const table_test tests[] =
+    {
+        {"ttl find after expiry",     TestTtlFindAfterExpiry},
+        {"ttl zero clears expiry",    TestTtlZeroClears},
+        {"disk table large values",   TestDiskLargeValues},
+        {"wal replay round trip",     TestWalReplayRoundTrip},
+        {"wal torn tail",             TestWalTornTail},
+        {"wal failed",                TestWalFailed},
+        {"snapshot round trip",       TestSnapshotRoundTrip},
+        {"snapshot corrupted header", TestSnapshotCorruptedHeader},
+        {"lru eviction order",        TestLruEvictionOrder},
+        {"multimap values order",     TestMultimapValuesOrder}
+    };
+
+    const size_t tests_number = sizeof (tests) / sizeof (tests[0]);
+    size_t failed = 0;
+
+    for (size_t i = 0; i < tests_number; ++i)
+    {
+        const int passed = tests[i].run ();
+        failed += !passed;
+
+        printf ("%-40s %s\n", tests[i].name, passed ? "ok" : "FAILED");
+    }
+
+    printf ("%zu of %zu tests passed\n", tests_number - failed, tests_number);
+
+    return (failed == 0) ? 0 : 1;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
@@ -0,0 +1,527 @@
+#include "workload.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+
+//-----------------------------------------------------------------------------
+// Consts
+//-----------------------------------------------------------------------------
+
+/// @brief Keys start with their 8-byte index
+static const size_t WORKLOAD_MIN_KEY_SIZE = sizeof (uint64_t);
+
+
+/// @brief Zeta terms summed exactly, the rest is integrated
+static const size_t WORKLOAD_ZETA_EXACT_TERMS = 1 << 20;
+
+
+/// @brief Initial capacity of the colliding candidates array
+static const size_t WORKLOAD_COLLIDING_MIN_CAPACITY = 64;
+
+
+/// @brief Letters the key tail is made of
+static const char WORKLOAD_LETTERS[] = "abcdefghijklmnopqrstuvwxyz";
+
+
+/// @brief Names of the distributions in the order of workload_distribution
+static const char* const WORKLOAD_DISTRIBUTION_NAMES[] =
+    {"uniform", "zipf", "sequential", "colliding"};
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static structures
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Workload stream
+ */
+struct workload
+{
+    workload_config config;         ///< parameters of the workload
+    uint64_t        state;          ///< random stream state
+    size_t          sequential;     ///< next index of the sequential stream
+
+    double zipf_zeta;               ///< zeta (keys_number, theta)
+    double zipf_alpha;              ///< 1 / (1 - theta)
+    double zipf_eta;                ///< constant of the inverse distribution
+    double zipf_second;             ///< 1 + 0.5^theta, rank 1 bound
+
+    uint64_t* candidates;           ///< colliding keys indexes found so far
+    size_t    candidates_number;    ///< number of the found colliding keys
+    size_t    candidates_capacity;  ///< capacity of the array
+    uint64_t  next_candidate;       ///< next index to try
+    size_t    target_bucket;        ///< bucket of the colliding keys
+};
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static functions prototypes
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Computes the zipf constants of the workload
+ */
+static void
+ZipfInit (workload* const load);
+
+
+/**
+ * @brief Returns zeta (n, theta), the first terms exactly and the tail
+ * by the integral
+ */
+static double
+Zeta (const size_t n,
+      const double theta);
+
+
+/**
+ * @brief Returns the zipf rank from 0 to keys_number - 1, 0 is the hottest
+ */
+static size_t
+ZipfNextRank (workload* const load);
+
+
+/**
+ * @brief Writes the key made of the index to the buffer
+ *
+ * @retval Size of the key
+ */
+static size_t
+MakeKey (const workload* const load,
+         const uint64_t index,
+         char* const buffer);
+
+
+/**
+ * @brief Finds colliding keys until the index-th one
+ *
+ * @retval 1 if found
+ * @retval 0 if allocation error occurred
+ */
+static int
+FindCandidates (workload* const load,
+                const size_t index);
+
+
+/**
+ * @brief Returns the next number of splitmix64
+ */
+static uint64_t
+NextSplitMix (uint64_t* const state);
+
+
+/**
+ * @brief Mixes the number, the splitmix64 finalizer
+ */
+static uint64_t
+Mix (uint64_t value);
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Workload implementation
+//-----------------------------------------------------------------------------
+
+workload*
+WorkloadConstructor (const workload_config* const config)
+{
+    if (config == NULL ||
+        config->keys_number == 0 ||
+        config->key_min < WORKLOAD_MIN_KEY_SIZE ||
+        config->key_max < config->key_min ||
+        (size_t) config->distribution >= sizeof (WORKLOAD_DISTRIBUTION_NAMES) /
+                                         sizeof (WORKLOAD_DISTRIBUTION_NAMES[0]))
+        return NULL;
+
+    if (config->distribution == WORKLOAD_ZIPF &&
+        !(config->zipf_theta > 0 && config->zipf_theta < 1))
+        return NULL;
+
+    if (config->distribution == WORKLOAD_COLLIDING &&
+        (config->h_func == NULL || config->buckets_number == 0))
+        return NULL;
+
+    workload* const load = calloc (1, sizeof (workload));
+    if (load == NULL) return NULL;
+
+    load->config = *config;
+    load->state  = config->seed;
+
+    if (config->distribution == WORKLOAD_ZIPF)
+        ZipfInit (load);
+
+    if (config->distribution == WORKLOAD_COLLIDING)
+    {
+        char* const buffer = calloc (config->key_max, sizeof (char));
+        if (buffer == NULL) return WorkloadDestructor (load);
+
+        // the bucket of the first candidate is attacked
+        hash_table_key key = {.key = buffer,
+                              .key_size = MakeKey (load, 0, buffer)};
+        load->target_bucket = config->h_func (&key, HASH_TABLE_FULL_RANGE) %
+                              config->buckets_number;
+        free (buffer);
+    }
+
+    return load;
+}
+
+
+workload*
+WorkloadDestructor (workload* const load)
+{
+    if (load == NULL) return NULL;
+
+    free (load->candidates);
+    free (load);
+
+    return NULL;
+}
+
+
+size_t
+WorkloadNextIndex (workload* const load)
+{
+    assert (load);
+
+    const size_t keys_number = load->config.keys_number;
+
+    switch (load->config.distribution)
+    {
+        case WORKLOAD_ZIPF:
+            return Mix (ZipfNextRank (load) ^ load->config.seed) % keys_number;
+
+        case WORKLOAD_SEQUENTIAL:
+        {
+            const size_t index = load->sequential;
+            load->sequential = (index + 1 == keys_number) ? 0 : index + 1;
+
+            return index;
+        }
+
+        case WORKLOAD_UNIFORM:
+        case WORKLOAD_COLLIDING:
+        default:
+            return NextSplitMix (&load->state) % keys_number;
+    }
+}
+
+
+void
+WorkloadKey (workload* const load,
+             const size_t index,
+             char* const buffer,
+             hash_table_key* const key)
+{
+    assert (load);
+    assert (buffer);
+    assert (key);
+
+    uint64_t key_index = index % load->config.keys_number;
+
+    if (load->config.distribution == WORKLOAD_COLLIDING)
+    {
+        const int found = FindCandidates (load, key_index);
+        assert (found);
+        (void) found;
+
+        key_index = load->candidates[key_index];
+    }
+
+    key->key      = buffer;
+    key->key_size = MakeKey (load, key_index, buffer);
+}
+
+
+workload_keys*
+WorkloadKeysConstructor (const workload* const load,
+                         const size_t capacity)
+{
+    assert (load);
+
+    workload_keys* const keys = calloc (1, sizeof (workload_keys));
+    if (keys == NULL) return NULL;
+
+    keys->capacity = capacity;
+    keys->offsets  = calloc (capacity + 1, sizeof (size_t));
+    keys->buffer   = calloc (capacity, load->config.key_max);
+
+    if (keys->offsets == NULL ||
+        keys->buffer  == NULL)
+        return WorkloadKeysDestructor (keys);
+
+    return keys;
+}
+
+
+void
+WorkloadKeysMake (workload* const load,
+                  workload_keys* const keys,
+                  const size_t* const indexes,
+                  const size_t keys_number)
+{
+    assert (load);
+    assert (keys);
+    assert (indexes);
+    assert (keys_number <= keys->capacity);
+
+    hash_table_key key = {0};
+
+    for (size_t i = 0; i < keys_number; ++i)
+    {
+        WorkloadKey (load, indexes[i], keys->buffer + keys->offsets[i], &key);
+        keys->offsets[i + 1] = keys->offsets[i] + key.key_size;
+    }
+
+    keys->keys_number = keys_number;
+}
+
+
+workload_keys*
+WorkloadKeysDestructor (workload_keys* const keys)
+{
+    if (keys == NULL) return NULL;
+
+    free (keys->buffer);
+    free (keys->offsets);
+    free (keys);
+
+    return NULL;
+}
+
+
+size_t
+WorkloadNext (workload* const load,
+              char* const buffer,
+              hash_table_key* const key)
+{
+    assert (load);
+
+    const size_t index = WorkloadNextIndex (load);
+    WorkloadKey (load, index, buffer, key);
+
+    return index;
+}
+
+
+int
+WorkloadParseDistribution (const char* const name,
+                           workload_distribution* const distribution)
+{
+    assert (name);
+    assert (distribution);
+
+    const size_t names_number = sizeof (WORKLOAD_DISTRIBUTION_NAMES) /
+                                sizeof (WORKLOAD_DISTRIBUTION_NAMES[0]);
+
+    for (size_t i = 0; i < names_number; ++i)
+    {
+        if (strcmp (name, WORKLOAD_DISTRIBUTION_NAMES[i]) == 0)
+        {
+            *distribution = (workload_distribution) i;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+int
+WorkloadDistributionArgument (const char* const value,
+                              void* const distribution)
+{
+    return WorkloadParseDistribution (value, distribution);
+}
+
+
+const char*
+WorkloadDistributionName (const workload_distribution distribution)
+{
+    if ((size_t) distribution >= sizeof (WORKLOAD_DISTRIBUTION_NAMES) /
+                                 sizeof (WORKLOAD_DISTRIBUTION_NAMES[0]))
+        return NULL;
+
+    return WORKLOAD_DISTRIBUTION_NAMES[distribution];
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+
+
+//-----------------------------------------------------------------------------
+// Static functions implementation
+//-----------------------------------------------------------------------------
+
+static void
+ZipfInit (workload* const load)
+{
+    assert (load);
+
+    const double n     = (double) load->config.keys_number;
+    const double theta = load->config.zipf_theta;
+
+    // Gray et al., "Quickly generating billion-record synthetic databases"
+    load->zipf_zeta   = Zeta (load->config.keys_number, theta);
+    load->zipf_alpha  = 1.0 / (1.0 - theta);
+    load->zipf_eta    = (1.0 - pow (2.0 / n, 1.0 - theta)) /
+                        (1.0 - Zeta (2, theta) / load->zipf_zeta);
+    load->zipf_second = 1.0 + pow (0.5, theta);
+}
+
+
+static double
+Zeta (const size_t n,
+      const double theta)
+{
+    const size_t exact = (n < WORKLOAD_ZETA_EXACT_TERMS) ?
+                         n : WORKLOAD_ZETA_EXACT_TERMS;
+
+    double sum = 0;
+    for (size_t i = 1; i <= exact; ++i)
+        sum += pow ((double) i, -theta);
+
+    // sum of the rest i^-theta is about the integral from exact + 1/2
+    if (n > exact)
+        sum += (pow (n + 0.5, 1.0 - theta) - pow (exact + 0.5, 1.0 - theta)) /
+               (1.0 - theta);
+
+    return sum;
+}
+
+
+static size_t
+ZipfNextRank (workload* const load)
+{
+    assert (load);
+
+    // 53 random bits to [0, 1)
+    const double uniform = (NextSplitMix (&load->state) >> 11) * 0x1.0p-53;
+    const double scaled  = uniform * load->zipf_zeta;
+
+    if (scaled < 1.0)               return 0;
+    if (scaled < load->zipf_second) return 1;
+
+    const size_t rank = (size_t) (load->config.keys_number *
+        pow (load->zipf_eta * uniform - load->zipf_eta + 1.0, load->zipf_alpha));
+
+    return (rank < load->config.keys_number) ?
+           rank : load->config.keys_number - 1;
+}
+
+
+static size_t
+MakeKey (const workload* const load,
+         const uint64_t index,
+         char* const buffer)
+{
+    assert (load);
+    assert (buffer);
+
+    const workload_config* const config = &load->config;
+    const size_t letters_number = sizeof (WORKLOAD_LETTERS) - 1;
+
+    uint64_t bits = Mix (index ^ Mix (config->seed));
+    const size_t key_size = config->key_min +
+                            bits % (config->key_max - config->key_min + 1);
+
+    memcpy (buffer, &index, sizeof (index));
+
+    for (size_t i = sizeof (index); i < key_size; ++i)
+    {
+        // one 64-bit mix gives 8 letters
+        if ((i - sizeof (index)) % sizeof (bits) == 0)
+            bits = Mix (bits + index);
+
+        buffer[i] = WORKLOAD_LETTERS[(bits >> (8 * (i % sizeof (bits)))) % 256 %
+                                     letters_number];
+    }
+
+    return key_size;
+}
+
+
+static int
+FindCandidates (workload* const load,
+                const size_t index)
+{
+    assert (load);
+
+    const workload_config* const config = &load->config;
+
+    if (index < load->candidates_number) return 1;
+
+    char* const buffer = calloc (config->key_max, sizeof (char));
+    if (buffer == NULL) return 0;
+
+    hash_table_key key = {.key = buffer, .key_size = 0};
+
+    while (load->candidates_number <= index)
+    {
+        if (load->candidates_number == load->candidates_capacity)
+        {
+            const size_t new_capacity = (load->candidates_capacity == 0) ?
+                                        WORKLOAD_COLLIDING_MIN_CAPACITY :
+                                        2 * load->candidates_capacity;
+
+            uint64_t* const new_candidates =
+                realloc (load->candidates, new_capacity * sizeof (uint64_t));
+            if (new_candidates == NULL)
+            {
+                free (buffer);
+                return 0;
+            }
+
+            load->candidates          = new_candidates;
+            load->candidates_capacity = new_capacity;
+        }
+
+        const uint64_t candidate = load->next_candidate++;
+        key.key_size = MakeKey (load, candidate, buffer);
+
+        if (config->h_func (&key, HASH_TABLE_FULL_RANGE) %
+            config->buckets_number == load->target_bucket)
+            load->candidates[load->candidates_number++] = candidate;
+    }
+
+    free (buffer);
+    return 1;
+}
+
+
+static uint64_t
+NextSplitMix (uint64_t* const state)
+{
+    assert (state);
+
+    *state += 0x9E3779B97F4A7C15;
+    return Mix (*state);
+}
+
+
+static uint64_t
+Mix (uint64_t value)
+{
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EB;
+
+    return value ^ (value >> 31);
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------